@@ -0,0 +1,284 @@
+/**
+ * @file addrcodec.cpp
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief C++ Python Extension for Base58Check and Bech32 address encoding.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "address.h"
+#include "metrics.h"
+#include "pymodule.h"
+
+ /* The encoding itself lives in address.h so other extensions (the
+    vanity search) can use it too.
+
+    The *_many functions take payloads back to back in one bytes object
+    (all the same size) and return a list of strings, releasing the GIL
+    while hashing and encoding. p2pkh_many and p2wpkh_many go from
+    public keys to addresses in one call, hashing 8 keys at a time with
+    the multi-buffer SHA-256 from sha256.h.
+ */
+
+using namespace address;
+
+static PyObject *string_list(const std::vector<std::string> &strings) {
+    PyObject *result = PyList_New((Py_ssize_t)strings.size());
+    for (size_t i = 0; result && i < strings.size(); ++i) {
+        PyObject *item = PyUnicode_FromStringAndSize(strings[i].data(), (Py_ssize_t)strings[i].size());
+        if (!item) {
+            Py_CLEAR(result);
+            break;
+        }
+        PyList_SET_ITEM(result, (Py_ssize_t)i, item);
+    }
+    return result;
+}
+
+/**
+ * @brief Checks that a buffer holds whole items of size bytes.
+ */
+static bool check_items(const Py_buffer &buf, Py_ssize_t size) {
+    if (size <= 0 || buf.len % size) {
+        PyErr_SetString(PyExc_ValueError, "data must be a whole number of items of the given size.");
+        return false;
+    }
+    return true;
+}
+
+static PyObject *addrcodec_hash160(PyObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    Py_buffer data;
+    if (!check_nargs("hash160", nargs, 1) || !read_buffer(args[0], &data))
+        return NULL;
+    uint8_t out[20];
+    METRICS_INC(HASHES);
+    ripemd160::hash160(static_cast<const uint8_t *>(data.buf), data.len, out);
+    PyBuffer_Release(&data);
+    return PyBytes_FromStringAndSize(reinterpret_cast<char *>(out), 20);
+}
+
+static PyObject *addrcodec_hash160_many(PyObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    Py_buffer data;
+    Py_ssize_t size;
+    if (!parse_args(args, nargs, "y*n:hash160_many", &data, &size))
+        return NULL;
+    PyObject *result = NULL;
+    if (check_items(data, size)) {
+        size_t count = data.len / size;
+        result = PyBytes_FromStringAndSize(NULL, (Py_ssize_t)count * 20);
+        if (result) {
+            METRICS_ADD(HASHES, count);
+            uint8_t *out = reinterpret_cast<uint8_t *>(PyBytes_AS_STRING(result));
+            Py_BEGIN_ALLOW_THREADS
+            hash160_many(static_cast<const uint8_t *>(data.buf), size, count, out);
+            Py_END_ALLOW_THREADS
+        }
+    }
+    PyBuffer_Release(&data);
+    return result;
+}
+
+static PyObject *addrcodec_b58check_encode(PyObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    Py_buffer data;
+    if (!check_nargs("b58check_encode", nargs, 1) || !read_buffer(args[0], &data))
+        return NULL;
+    std::string out = b58check_encode(NULL, 0, static_cast<const uint8_t *>(data.buf), data.len);
+    PyBuffer_Release(&data);
+    return PyUnicode_FromStringAndSize(out.data(), (Py_ssize_t)out.size());
+}
+
+static PyObject *addrcodec_b58check_decode(PyObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    const char *text;
+    Py_ssize_t len;
+    if (!check_nargs("b58check_decode", nargs, 1) || !read_str(args[0], &text, &len))
+        return NULL;
+    std::vector<uint8_t> data;
+    if (!b58_decode(text, len, data)) {
+        PyErr_SetString(PyExc_ValueError, "Invalid base58 character.");
+        return NULL;
+    }
+    uint8_t digest[32];
+    METRICS_INC(HASHES);
+    if (data.size() < 4
+        || (sha256::sha256d(data.data(), data.size() - 4, digest), std::memcmp(digest, &data[data.size() - 4], 4))) {
+        PyErr_SetString(PyExc_ValueError, "Invalid checksum.");
+        return NULL;
+    }
+    return PyBytes_FromStringAndSize(reinterpret_cast<char *>(data.data()), (Py_ssize_t)data.size() - 4);
+}
+
+static PyObject *addrcodec_b58check_encode_many(PyObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    Py_buffer data, prefix = {NULL, NULL};
+    Py_ssize_t size;
+    if (!parse_args(args, nargs, "y*n|y*:b58check_encode_many", &data, &size, &prefix))
+        return NULL;
+    PyObject *result = NULL;
+    if (check_items(data, size)) {
+        size_t count = data.len / size;
+        std::vector<std::string> out(count);
+        const uint8_t *p = static_cast<const uint8_t *>(data.buf);
+        METRICS_ADD(HASHES, count);
+        Py_BEGIN_ALLOW_THREADS
+        for (size_t i = 0; i < count; ++i)
+            out[i] = b58check_encode(static_cast<const uint8_t *>(prefix.buf), prefix.buf ? prefix.len : 0,
+                                     p + size * i, size);
+        Py_END_ALLOW_THREADS
+        result = string_list(out);
+    }
+    PyBuffer_Release(&data);
+    if (prefix.buf)
+        PyBuffer_Release(&prefix);
+    return result;
+}
+
+static PyObject *addrcodec_segwit_encode(PyObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    const char *hrp;
+    int version;
+    Py_buffer program;
+    if (!parse_args(args, nargs, "siy*:segwit_encode", &hrp, &version, &program))
+        return NULL;
+    PyObject *result = NULL;
+    if (valid_program(version, program.len)) {
+        std::string out = segwit_encode(hrp, version, static_cast<const uint8_t *>(program.buf), program.len);
+        result = PyUnicode_FromStringAndSize(out.data(), (Py_ssize_t)out.size());
+    } else {
+        PyErr_SetString(PyExc_ValueError, "Invalid witness program.");
+    }
+    PyBuffer_Release(&program);
+    return result;
+}
+
+static PyObject *addrcodec_segwit_decode(PyObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    const char *hrp, *addr;
+    if (!parse_args(args, nargs, "ss:segwit_decode", &hrp, &addr))
+        return NULL;
+    int version;
+    std::vector<uint8_t> program;
+    if (!segwit_decode(hrp, addr, version, program)) {
+        PyErr_SetString(PyExc_ValueError, "Invalid segwit address.");
+        return NULL;
+    }
+    return Py_BuildValue("(iy#)", version, program.data(), (Py_ssize_t)program.size());
+}
+
+static PyObject *addrcodec_segwit_encode_many(PyObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    const char *hrp;
+    int version;
+    Py_buffer programs;
+    Py_ssize_t size;
+    if (!parse_args(args, nargs, "siy*n:segwit_encode_many", &hrp, &version, &programs, &size))
+        return NULL;
+    PyObject *result = NULL;
+    if (check_items(programs, size) && !valid_program(version, size)) {
+        PyErr_SetString(PyExc_ValueError, "Invalid witness program.");
+    } else if (!PyErr_Occurred()) {
+        size_t count = programs.len / size;
+        std::vector<std::string> out(count);
+        std::string h = hrp;
+        const uint8_t *p = static_cast<const uint8_t *>(programs.buf);
+        Py_BEGIN_ALLOW_THREADS
+        for (size_t i = 0; i < count; ++i)
+            out[i] = segwit_encode(h, version, p + size * i, size);
+        Py_END_ALLOW_THREADS
+        result = string_list(out);
+    }
+    PyBuffer_Release(&programs);
+    return result;
+}
+
+static PyObject *addrcodec_p2pkh_many(PyObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    Py_buffer pubkeys;
+    Py_ssize_t size = 33;
+    unsigned char version = 0;
+    if (!parse_args(args, nargs, "y*|nb:p2pkh_many", &pubkeys, &size, &version))
+        return NULL;
+    PyObject *result = NULL;
+    if (check_items(pubkeys, size)) {
+        size_t count = pubkeys.len / size;
+        std::vector<std::string> out(count);
+        std::vector<uint8_t> hashes(count * 20);
+        METRICS_ADD(HASHES, 2 * count);  // hash160 and the base58 checksum.
+        Py_BEGIN_ALLOW_THREADS
+        hash160_many(static_cast<const uint8_t *>(pubkeys.buf), size, count, hashes.data());
+        for (size_t i = 0; i < count; ++i)
+            out[i] = b58check_encode(&version, 1, &hashes[20 * i], 20);
+        Py_END_ALLOW_THREADS
+        result = string_list(out);
+    }
+    PyBuffer_Release(&pubkeys);
+    return result;
+}
+
+static PyObject *addrcodec_p2wpkh_many(PyObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    Py_buffer pubkeys;
+    const char *hrp = "bc";
+    if (!parse_args(args, nargs, "y*|s:p2wpkh_many", &pubkeys, &hrp))
+        return NULL;
+    PyObject *result = NULL;
+    if (check_items(pubkeys, 33)) {
+        size_t count = pubkeys.len / 33;
+        std::vector<std::string> out(count);
+        std::vector<uint8_t> hashes(count * 20);
+        std::string h = hrp;
+        METRICS_ADD(HASHES, count);
+        Py_BEGIN_ALLOW_THREADS
+        hash160_many(static_cast<const uint8_t *>(pubkeys.buf), 33, count, hashes.data());
+        for (size_t i = 0; i < count; ++i)
+            out[i] = segwit_encode(h, 0, &hashes[20 * i], 20);
+        Py_END_ALLOW_THREADS
+        result = string_list(out);
+    }
+    PyBuffer_Release(&pubkeys);
+    return result;
+}
+
+static PyMethodDef addrcodec_methods[] = {
+    {"hash160", (PyCFunction)(void (*)(void))addrcodec_hash160, METH_FASTCALL, "RIPEMD-160 of the SHA-256 of data."},
+    {"hash160_many", (PyCFunction)(void (*)(void))addrcodec_hash160_many, METH_FASTCALL,
+     "HASH160 of every item of size bytes in data, concatenated."},
+    {"b58check_encode", (PyCFunction)(void (*)(void))addrcodec_b58check_encode, METH_FASTCALL,
+     "Base58 of data and its checksum."},
+    {"b58check_decode", (PyCFunction)(void (*)(void))addrcodec_b58check_decode, METH_FASTCALL,
+     "The data of a Base58Check string."},
+    {"b58check_encode_many", (PyCFunction)(void (*)(void))addrcodec_b58check_encode_many, METH_FASTCALL,
+     "Base58Check of prefix + every item of size bytes in data."},
+    {"segwit_encode", (PyCFunction)(void (*)(void))addrcodec_segwit_encode, METH_FASTCALL,
+     "Bech32 (version 0) or Bech32m address of a witness program."},
+    {"segwit_decode", (PyCFunction)(void (*)(void))addrcodec_segwit_decode, METH_FASTCALL,
+     "The (version, program) of a segwit address."},
+    {"segwit_encode_many", (PyCFunction)(void (*)(void))addrcodec_segwit_encode_many, METH_FASTCALL,
+     "Segwit addresses of every program of size bytes in programs."},
+    {"p2pkh_many", (PyCFunction)(void (*)(void))addrcodec_p2pkh_many, METH_FASTCALL,
+     "P2PKH addresses of public keys of size bytes each."},
+    {"p2wpkh_many", (PyCFunction)(void (*)(void))addrcodec_p2wpkh_many, METH_FASTCALL,
+     "P2WPKH addresses of 33-byte public keys."},
+    METRICS_METHODS,
+    {NULL, NULL, 0, NULL}
+};
+
+static PyModuleDef_Slot addrcodec_slots[] = {
+    MODULE_SLOTS
+    {0, NULL}
+};
+
+static struct PyModuleDef addrcodec = {
+    PyModuleDef_HEAD_INIT,
+    "addrcodec",
+    NULL,
+    0,
+    addrcodec_methods,
+    addrcodec_slots
+};
+
+PyMODINIT_FUNC PyInit_addrcodec(void) {
+    return PyModuleDef_Init(&addrcodec);
+}
@@ -0,0 +1,13 @@
+def hash160(data: bytes) -> bytes: ...
+def hash160_many(data: bytes, size: int) -> bytes: ...
+def b58check_encode(data: bytes) -> str: ...
+def b58check_decode(text: str) -> bytes: ...
+def b58check_encode_many(data: bytes, size: int, prefix: bytes = ...) -> list[str]: ...
+def segwit_encode(hrp: str, version: int, program: bytes) -> str: ...
+def segwit_decode(hrp: str, address: str) -> tuple[int, bytes]: ...
+def segwit_encode_many(hrp: str, version: int, programs: bytes, size: int) -> list[str]: ...
+def p2pkh_many(pubkeys: bytes, size: int = ..., version: int = ...) -> list[str]: ...
+def p2wpkh_many(pubkeys: bytes, hrp: str = ...) -> list[str]: ...
+def _metrics() -> dict: ...
+def _metrics_reset() -> None: ...
+def _metrics_enable(flag: bool) -> None: ...
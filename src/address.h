@@ -0,0 +1,272 @@
+/**
+ * @file address.h
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief Header-only Base58Check and Bech32/Bech32m encoding shared by the extensions.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef PYCOIN_ADDRESS_H
+#define PYCOIN_ADDRESS_H
+
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "ripemd160.h"
+#include "sha256.h"
+
+ /* Base58 treats the whole payload as one big number and writes it in
+    base 58, so every output digit depends on every input byte and the
+    conversion is quadratic. What can be cut is the constant: instead of
+    dividing the number by 58 one byte at a time (once per digit), the
+    number is kept in limbs of 58^5 (which fits in 32 bits) and built up
+    from the input 32 bits at a time, each step multiplying every limb
+    by 2^32 in 64-bit arithmetic. That is about 20 times fewer
+    operations for a 25-byte address, and each limb then gives five
+    digits. Decoding runs the other way: groups of five digits are
+    folded into 32-bit limbs by multiplying with 58^5.
+
+    Bech32 (BIP173, for witness version 0) and Bech32m (BIP350, for
+    version 1 and later) only differ in the constant the checksum is
+    xored with. The checksum is a BCH code over 5-bit groups, computed
+    with the polymod function from the BIPs.
+
+    References:
+        - https://github.com/bitcoin/bips/blob/master/bip-0173.mediawiki
+        - https://github.com/bitcoin/bips/blob/master/bip-0350.mediawiki
+ */
+
+#define B58_LIMB 656356768U  // 58^5
+#define BECH32_CONST 1U
+#define BECH32M_CONST 0x2BC830A3U
+#define BECH32_MAX_LENGTH 90
+
+namespace address {
+
+static const char B58_ALPHABET[] = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+static const char BECH32_CHARSET[] = "qpzry9x8gf2tvdw0s3jn54khce6mua7l";
+
+inline int8_t b58_value(char c) {
+    const char *p = std::strchr(B58_ALPHABET, c);
+    return c && p ? (int8_t)(p - B58_ALPHABET) : -1;
+}
+
+inline std::string b58_encode(const uint8_t *data, size_t len) {
+    size_t zeros = 0;
+    while (zeros < len && data[zeros] == 0)
+        ++zeros;
+    std::vector<uint32_t> limbs;  // Base 58^5, least significant first.
+    size_t head = (len - zeros) % 4;
+    for (size_t i = zeros; i < len;) {
+        size_t take = i == zeros && head ? head : 4;
+        uint64_t carry = 0;
+        for (size_t j = 0; j < take; ++j)
+            carry = carry << 8 | data[i + j];
+        i += take;
+        for (uint32_t &limb : limbs) {
+            carry += (uint64_t)limb << (8 * take);
+            limb = (uint32_t)(carry % B58_LIMB);
+            carry /= B58_LIMB;
+        }
+        for (; carry; carry /= B58_LIMB)
+            limbs.push_back((uint32_t)(carry % B58_LIMB));
+    }
+    std::string out(zeros, '1');
+    size_t start = out.size();
+    for (size_t i = limbs.size(); i-- > 0;) {
+        char digits[5];
+        uint32_t v = limbs[i];
+        for (int j = 4; j >= 0; --j, v /= 58)
+            digits[j] = B58_ALPHABET[v % 58];
+        out.append(digits, 5);
+    }
+    size_t first = out.find_first_not_of('1', start);
+    out.erase(start, (first == std::string::npos ? out.size() : first) - start);
+    return out;
+}
+
+inline bool b58_decode(const char *text, size_t len, std::vector<uint8_t> &out) {
+    size_t ones = 0;
+    while (ones < len && text[ones] == '1')
+        ++ones;
+    std::vector<uint32_t> limbs;  // Base 2^32, least significant first.
+    size_t head = (len - ones) % 5;
+    for (size_t i = ones; i < len;) {
+        size_t take = i == ones && head ? head : 5;
+        uint64_t carry = 0, scale = 1;
+        for (size_t j = 0; j < take; ++j) {
+            int8_t v = b58_value(text[i + j]);
+            if (v < 0)
+                return false;
+            carry = carry * 58 + v;
+            scale *= 58;
+        }
+        i += take;
+        for (uint32_t &limb : limbs) {
+            carry += limb * scale;
+            limb = (uint32_t)carry;
+            carry >>= 32;
+        }
+        for (; carry; carry >>= 32)
+            limbs.push_back((uint32_t)carry);
+    }
+    out.assign(ones, 0);
+    bool leading = true;
+    for (size_t i = limbs.size(); i-- > 0;) {
+        for (int j = 3; j >= 0; --j) {
+            uint8_t byte = (uint8_t)(limbs[i] >> (8 * j));
+            if (leading && byte == 0)
+                continue;
+            leading = false;
+            out.push_back(byte);
+        }
+    }
+    return true;
+}
+
+inline std::string b58check_encode(const uint8_t *prefix, size_t plen, const uint8_t *data, size_t len) {
+    std::vector<uint8_t> buf(plen + len + 4);
+    if (plen)
+        std::memcpy(buf.data(), prefix, plen);
+    std::memcpy(buf.data() + plen, data, len);
+    uint8_t digest[32];
+    sha256::sha256d(buf.data(), plen + len, digest);
+    std::memcpy(buf.data() + plen + len, digest, 4);
+    return b58_encode(buf.data(), buf.size());
+}
+
+inline uint32_t polymod(const std::vector<uint8_t> &values) {
+    static const uint32_t GEN[5] = {0x3B6A57B2, 0x26508E6D, 0x1EA119FA, 0x3D4233DD, 0x2A1462B3};
+    uint32_t chk = 1;
+    for (uint8_t v : values) {
+        uint8_t top = chk >> 25;
+        chk = (chk & 0x1FFFFFF) << 5 ^ v;
+        for (int i = 0; i < 5; ++i)
+            if (top >> i & 1)
+                chk ^= GEN[i];
+    }
+    return chk;
+}
+
+inline std::vector<uint8_t> hrp_expand(const std::string &hrp) {
+    std::vector<uint8_t> out;
+    for (char c : hrp)
+        out.push_back((uint8_t)c >> 5);
+    out.push_back(0);
+    for (char c : hrp)
+        out.push_back((uint8_t)c & 31);
+    return out;
+}
+
+inline bool convert_bits(std::vector<uint8_t> &out, const uint8_t *in, size_t len, int from, int to, bool pad) {
+    uint32_t acc = 0, maxv = (1U << to) - 1;
+    int bits = 0;
+    for (size_t i = 0; i < len; ++i) {
+        acc = acc << from | in[i];
+        bits += from;
+        while (bits >= to) {
+            bits -= to;
+            out.push_back((acc >> bits) & maxv);
+        }
+    }
+    if (pad && bits)
+        out.push_back((acc << (to - bits)) & maxv);
+    else if (!pad && (bits >= from || ((acc << (to - bits)) & maxv)))
+        return false;
+    return true;
+}
+
+inline bool valid_program(int version, size_t len) {
+    return version >= 0 && version <= 16 && len >= 2 && len <= 40 && (version != 0 || len == 20 || len == 32);
+}
+
+inline std::string segwit_encode(const std::string &hrp, int version, const uint8_t *program, size_t len) {
+    std::vector<uint8_t> data{(uint8_t)version};
+    convert_bits(data, program, len, 8, 5, true);
+    std::vector<uint8_t> values = hrp_expand(hrp);
+    values.insert(values.end(), data.begin(), data.end());
+    values.resize(values.size() + 6, 0);
+    uint32_t mod = polymod(values) ^ (version == 0 ? BECH32_CONST : BECH32M_CONST);
+    std::string out = hrp + "1";
+    for (uint8_t d : data)
+        out += BECH32_CHARSET[d];
+    for (int i = 0; i < 6; ++i)
+        out += BECH32_CHARSET[(mod >> (5 * (5 - i))) & 31];
+    return out;
+}
+
+inline bool segwit_decode(const std::string &hrp, std::string addr, int &version, std::vector<uint8_t> &program) {
+    bool lower = false, upper = false;
+    for (char c : addr) {
+        if (c < 33 || c > 126)
+            return false;
+        lower |= std::islower((unsigned char)c) != 0;
+        upper |= std::isupper((unsigned char)c) != 0;
+    }
+    if ((lower && upper) || addr.size() > BECH32_MAX_LENGTH)
+        return false;
+    for (char &c : addr)
+        c = (char)std::tolower((unsigned char)c);
+    size_t sep = addr.rfind('1');
+    if (sep == std::string::npos || sep == 0 || sep + 7 > addr.size() || addr.substr(0, sep) != hrp)
+        return false;
+    std::vector<uint8_t> data;
+    for (size_t i = sep + 1; i < addr.size(); ++i) {
+        const char *p = std::strchr(BECH32_CHARSET, addr[i]);
+        if (!p)
+            return false;
+        data.push_back((uint8_t)(p - BECH32_CHARSET));
+    }
+    std::vector<uint8_t> values = hrp_expand(hrp);
+    values.insert(values.end(), data.begin(), data.end());
+    version = data[0];
+    if (polymod(values) != (version == 0 ? BECH32_CONST : BECH32M_CONST))
+        return false;
+    program.clear();
+    return convert_bits(program, data.data() + 1, data.size() - 7, 5, 8, false)
+        && valid_program(version, program.size());
+}
+
+/**
+ * @brief HASH160 of count items of size bytes each, 8 at a time through the
+ * multi-buffer SHA-256 when an item fits in one block.
+ */
+inline void hash160_many(const uint8_t *data, size_t size, size_t count, uint8_t *out) {
+    if (size > 55) {
+        for (size_t i = 0; i < count; ++i)
+            ripemd160::hash160(data + size * i, size, out + 20 * i);
+        return;
+    }
+    uint8_t blocks[SHA256_LANES][64], digest[32];
+    const uint8_t *ptrs[SHA256_LANES];
+    uint32_t s[8][SHA256_LANES];
+    for (size_t base = 0; base < count; base += SHA256_LANES) {
+        size_t n = count - base < SHA256_LANES ? count - base : SHA256_LANES;
+        for (int l = 0; l < SHA256_LANES; ++l) {
+            std::memset(blocks[l], 0, 64);
+            if ((size_t)l < n)
+                std::memcpy(blocks[l], data + size * (base + l), size);
+            blocks[l][size] = 0x80;
+            sha256::store_be64(blocks[l] + 56, (uint64_t)size << 3);
+            ptrs[l] = blocks[l];
+            for (int i = 0; i < 8; ++i)
+                s[i][l] = sha256::IV[i];
+        }
+        sha256::transform_lanes(s, ptrs);
+        for (size_t l = 0; l < n; ++l) {
+            for (int i = 0; i < 8; ++i)
+                sha256::store_be32(digest + 4 * i, s[i][l]);
+            ripemd160::hash(digest, 32, out + 20 * (base + l));
+        }
+    }
+}
+
+}  // namespace address
+
+#endif  // PYCOIN_ADDRESS_H
@@ -0,0 +1,185 @@
+"""Bitcoin addresses: Base58Check (P2PKH) and Bech32/Bech32m (segwit).
+
+When the addrcodec extension is built, encoding and HASH160 run
+natively, and the *_many functions turn a whole batch of public keys
+(or hashes) into addresses in one call; see addrcodec.cpp. Otherwise
+the pure-Python versions below are used, with the same interface.
+
+Batches are passed as one bytes object holding the items back to back
+(33 bytes per compressed public key, 20 or 32 per witness program),
+which is what wallet.derive_public_range() returns.
+
+References:
+    - https://en.bitcoin.it/wiki/Base58Check_encoding
+    - https://github.com/bitcoin/bips/blob/master/bip-0173.mediawiki
+    - https://github.com/bitcoin/bips/blob/master/bip-0350.mediawiki
+"""
+
+from __future__ import annotations
+
+import hashlib
+
+from .utils import sha256d
+
+try:
+    from . import addrcodec  # type: ignore
+except ImportError:
+    addrcodec = None
+
+B58_ALPHABET = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz"
+BECH32_CHARSET = "qpzry9x8gf2tvdw0s3jn54khce6mua7l"
+BECH32_CONST, BECH32M_CONST = 1, 0x2BC830A3
+P2PKH_VERSION, P2PKH_TESTNET_VERSION = 0x00, 0x6F
+
+
+def py_hash160(data: bytes) -> bytes:
+    # Needs OpenSSL's RIPEMD-160, which is not always there (addrcodec has its own).
+    return hashlib.new("ripemd160", hashlib.sha256(data).digest()).digest()
+
+
+def py_hash160_many(data: bytes, size: int) -> bytes:
+    if size <= 0 or len(data) % size:
+        raise ValueError("data must be a whole number of items of the given size.")
+    return b"".join(py_hash160(data[i : i + size]) for i in range(0, len(data), size))
+
+
+def py_b58check_encode(data: bytes) -> str:
+    data += sha256d(data)[:4]
+    value = int.from_bytes(data, "big")
+    digits = []
+    while value:
+        value, digit = divmod(value, 58)
+        digits.append(B58_ALPHABET[digit])
+    zeros = len(data) - len(data.lstrip(b"\x00"))
+    return "1" * zeros + "".join(reversed(digits))
+
+
+def py_b58check_decode(text: str) -> bytes:
+    value = 0
+    for char in text:
+        if char not in B58_ALPHABET:
+            raise ValueError("Invalid base58 character.")
+        value = value * 58 + B58_ALPHABET.index(char)
+    zeros = len(text) - len(text.lstrip("1"))
+    data = bytes(zeros) + value.to_bytes((value.bit_length() + 7) // 8, "big")
+    payload, checksum = data[:-4], data[-4:]
+    if len(data) < 4 or sha256d(payload)[:4] != checksum:
+        raise ValueError("Invalid checksum.")
+    return payload
+
+
+def py_b58check_encode_many(data: bytes, size: int, prefix: bytes = b"") -> list[str]:
+    if size <= 0 or len(data) % size:
+        raise ValueError("data must be a whole number of items of the given size.")
+    return [py_b58check_encode(prefix + data[i : i + size]) for i in range(0, len(data), size)]
+
+
+def _polymod(values: list[int]) -> int:
+    generator = [0x3B6A57B2, 0x26508E6D, 0x1EA119FA, 0x3D4233DD, 0x2A1462B3]
+    chk = 1
+    for value in values:
+        top = chk >> 25
+        chk = (chk & 0x1FFFFFF) << 5 ^ value
+        for i in range(5):
+            if top >> i & 1:
+                chk ^= generator[i]
+    return chk
+
+
+def _hrp_expand(hrp: str) -> list[int]:
+    return [ord(c) >> 5 for c in hrp] + [0] + [ord(c) & 31 for c in hrp]
+
+
+def _convert_bits(data: bytes | list[int], frombits: int, tobits: int, pad: bool) -> list[int] | None:
+    acc, bits, out, maxv = 0, 0, [], (1 << tobits) - 1
+    for value in data:
+        acc = (acc << frombits | value) & 0xFFFFFFFF
+        bits += frombits
+        while bits >= tobits:
+            bits -= tobits
+            out.append(acc >> bits & maxv)
+    if pad and bits:
+        out.append(acc << (tobits - bits) & maxv)
+    elif not pad and (bits >= frombits or acc << (tobits - bits) & maxv):
+        return None
+    return out
+
+
+def _valid_program(version: int, size: int) -> bool:
+    return 0 <= version <= 16 and 2 <= size <= 40 and (version != 0 or size in {20, 32})
+
+
+def py_segwit_encode(hrp: str, version: int, program: bytes) -> str:
+    if not _valid_program(version, len(program)):
+        raise ValueError("Invalid witness program.")
+    data = [version] + _convert_bits(program, 8, 5, True)  # type: ignore
+    const = BECH32_CONST if version == 0 else BECH32M_CONST
+    mod = _polymod(_hrp_expand(hrp) + data + [0] * 6) ^ const
+    checksum = [mod >> 5 * (5 - i) & 31 for i in range(6)]
+    return hrp + "1" + "".join(BECH32_CHARSET[d] for d in data + checksum)
+
+
+def py_segwit_decode(hrp: str, address: str) -> tuple[int, bytes]:
+    invalid = ValueError("Invalid segwit address.")
+    if address.lower() != address and address.upper() != address or len(address) > 90:
+        raise invalid
+    address = address.lower()
+    prefix, _, rest = address.rpartition("1")
+    if prefix != hrp or len(rest) < 7 or any(c not in BECH32_CHARSET for c in rest):
+        raise invalid
+    data = [BECH32_CHARSET.index(c) for c in rest]
+    version = data[0]
+    const = BECH32_CONST if version == 0 else BECH32M_CONST
+    if _polymod(_hrp_expand(hrp) + data) != const:
+        raise invalid
+    program = _convert_bits(data[1:-6], 5, 8, False)
+    if program is None or not _valid_program(version, len(program)):
+        raise invalid
+    return version, bytes(program)
+
+
+def py_segwit_encode_many(hrp: str, version: int, programs: bytes, size: int) -> list[str]:
+    if size <= 0 or len(programs) % size:
+        raise ValueError("data must be a whole number of items of the given size.")
+    return [py_segwit_encode(hrp, version, programs[i : i + size]) for i in range(0, len(programs), size)]
+
+
+def py_p2pkh_many(pubkeys: bytes, size: int = 33, version: int = P2PKH_VERSION) -> list[str]:
+    return py_b58check_encode_many(py_hash160_many(pubkeys, size), 20, bytes([version]))
+
+
+def py_p2wpkh_many(pubkeys: bytes, hrp: str = "bc") -> list[str]:
+    return py_segwit_encode_many(hrp, 0, py_hash160_many(pubkeys, 33), 20)
+
+
+if addrcodec is not None:
+    hash160 = addrcodec.hash160
+    hash160_many = addrcodec.hash160_many
+    b58check_encode = addrcodec.b58check_encode
+    b58check_decode = addrcodec.b58check_decode
+    b58check_encode_many = addrcodec.b58check_encode_many
+    segwit_encode = addrcodec.segwit_encode
+    segwit_decode = addrcodec.segwit_decode
+    segwit_encode_many = addrcodec.segwit_encode_many
+    p2pkh_many = addrcodec.p2pkh_many
+    p2wpkh_many = addrcodec.p2wpkh_many
+else:
+    hash160 = py_hash160
+    hash160_many = py_hash160_many
+    b58check_encode = py_b58check_encode
+    b58check_decode = py_b58check_decode
+    b58check_encode_many = py_b58check_encode_many
+    segwit_encode = py_segwit_encode
+    segwit_decode = py_segwit_decode
+    segwit_encode_many = py_segwit_encode_many
+    p2pkh_many = py_p2pkh_many
+    p2wpkh_many = py_p2wpkh_many
+
+
+def p2pkh(pubkey: bytes, testnet: bool = False) -> str:
+    version = P2PKH_TESTNET_VERSION if testnet else P2PKH_VERSION
+    return b58check_encode(bytes([version]) + hash160(pubkey))
+
+
+def p2wpkh(pubkey: bytes, hrp: str = "bc") -> str:
+    return segwit_encode(hrp, 0, hash160(pubkey))
@@ -0,0 +1,845 @@
+/**
+ * @file addrman.cpp
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief C++ Python Extension for keeping track of peer addresses.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <arpa/inet.h>
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "memory.h"
+#include "pymodule.h"
+#include "sha256.h"
+#include "siphash.h"
+
+ /* Addresses are kept in two tables, the same way Bitcoin Core does:
+
+        - new: addresses we have heard of but never connected to, in
+          buckets chosen by the network group of the address together
+          with the group of the peer that told us about it, so a single
+          peer (or network) cannot fill the table, and
+        - tried: addresses we have connected to at least once, in
+          buckets chosen by the group of the address itself.
+
+    Bucket and slot positions come from SipHash under a secret key, so
+    nobody can predict where an address will land. A slot holds one
+    entry; when a new address collides with an old one, the old one
+    only makes room if it looks useless (IsTerrible() in Core).
+
+    Entries live in one flat vector (with a free list) instead of one
+    Python object each, and every table also keeps a dense list of its
+    entries. Selection picks a uniformly random entry from a list and
+    accepts it with a probability based on how fresh it is and how
+    often connecting to it failed, raising the odds by 1.2x after every
+    rejection (like Core), so it takes O(1) expected time however empty
+    the tables are.
+
+    save() writes every entry as a fixed-size record, followed by a
+    checksum. Positions are not stored, they follow from the key.
+
+    References:
+        - https://github.com/bitcoin/bitcoin/blob/master/src/addrman.cpp
+ */
+
+#define DEFAULT_NEW_BUCKETS 1024
+#define DEFAULT_TRIED_BUCKETS 256
+#define DEFAULT_BUCKET_SIZE 64
+#define TRIED_BUCKETS_PER_GROUP 8
+#define NEW_BUCKETS_PER_SOURCE_GROUP 64
+#define HORIZON_DAYS 30           // Addresses not seen for this long are useless.
+#define RETRIES 3                 // Failures (without ever succeeding) before that.
+#define MAX_FAILURES 10           // Failures in a week (after succeeding) before that.
+#define MIN_FAIL_DAYS 7
+#define ADDR_VERSION 1
+#define RECORD_SIZE 57
+#define DAY 86400
+
+typedef std::array<uint8_t, 18> AddrKey;  // IPv6 (or IPv4 mapped) address and port.
+
+struct Entry {
+    AddrKey addr;
+    uint8_t source[16];
+    uint64_t services;
+    uint32_t time, last_try, last_success;
+    uint16_t attempts;
+    bool used, tried;
+    int32_t position;  // Index in its table.
+    int32_t dense;     // Index in its table's list.
+};
+
+typedef memory::Vector<int32_t, memory::ADDRMAN> Indices;
+
+struct Table {
+    Indices slots;  // Entry index or -1.
+    Indices list;   // Every entry in the table.
+};
+
+struct AddrMan {
+    uint64_t k0, k1;
+    uint32_t new_buckets, tried_buckets, bucket_size;
+    memory::Vector<Entry, memory::ADDRMAN> entries;
+    Indices free;
+    Table new_table, tried_table;
+    std::mt19937_64 rng;
+
+    struct Hasher {
+        const AddrMan *man;
+        size_t operator()(const AddrKey &a) const { return siphash::hash(man->k0, man->k1, a.data(), a.size()); }
+    };
+    std::unordered_map<AddrKey, int32_t, Hasher, std::equal_to<AddrKey>,
+                       memory::Allocator<std::pair<const AddrKey, int32_t>, memory::ADDRMAN>>
+        index;
+
+    AddrMan(uint64_t k0, uint64_t k1, uint32_t nb, uint32_t tb, uint32_t bs)
+        : k0(k0), k1(k1), new_buckets(nb), tried_buckets(tb), bucket_size(bs), rng(k0 ^ k1),
+          index(16, Hasher{this}) {
+        new_table.slots.assign((size_t)nb * bs, -1);
+        tried_table.slots.assign((size_t)tb * bs, -1);
+    }
+};
+
+static bool is_ipv4(const uint8_t *ip) {
+    static const uint8_t prefix[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF};
+    return std::memcmp(ip, prefix, 12) == 0;
+}
+
+/**
+ * @brief Network group of an address (/16 for IPv4, /32 for IPv6).
+ */
+static size_t group(const uint8_t *ip, uint8_t *out) {
+    if (is_ipv4(ip)) {
+        out[0] = 4, out[1] = ip[12], out[2] = ip[13];
+        return 3;
+    }
+    out[0] = 6;
+    std::memcpy(out + 1, ip, 4);
+    return 5;
+}
+
+/**
+ * @brief Small fixed buffer for the data hashed to find a position.
+ */
+struct HashInput {
+    uint8_t data[32];
+    size_t len = 0;
+
+    HashInput &add(const void *p, size_t n) {
+        std::memcpy(data + len, p, n);
+        len += n;
+        return *this;
+    }
+    HashInput &add_u64(uint64_t v) {
+        for (int i = 0; i < 8; ++i)
+            data[len++] = (uint8_t)(v >> (8 * i));
+        return *this;
+    }
+    uint64_t hash(const AddrMan *m) const { return siphash::hash(m->k0, m->k1, data, len); }
+};
+
+static uint32_t tried_bucket(const AddrMan *m, const Entry &e) {
+    uint64_t h = HashInput().add(e.addr.data(), e.addr.size()).hash(m) % TRIED_BUCKETS_PER_GROUP;
+    uint8_t g[5];
+    return (uint32_t)(HashInput().add(g, group(e.addr.data(), g)).add_u64(h).hash(m) % m->tried_buckets);
+}
+
+static uint32_t new_bucket(const AddrMan *m, const Entry &e) {
+    uint8_t g[5], sg[5];
+    size_t glen = group(e.addr.data(), g), sglen = group(e.source, sg);
+    uint64_t h = HashInput().add(g, glen).add(sg, sglen).hash(m) % NEW_BUCKETS_PER_SOURCE_GROUP;
+    return (uint32_t)(HashInput().add(sg, sglen).add_u64(h).hash(m) % m->new_buckets);
+}
+
+static int32_t position(const AddrMan *m, const Entry &e, bool tried) {
+    uint32_t bucket = tried ? tried_bucket(m, e) : new_bucket(m, e);
+    uint8_t tag = tried ? 'T' : 'N';
+    uint64_t h = HashInput().add(&tag, 1).add_u64(bucket).add(e.addr.data(), e.addr.size()).hash(m);
+    return (int32_t)(bucket * m->bucket_size + h % m->bucket_size);
+}
+
+/* Times are compared as signed 64-bit seconds, like Bitcoin Core does:
+   add() takes timestamps up to 10 minutes ahead of now, and unsigned
+   differences with those wrap around to huge ages. */
+
+static bool is_terrible(const Entry &e, uint32_t now_) {
+    int64_t now = now_, time = e.time, last_try = e.last_try, last_success = e.last_success;
+    if (last_try && last_try >= now - 60)
+        return false;  // Never remove something we just tried.
+    if (time > now + 10 * 60)
+        return true;   // Came with a timestamp from the future.
+    if (time == 0 || now - time > (int64_t)HORIZON_DAYS * DAY)
+        return true;
+    if (last_success == 0 && e.attempts >= RETRIES)
+        return true;
+    if (now - last_success > (int64_t)MIN_FAIL_DAYS * DAY && e.attempts >= MAX_FAILURES)
+        return true;
+    return false;
+}
+
+/**
+ * @brief Relative chance of selecting an entry: lower for addresses we
+ * tried in the last 10 minutes, that failed a lot, or that have not
+ * been heard of in a while.
+ */
+static double chance(const Entry &e, uint32_t now_) {
+    int64_t now = now_, time = e.time, last_try = e.last_try;
+    double c = 1.0;
+    if (last_try && now - last_try < 10 * 60)
+        c *= 0.01;
+    for (int i = 0; i < std::min<int>(e.attempts, 8); ++i)
+        c *= 0.66;
+    double age = time && now > time ? (now - time) / (double)DAY : 0.0;
+    return c * std::max(0.1, 1.0 - age / HORIZON_DAYS);
+}
+
+static void table_insert(AddrMan *m, int32_t idx, bool tried, int32_t pos) {
+    Table &t = tried ? m->tried_table : m->new_table;
+    Entry &e = m->entries[idx];
+    e.tried = tried;
+    e.position = pos;
+    e.dense = (int32_t)t.list.size();
+    t.slots[pos] = idx;
+    t.list.push_back(idx);
+}
+
+static void table_remove(AddrMan *m, int32_t idx) {
+    Entry &e = m->entries[idx];
+    Table &t = e.tried ? m->tried_table : m->new_table;
+    t.slots[e.position] = -1;
+    int32_t last = t.list.back();
+    t.list[e.dense] = last;
+    m->entries[last].dense = e.dense;
+    t.list.pop_back();
+}
+
+static void erase(AddrMan *m, int32_t idx) {
+    table_remove(m, idx);
+    Entry &e = m->entries[idx];
+    m->index.erase(e.addr);
+    e.used = false;
+    m->free.push_back(idx);
+}
+
+static int32_t allocate(AddrMan *m, const Entry &e) {
+    int32_t idx;
+    if (!m->free.empty()) {
+        idx = m->free.back();
+        m->free.pop_back();
+        m->entries[idx] = e;
+    } else {
+        idx = (int32_t)m->entries.size();
+        m->entries.push_back(e);
+    }
+    m->entries[idx].used = true;
+    m->index.emplace(e.addr, idx);
+    return idx;
+}
+
+/**
+ * @brief Puts an entry in its slot of the new table, evicting what is
+ * there if it is terrible. Returns false (and frees the entry) if the
+ * slot was taken by something worth keeping.
+ */
+static bool place_new(AddrMan *m, int32_t idx, uint32_t now) {
+    int32_t pos = position(m, m->entries[idx], false);
+    int32_t other = m->new_table.slots[pos];
+    if (other >= 0) {
+        if (!is_terrible(m->entries[other], now)) {
+            m->index.erase(m->entries[idx].addr);
+            m->entries[idx].used = false;
+            m->free.push_back(idx);
+            return false;
+        }
+        erase(m, other);
+    }
+    table_insert(m, idx, false, pos);
+    return true;
+}
+
+static bool add(AddrMan *m, const AddrKey &addr, uint64_t services, uint32_t time, const uint8_t *source,
+                uint32_t now) {
+    auto it = m->index.find(addr);
+    if (it != m->index.end()) {
+        Entry &e = m->entries[it->second];
+        e.services |= services;
+        if (time > e.time)
+            e.time = time;
+        return false;
+    }
+    Entry e{};
+    e.addr = addr;
+    std::memcpy(e.source, source, 16);
+    e.services = services;
+    e.time = time;
+    return place_new(m, allocate(m, e), now);
+}
+
+static void good(AddrMan *m, int32_t idx, uint32_t now) {
+    Entry &e = m->entries[idx];
+    e.last_success = e.last_try = e.time = now;
+    e.attempts = 0;
+    if (e.tried)
+        return;
+    table_remove(m, idx);
+    int32_t pos = position(m, e, true);
+    int32_t other = m->tried_table.slots[pos];
+    if (other >= 0) {
+        /* The entry in the way goes back to the new table. */
+        table_remove(m, other);
+        place_new(m, other, now);
+    }
+    table_insert(m, idx, true, pos);
+}
+
+static int32_t select(AddrMan *m, bool new_only, uint32_t now) {
+    const Indices &nl = m->new_table.list, &tl = m->tried_table.list;
+    if (nl.empty() && (new_only || tl.empty()))
+        return -1;
+    bool tried = !new_only && !tl.empty() && (nl.empty() || (m->rng() & 1));
+    const Indices &list = tried ? tl : nl;
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    double factor = 1.0;
+    for (;;) {
+        int32_t idx = list[m->rng() % list.size()];
+        if (uniform(m->rng) < chance(m->entries[idx], now) * factor)
+            return idx;
+        factor *= 1.2;
+    }
+}
+
+static bool parse_host(const char *host, AddrKey &key, int port) {
+    in_addr v4;
+    in6_addr v6;
+    if (inet_pton(AF_INET, host, &v4) == 1) {
+        std::memset(key.data(), 0, 10);
+        key[10] = key[11] = 0xFF;
+        std::memcpy(key.data() + 12, &v4, 4);
+    } else if (inet_pton(AF_INET6, host, &v6) == 1) {
+        std::memcpy(key.data(), &v6, 16);
+    } else {
+        return false;
+    }
+    key[16] = (uint8_t)(port >> 8), key[17] = (uint8_t)port;
+    return true;
+}
+
+static std::string format_host(const uint8_t *ip) {
+    char buf[INET6_ADDRSTRLEN];
+    if (is_ipv4(ip))
+        inet_ntop(AF_INET, ip + 12, buf, sizeof(buf));
+    else
+        inet_ntop(AF_INET6, ip, buf, sizeof(buf));
+    return buf;
+}
+
+static void put_le(uint8_t *p, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i)
+        p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint64_t get_le(const uint8_t *p, int bytes) {
+    uint64_t v = 0;
+    for (int i = bytes - 1; i >= 0; --i)
+        v = v << 8 | p[i];
+    return v;
+}
+
+/* AddrMan type. */
+
+typedef struct {
+    PyObject_HEAD
+    AddrMan *man;
+    std::mutex *mu;  // Guards man, which load() replaces.
+} AddrManObject;
+
+static uint32_t now_or(long long now) {
+    return now > 0 ? (uint32_t)now : (uint32_t)std::time(nullptr);
+}
+
+static int AddrMan_init(AddrManObject *self, PyObject *args, PyObject *kwds) {
+    static const char *kwlist[] = {"key", "new_buckets", "tried_buckets", "bucket_size", NULL};
+    Py_buffer key = {NULL, NULL};
+    unsigned int nb = DEFAULT_NEW_BUCKETS, tb = DEFAULT_TRIED_BUCKETS, bs = DEFAULT_BUCKET_SIZE;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|z*III", const_cast<char **>(kwlist), &key, &nb, &tb, &bs))
+        return -1;
+    uint64_t k0, k1;
+    if (key.buf) {
+        bool ok = key.len == 16;
+        if (ok) {
+            k0 = get_le(static_cast<uint8_t *>(key.buf), 8);
+            k1 = get_le(static_cast<uint8_t *>(key.buf) + 8, 8);
+        }
+        PyBuffer_Release(&key);
+        if (!ok) {
+            PyErr_SetString(PyExc_ValueError, "key must be exactly 16 bytes.");
+            return -1;
+        }
+    } else {
+        std::random_device rd;
+        k0 = (uint64_t)rd() << 32 | rd();
+        k1 = (uint64_t)rd() << 32 | rd();
+    }
+    if (nb == 0 || tb == 0 || bs == 0 || (uint64_t)nb * bs > INT32_MAX || (uint64_t)tb * bs > INT32_MAX) {
+        PyErr_SetString(PyExc_ValueError, "invalid table size.");
+        return -1;
+    }
+    AddrMan *man = new (std::nothrow) AddrMan(k0, k1, nb, tb, bs);
+    if (!man) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    if (!self->mu)
+        self->mu = new std::mutex();
+    ObjectLock lock(*self->mu);
+    delete self->man;
+    self->man = man;
+    return 0;
+}
+
+static void AddrMan_dealloc(AddrManObject *self) {
+    delete self->man;
+    delete self->mu;
+    heap_free(reinterpret_cast<PyObject *>(self));
+}
+
+static AddrMan *get_man(AddrManObject *self) {
+    if (!self->man)
+        PyErr_SetString(PyExc_RuntimeError, "AddrMan is not initialized.");
+    return self->man;
+}
+
+static bool get_addr(const char *host, int port, AddrKey &key) {
+    if (port < 0 || port > 0xFFFF || !parse_host(host, key, port)) {
+        PyErr_Format(PyExc_ValueError, "invalid address %s:%d.", host, port);
+        return false;
+    }
+    return true;
+}
+
+static PyObject *AddrMan_add(AddrManObject *self, PyObject *args, PyObject *kwds) {
+    static const char *kwlist[] = {"host", "port", "services", "time", "source", "now", NULL};
+    const char *host, *source = "0.0.0.0";
+    int port;
+    unsigned long long services = 0;
+    long long time = 0, now = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "si|KLsL", const_cast<char **>(kwlist), &host, &port, &services,
+                                     &time, &source, &now))
+        return NULL;
+    AddrKey addr, src;
+    if (!get_man(self) || !get_addr(host, port, addr) || !get_addr(source, 0, src))
+        return NULL;
+    ObjectLock lock(*self->mu);
+    uint32_t t = now_or(now);
+    return PyBool_FromLong(add(self->man, addr, services, time > 0 ? (uint32_t)time : t, src.data(), t));
+}
+
+static PyObject *AddrMan_add_many(AddrManObject *self, PyObject *args, PyObject *kwds) {
+    static const char *kwlist[] = {"addresses", "source", "now", NULL};
+    PyObject *addresses;
+    const char *source = "0.0.0.0";
+    long long now = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|sL", const_cast<char **>(kwlist), &addresses, &source, &now))
+        return NULL;
+    AddrKey src;
+    if (!get_man(self) || !get_addr(source, 0, src))
+        return NULL;
+    PyObject *seq = PySequence_Fast(addresses, "expected a sequence of (host, port, services, time) tuples.");
+    if (!seq)
+        return NULL;
+    ObjectLock lock(*self->mu);
+    AddrMan *m = self->man;
+    uint32_t t = now_or(now);
+    Py_ssize_t added = 0, n = PySequence_Fast_GET_SIZE(seq);
+    for (Py_ssize_t i = 0; i < n; ++i) {
+        const char *host;
+        int port;
+        unsigned long long services = 0;
+        long long time = 0;
+        AddrKey addr;
+        if (!PyArg_ParseTuple(PySequence_Fast_GET_ITEM(seq, i), "si|KL", &host, &port, &services, &time)
+            || !get_addr(host, port, addr)) {
+            Py_DECREF(seq);
+            return NULL;
+        }
+        added += add(m, addr, services, time > 0 ? (uint32_t)time : t, src.data(), t);
+    }
+    Py_DECREF(seq);
+    return PyLong_FromSsize_t(added);
+}
+
+static bool find_args(AddrManObject *self, PyObject *const *args, Py_ssize_t nargs, const char *format, AddrKey &addr,
+                      uint32_t *now) {
+    const char *host;
+    int port;
+    long long when = 0;
+    if (!parse_args(args, nargs, format, &host, &port, &when) || !get_man(self) || !get_addr(host, port, addr))
+        return false;
+    *now = now_or(when);
+    return true;
+}
+
+static int32_t find(const AddrMan *m, const AddrKey &addr) {
+    auto it = m->index.find(addr);
+    return it == m->index.end() ? -1 : it->second;
+}
+
+static PyObject *AddrMan_good(AddrManObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    AddrKey addr;
+    uint32_t now;
+    if (!find_args(self, args, nargs, "si|L:good", addr, &now))
+        return NULL;
+    ObjectLock lock(*self->mu);
+    int32_t idx = find(self->man, addr);
+    if (idx >= 0)
+        good(self->man, idx, now);
+    return PyBool_FromLong(idx >= 0);
+}
+
+static PyObject *AddrMan_attempt(AddrManObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    AddrKey addr;
+    uint32_t now;
+    if (!find_args(self, args, nargs, "si|L:attempt", addr, &now))
+        return NULL;
+    ObjectLock lock(*self->mu);
+    int32_t idx = find(self->man, addr);
+    if (idx >= 0) {
+        Entry &e = self->man->entries[idx];
+        e.last_try = now;
+        if (e.attempts < UINT16_MAX)
+            ++e.attempts;
+    }
+    return PyBool_FromLong(idx >= 0);
+}
+
+static PyObject *entry_tuple(const Entry &e) {
+    std::string host = format_host(e.addr.data());
+    return Py_BuildValue("(siKI)", host.c_str(), (int)(e.addr[16] << 8 | e.addr[17]), (unsigned long long)e.services,
+                         e.time);
+}
+
+static PyObject *AddrMan_select(AddrManObject *self, PyObject *args, PyObject *kwds) {
+    static const char *kwlist[] = {"new_only", "now", NULL};
+    int new_only = 0;
+    long long now = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|pL", const_cast<char **>(kwlist), &new_only, &now))
+        return NULL;
+    if (!get_man(self))
+        return NULL;
+    ObjectLock lock(*self->mu);
+    AddrMan *m = self->man;
+    int32_t idx = select(m, new_only, now_or(now));
+    if (idx < 0)
+        Py_RETURN_NONE;
+    return entry_tuple(m->entries[idx]);
+}
+
+static PyObject *AddrMan_addresses(AddrManObject *self, PyObject *args, PyObject *kwds) {
+    static const char *kwlist[] = {"max_count", "max_pct", "now", NULL};
+    Py_ssize_t max_count = 1000, max_pct = 23;
+    long long now = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|nnL", const_cast<char **>(kwlist), &max_count, &max_pct, &now))
+        return NULL;
+    if (!get_man(self))
+        return NULL;
+    ObjectLock lock(*self->mu);
+    AddrMan *m = self->man;
+    uint32_t t = now_or(now);
+    std::vector<int32_t> all(m->new_table.list.begin(), m->new_table.list.end());
+    all.insert(all.end(), m->tried_table.list.begin(), m->tried_table.list.end());
+    size_t n = all.size() * std::max<Py_ssize_t>(0, std::min<Py_ssize_t>(max_pct, 100)) / 100;
+    if (max_count >= 0 && (size_t)max_count < n)
+        n = max_count;
+    PyObject *result = PyList_New(0);
+    /* Partial Fisher-Yates shuffle, skipping useless entries. */
+    for (size_t i = 0; result && i < all.size() && (size_t)PyList_GET_SIZE(result) < n; ++i) {
+        std::swap(all[i], all[i + m->rng() % (all.size() - i)]);
+        const Entry &e = m->entries[all[i]];
+        if (is_terrible(e, t))
+            continue;
+        PyObject *item = entry_tuple(e);
+        if (!item || PyList_Append(result, item) < 0)
+            Py_CLEAR(result);
+        Py_XDECREF(item);
+    }
+    return result;
+}
+
+static PyObject *AddrMan_info(AddrManObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    AddrKey addr;
+    uint32_t now;
+    if (!find_args(self, args, nargs, "si|L:info", addr, &now))
+        return NULL;
+    ObjectLock lock(*self->mu);
+    int32_t idx = find(self->man, addr);
+    if (idx < 0)
+        Py_RETURN_NONE;
+    const Entry &e = self->man->entries[idx];
+    return Py_BuildValue("{sKsIsIsIsisO}", "services", (unsigned long long)e.services, "time", e.time, "last_try",
+                         e.last_try, "last_success", e.last_success, "attempts", (int)e.attempts, "tried",
+                         e.tried ? Py_True : Py_False);
+}
+
+static PyObject *AddrMan_save(AddrManObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    PyObject *path;
+    if (!parse_args(args, nargs, "O&:save", PyUnicode_FSConverter, &path))
+        return NULL;
+    if (!get_man(self)) {
+        Py_DECREF(path);
+        return NULL;
+    }
+    size_t count;
+    std::vector<uint8_t> buf;
+    {
+        /* Only serializing needs the lock, not the write. */
+        ObjectLock lock(*self->mu);
+        const AddrMan *m = self->man;
+        count = m->new_table.list.size() + m->tried_table.list.size();
+        buf.resize(4 + 4 + 16 + 12 + 8 + count * RECORD_SIZE + 4);
+        uint8_t *p = buf.data();
+        std::memcpy(p, "PCAM", 4);
+        put_le(p + 4, ADDR_VERSION, 4);
+        put_le(p + 8, m->k0, 8);
+        put_le(p + 16, m->k1, 8);
+        put_le(p + 24, m->new_buckets, 4);
+        put_le(p + 28, m->tried_buckets, 4);
+        put_le(p + 32, m->bucket_size, 4);
+        put_le(p + 36, count, 8);
+        p += 44;
+        /* Tried entries first, so they get their slots back on load. */
+        for (const Indices *list : {&m->tried_table.list, &m->new_table.list}) {
+            for (int32_t idx : *list) {
+                const Entry &e = m->entries[idx];
+                std::memcpy(p, e.addr.data(), 18);
+                put_le(p + 18, e.services, 8);
+                put_le(p + 26, e.time, 4);
+                put_le(p + 30, e.last_try, 4);
+                put_le(p + 34, e.last_success, 4);
+                put_le(p + 38, e.attempts, 2);
+                std::memcpy(p + 40, e.source, 16);
+                p[56] = e.tried;
+                p += RECORD_SIZE;
+            }
+        }
+        uint8_t digest[32];
+        sha256::sha256d(buf.data(), buf.size() - 4, digest);
+        std::memcpy(p, digest, 4);
+    }
+    /* Written to a temporary file first, so a crash never leaves half a file. */
+    std::string target = PyBytes_AS_STRING(path), tmp = target + ".tmp";
+    Py_DECREF(path);
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS
+    std::FILE *f = std::fopen(tmp.c_str(), "wb");
+    ok = f && std::fwrite(buf.data(), 1, buf.size(), f) == buf.size();
+    ok = f && std::fclose(f) == 0 && ok;
+    ok = ok && std::rename(tmp.c_str(), target.c_str()) == 0;
+    Py_END_ALLOW_THREADS
+    if (!ok)
+        return PyErr_SetFromErrnoWithFilename(PyExc_OSError, target.c_str());
+    return PyLong_FromSize_t(count);
+}
+
+static PyObject *AddrMan_load(AddrManObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    PyObject *path;
+    if (!parse_args(args, nargs, "O&:load", PyUnicode_FSConverter, &path))
+        return NULL;
+    std::string name = PyBytes_AS_STRING(path);
+    Py_DECREF(path);
+    if (!get_man(self))
+        return NULL;
+    std::vector<uint8_t> buf;
+    bool read_ok;
+    Py_BEGIN_ALLOW_THREADS
+    std::FILE *f = std::fopen(name.c_str(), "rb");
+    read_ok = f != nullptr;
+    if (f) {
+        uint8_t chunk[65536];
+        size_t n;
+        while ((n = std::fread(chunk, 1, sizeof(chunk), f)) > 0)
+            buf.insert(buf.end(), chunk, chunk + n);
+        read_ok = !std::ferror(f);
+        std::fclose(f);
+    }
+    Py_END_ALLOW_THREADS
+    if (!read_ok)
+        return PyErr_SetFromErrnoWithFilename(PyExc_OSError, name.c_str());
+    uint8_t digest[32];
+    bool valid = buf.size() >= 48 && std::memcmp(buf.data(), "PCAM", 4) == 0 && get_le(&buf[4], 4) == ADDR_VERSION;
+    uint64_t count = valid ? get_le(&buf[36], 8) : 0;
+    valid = valid && count <= (buf.size() - 48) / RECORD_SIZE && buf.size() == 48 + count * RECORD_SIZE;
+    if (valid) {
+        sha256::sha256d(buf.data(), buf.size() - 4, digest);
+        valid = std::memcmp(digest, &buf[buf.size() - 4], 4) == 0;
+    }
+    uint32_t nb = valid ? (uint32_t)get_le(&buf[24], 4) : 0, tb = valid ? (uint32_t)get_le(&buf[28], 4) : 0;
+    uint32_t bs = valid ? (uint32_t)get_le(&buf[32], 4) : 0;
+    if (!valid || nb == 0 || tb == 0 || bs == 0 || (uint64_t)nb * bs > INT32_MAX || (uint64_t)tb * bs > INT32_MAX) {
+        PyErr_Format(PyExc_ValueError, "%s is not a valid address file.", name.c_str());
+        return NULL;
+    }
+    AddrMan *m = new (std::nothrow) AddrMan(get_le(&buf[8], 8), get_le(&buf[16], 8), nb, tb, bs);
+    if (!m)
+        return PyErr_NoMemory();
+    m->entries.reserve(count);
+    uint32_t now = (uint32_t)std::time(nullptr);
+    const uint8_t *p = buf.data() + 44;
+    for (uint64_t i = 0; i < count; ++i, p += RECORD_SIZE) {
+        Entry e{};
+        std::memcpy(e.addr.data(), p, 18);
+        if (m->index.count(e.addr))
+            continue;
+        e.services = get_le(p + 18, 8);
+        e.time = (uint32_t)get_le(p + 26, 4);
+        e.last_try = (uint32_t)get_le(p + 30, 4);
+        e.last_success = (uint32_t)get_le(p + 34, 4);
+        e.attempts = (uint16_t)get_le(p + 38, 2);
+        std::memcpy(e.source, p + 40, 16);
+        int32_t idx = allocate(m, e);
+        int32_t pos = p[56] ? position(m, e, true) : -1;
+        if (pos >= 0 && m->tried_table.slots[pos] < 0)
+            table_insert(m, idx, true, pos);
+        else
+            place_new(m, idx, now);
+    }
+    ObjectLock lock(*self->mu);
+    delete self->man;
+    self->man = m;
+    return PyLong_FromSize_t(m->new_table.list.size() + m->tried_table.list.size());
+}
+
+static Py_ssize_t AddrMan_len(AddrManObject *self) {
+    if (!self->man)
+        return 0;
+    ObjectLock lock(*self->mu);
+    return (Py_ssize_t)(self->man->new_table.list.size() + self->man->tried_table.list.size());
+}
+
+static PyObject *AddrMan_get_new_count(AddrManObject *self, void *closure) {
+    if (!self->man)
+        return PyLong_FromLong(0);
+    ObjectLock lock(*self->mu);
+    return PyLong_FromSize_t(self->man->new_table.list.size());
+}
+
+static PyObject *AddrMan_get_tried_count(AddrManObject *self, void *closure) {
+    if (!self->man)
+        return PyLong_FromLong(0);
+    ObjectLock lock(*self->mu);
+    return PyLong_FromSize_t(self->man->tried_table.list.size());
+}
+
+static PyMethodDef AddrMan_methods[] = {
+    {"add", (PyCFunction)(void (*)(void))AddrMan_add, METH_VARARGS | METH_KEYWORDS,
+     "Add an address heard of from source to the new table. Returns True if it was not known yet."},
+    {"add_many", (PyCFunction)(void (*)(void))AddrMan_add_many, METH_VARARGS | METH_KEYWORDS,
+     "Add (host, port, services, time) tuples from one source, returning how many were new."},
+    {"good", (PyCFunction)(void (*)(void))AddrMan_good, METH_FASTCALL,
+     "Mark (host, port[, now]) as connected to successfully, moving it to the tried table."},
+    {"attempt", (PyCFunction)(void (*)(void))AddrMan_attempt, METH_FASTCALL,
+     "Record a connection attempt to (host, port[, now])."},
+    {"select", (PyCFunction)(void (*)(void))AddrMan_select, METH_VARARGS | METH_KEYWORDS,
+     "Pick an address to connect to, as (host, port, services, time), or None if there are none."},
+    {"addresses", (PyCFunction)(void (*)(void))AddrMan_addresses, METH_VARARGS | METH_KEYWORDS,
+     "A random sample of addresses to share with peers (at most max_count, and max_pct percent)."},
+    {"info", (PyCFunction)(void (*)(void))AddrMan_info, METH_FASTCALL, "What is known about (host, port), or None."},
+    {"save", (PyCFunction)(void (*)(void))AddrMan_save, METH_FASTCALL,
+     "Write every address to a file, returning how many."},
+    {"load", (PyCFunction)(void (*)(void))AddrMan_load, METH_FASTCALL,
+     "Replace the contents (and key) with those of a file written by save()."},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyGetSetDef AddrMan_getset[] = {
+    {"new_count", (getter)AddrMan_get_new_count, NULL, "Number of addresses in the new table.", NULL},
+    {"tried_count", (getter)AddrMan_get_tried_count, NULL, "Number of addresses in the tried table.", NULL},
+    {NULL}
+};
+
+static PyType_Slot AddrMan_slots[] = {
+    {Py_tp_dealloc, (void *)AddrMan_dealloc},
+    {Py_tp_doc, (void *)"Peer addresses in bucketed new and tried tables."},
+    {Py_tp_methods, AddrMan_methods},
+    {Py_tp_getset, AddrMan_getset},
+    {Py_sq_length, (void *)AddrMan_len},
+    {Py_tp_init, (void *)AddrMan_init},
+    {Py_tp_new, (void *)PyType_GenericNew},
+    {0, NULL}
+};
+
+static PyType_Spec AddrMan_spec = {
+    "addrman.AddrMan",
+    sizeof(AddrManObject),
+    0,
+    Py_TPFLAGS_DEFAULT,
+    AddrMan_slots
+};
+
+/* Module. */
+
+typedef struct {
+    PyObject *addrman_type;
+} AddrManState;
+
+static AddrManState *get_state(PyObject *m) {
+    return static_cast<AddrManState *>(PyModule_GetState(m));
+}
+
+static int addrman_exec(PyObject *m) {
+    return module_add_type(m, &AddrMan_spec, &get_state(m)->addrman_type);
+}
+
+static int addrman_traverse(PyObject *m, visitproc visit, void *arg) {
+    Py_VISIT(get_state(m)->addrman_type);
+    return 0;
+}
+
+static int addrman_clear(PyObject *m) {
+    Py_CLEAR(get_state(m)->addrman_type);
+    return 0;
+}
+
+static void addrman_free(void *m) {
+    addrman_clear(static_cast<PyObject *>(m));
+}
+
+static PyMethodDef addrman_methods[] = {
+    MEMORY_METHODS,
+    {NULL, NULL, 0, NULL}
+};
+
+static PyModuleDef_Slot addrman_slots[] = {
+    {Py_mod_exec, (void *)addrman_exec},
+    MODULE_SLOTS
+    {0, NULL}
+};
+
+static struct PyModuleDef addrman = {
+    PyModuleDef_HEAD_INIT,
+    "addrman",
+    NULL,
+    sizeof(AddrManState),
+    addrman_methods,
+    addrman_slots,
+    addrman_traverse,
+    addrman_clear,
+    addrman_free
+};
+
+PyMODINIT_FUNC PyInit_addrman(void) {
+    return PyModuleDef_Init(&addrman);
+}
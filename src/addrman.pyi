@@ -0,0 +1,37 @@
+from os import PathLike
+from typing import Sequence
+
+Address = tuple[str, int, int, int]
+
+class AddrMan:
+    new_count: int
+    tried_count: int
+    def __init__(
+        self,
+        key: bytes | None = ...,
+        new_buckets: int = ...,
+        tried_buckets: int = ...,
+        bucket_size: int = ...,
+    ) -> None: ...
+    def __len__(self) -> int: ...
+    def add(
+        self,
+        host: str,
+        port: int,
+        services: int = ...,
+        time: int = ...,
+        source: str = ...,
+        now: int = ...,
+    ) -> bool: ...
+    def add_many(
+        self, addresses: Sequence[tuple[str, int] | tuple[str, int, int] | Address], source: str = ..., now: int = ...
+    ) -> int: ...
+    def good(self, host: str, port: int, now: int = ...) -> bool: ...
+    def attempt(self, host: str, port: int, now: int = ...) -> bool: ...
+    def select(self, new_only: bool = ..., now: int = ...) -> Address | None: ...
+    def addresses(self, max_count: int = ..., max_pct: int = ..., now: int = ...) -> list[Address]: ...
+    def info(self, host: str, port: int) -> dict[str, int | bool] | None: ...
+    def save(self, path: str | PathLike[str]) -> int: ...
+    def load(self, path: str | PathLike[str]) -> int: ...
+def _memory() -> dict[str, dict[str, int]]: ...
+def _memory_reset_peak() -> None: ...
@@ -0,0 +1,295 @@
+"""A registry of implementations of the crypto primitives, choosing the
+fastest on the machine it runs on.
+
+Each primitive has a pure-Python implementation, registered by the
+module that uses it, and may have native ones: the extensions list
+theirs in a BACKENDS attribute (see module_add_backends() in
+pymodule.h), with their capabilities. Every implementation of a
+primitive takes the same arguments and returns the same thing:
+
+    field    inverse(a, m) -> int         a**-1 mod m, for a coprime to m
+    point    public_key(key) -> bytes     compressed SEC encoding of
+                                          key * G, for a 32-byte key
+    hash     sha256d(data) -> bytes       two rounds of SHA-256
+    merkle   merkle_root(hashes) -> bytes root of 32-byte hashes, in
+                                          internal byte order (32 zero
+                                          bytes for none)
+    siphash  siphash(k0, k1, data) -> int SipHash-2-4
+
+The first time a module asks for a primitive (select()), each
+implementation is timed for a few milliseconds on the inputs of
+SAMPLES, its results checked against the Python one's, and the fastest
+kept. The inputs span the sizes the primitive is called with, a block
+header and a 1 MiB message for the hash, so that an implementation
+fast on one size and slow on the other is scored by both: by the
+geometric mean of its times, which weighs being twice as slow on
+either the same. Which
+one won is cached on disk (CACHE), under a fingerprint of the machine,
+the Python build and the implementations (their files' sizes and
+modification times), so the next import on the same machine reads it
+instead, and another machine sharing the cache, or a rebuilt extension,
+calibrates again. Nothing needs configuring: a native implementation
+that is not built, or is slower on this CPU (SIMD code on an old one,
+or one whose call overhead outweighs a cheap primitive), simply loses.
+
+    sha256d = backends.select("hash")
+
+    python -m src.backends                # Calibrate, print the choices.
+"""
+
+from __future__ import annotations
+
+import enum
+import hashlib
+import importlib
+import json
+import math
+import os
+import platform
+import sys
+import threading
+import time
+import warnings
+from pathlib import Path
+from typing import Callable, NamedTuple
+
+PRIMITIVES = ("field", "point", "hash", "merkle", "siphash")
+NATIVE_MODULES = ("fastinv", "bip32", "netcodec", "validation", "siphash")
+REFERENCE = "python"  # The implementation the others are checked against.
+
+CALIBRATION_TIME = 0.01  # Seconds per implementation.
+CACHE_VERSION = 2
+CACHE = Path(os.environ.get("XDG_CACHE_HOME") or Path.home() / ".cache") / "pycoin" / "backends.json"
+
+_KEY = bytes.fromhex("18e14a7b6a307f426a94f8114701e7c8e774e7f9a47e2c2035db29a206321725")
+_P = 0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEFFFFFC2F
+
+# The arguments each primitive is timed with: a typical call for each
+# size it is called with.
+SAMPLES: dict[str, list[tuple]] = {
+    "field": [(int.from_bytes(_KEY, "big"), _P)],
+    "point": [(_KEY,)],
+    "hash": [(bytes(80),), (bytes(1 << 20),)],
+    "merkle": [
+        ([hashlib.sha256(i.to_bytes(2, "little")).digest() for i in range(16)],),
+        ([hashlib.sha256(i.to_bytes(2, "little")).digest() for i in range(2000)],),
+    ],
+    "siphash": [(0x0706050403020100, 0x0F0E0D0C0B0A0908, _KEY)],
+}
+
+
+class Capability(enum.Flag):
+    NONE = 0
+    NATIVE = enum.auto()  # In an extension.
+    RELEASES_GIL = enum.auto()  # Runs without the GIL, so threads can share the work.
+    SIMD = enum.auto()  # Vectorized, so how fast it is depends most on the CPU.
+
+    @classmethod
+    def parse(cls, names: str) -> Capability:
+        flags = cls.NATIVE
+        for name in names.split():
+            flags |= cls.__members__.get(name.upper(), cls.NONE)
+        return flags
+
+
+class Backend(NamedTuple):
+    primitive: str
+    name: str
+    func: Callable
+    capabilities: Capability
+    origin: str | None  # The file it comes from, for the fingerprint.
+
+
+_registry: dict[str, dict[str, Backend]] = {primitive: {} for primitive in PRIMITIVES}
+_selected: dict[str, Backend] = {}
+_lock = threading.RLock()
+_natives_loaded = False
+
+
+def register(
+    primitive: str, name: str, func: Callable, capabilities: Capability = Capability.NONE, origin: str | None = None
+) -> None:
+    """Adds an implementation of a primitive. The Python one is named
+    REFERENCE."""
+    if primitive not in _registry:
+        raise ValueError(f"unknown primitive {primitive!r}.")
+    with _lock:
+        _registry[primitive][name] = Backend(primitive, name, func, capabilities, origin)
+        _selected.pop(primitive, None)
+
+
+def _load_natives() -> None:
+    global _natives_loaded
+    with _lock:
+        if _natives_loaded:
+            return
+        _natives_loaded = True
+        for module_name in NATIVE_MODULES:
+            try:
+                module = importlib.import_module(f".{module_name}", __package__)
+            except ImportError:
+                continue
+            for primitive, function, capabilities in getattr(module, "BACKENDS", ()):
+                if primitive in _registry:
+                    register(
+                        primitive,
+                        f"{module_name}.{function}",
+                        getattr(module, function),
+                        Capability.parse(capabilities),
+                        getattr(module, "__file__", None),
+                    )
+
+
+def backends(primitive: str) -> list[Backend]:
+    """The registered implementations of a primitive, the Python one first."""
+    _load_natives()
+    with _lock:
+        found = _registry[primitive]
+        return sorted(found.values(), key=lambda b: b.name != REFERENCE)
+
+
+def _origin(path: str | None) -> list:
+    try:
+        st = os.stat(path) if path else None
+    except OSError:
+        st = None
+    return [st.st_size, st.st_mtime_ns] if st else []
+
+
+def _cpu() -> str:
+    try:
+        with open("/proc/cpuinfo") as f:
+            for line in f:
+                if line.startswith("model name"):
+                    return line.split(":", 1)[1].strip()
+    except OSError:
+        pass
+    return platform.processor()
+
+
+def fingerprint(primitive: str) -> str:
+    """What the choice for a primitive depends on: the machine, the
+    Python build and the implementations registered."""
+    identity = {
+        "version": CACHE_VERSION,
+        "primitive": primitive,
+        "machine": platform.machine(),
+        "cpu": _cpu(),
+        "python": [platform.python_implementation(), platform.python_version(), getattr(sys, "abiflags", "")],
+        "backends": [[b.name, _origin(b.origin)] for b in backends(primitive)],
+    }
+    return hashlib.sha256(json.dumps(identity, sort_keys=True).encode()).hexdigest()
+
+
+def _time(func: Callable, args: tuple, min_time: float) -> float:
+    """Nanoseconds per call, the best of three rounds of at least
+    min_time / 3 seconds each."""
+    best, target = float("inf"), min_time / 3 * 1e9
+    for _ in range(3):
+        calls, start = 0, time.perf_counter_ns()
+        while True:
+            func(*args)
+            calls += 1
+            elapsed = time.perf_counter_ns() - start
+            if elapsed >= target:
+                break
+        best = min(best, elapsed / calls)
+    return best
+
+
+def calibrate(primitive: str, min_time: float = CALIBRATION_TIME) -> dict[str, float]:
+    """Nanoseconds per call of each implementation of a primitive that
+    gives the same results as the Python one, the geometric mean over
+    SAMPLES. The others are left out, with a warning."""
+    samples = SAMPLES[primitive]
+    found = backends(primitive)
+    expected = [found[0].func(*args) for args in samples] if found and found[0].name == REFERENCE else None
+    timings = {}
+    for backend in found:
+        try:
+            results = [backend.func(*args) for args in samples]
+        except Exception as e:  # noqa: BLE001
+            warnings.warn(f"{backend.name} failed calibrating {primitive}: {e!r}", RuntimeWarning)
+            continue
+        if expected is not None and results != expected:
+            warnings.warn(f"{backend.name} disagrees with {REFERENCE} on {primitive}.", RuntimeWarning)
+            continue
+        times = [_time(backend.func, args, min_time / len(samples)) for args in samples]
+        timings[backend.name] = math.prod(times) ** (1 / len(times))
+    return timings
+
+
+def _read_cache() -> dict:
+    try:
+        with open(CACHE) as f:
+            cache = json.load(f)
+    except (OSError, ValueError):
+        return {}
+    return cache if isinstance(cache, dict) and cache.get("version") == CACHE_VERSION else {}
+
+
+def _write_cache(key: str, entry: dict) -> None:
+    """Adds an entry to the cache, replacing the file in one step so that
+    processes reading it never see half of it. A cache that cannot be
+    written only means calibrating again next time."""
+    with _lock:
+        cache = _read_cache() or {"version": CACHE_VERSION, "choices": {}}
+        cache.setdefault("choices", {})[key] = entry
+        tmp = CACHE.with_name(f"{CACHE.name}.{os.getpid()}.{threading.get_ident()}.tmp")
+        try:
+            CACHE.parent.mkdir(parents=True, exist_ok=True)
+            with open(tmp, "w") as f:
+                json.dump(cache, f, indent=1, sort_keys=True)
+            os.replace(tmp, CACHE)
+        except OSError:
+            try:
+                tmp.unlink()
+            except OSError:
+                pass
+
+
+def selected(primitive: str) -> Backend:
+    """The implementation of a primitive to use: the cached choice for
+    this machine if there is one, else the fastest after calibrating."""
+    with _lock:
+        if primitive in _selected:
+            return _selected[primitive]
+        found = {b.name: b for b in backends(primitive)}
+        if not found:
+            raise LookupError(f"no implementation of {primitive} is registered.")
+        key = fingerprint(primitive)
+        choice = _read_cache().get("choices", {}).get(key, {}).get("backend")
+        if choice not in found:
+            timings = calibrate(primitive)
+            choice = min(timings, key=timings.__getitem__) if timings else next(iter(found))
+            ns = {name: round(t, 1) for name, t in timings.items()}
+            _write_cache(key, {"primitive": primitive, "backend": choice, "ns": ns})
+        _selected[primitive] = found[choice]
+        return found[choice]
+
+
+def select(primitive: str) -> Callable:
+    """The function implementing a primitive, see selected()."""
+    return selected(primitive).func
+
+
+def report() -> str:
+    lines = [f"{'primitive':<9} {'backend':<24} {'ns/call':>10}  capabilities"]
+    for primitive in PRIMITIVES:
+        chosen = selected(primitive).name if _registry[primitive] else None
+        timings = calibrate(primitive)
+        for backend in backends(primitive):
+            ns = timings.get(backend.name)
+            flags = "|".join(f.name.lower() for f in Capability if f and f in backend.capabilities) or "-"
+            lines.append(
+                f"{primitive:<9} {backend.name + (' *' if backend.name == chosen else ''):<24} "
+                f"{f'{ns:.0f}' if ns is not None else '-':>10}  {flags}"
+            )
+    return "\n".join(lines)
+
+
+if __name__ == "__main__":
+    # The registry the modules use is the imported one, not __main__.
+    from . import backends, merkle, reconcile, secp256k1, utils  # noqa: F401
+
+    print(backends.report())
@@ -0,0 +1,294 @@
+/**
+ * @file bench.h
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief Header-only micro-benchmark harness (warmup, calibration, cycles).
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef PYCOIN_BENCH_H
+#define PYCOIN_BENCH_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAVE_RDTSC 1
+#endif
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define BENCH_HAVE_PERF 1
+#endif
+
+ /* A benchmark is a function run(n) that does n iterations of the
+    operation being measured. The harness:
+
+        1. Warms up, calling run(1) for a while, so lazily built tables
+           exist, caches and branch predictors are warm and the CPU has
+           left its idle clock.
+        2. Calibrates n, growing it until one call takes its share of the
+           time budget, so that timer overhead and resolution do not
+           matter.
+        3. Takes a number of samples of n iterations each, recording the
+           time and the cycles per iteration of each.
+
+    The median is the number to compare between runs; the 99th
+    percentile shows how noisy the machine was (with the default 31
+    samples it is simply the slowest one).
+
+    Cycles come from the CPU's cycle counter through perf_event_open
+    when the kernel allows it (actual core cycles of this thread), and
+    otherwise from rdtsc, which counts at a constant reference rate
+    whatever the clock is. Neither is available everywhere, in which
+    case only times are reported.
+
+    Operations should feed each result into the next iteration (or go
+    through do_not_optimize()), so the compiler cannot drop or hoist
+    them.
+
+    Throughput across threads is measured differently (run_threads()):
+    every thread sets up its own work and does one batch of it, then
+    all of them start together and do batches until the time is up,
+    counting the items they finish. Threads can be pinned to CPUs, so
+    that runs are comparable (and so the caller decides whether they
+    share physical cores).
+
+    References:
+        - https://man7.org/linux/man-pages/man2/perf_event_open.2.html
+        - https://github.com/google/benchmark/blob/main/docs/user_guide.md
+ */
+
+#define BENCH_DEFAULT_MIN_TIME 0.2
+#define BENCH_DEFAULT_SAMPLES 31
+#define BENCH_WARMUP_TIME 0.05
+
+namespace bench {
+
+inline void do_not_optimize(const void *p) { asm volatile("" : : "g"(p) : "memory"); }
+
+class CycleCounter {
+  public:
+    enum Source { NONE, RDTSC, PERF };
+
+    explicit CycleCounter(bool perf = true) {
+#ifdef BENCH_HAVE_PERF
+        if (perf) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fd_ = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+            if (fd_ >= 0) {
+                source_ = PERF;
+                return;
+            }
+        }
+#endif
+#ifdef BENCH_HAVE_RDTSC
+        source_ = RDTSC;
+#endif
+    }
+
+    ~CycleCounter() {
+#ifdef BENCH_HAVE_PERF
+        if (fd_ >= 0)
+            close(fd_);
+#endif
+    }
+
+    CycleCounter(const CycleCounter &) = delete;
+    CycleCounter &operator=(const CycleCounter &) = delete;
+
+    Source source() const { return source_; }
+
+    const char *name() const { return source_ == PERF ? "perf" : source_ == RDTSC ? "rdtsc" : "none"; }
+
+    uint64_t now() const {
+#ifdef BENCH_HAVE_PERF
+        uint64_t v = 0;
+        if (source_ == PERF && read(fd_, &v, sizeof(v)) == sizeof(v))
+            return v;
+#endif
+#ifdef BENCH_HAVE_RDTSC
+        if (source_ == RDTSC)
+            return __rdtsc();
+#endif
+        return 0;
+    }
+
+  private:
+    Source source_ = NONE;
+    int fd_ = -1;
+};
+
+struct Options {
+    double min_time = BENCH_DEFAULT_MIN_TIME;  // Seconds, for all samples together.
+    size_t samples = BENCH_DEFAULT_SAMPLES;
+    double warmup = BENCH_WARMUP_TIME;
+};
+
+struct Stats {
+    uint64_t iterations = 0;  // Per sample.
+    size_t samples = 0;
+    double median_ns = 0, p99_ns = 0, min_ns = 0, mean_ns = 0;
+    double median_cycles = 0, p99_cycles = 0;
+};
+
+/**
+ * @brief The q-th quantile (0 < q <= 1) of values, by nearest rank.
+ */
+inline double quantile(std::vector<double> values, double q) {
+    if (values.empty())
+        return 0;
+    size_t rank = (size_t)std::ceil(q * values.size());
+    size_t i = std::min(values.size(), std::max<size_t>(rank, 1)) - 1;
+    std::nth_element(values.begin(), values.begin() + i, values.end());
+    return values[i];
+}
+
+inline Stats summarize(const std::vector<double> &ns, const std::vector<double> &cycles, uint64_t iterations) {
+    Stats s;
+    s.iterations = iterations;
+    s.samples = ns.size();
+    s.median_ns = quantile(ns, 0.5);
+    s.p99_ns = quantile(ns, 0.99);
+    s.min_ns = ns.empty() ? 0 : *std::min_element(ns.begin(), ns.end());
+    for (double v : ns)
+        s.mean_ns += v / ns.size();
+    s.median_cycles = quantile(cycles, 0.5);
+    s.p99_cycles = quantile(cycles, 0.99);
+    return s;
+}
+
+/**
+ * @brief Measures run (a callable taking an iteration count and
+ * returning false to stop early, e.g. on an error). Returns false if it
+ * stopped.
+ */
+template <class F>
+bool measure(F &&run, const Options &options, const CycleCounter &counter, Stats &out) {
+    typedef std::chrono::steady_clock clock;
+    auto seconds = [](clock::duration d) { return std::chrono::duration<double>(d).count(); };
+    clock::time_point start = clock::now();
+    do {
+        if (!run(1))
+            return false;
+    } while (seconds(clock::now() - start) < options.warmup);
+    size_t samples = std::max<size_t>(options.samples, 1);
+    double target = options.min_time / samples;
+    uint64_t iterations = 1;
+    for (;;) {
+        clock::time_point t0 = clock::now();
+        if (!run(iterations))
+            return false;
+        double elapsed = seconds(clock::now() - t0);
+        if (elapsed >= target)
+            break;
+        // Aim 20% past the target, but grow at most 10x per step.
+        double next = elapsed > 0 ? iterations * target / elapsed * 1.2 : iterations * 10.0;
+        iterations = std::max(iterations + 1, (uint64_t)std::min(next, iterations * 10.0));
+    }
+    std::vector<double> ns, cycles;
+    for (size_t i = 0; i < samples; ++i) {
+        uint64_t c0 = counter.now();
+        clock::time_point t0 = clock::now();
+        if (!run(iterations))
+            return false;
+        double elapsed = seconds(clock::now() - t0);
+        uint64_t c1 = counter.now();
+        ns.push_back(elapsed * 1e9 / iterations);
+        if (counter.source() != CycleCounter::NONE)
+            cycles.push_back((double)(c1 - c0) / iterations);
+    }
+    out = summarize(ns, cycles, iterations);
+    return true;
+}
+
+/**
+ * @brief Pins the calling thread to a CPU. Returns false if that is not
+ * possible (or not supported here).
+ */
+inline bool pin_thread(int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return cpu >= 0 && cpu < CPU_SETSIZE && pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+struct Throughput {
+    uint64_t items = 0;
+    double seconds = 0;
+    bool pinned = true;  // Whether every thread that was asked to be pinned was.
+};
+
+/**
+ * @brief Runs batches on threads for min_time seconds. make(thread)
+ * returns that thread's batch, a function doing some work and returning
+ * how many items it did. Thread i is pinned to cpus[i % cpus.size()]
+ * unless cpus is empty.
+ */
+template <class Make>
+Throughput run_threads(int threads, const std::vector<int> &cpus, double min_time, Make &&make) {
+    typedef std::chrono::steady_clock clock;
+    std::atomic<int> ready{0};
+    std::atomic<bool> go{false}, stop{false}, pinned{true};
+    std::atomic<uint64_t> items{0};
+    auto worker = [&](int index) {
+        if (!cpus.empty() && !pin_thread(cpus[index % cpus.size()]))
+            pinned = false;
+        std::function<uint64_t()> batch = make(index);
+        batch();  // Warm up.
+        ready.fetch_add(1);
+        while (!go.load(std::memory_order_acquire))
+            std::this_thread::yield();
+        uint64_t done = 0;
+        while (!stop.load(std::memory_order_relaxed))
+            done += batch();
+        items.fetch_add(done);
+    };
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; ++i)
+        workers.emplace_back(worker, i);
+    while (ready.load() < threads)
+        std::this_thread::yield();
+    clock::time_point t0 = clock::now();
+    go.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(std::chrono::duration<double>(min_time));
+    stop = true;
+    for (std::thread &w : workers)
+        w.join();
+    Throughput out;
+    out.seconds = std::chrono::duration<double>(clock::now() - t0).count();
+    out.items = items.load();
+    out.pinned = pinned.load();
+    return out;
+}
+
+}  // namespace bench
+
+#endif  // PYCOIN_BENCH_H
@@ -1,52 +1,357 @@
 # !usr/bin/env python3
 
 
-def affine_point_add() -> None:
-    ...
+"""Micro-benchmarks of the elliptic curve, hashing and signature
+primitives, native and pure-Python side by side.
 
+Each function below benchmarks one primitive twice: the native version
+from the headers (through the microbench extension, see microbench.cpp
+and bench.h) and the pure-Python one (secp256k1.py, utils.py,
+reconcile.py), both in the same harness. secp256k1.py uses the
+fastest inverse, public key and hash implementations backends.py finds,
+native ones when built; while the Python column is timed they are
+rebound to the Python references (pure_python()). The harness warms up, grows
+the iteration count until a sample takes long enough to time, then
+reports the median and the 99th percentile of the time (and, where a
+cycle counter is available, the cycles) per iteration over the samples.
 
-def affine_point_multiply() -> None:
-    ...
+When microbench is not built, the Python versions are still measured,
+by a harness in Python that works the same way, without cycle counts.
 
+The call benchmarks (CALLS) time one call of an extension function
+from Python, with small arguments, against the pure-Python (or builtin)
+equivalent, both through the same harness. For those, the cost is
+mostly the call itself: argument passing and parsing, and boxing the
+result. Their native column is empty when the extension is not built.
 
-def point_add() -> None:
-    ...
+Run as a script to print a table, or write JSON (one object per
+primitive) with --json to compare runs:
 
+    python -m src.benchmark --json before.json
+    python -m src.benchmark point_multiply ecdsa_verify --time 1
+    python -m src.benchmark modinv_call siphash_call
+"""
 
-def point_multiply() -> None:
-    ...
+from __future__ import annotations
 
+import argparse
+import contextlib
+import json
+import math
+import platform
+import struct
+import sys
+import time
+from typing import Callable, Iterator, NamedTuple
 
-def signature_encode() -> None:
-    ...
+from . import secp256k1
+from .network import MAGIC
+from .reconcile import py_siphash
+from .secp256k1 import G, AffinePoint, p
+from .utils import py_sha256d
 
+try:
+    from . import microbench  # type: ignore
+except ImportError:
+    microbench = None
 
-def signature_decode() -> None:
-    ...
+try:
+    from . import fastinv  # type: ignore
+except ImportError:
+    fastinv = None
 
+try:
+    from . import siphash  # type: ignore
+except ImportError:
+    siphash = None
 
-def ecdsa_generate() -> None:
-    ...
+try:
+    from . import netcodec  # type: ignore
+except ImportError:
+    netcodec = None
 
+MIN_TIME = 0.2  # Seconds per backend and primitive, over all samples.
+SAMPLES = 31
+WARMUP = 0.05
 
-def ecdsa_verify() -> None:
-    ...
+KEY = 0x18E14A7B6A307F426A94F8114701E7C8E774E7F9A47E2C2035DB29A206321725
+MESSAGE = b"PyCoin benchmark"
 
 
-def double_hash_sha256() -> None:
-    ...
+class Comparison(NamedTuple):
+    name: str
+    native: dict | None  # Statistics per iteration, None if microbench is not built.
+    python: dict
 
+    @property
+    def speedup(self) -> float | None:
+        if self.native is None:
+            return None
+        return self.python["median_ns"] / self.native["median_ns"]
 
-def siphash_2_4() -> None:
-    ...
+    def to_json(self) -> dict:
+        return {**self._asdict(), "speedup": self.speedup}
 
 
-def invert() -> None:
-    ...
+def _quantile(values: list[float], q: float) -> float:
+    values = sorted(values)
+    return values[min(len(values), max(math.ceil(q * len(values)), 1)) - 1]
 
 
-def main() -> None:
-    ...
+def py_measure(func: Callable[[], object], min_time: float = MIN_TIME, samples: int = SAMPLES) -> dict:
+    """The harness of bench.h in Python, timing calls of func."""
+    if not min_time > 0 or samples <= 0:
+        raise ValueError("min_time and samples must be positive.")
+    clock = time.perf_counter_ns
+    start, warmup = clock(), min(WARMUP, min_time / 4) * 1e9
+    while clock() - start < warmup:
+        func()
+    target, iterations = min_time / samples * 1e9, 1
+    while True:
+        t0 = clock()
+        for _ in range(iterations):
+            func()
+        elapsed = clock() - t0
+        if elapsed >= target:
+            break
+        step = iterations * target / elapsed * 1.2 if elapsed else iterations * 10
+        iterations = max(iterations + 1, int(min(step, iterations * 10)))
+    ns = []
+    for _ in range(samples):
+        t0 = clock()
+        for _ in range(iterations):
+            func()
+        ns.append((clock() - t0) / iterations)
+    return {
+        "iterations": iterations,
+        "samples": samples,
+        "median_ns": _quantile(ns, 0.5),
+        "p99_ns": _quantile(ns, 0.99),
+        "min_ns": min(ns),
+        "mean_ns": sum(ns) / len(ns),
+        "median_cycles": None,
+        "p99_cycles": None,
+        "counter": "none",
+    }
+
+
+measure = microbench.measure if microbench is not None else py_measure
+
+
+@contextlib.contextmanager
+def pure_python() -> Iterator[None]:
+    """Makes secp256k1.py use the Python references of the primitives it
+    takes from backends.py (Point.affine(), sign_hash(), verify_hash()
+    and the hashing of messages), instead of the native ones."""
+    saved = secp256k1.inverse, secp256k1.public_key, secp256k1.sha256d
+    secp256k1.inverse, secp256k1.public_key, secp256k1.sha256d = (
+        secp256k1.py_inverse,
+        secp256k1.py_public_key,
+        py_sha256d,
+    )
+    try:
+        yield
+    finally:
+        secp256k1.inverse, secp256k1.public_key, secp256k1.sha256d = saved
+
+
+def _compare(name: str, func: Callable[[], object], min_time: float, samples: int) -> Comparison:
+    native = None
+    if microbench is not None:
+        native = microbench.run(name, min_time=min_time, samples=samples)
+    with pure_python():
+        return Comparison(name, native, measure(func, min_time=min_time, samples=samples))
+
+
+def _chain(step: Callable[[object], object], value: object) -> Callable[[], None]:
+    """A callable applying step to its own last result, like the native
+    kernels do."""
+    state = [value]
+
+    def run() -> None:
+        state[0] = step(state[0])
+
+    return run
+
+
+def affine_point_add(min_time: float = MIN_TIME, samples: int = SAMPLES) -> Comparison:
+    a, b = (2 * G).affine(), (3 * G).affine()  # type: ignore
+    return _compare("affine_point_add", _chain(lambda x: x + b, a), min_time, samples)
+
+
+def affine_point_multiply(min_time: float = MIN_TIME, samples: int = SAMPLES) -> Comparison:
+    a: AffinePoint = (2 * G).affine()  # type: ignore
+    return _compare("affine_point_multiply", _chain(lambda x: x * KEY, a), min_time, samples)
+
+
+def point_add(min_time: float = MIN_TIME, samples: int = SAMPLES) -> Comparison:
+    a, b = 2 * G, 3 * G
+    return _compare("point_add", _chain(lambda x: x + b, a), min_time, samples)
+
+
+def point_multiply(min_time: float = MIN_TIME, samples: int = SAMPLES) -> Comparison:
+    return _compare("point_multiply", _chain(lambda x: x * KEY, 2 * G), min_time, samples)
+
+
+def signature_encode(min_time: float = MIN_TIME, samples: int = SAMPLES) -> Comparison:
+    signature = secp256k1.generate(KEY, MESSAGE)
+    return _compare("signature_encode", lambda: secp256k1.encode(signature), min_time, samples)
+
+
+def signature_decode(min_time: float = MIN_TIME, samples: int = SAMPLES) -> Comparison:
+    encoded = secp256k1.encode(secp256k1.generate(KEY, MESSAGE))
+    return _compare("signature_decode", lambda: secp256k1.decode(encoded), min_time, samples)
+
+
+def ecdsa_generate(min_time: float = MIN_TIME, samples: int = SAMPLES) -> Comparison:
+    return _compare("ecdsa_generate", lambda: secp256k1.generate(KEY, MESSAGE), min_time, samples)
+
+
+def ecdsa_verify(min_time: float = MIN_TIME, samples: int = SAMPLES) -> Comparison:
+    signature, pubkey = secp256k1.generate(KEY, MESSAGE), KEY * G
+    return _compare("ecdsa_verify", lambda: secp256k1.verify(signature, pubkey, MESSAGE), min_time, samples)
+
+
+def double_hash_sha256(min_time: float = MIN_TIME, samples: int = SAMPLES) -> Comparison:
+    step = lambda header: header[:4] + py_sha256d(header) + header[36:]  # noqa: E731
+    return _compare("double_hash_sha256", _chain(step, bytes(80)), min_time, samples)
+
+
+def siphash_2_4(min_time: float = MIN_TIME, samples: int = SAMPLES) -> Comparison:
+    k0, k1 = 0x0706050403020100, 0x0F0E0D0C0B0A0908
+    step = lambda data: py_siphash(k0, k1, data).to_bytes(8, "little") + data[8:]  # noqa: E731
+    return _compare("siphash_2_4", _chain(step, KEY.to_bytes(32, "big")), min_time, samples)
+
+
+def invert(min_time: float = MIN_TIME, samples: int = SAMPLES) -> Comparison:
+    return _compare("invert", _chain(lambda x: pow(x, -1, p), KEY % p), min_time, samples)
+
+
+BENCHMARKS: dict[str, Callable[..., Comparison]] = {
+    f.__name__: f
+    for f in (
+        affine_point_add,
+        affine_point_multiply,
+        point_add,
+        point_multiply,
+        signature_encode,
+        signature_decode,
+        ecdsa_generate,
+        ecdsa_verify,
+        double_hash_sha256,
+        siphash_2_4,
+        invert,
+    )
+}
+
+
+def _compare_calls(
+    name: str, native: Callable[[], object] | None, python: Callable[[], object], min_time: float, samples: int
+) -> Comparison:
+    stats = None if native is None else measure(native, min_time=min_time, samples=samples)
+    return Comparison(name, stats, measure(python, min_time=min_time, samples=samples))
+
+
+def modinv_call(min_time: float = MIN_TIME, samples: int = SAMPLES) -> Comparison:
+    native = (lambda: fastinv.modinv(3, 1_000_003)) if fastinv is not None else None
+    return _compare_calls("modinv_call", native, lambda: pow(3, -1, 1_000_003), min_time, samples)
+
+
+def modexp_call(min_time: float = MIN_TIME, samples: int = SAMPLES) -> Comparison:
+    g, k, q = 3, 0x1F2E3D4C5B6A7988, (1 << 61) - 1
+    native = (lambda: fastinv.modexp(g, k, q)) if fastinv is not None else None
+    return _compare_calls("modexp_call", native, lambda: pow(g, k, q), min_time, samples)
+
+
+def siphash_call(min_time: float = MIN_TIME, samples: int = SAMPLES) -> Comparison:
+    k0, k1, data = 0x0706050403020100, 0x0F0E0D0C0B0A0908, KEY.to_bytes(32, "big")
+    native = (lambda: siphash.siphash(k0, k1, data)) if siphash is not None else None
+    return _compare_calls("siphash_call", native, lambda: py_siphash(k0, k1, data), min_time, samples)
+
+
+def sha256d_call(min_time: float = MIN_TIME, samples: int = SAMPLES) -> Comparison:
+    header = bytes(80)
+    native = (lambda: netcodec.sha256d(header)) if netcodec is not None else None
+    return _compare_calls("sha256d_call", native, lambda: py_sha256d(header), min_time, samples)
+
+
+def frame_call(min_time: float = MIN_TIME, samples: int = SAMPLES) -> Comparison:
+    payload = KEY.to_bytes(32, "big")
+    native = (lambda: netcodec.frame(MAGIC, "ping", payload)) if netcodec is not None else None
+
+    def python() -> bytes:
+        return MAGIC + b"ping".ljust(12, b"\0") + struct.pack("<I", len(payload)) + py_sha256d(payload)[:4] + payload
+
+    return _compare_calls("frame_call", native, python, min_time, samples)
+
+
+CALLS: dict[str, Callable[..., Comparison]] = {
+    f.__name__: f for f in (modinv_call, modexp_call, siphash_call, sha256d_call, frame_call)
+}
+
+
+def run(names: list[str] | None = None, min_time: float = MIN_TIME, samples: int = SAMPLES) -> list[Comparison]:
+    benchmarks = {**BENCHMARKS, **CALLS}
+    unknown = set(names or ()) - benchmarks.keys()
+    if unknown:
+        raise ValueError(f"Unknown benchmarks: {', '.join(sorted(unknown))}.")
+    return [benchmarks[name](min_time, samples) for name in names or benchmarks]
+
+
+def _format_ns(ns: float) -> str:
+    for unit, scale in (("s", 1e9), ("ms", 1e6), ("us", 1e3)):
+        if ns >= scale:
+            return f"{ns / scale:.2f} {unit}"
+    return f"{ns:.1f} ns"
+
+
+def report(results: list[Comparison]) -> str:
+    lines = [
+        f"{'benchmark':<22} {'native median':>14} {'p99':>10} {'cycles':>10} "
+        f"{'python median':>14} {'p99':>10} {'speedup':>8}"
+    ]
+    for r in results:
+        native = r.native or {}
+        cycles = native.get("median_cycles")
+        lines.append(
+            f"{r.name:<22} "
+            f"{_format_ns(native['median_ns']) if native else '-':>14} "
+            f"{_format_ns(native['p99_ns']) if native else '-':>10} "
+            f"{f'{cycles:.0f}' if cycles is not None else '-':>10} "
+            f"{_format_ns(r.python['median_ns']):>14} "
+            f"{_format_ns(r.python['p99_ns']):>10} "
+            f"{f'{r.speedup:.1f}x' if r.speedup is not None else '-':>8}"
+        )
+    return "\n".join(lines)
+
+
+def main(argv: list[str] | None = None) -> None:
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument(
+        "names", nargs="*", help=f"benchmarks to run (default all): {', '.join([*BENCHMARKS, *CALLS])}"
+    )
+    parser.add_argument("--time", type=float, default=MIN_TIME, help="seconds per backend and benchmark")
+    parser.add_argument("--samples", type=int, default=SAMPLES)
+    parser.add_argument("--json", metavar="PATH", help="write the results as JSON ('-' for stdout)")
+    args = parser.parse_args(argv)
+    results = run(args.names, args.time, args.samples)
+    if args.json is None:
+        print(report(results))
+        return
+    document = {
+        "machine": platform.machine(),
+        "python": platform.python_version(),
+        "counter": microbench.counter() if microbench is not None else "none",
+        "min_time": args.time,
+        "samples": args.samples,
+        "results": [r.to_json() for r in results],
+    }
+    if args.json == "-":
+        json.dump(document, sys.stdout, indent=2)
+        print()
+    else:
+        with open(args.json, "w") as f:
+            json.dump(document, f, indent=2)
 
 
 if __name__ == "__main__":
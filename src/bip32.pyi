@@ -0,0 +1,12 @@
+def master_key(seed: bytes) -> tuple[bytes, bytes]: ...
+def public_key(key: bytes, compressed: bool = ...) -> bytes: ...
+def derive_private(key: bytes, chain_code: bytes, index: int) -> tuple[bytes, bytes]: ...
+def derive_public(key: bytes, chain_code: bytes, index: int) -> tuple[bytes, bytes]: ...
+def derive_private_range(
+    key: bytes, chain_code: bytes, start: int, stop: int, threads: int = ...
+) -> bytes: ...
+def derive_public_range(
+    key: bytes, chain_code: bytes, start: int, stop: int, threads: int = ...
+) -> bytes: ...
+
+BACKENDS: tuple[tuple[str, str, str], ...]
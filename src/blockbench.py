@@ -0,0 +1,472 @@
+"""End-to-end block validation benchmark: connecting a real block to a
+UTXO set, stage by stage, on 1..N threads.
+
+The block is one of the examples in example_blocks/ (727056 by default,
+2711 transactions). validation.cpp connects it to a Chainstate, timing
+parsing, txid/wtxid hashing, the Merkle and witness commitment checks,
+the input lookups, the script and signature checks and the UTXO set
+update separately (see validation.cpp for what each involves).
+
+The example blocks come from a block explorer, which leaves out the
+txids of the outputs being spent (see netsim.py), so the outpoints are
+made up and the original signatures cannot be checked. prepare()
+therefore rebuilds the block: every input spending a standard template
+(P2PKH, P2WPKH, P2TR key path, multisig in P2SH, P2WSH or P2SH-P2WSH,
+and P2SH-P2WPKH) is given fresh keys and signed again, with the same
+template, number of keys and hash type as the original, and the coins
+it spends (in the UTXO set, or earlier in the block) get the matching
+scripts. Other inputs are kept as they are, and skipped by the
+validator. The values, and so the fees, are the originals. The Merkle
+root and witness commitment are recomputed, so those checks pass; the
+proof of work no longer does, and is not checked.
+
+    python -m src.blockbench --threads 1 2 4 --repeat 5
+    python -m src.blockbench --json results.json
+"""
+
+from __future__ import annotations
+
+import argparse
+import hashlib
+import json
+import os
+import platform
+import statistics
+import struct
+import sys
+import time
+from pathlib import Path
+from typing import NamedTuple, Sequence
+
+from .address import hash160
+from .netsim import EXAMPLE_BLOCKS, NULL_OUTPOINT, header_from_json, merkle_root
+from .secp256k1 import n
+from .signing import SIGHASH_ALL, SIGHASH_DEFAULT, ecdsa_sign, schnorr_sign, tagged_hash
+from .utils import int_to_vint, read_vint, sha256d
+from .wallet import public_key
+
+try:
+    from . import validation  # type: ignore
+except ImportError:
+    validation = None
+
+BLOCK = EXAMPLE_BLOCKS / "727056.json"
+REPEAT = 5
+STAGES = ("parse", "hash", "merkle", "inputs", "scripts", "update")
+SIGHASH_ANYONECANPAY = 0x80
+WITNESS_COMMITMENT = b"\x6a\x24\xaa\x21\xa9\xed"
+
+
+class Prepared(NamedTuple):
+    block: bytes
+    outpoints: bytes  # 36 bytes per coin spent from outside the block.
+    values: list[int]
+    scripts: list[bytes]
+    resigned: int  # Inputs signed again.
+    kept: int  # Inputs kept as they were.
+
+    def chainstate(self) -> validation.Chainstate:
+        return validation.Chainstate(self.outpoints, self.values, self.scripts)
+
+
+class Result(NamedTuple):
+    threads: int
+    stages: dict[str, float]  # Median seconds per stage.
+    total: float  # Median of the sum of the stages.
+    wall: float  # Median time of the whole call, in seconds.
+    txs: int
+    inputs: int
+    signatures: int
+    skipped: int
+
+    @property
+    def ns_per_tx(self) -> float:
+        return self.total / self.txs * 1e9
+
+
+# Scripts.
+
+
+def _push(data: bytes) -> bytes:
+    if len(data) < 0x4C:
+        return bytes([len(data)]) + data
+    if len(data) <= 0xFF:
+        return b"\x4c" + bytes([len(data)]) + data
+    return b"\x4d" + struct.pack("<H", len(data)) + data
+
+
+def _pushes(script: bytes) -> list[bytes] | None:
+    """The data pushed by a push-only script, or None."""
+    items, pos = [], 0
+    while pos < len(script):
+        op, pos = script[pos], pos + 1
+        if op < 0x4C:
+            length = op
+        elif op == 0x4C:
+            length, pos = script[pos], pos + 1
+        elif op == 0x4D:
+            length, pos = struct.unpack_from("<H", script, pos)[0], pos + 2
+        else:
+            return None
+        items.append(script[pos : pos + length])
+        pos += length
+    return items
+
+
+def _witness_items(witness: bytes) -> list[bytes]:
+    if not witness:
+        return []
+    count, pos = read_vint(witness)
+    items = []
+    for _ in range(count):
+        length, pos = read_vint(witness, pos)
+        items.append(witness[pos : pos + length])
+        pos += length
+    return items
+
+
+def _serialize_witness(items: list[bytes]) -> bytes:
+    return int_to_vint(len(items)) + b"".join(int_to_vint(len(item)) + item for item in items)
+
+
+def _multisig(script: bytes) -> tuple[int, int] | None:
+    """(m, n) of OP_m <keys> OP_n OP_CHECKMULTISIG."""
+    if len(script) < 3 or script[-1] != 0xAE or not 0x51 <= script[0] <= 0x60 or not 0x51 <= script[-2] <= 0x60:
+        return None
+    return script[0] - 0x50, script[-2] - 0x50
+
+
+def _multisig_script(m: int, pubkeys: list[bytes]) -> bytes:
+    return bytes([0x50 + m]) + b"".join(_push(key) for key in pubkeys) + bytes([0x50 + len(pubkeys), 0xAE])
+
+
+def _p2sh(script: bytes) -> bytes:
+    return b"\xa9\x14" + hash160(script) + b"\x87"
+
+
+def _p2wsh(script: bytes) -> bytes:
+    return b"\x00\x20" + hashlib.sha256(script).digest()
+
+
+def _hash_type(sig: bytes) -> int:
+    """The hash type of a signature, if it is one the benchmark signs with."""
+    return sig[-1] if sig and sig[-1] in {SIGHASH_ALL, SIGHASH_ALL | SIGHASH_ANYONECANPAY} else SIGHASH_ALL
+
+
+class _Plan(NamedTuple):
+    """How an input is signed again."""
+
+    kind: str  # p2pkh, p2wpkh, p2sh-p2wpkh, p2wsh, p2sh-p2wsh, p2sh, p2tr.
+    m: int
+    keys: list[bytes]
+    hash_type: int
+
+    @property
+    def pubkeys(self) -> list[bytes]:
+        return [public_key(key) for key in self.keys]
+
+    def redeem(self) -> bytes:
+        """The witness script of multisig spends, else the redeem script."""
+        if self.kind == "p2sh-p2wpkh":
+            return b"\x00\x14" + hash160(self.pubkeys[0])
+        return _multisig_script(self.m, self.pubkeys)
+
+    def script(self) -> bytes:
+        """The script of the output spent."""
+        pubkey = self.pubkeys[0]
+        if self.kind == "p2pkh":
+            return b"\x76\xa9\x14" + hash160(pubkey) + b"\x88\xac"
+        if self.kind == "p2wpkh":
+            return b"\x00\x14" + hash160(pubkey)
+        if self.kind == "p2tr":
+            return b"\x51\x20" + pubkey[1:]
+        if self.kind == "p2wsh":
+            return _p2wsh(self.redeem())
+        if self.kind == "p2sh-p2wsh":
+            return _p2sh(_p2wsh(self.redeem()))
+        return _p2sh(self.redeem())
+
+
+def _key(*index: int) -> bytes:
+    d = int.from_bytes(hashlib.sha256(b"blockbench" + struct.pack("<III", *index)).digest(), "big") % n
+    return (d or 1).to_bytes(32, "big")
+
+
+def _plan(t: int, i: int, prev_script: bytes, script_sig: bytes, witness: bytes) -> _Plan | None:
+    """The template of an input, with fresh keys, or None to keep it."""
+    pushes, items = _pushes(script_sig), _witness_items(witness)
+    if pushes is None:
+        return None
+    kind, m, count, sig = None, 1, 1, b""
+    if len(prev_script) == 25 and prev_script[:3] == b"\x76\xa9\x14" and len(pushes) == 2:
+        kind, sig = "p2pkh", pushes[0]
+    elif len(prev_script) == 22 and prev_script[:2] == b"\x00\x14" and len(items) == 2:
+        kind, sig = "p2wpkh", items[0]
+    elif len(prev_script) == 34 and prev_script[:2] == b"\x51\x20" and len(items) == 1 and len(items[0]) in {64, 65}:
+        kind = "p2tr"
+    elif len(prev_script) == 34 and prev_script[:2] == b"\x00\x20" and items and _multisig(items[-1]):
+        kind, (m, count), sig = "p2wsh", _multisig(items[-1]), items[1] if len(items) > 2 else b""
+    elif len(prev_script) == 23 and prev_script[:2] == b"\xa9\x14" and pushes:
+        redeem = pushes[-1]
+        if len(redeem) == 22 and redeem[:2] == b"\x00\x14" and len(items) == 2:
+            kind, sig = "p2sh-p2wpkh", items[0]
+        elif len(redeem) == 34 and redeem[:2] == b"\x00\x20" and items and _multisig(items[-1]):
+            kind, (m, count), sig = "p2sh-p2wsh", _multisig(items[-1]), items[1] if len(items) > 2 else b""
+        elif not items and _multisig(redeem):
+            kind, (m, count), sig = "p2sh", _multisig(redeem), pushes[1] if len(pushes) > 2 else b""
+    if kind is None:
+        return None
+    hash_type = SIGHASH_DEFAULT if kind == "p2tr" else _hash_type(sig)
+    return _Plan(kind, m, [_key(t, i, j) for j in range(count)], hash_type)
+
+
+# Signature hashes.
+
+
+class _Tx(NamedTuple):
+    version: bytes
+    inputs: list[list]  # [outpoint, script_sig, sequence, witness (serialized)]
+    outputs: list[tuple[int, bytes]]
+    locktime: bytes
+
+    def outputs_data(self) -> bytes:
+        return b"".join(struct.pack("<q", value) + int_to_vint(len(s)) + s for value, s in self.outputs)
+
+    def serialize(self, witnesses: bool = True) -> bytes:
+        body = int_to_vint(len(self.inputs))
+        for outpoint, script_sig, sequence, _ in self.inputs:
+            body += outpoint + int_to_vint(len(script_sig)) + script_sig + struct.pack("<I", sequence)
+        body += int_to_vint(len(self.outputs)) + self.outputs_data()
+        if not witnesses or not any(i[3] for i in self.inputs):
+            return self.version + body + self.locktime
+        witness = b"".join(i[3] or b"\x00" for i in self.inputs)
+        return self.version + b"\x00\x01" + body + witness + self.locktime
+
+    def legacy_sighash(self, i: int, script_code: bytes, hash_type: int) -> bytes:
+        indexes = [i] if hash_type & SIGHASH_ANYONECANPAY else range(len(self.inputs))
+        data = self.version + int_to_vint(len(indexes))
+        for j in indexes:
+            outpoint, _, sequence, _ = self.inputs[j]
+            script = int_to_vint(len(script_code)) + script_code if j == i else b"\x00"
+            data += outpoint + script + struct.pack("<I", sequence)
+        data += int_to_vint(len(self.outputs)) + self.outputs_data() + self.locktime
+        return sha256d(data + struct.pack("<I", hash_type))
+
+    def segwit_sighash(self, i: int, script_code: bytes, amount: int, hash_type: int) -> bytes:
+        anyone = hash_type & SIGHASH_ANYONECANPAY
+        prevouts = bytes(32) if anyone else sha256d(b"".join(x[0] for x in self.inputs))
+        sequences = bytes(32) if anyone else sha256d(b"".join(struct.pack("<I", x[2]) for x in self.inputs))
+        outpoint, _, sequence, _ = self.inputs[i]
+        data = self.version + prevouts + sequences + outpoint + int_to_vint(len(script_code)) + script_code
+        data += struct.pack("<qI", amount, sequence) + sha256d(self.outputs_data()) + self.locktime
+        return sha256d(data + struct.pack("<I", hash_type))
+
+    def taproot_sighash(self, i: int, amounts: list[int], scripts: list[bytes]) -> bytes:
+        sha = lambda data: hashlib.sha256(data).digest()  # noqa: E731
+        data = bytes([0, SIGHASH_DEFAULT]) + self.version + self.locktime
+        data += sha(b"".join(x[0] for x in self.inputs))
+        data += sha(b"".join(struct.pack("<q", amount) for amount in amounts))
+        data += sha(b"".join(int_to_vint(len(s)) + s for s in scripts))
+        data += sha(b"".join(struct.pack("<I", x[2]) for x in self.inputs))
+        data += sha(self.outputs_data()) + b"\x00" + struct.pack("<I", i)
+        return tagged_hash("TapSighash", data)
+
+
+def _sign(tx: _Tx, i: int, plan: _Plan, amount: int, amounts: list[int], scripts: list[bytes]) -> None:
+    """Fills in the script_sig and witness of input i."""
+    if plan.kind == "p2tr":
+        tx.inputs[i][1] = b""
+        tx.inputs[i][3] = _serialize_witness([schnorr_sign(plan.keys[0], tx.taproot_sighash(i, amounts, scripts))])
+        return
+    pubkeys, redeem, hash_type = plan.pubkeys, plan.redeem(), bytes([plan.hash_type])
+    if plan.kind in {"p2pkh", "p2wpkh", "p2sh-p2wpkh"}:
+        script_code = b"\x76\xa9\x14" + hash160(pubkeys[0]) + b"\x88\xac"
+        if plan.kind == "p2pkh":
+            sig = ecdsa_sign(plan.keys[0], tx.legacy_sighash(i, script_code, plan.hash_type)) + hash_type
+            tx.inputs[i][1], tx.inputs[i][3] = _push(sig) + _push(pubkeys[0]), b""
+            return
+        sig = ecdsa_sign(plan.keys[0], tx.segwit_sighash(i, script_code, amount, plan.hash_type)) + hash_type
+        tx.inputs[i][1] = _push(redeem) if plan.kind == "p2sh-p2wpkh" else b""
+        tx.inputs[i][3] = _serialize_witness([sig, pubkeys[0]])
+        return
+    if plan.kind == "p2sh":
+        digest = tx.legacy_sighash(i, redeem, plan.hash_type)
+        sigs = [ecdsa_sign(key, digest) + hash_type for key in plan.keys[: plan.m]]
+        tx.inputs[i][1], tx.inputs[i][3] = b"\x00" + b"".join(_push(sig) for sig in sigs) + _push(redeem), b""
+        return
+    digest = tx.segwit_sighash(i, redeem, amount, plan.hash_type)
+    sigs = [ecdsa_sign(key, digest) + hash_type for key in plan.keys[: plan.m]]
+    tx.inputs[i][1] = _push(_p2wsh(redeem)) if plan.kind == "p2sh-p2wsh" else b""
+    tx.inputs[i][3] = _serialize_witness([b""] + sigs + [redeem])
+
+
+def prepare(path: str | Path = BLOCK) -> Prepared:
+    """Loads an example block and signs it again (see the module
+    docstring), returning it with the UTXO set it spends from."""
+    with open(path) as f:
+        block = json.load(f)
+    position = {tx["tx_index"]: t for t, tx in enumerate(block["tx"])}
+    txs: list[_Tx] = []
+    plans: dict[tuple[int, int], _Plan] = {}
+    # New scripts for the outputs spent within the block, by (tx, n).
+    scripts: dict[tuple[int, int], bytes] = {}
+    for t, tx in enumerate(block["tx"]):
+        inputs = []
+        for i, x in enumerate(tx["inputs"]):
+            prev = x["prev_out"]
+            script_sig, witness = bytes.fromhex(x["script"]), bytes.fromhex(x["witness"])
+            inputs.append([b"", script_sig, x["sequence"], witness])
+            if t == 0:
+                continue
+            plan = _plan(t, i, bytes.fromhex(prev["script"]), script_sig, witness)
+            if plan is not None:
+                plans[t, i] = plan
+                if prev["tx_index"] in position:
+                    scripts[position[prev["tx_index"]], prev["n"]] = plan.script()
+        outputs = [(o["value"], bytes.fromhex(o["script"])) for o in tx["out"]]
+        txs.append(_Tx(struct.pack("<I", tx["ver"] & 0xFFFFFFFF), inputs, outputs, struct.pack("<I", tx["lock_time"])))
+    for (t, o), script in scripts.items():
+        txs[t].outputs[o] = (txs[t].outputs[o][0], script)
+    coins: list[tuple[bytes, int, bytes]] = []
+    txids: list[bytes] = []
+    for t, (tx, data) in enumerate(zip(txs, block["tx"])):
+        spent = []  # (amount, script) per input.
+        for i, x in enumerate(data["inputs"]):
+            prev = x["prev_out"]
+            if (prev["tx_index"], prev["n"]) == NULL_OUTPOINT:
+                tx.inputs[i][0] = bytes(32) + struct.pack("<I", 0xFFFFFFFF)
+                continue
+            plan = plans.get((t, i))
+            script = plan.script() if plan else bytes.fromhex(prev["script"])
+            if prev["tx_index"] in position:
+                txid = txids[position[prev["tx_index"]]]
+            else:
+                txid = sha256d(struct.pack("<Q", prev["tx_index"]))
+                coins.append((txid + struct.pack("<I", prev["n"]), prev["value"], script))
+            tx.inputs[i][0] = txid + struct.pack("<I", prev["n"])
+            spent.append((prev["value"], script))
+        amounts, spent_scripts = [a for a, _ in spent], [s for _, s in spent]
+        for i in range(len(tx.inputs) if t else 0):
+            if (t, i) in plans:
+                _sign(tx, i, plans[t, i], amounts[i], amounts, spent_scripts)
+        txids.append(sha256d(tx.serialize(witnesses=False)))
+    # The witness commitment, then the Merkle root (over the new coinbase).
+    wtxids = [bytes(32)] + [sha256d(tx.serialize()) for tx in txs[1:]]
+    reserved = _witness_items(txs[0].inputs[0][3])
+    coinbase = txs[0]
+    for o, (value, script) in enumerate(coinbase.outputs):
+        if script.startswith(WITNESS_COMMITMENT) and reserved:
+            commitment = sha256d(merkle_root(wtxids) + reserved[0])
+            coinbase.outputs[o] = (value, script[:6] + commitment + script[38:])
+    txids[0] = sha256d(coinbase.serialize(witnesses=False))
+    header = header_from_json({**block, "mrkl_root": merkle_root(txids)[::-1].hex()})
+    raw = header + int_to_vint(len(txs)) + b"".join(tx.serialize() for tx in txs)
+    inputs = sum(len(tx.inputs) for tx in txs[1:])
+    return Prepared(
+        raw,
+        b"".join(c[0] for c in coins),
+        [c[1] for c in coins],
+        [c[2] for c in coins],
+        len(plans),
+        inputs - len(plans),
+    )
+
+
+def _require() -> None:
+    if validation is None:
+        raise RuntimeError("the validation extension is not built.")
+
+
+def run(prepared: Prepared, threads: Sequence[int] = (1,), repeat: int = REPEAT) -> list[Result]:
+    """Connects the block repeat times per thread count (without keeping
+    it), returning the median times."""
+    _require()
+    if repeat <= 0 or any(t <= 0 for t in threads):
+        raise ValueError("threads and repeat must be positive.")
+    chainstate = prepared.chainstate()
+    results = []
+    for count in threads:
+        runs, walls = [], []
+        for _ in range(repeat):
+            start = time.perf_counter()
+            result = chainstate.connect(prepared.block, threads=count)
+            walls.append(time.perf_counter() - start)
+            runs.append(result)
+        stages = {stage: statistics.median(r["stages"][stage] for r in runs) for stage in STAGES}
+        last = runs[-1]
+        results.append(
+            Result(
+                count,
+                stages,
+                statistics.median(sum(r["stages"].values()) for r in runs),
+                statistics.median(walls),
+                last["txs"],
+                last["inputs"],
+                last["signatures"],
+                last["skipped"],
+            )
+        )
+    return results
+
+
+def report(results: list[Result]) -> str:
+    lines = [
+        f"{'threads':>7} "
+        + " ".join(f"{stage:>9}" for stage in STAGES)
+        + f" {'total':>9} {'wall':>9} {'per tx':>9} {'speedup':>8}"
+    ]
+    base = results[0].total if results else 0
+    for r in results:
+        lines.append(
+            f"{r.threads:>7} "
+            + " ".join(f"{r.stages[stage] * 1e3:>7.2f}ms" for stage in STAGES)
+            + f" {r.total * 1e3:>7.1f}ms {r.wall * 1e3:>7.1f}ms {r.ns_per_tx / 1e3:>7.1f}us {base / r.total:>7.2f}x"
+        )
+    if results:
+        r = results[0]
+        lines.append(f"{r.txs} txs, {r.inputs} inputs, {r.signatures} signatures, {r.skipped} inputs skipped")
+    return "\n".join(lines)
+
+
+def _default_threads() -> list[int]:
+    cpus, counts = os.cpu_count() or 1, [1]
+    while counts[-1] * 2 <= cpus:
+        counts.append(counts[-1] * 2)
+    if counts[-1] != cpus:
+        counts.append(cpus)
+    return counts
+
+
+def main(argv: list[str] | None = None) -> None:
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--block", default=str(BLOCK), help="example block (JSON)")
+    parser.add_argument("--threads", type=int, nargs="+", default=None, help="thread counts (default 1, 2, 4... cpus)")
+    parser.add_argument("--repeat", type=int, default=REPEAT)
+    parser.add_argument("--json", metavar="PATH", help="write the results as JSON ('-' for stdout)")
+    args = parser.parse_args(argv)
+    _require()
+    prepared = prepare(args.block)
+    results = run(prepared, args.threads or _default_threads(), args.repeat)
+    if args.json is None:
+        print(report(results))
+        return
+    document = {
+        "machine": platform.machine(),
+        "python": platform.python_version(),
+        "cpus": os.cpu_count(),
+        "block": Path(args.block).name,
+        "repeat": args.repeat,
+        "resigned": prepared.resigned,
+        "kept": prepared.kept,
+        "results": [{**r._asdict(), "ns_per_tx": r.ns_per_tx} for r in results],
+    }
+    if args.json == "-":
+        json.dump(document, sys.stdout, indent=2)
+        print()
+    else:
+        with open(args.json, "w") as f:
+            json.dump(document, f, indent=2)
+
+
+if __name__ == "__main__":
+    main()
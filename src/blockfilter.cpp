@@ -0,0 +1,487 @@
+/**
+ * @file blockfilter.cpp
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief C++ Python Extension for BIP158 block filters and wallet rescans.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "blockparser.h"
+#include "gcs.h"
+#include "pymodule.h"
+
+ /* A rescan finds the outputs paying to a wallet (and the inputs
+    spending them) in every block since the wallet's birthday. Parsing
+    every block is what makes that slow, so it is done in two steps:
+
+        1. Scanner.match() checks the wallet's scripts against the BIP158
+           filter of every block (see gcs.h), spread over threads. A
+           filter is about 1/50 the size of its block.
+        2. Scanner.scan() parses only the blocks that matched, straight
+           from the bytes BlockStore maps (see blockparser.h), and
+           returns the outputs paying to the wallet and the inputs
+           spending outputs found so far.
+
+    Filters also match blocks that spend from the wallet, since they
+    include the scripts of the outputs being spent; and a false positive
+    (1 in 784931 per script) only costs parsing one more block.
+ */
+
+#define OUTPOINT_SIZE 36
+
+using blockparser::Block;
+using blockparser::Tx;
+
+/**
+ * @brief The scripts in a filter: every output script except empty and
+ * OP_RETURN ones, and the scripts of the outputs spent, once each.
+ */
+static std::vector<std::string> filter_items(const Block &block, const std::vector<std::string> &spent) {
+    std::unordered_set<std::string> seen;
+    std::vector<std::string> items;
+    for (const blockparser::Output &out : block.outputs) {
+        if (out.script.len == 0 || out.script.data[0] == 0x6A)
+            continue;
+        std::string script(reinterpret_cast<const char *>(out.script.data), out.script.len);
+        if (seen.insert(script).second)
+            items.push_back(std::move(script));
+    }
+    for (const std::string &script : spent)
+        if (!script.empty() && seen.insert(script).second)
+            items.push_back(script);
+    return items;
+}
+
+static bool parse(const Py_buffer &buf, Block &block) {
+    if (!blockparser::parse_block(static_cast<const uint8_t *>(buf.buf), buf.len, block)) {
+        PyErr_SetString(PyExc_ValueError, "malformed block.");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Copies a sequence of bytes-like objects into strings.
+ */
+static bool get_strings(PyObject *seq, std::vector<std::string> &out) {
+    PyObject *it = PyObject_GetIter(seq);
+    if (!it)
+        return false;
+    PyObject *item;
+    while ((item = PyIter_Next(it))) {
+        Py_buffer buf;
+        if (PyObject_GetBuffer(item, &buf, PyBUF_SIMPLE) < 0) {
+            Py_DECREF(item);
+            break;
+        }
+        out.emplace_back(static_cast<const char *>(buf.buf), buf.len);
+        PyBuffer_Release(&buf);
+        Py_DECREF(item);
+    }
+    Py_DECREF(it);
+    return !PyErr_Occurred();
+}
+
+static PyObject *to_bytes(const uint8_t *data, size_t len) {
+    return PyBytes_FromStringAndSize(reinterpret_cast<const char *>(data), (Py_ssize_t)len);
+}
+
+static PyObject *blockfilter_build(PyObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    Py_buffer data;
+    PyObject *spent_seq = NULL;
+    if (!parse_args(args, nargs, "y*|O:build", &data, &spent_seq))
+        return NULL;
+    Block block;
+    std::vector<std::string> spent;
+    PyObject *result = NULL;
+    if (parse(data, block) && (!spent_seq || get_strings(spent_seq, spent))) {
+        uint8_t block_hash[32];
+        sha256::sha256d(block.header, 80, block_hash);
+        std::string filter = gcs::build(gcs::block_key(block_hash), filter_items(block, spent));
+        result = to_bytes(reinterpret_cast<const uint8_t *>(filter.data()), filter.size());
+    }
+    PyBuffer_Release(&data);
+    return result;
+}
+
+static PyObject *blockfilter_match_any(PyObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    Py_buffer filter, block_hash;
+    PyObject *items_seq;
+    if (!parse_args(args, nargs, "y*y*O:match_any", &filter, &block_hash, &items_seq))
+        return NULL;
+    std::vector<std::string> items;
+    PyObject *result = NULL;
+    if (block_hash.len != 32) {
+        PyErr_SetString(PyExc_ValueError, "block_hash must be 32 bytes.");
+    } else if (get_strings(items_seq, items)) {
+        std::vector<uint64_t> hashed;
+        bool match = gcs::match_any(gcs::block_key(static_cast<const uint8_t *>(block_hash.buf)),
+                                    static_cast<const uint8_t *>(filter.buf), filter.len, items.data(), items.size(),
+                                    hashed);
+        result = PyBool_FromLong(match);
+    }
+    PyBuffer_Release(&filter);
+    PyBuffer_Release(&block_hash);
+    return result;
+}
+
+static PyObject *blockfilter_transactions(PyObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    Py_buffer data;
+    if (!parse_args(args, nargs, "y*:transactions", &data))
+        return NULL;
+    Block block;
+    PyObject *result = NULL;
+    if (parse(data, block) && (result = PyList_New((Py_ssize_t)block.txs.size()))) {
+        for (size_t t = 0; t < block.txs.size(); ++t) {
+            const Tx &tx = block.txs[t];
+            uint8_t txid[32];
+            tx.txid(txid);
+            PyObject *inputs = PyList_New(tx.input_count), *outputs = PyList_New(tx.output_count);
+            for (uint32_t i = 0; inputs && i < tx.input_count; ++i)
+                PyList_SET_ITEM(inputs, i, to_bytes(block.input(tx, i).prevout, OUTPOINT_SIZE));
+            for (uint32_t i = 0; outputs && i < tx.output_count; ++i) {
+                const blockparser::Output &out = block.output(tx, i);
+                PyList_SET_ITEM(outputs, i, Py_BuildValue("(Ly#)", (long long)out.value, out.script.data,
+                                                          (Py_ssize_t)out.script.len));
+            }
+            PyObject *item = inputs && outputs ? Py_BuildValue("(y#OO)", txid, (Py_ssize_t)32, inputs, outputs) : NULL;
+            Py_XDECREF(inputs);
+            Py_XDECREF(outputs);
+            if (!item || PyErr_Occurred()) {
+                Py_XDECREF(item);
+                Py_CLEAR(result);
+                break;
+            }
+            PyList_SET_ITEM(result, (Py_ssize_t)t, item);
+        }
+    }
+    PyBuffer_Release(&data);
+    return result;
+}
+
+/* Scanner type. */
+
+typedef struct {
+    PyObject_HEAD
+    std::unordered_set<std::string> *scripts;
+    std::unordered_set<std::string> *outpoints;
+    std::mutex *mu;  // Held while the sets are used (only to copy them in match()).
+} ScannerObject;
+
+static bool add_all(PyObject *seq, std::unordered_set<std::string> *set, Py_ssize_t size) {
+    std::vector<std::string> items;
+    if (!get_strings(seq, items))
+        return false;
+    for (std::string &item : items) {
+        if (size && (Py_ssize_t)item.size() != size) {
+            PyErr_Format(PyExc_ValueError, "outpoints must be %zd bytes.", size);
+            return false;
+        }
+        set->insert(std::move(item));
+    }
+    return true;
+}
+
+static int Scanner_init(ScannerObject *self, PyObject *args, PyObject *kwds) {
+    static const char *kwlist[] = {"scripts", "outpoints", NULL};
+    PyObject *scripts = NULL, *outpoints = NULL;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|OO", const_cast<char **>(kwlist), &scripts, &outpoints))
+        return -1;
+    if (!self->scripts) {
+        self->scripts = new std::unordered_set<std::string>();
+        self->outpoints = new std::unordered_set<std::string>();
+        self->mu = new std::mutex();
+    }
+    ObjectLock lock(*self->mu);
+    self->scripts->clear();
+    self->outpoints->clear();
+    if ((scripts && !add_all(scripts, self->scripts, 0))
+        || (outpoints && !add_all(outpoints, self->outpoints, OUTPOINT_SIZE)))
+        return -1;
+    return 0;
+}
+
+static void Scanner_dealloc(ScannerObject *self) {
+    delete self->scripts;
+    delete self->outpoints;
+    delete self->mu;
+    heap_free(reinterpret_cast<PyObject *>(self));
+}
+
+static bool ready(ScannerObject *self) {
+    if (!self->scripts)
+        PyErr_SetString(PyExc_RuntimeError, "Scanner is not initialized.");
+    return self->scripts != NULL;
+}
+
+static PyObject *Scanner_add_scripts(ScannerObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    PyObject *seq;
+    if (!parse_args(args, nargs, "O:add_scripts", &seq) || !ready(self))
+        return NULL;
+    ObjectLock lock(*self->mu);
+    if (!add_all(seq, self->scripts, 0))
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+static PyObject *Scanner_add_outpoints(ScannerObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    PyObject *seq;
+    if (!parse_args(args, nargs, "O:add_outpoints", &seq) || !ready(self))
+        return NULL;
+    ObjectLock lock(*self->mu);
+    if (!add_all(seq, self->outpoints, OUTPOINT_SIZE))
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+static PyObject *Scanner_match(ScannerObject *self, PyObject *args, PyObject *kwds) {
+    static const char *kwlist[] = {"filters", "block_hashes", "threads", NULL};
+    PyObject *filters_seq, *hashes_seq;
+    int threads = 1;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "OO|i", const_cast<char **>(kwlist), &filters_seq, &hashes_seq,
+                                     &threads)
+        || !ready(self))
+        return NULL;
+    PyObject *filters = PySequence_Fast(filters_seq, "filters must be a sequence.");
+    PyObject *hashes = filters ? PySequence_Fast(hashes_seq, "block_hashes must be a sequence.") : NULL;
+    PyObject *result = NULL;
+    if (hashes && PySequence_Fast_GET_SIZE(filters) != PySequence_Fast_GET_SIZE(hashes)) {
+        PyErr_SetString(PyExc_ValueError, "filters and block_hashes must have the same length.");
+    } else if (hashes) {
+        size_t count = PySequence_Fast_GET_SIZE(filters);
+        std::vector<blockparser::Span> spans(count);
+        std::vector<gcs::Key> keys(count);
+        for (size_t i = 0; i < count && !PyErr_Occurred(); ++i) {
+            char *f, *h;
+            Py_ssize_t flen, hlen;
+            if (PyBytes_AsStringAndSize(PySequence_Fast_GET_ITEM(filters, i), &f, &flen) < 0
+                || PyBytes_AsStringAndSize(PySequence_Fast_GET_ITEM(hashes, i), &h, &hlen) < 0)
+                break;
+            if (hlen != 32) {
+                PyErr_SetString(PyExc_ValueError, "block hashes must be 32 bytes.");
+                break;
+            }
+            spans[i] = blockparser::Span{reinterpret_cast<const uint8_t *>(f), (size_t)flen};
+            keys[i] = gcs::block_key(reinterpret_cast<const uint8_t *>(h));
+        }
+        if (!PyErr_Occurred()) {
+            // A copy, so the GIL can be released while other threads use the Scanner.
+            std::vector<std::string> items;
+            {
+                ObjectLock lock(*self->mu);
+                items.assign(self->scripts->begin(), self->scripts->end());
+            }
+            std::vector<char> matched(count);
+            size_t n = std::max<size_t>(1, std::min<size_t>(std::max(threads, 1), count / 64 + 1));
+            auto work = [&](size_t t) {
+                std::vector<uint64_t> hashed;
+                for (size_t i = t; i < count; i += n)
+                    matched[i] = gcs::match_any(keys[i], spans[i].data, spans[i].len, items.data(), items.size(),
+                                                hashed);
+            };
+            Py_BEGIN_ALLOW_THREADS
+            std::vector<std::thread> workers;
+            for (size_t t = 1; t < n; ++t)
+                workers.emplace_back(work, t);
+            work(0);
+            for (std::thread &w : workers)
+                w.join();
+            Py_END_ALLOW_THREADS
+            result = PyList_New(0);
+            for (size_t i = 0; result && i < count; ++i) {
+                if (!matched[i])
+                    continue;
+                PyObject *index = PyLong_FromSize_t(i);
+                if (!index || PyList_Append(result, index) < 0)
+                    Py_CLEAR(result);
+                Py_XDECREF(index);
+            }
+        }
+    }
+    Py_XDECREF(filters);
+    Py_XDECREF(hashes);
+    return result;
+}
+
+/**
+ * @brief Appends a new tuple to a list, stealing the reference.
+ */
+static bool append(PyObject *list, PyObject *item) {
+    bool ok = item && PyList_Append(list, item) == 0;
+    Py_XDECREF(item);
+    return ok;
+}
+
+static PyObject *Scanner_scan(ScannerObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    Py_buffer data;
+    if (!parse_args(args, nargs, "y*:scan", &data))
+        return NULL;
+    Block block;
+    PyObject *outputs = NULL, *spends = NULL, *result = NULL;
+    if (ready(self) && parse(data, block) && (outputs = PyList_New(0)) && (spends = PyList_New(0))) {
+        ObjectLock lock(*self->mu);
+        std::string key;
+        bool ok = true;
+        for (size_t t = 0; ok && t < block.txs.size(); ++t) {
+            const Tx &tx = block.txs[t];
+            uint8_t txid[32];
+            bool have_txid = false;
+            for (uint32_t i = 0; ok && i < tx.input_count; ++i) {
+                const uint8_t *prevout = block.input(tx, i).prevout;
+                key.assign(reinterpret_cast<const char *>(prevout), OUTPOINT_SIZE);
+                if (!self->outpoints->erase(key))
+                    continue;
+                if (!have_txid)
+                    tx.txid(txid), have_txid = true;
+                ok = append(spends, Py_BuildValue("(y#Iy#)", txid, (Py_ssize_t)32, i, prevout,
+                                                  (Py_ssize_t)OUTPOINT_SIZE));
+            }
+            for (uint32_t i = 0; ok && i < tx.output_count; ++i) {
+                const blockparser::Output &out = block.output(tx, i);
+                key.assign(reinterpret_cast<const char *>(out.script.data), out.script.len);
+                if (!self->scripts->count(key))
+                    continue;
+                if (!have_txid)
+                    tx.txid(txid), have_txid = true;
+                // Watched from here on, so a spend later in the block is found too.
+                std::string outpoint(reinterpret_cast<const char *>(txid), 32);
+                for (int b = 0; b < 4; ++b)
+                    outpoint.push_back((char)(i >> (8 * b)));
+                self->outpoints->insert(outpoint);
+                ok = append(outputs, Py_BuildValue("(y#ILy#)", txid, (Py_ssize_t)32, i, (long long)out.value,
+                                                   out.script.data, (Py_ssize_t)out.script.len));
+            }
+        }
+        if (ok)
+            result = PyTuple_Pack(2, outputs, spends);
+    }
+    Py_XDECREF(outputs);
+    Py_XDECREF(spends);
+    PyBuffer_Release(&data);
+    return result;
+}
+
+static PyObject *Scanner_outpoints(ScannerObject *self, PyObject *args) {
+    if (!ready(self))
+        return NULL;
+    ObjectLock lock(*self->mu);
+    PyObject *result = PyList_New(0);
+    for (const std::string &outpoint : *self->outpoints) {
+        if (!result || !append(result, to_bytes(reinterpret_cast<const uint8_t *>(outpoint.data()), OUTPOINT_SIZE))) {
+            Py_CLEAR(result);
+            break;
+        }
+    }
+    return result;
+}
+
+static Py_ssize_t Scanner_len(ScannerObject *self) {
+    if (!self->scripts)
+        return 0;
+    ObjectLock lock(*self->mu);
+    return (Py_ssize_t)self->scripts->size();
+}
+
+static PyMethodDef Scanner_methods[] = {
+    {"add_scripts", (PyCFunction)(void (*)(void))Scanner_add_scripts, METH_FASTCALL, "Watch more output scripts."},
+    {"add_outpoints", (PyCFunction)(void (*)(void))Scanner_add_outpoints, METH_FASTCALL,
+     "Watch more outpoints (32-byte txid and 4-byte index) for spends."},
+    {"match", (PyCFunction)(void (*)(void))Scanner_match, METH_VARARGS | METH_KEYWORDS,
+     "Indexes of the filters (of the blocks with block_hashes) matching any watched script."},
+    {"scan", (PyCFunction)(void (*)(void))Scanner_scan, METH_FASTCALL,
+     "Parse a block, returning (outputs, spends): (txid, index, value, script) for outputs paying to a watched "
+     "script, and (txid, input, outpoint) for inputs spending a watched outpoint."},
+    {"outpoints", (PyCFunction)Scanner_outpoints, METH_NOARGS, "The watched outpoints not spent so far."},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyType_Slot Scanner_slots[] = {
+    {Py_tp_dealloc, (void *)Scanner_dealloc},
+    {Py_tp_doc, (void *)"The scripts and outpoints of a wallet, matched against block filters and blocks."},
+    {Py_tp_methods, Scanner_methods},
+    {Py_sq_length, (void *)Scanner_len},
+    {Py_tp_init, (void *)Scanner_init},
+    {Py_tp_new, (void *)PyType_GenericNew},
+    {0, NULL}
+};
+
+static PyType_Spec Scanner_spec = {
+    "blockfilter.Scanner",
+    sizeof(ScannerObject),
+    0,
+    Py_TPFLAGS_DEFAULT,
+    Scanner_slots
+};
+
+/* Module. */
+
+typedef struct {
+    PyObject *scanner_type;
+} BlockFilterState;
+
+static BlockFilterState *get_state(PyObject *m) {
+    return static_cast<BlockFilterState *>(PyModule_GetState(m));
+}
+
+static int blockfilter_exec(PyObject *m) {
+    return module_add_type(m, &Scanner_spec, &get_state(m)->scanner_type);
+}
+
+static int blockfilter_traverse(PyObject *m, visitproc visit, void *arg) {
+    Py_VISIT(get_state(m)->scanner_type);
+    return 0;
+}
+
+static int blockfilter_clear(PyObject *m) {
+    Py_CLEAR(get_state(m)->scanner_type);
+    return 0;
+}
+
+static void blockfilter_free(void *m) {
+    blockfilter_clear(static_cast<PyObject *>(m));
+}
+
+static PyMethodDef blockfilter_methods[] = {
+    {"build", (PyCFunction)(void (*)(void))blockfilter_build, METH_FASTCALL,
+     "The BIP158 basic filter of a block, given the scripts of the outputs it spends."},
+    {"match_any", (PyCFunction)(void (*)(void))blockfilter_match_any, METH_FASTCALL,
+     "Whether any of the scripts is in the filter of the block with block_hash."},
+    {"transactions", (PyCFunction)(void (*)(void))blockfilter_transactions, METH_FASTCALL,
+     "The (txid, outpoints spent, [(value, script)]) of every transaction in a block."},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyModuleDef_Slot blockfilter_slots[] = {
+    {Py_mod_exec, (void *)blockfilter_exec},
+    MODULE_SLOTS
+    {0, NULL}
+};
+
+static struct PyModuleDef blockfilter = {
+    PyModuleDef_HEAD_INIT,
+    "blockfilter",
+    NULL,
+    sizeof(BlockFilterState),
+    blockfilter_methods,
+    blockfilter_slots,
+    blockfilter_traverse,
+    blockfilter_clear,
+    blockfilter_free
+};
+
+PyMODINIT_FUNC PyInit_blockfilter(void) {
+    return PyModuleDef_Init(&blockfilter);
+}
@@ -0,0 +1,16 @@
+from typing import Iterable, Sequence
+
+def build(block: bytes, spent: Iterable[bytes] = ...) -> bytes: ...
+def match_any(filter: bytes, block_hash: bytes, scripts: Iterable[bytes]) -> bool: ...
+def transactions(block: bytes) -> list[tuple[bytes, list[bytes], list[tuple[int, bytes]]]]: ...
+
+class Scanner:
+    def __init__(self, scripts: Iterable[bytes] = ..., outpoints: Iterable[bytes] = ...) -> None: ...
+    def __len__(self) -> int: ...
+    def add_scripts(self, scripts: Iterable[bytes]) -> None: ...
+    def add_outpoints(self, outpoints: Iterable[bytes]) -> None: ...
+    def match(self, filters: Sequence[bytes], block_hashes: Sequence[bytes], threads: int = ...) -> list[int]: ...
+    def scan(
+        self, block: bytes
+    ) -> tuple[list[tuple[bytes, int, int, bytes]], list[tuple[bytes, int, bytes]]]: ...
+    def outpoints(self) -> list[bytes]: ...
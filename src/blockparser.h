@@ -0,0 +1,205 @@
+/**
+ * @file blockparser.h
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief Header-only zero-copy parser for serialized blocks.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef PYCOIN_BLOCKPARSER_H
+#define PYCOIN_BLOCKPARSER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "sha256.h"
+
+ /* The parser does not copy anything out of the block: transactions,
+    scripts and outpoints are pointers into the serialized block (for
+    example a block file mapped by BlockStore), so finding the outputs
+    of a block that pay to some scripts costs one pass over its bytes
+    and no allocation beyond the three vectors below, which are reused
+    between blocks.
+
+    Transactions are in the BIP144 format when they have witnesses
+    (marker 0x00, flag 0x01 after the version, witness stacks before the
+    lock time). The txid hashes everything except the marker, flag and
+    witnesses, which are three contiguous ranges, so it is computed
+    without building the legacy serialization.
+
+    References:
+        - https://developer.bitcoin.org/reference/block_chain.html
+        - https://github.com/bitcoin/bips/blob/master/bip-0144.mediawiki
+ */
+
+namespace blockparser {
+
+struct Span {
+    const uint8_t *data;
+    size_t len;
+};
+
+struct Input {
+    const uint8_t *prevout;  // 32-byte txid and 4-byte index.
+    Span script;
+    uint32_t sequence;
+    Span witness;  // The item count and the items (len 0 without witnesses).
+};
+
+struct Output {
+    int64_t value;
+    Span script;
+};
+
+struct Tx {
+    Span raw;   // The whole transaction, with witnesses.
+    Span body;  // Input count to the end of the outputs.
+    bool segwit;
+    uint32_t first_input, input_count;
+    uint32_t first_output, output_count;
+
+    /**
+     * @brief The txid (sha256d of the serialization without witnesses).
+     */
+    void txid(uint8_t out[32]) const {
+        uint8_t tmp[32];
+        sha256::Context()
+            .write(raw.data, 4)
+            .write(body.data, body.len)
+            .write(raw.data + raw.len - 4, 4)
+            .finalize(tmp);
+        sha256::hash_digest(tmp, out);
+    }
+};
+
+struct Block {
+    const uint8_t *header;  // 80 bytes.
+    std::vector<Tx> txs;
+    std::vector<Input> inputs;
+    std::vector<Output> outputs;
+
+    const Input &input(const Tx &tx, uint32_t i) const { return inputs[tx.first_input + i]; }
+    const Output &output(const Tx &tx, uint32_t i) const { return outputs[tx.first_output + i]; }
+};
+
+/**
+ * @brief Bounds-checked cursor over a buffer. Any read past the end sets
+ * ok to false (and reads zeros), so callers only check once at the end.
+ */
+struct Reader {
+    const uint8_t *p, *end;
+    bool ok = true;
+
+    Reader(const uint8_t *data, size_t len) : p(data), end(data + len) {}
+
+    const uint8_t *skip(size_t n) {
+        if ((size_t)(end - p) < n) {
+            ok = false;
+            p = end;
+            return nullptr;
+        }
+        const uint8_t *at = p;
+        p += n;
+        return at;
+    }
+
+    uint64_t le(int n) {
+        const uint8_t *at = skip(n);
+        uint64_t v = 0;
+        for (int i = n - 1; at && i >= 0; --i)
+            v = v << 8 | at[i];
+        return v;
+    }
+
+    uint64_t varint() {
+        uint8_t first = (uint8_t)le(1);
+        if (first < 0xFD)
+            return first;
+        return le(first == 0xFD ? 2 : first == 0xFE ? 4 : 8);
+    }
+
+    /**
+     * @brief A count of items of at least min bytes each, rejected if they
+     * could not possibly fit in what is left (so corrupt counts do not
+     * make the caller reserve gigabytes).
+     */
+    uint64_t count(size_t min) {
+        uint64_t n = varint();
+        if (n > (uint64_t)(end - p) / min)
+            ok = false;
+        return ok ? n : 0;
+    }
+
+    Span bytes() {
+        uint64_t n = varint();
+        const uint8_t *at = n <= (uint64_t)(end - p) ? skip(n) : (ok = false, nullptr);
+        return Span{at, at ? (size_t)n : 0};
+    }
+};
+
+inline bool parse_tx(Reader &r, Block &block) {
+    Tx tx;
+    const uint8_t *start = r.p;
+    r.skip(4);
+    tx.segwit = r.end - r.p >= 2 && r.p[0] == 0 && r.p[1] == 1;
+    if (tx.segwit)
+        r.skip(2);
+    tx.body.data = r.p;
+    tx.first_input = (uint32_t)block.inputs.size();
+    tx.input_count = (uint32_t)r.count(41);
+    for (uint32_t i = 0; i < tx.input_count && r.ok; ++i) {
+        Input in;
+        in.prevout = r.skip(36);
+        in.script = r.bytes();
+        in.sequence = (uint32_t)r.le(4);
+        in.witness = Span{nullptr, 0};
+        block.inputs.push_back(in);
+    }
+    tx.first_output = (uint32_t)block.outputs.size();
+    tx.output_count = (uint32_t)r.count(9);
+    for (uint32_t i = 0; i < tx.output_count && r.ok; ++i) {
+        Output out;
+        out.value = (int64_t)r.le(8);
+        out.script = r.bytes();
+        block.outputs.push_back(out);
+    }
+    tx.body.len = r.p - tx.body.data;
+    if (tx.segwit) {
+        for (uint32_t i = 0; i < tx.input_count && r.ok; ++i) {
+            const uint8_t *start = r.p;
+            uint64_t items = r.count(1);
+            for (uint64_t j = 0; j < items && r.ok; ++j)
+                r.bytes();
+            block.inputs[tx.first_input + i].witness = Span{start, (size_t)(r.p - start)};
+        }
+    }
+    r.skip(4);
+    tx.raw = Span{start, (size_t)(r.p - start)};
+    if (r.ok)
+        block.txs.push_back(tx);
+    return r.ok;
+}
+
+/**
+ * @brief Parses a serialized block into block (clearing what it held).
+ * Returns false if the block is truncated or malformed.
+ */
+inline bool parse_block(const uint8_t *data, size_t len, Block &block) {
+    block.txs.clear();
+    block.inputs.clear();
+    block.outputs.clear();
+    Reader r(data, len);
+    block.header = r.skip(80);
+    uint64_t count = r.count(60);
+    for (uint64_t i = 0; i < count && r.ok; ++i)
+        parse_tx(r, block);
+    return r.ok && r.p == r.end;
+}
+
+}  // namespace blockparser
+
+#endif  // PYCOIN_BLOCKPARSER_H
@@ -0,0 +1,261 @@
+"""Block storage on disk. Blocks are appended to blk?????.dat files in
+the same format Bitcoin Core uses (network magic, 4-byte size, then the
+raw block), so they are already in wire format and can be sent to peers
+straight from the file.
+
+Every block file has a small index next to it (blk?????.idx) with one
+fixed-size record per block: its hash, where it starts, its size and
+the 4-byte message checksum of its bytes. The checksum is computed once
+when the block is stored, so serving a block never needs to hash it
+again, let alone re-serialize it.
+
+Peers asking for a block without witnesses (BIP 144) are served from
+the same files. The record also holds the size and checksum of the
+block stripped of its witnesses, and for a block that has some, where
+the runs of bytes that make up the stripped block are listed in a third
+file (blk?????.rng): building it is a join of slices of the stored one,
+with no parsing. A block without witnesses is its own stripped block.
+
+Reads go through mmap, so get() returns a memoryview over the page
+cache instead of a copy.
+"""
+
+from __future__ import annotations
+
+import mmap
+import os
+import struct
+from pathlib import Path
+from typing import BinaryIO, Iterator, NamedTuple
+
+from .network import MAGIC, Header, checksum
+from .utils import read_vint, sha256d
+
+MAX_FILE_SIZE = 128 * 1024 * 1024  # Same as Bitcoin Core.
+RECORD_FORMAT = "<32sQI4sI4sQI"
+RECORD_SIZE = struct.calcsize(RECORD_FORMAT)
+RANGE_FORMAT = "<II"  # Start and end of a run of the stripped block.
+RANGE_SIZE = struct.calcsize(RANGE_FORMAT)
+PREFIX_SIZE = 8  # Magic and size in front of every block.
+
+
+class BlockLocation(NamedTuple):
+    file: int
+    offset: int  # Start of the raw block (after magic and size).
+    size: int
+    checksum: bytes
+    stripped_size: int  # Without witnesses, the same as size if it has none.
+    stripped_checksum: bytes
+    ranges: int  # Offset of its runs in the .rng file.
+    range_count: int  # 0 for a block without witnesses.
+
+
+def stripped_ranges(block: bytes) -> list[tuple[int, int]]:
+    """The runs of bytes (start, end) of a block that make up its
+    serialization without witnesses: all of it but the marker, flag and
+    witnesses of segwit transactions. Raises ValueError if the
+    transactions cannot be parsed."""
+    data = memoryview(block)
+    ranges: list[tuple[int, int]] = []
+    try:
+        count, pos = read_vint(data, 80)
+        kept = 0  # Start of the current run.
+        for _ in range(count):
+            start = pos
+            segwit = data[pos + 4 : pos + 6] == b"\x00\x01"
+            pos += 6 if segwit else 4
+            body = pos
+            inputs, pos = read_vint(data, pos)
+            for _ in range(inputs):
+                length, pos = read_vint(data, pos + 36)
+                pos += length + 4
+            outputs, pos = read_vint(data, pos)
+            for _ in range(outputs):
+                length, pos = read_vint(data, pos + 8)
+                pos += length
+            body_end = pos
+            if segwit:
+                for _ in range(inputs):
+                    items, pos = read_vint(data, pos)
+                    for _ in range(items):
+                        length, pos = read_vint(data, pos)
+                        pos += length
+                ranges += [(kept, start + 4), (body, body_end)]
+                kept = pos
+            pos += 4
+    except IndexError:
+        raise ValueError("malformed block.") from None
+    if pos != len(data):
+        raise ValueError("malformed block.")
+    ranges.append((kept, pos))
+    return ranges
+
+
+def _stripped(block: bytes) -> tuple[int, bytes, list[tuple[int, int]]]:
+    """Size, checksum and runs of the stripped block, for the index. A
+    block whose transactions cannot be parsed is kept whole."""
+    try:
+        ranges = stripped_ranges(block)
+    except ValueError:
+        ranges = [(0, len(block))]
+    if len(ranges) == 1:
+        return len(block), checksum(block), []
+    view = memoryview(block)
+    stripped = b"".join(view[start:end] for start, end in ranges)
+    return len(stripped), checksum(stripped), ranges
+
+
+class BlockStore:
+    def __init__(
+        self,
+        directory: str | os.PathLike,
+        magic: bytes = MAGIC,
+        max_file_size: int = MAX_FILE_SIZE,
+    ) -> None:
+        self.directory = Path(directory)
+        self.directory.mkdir(parents=True, exist_ok=True)
+        self.magic = magic
+        self.max_file_size = max_file_size
+        self._index: dict[bytes, BlockLocation] = {}
+        self._fds: dict[int, int] = {}
+        self._range_fds: dict[int, int] = {}
+        self._maps: dict[int, mmap.mmap] = {}
+        self._current = 0
+        for path in sorted(self.directory.glob("blk*.dat")):
+            self._load(int(path.stem[3:]))
+
+    def __len__(self) -> int:
+        return len(self._index)
+
+    def __contains__(self, block_hash: bytes) -> bool:
+        return block_hash in self._index
+
+    def __enter__(self) -> BlockStore:
+        return self
+
+    def __exit__(self, *exc: object) -> None:
+        self.close()
+
+    def hashes(self) -> Iterator[bytes]:
+        """Block hashes in the order they were stored."""
+        return iter(self._index)
+
+    def path(self, file: int, suffix: str = "dat") -> Path:
+        return self.directory / f"blk{file:05}.{suffix}"
+
+    def put(self, block: bytes) -> bytes:
+        """Appends a serialized block, returning its hash. Blocks that are
+        already stored are not written again."""
+        block_hash = sha256d(block[:80])
+        if block_hash in self._index:
+            return block_hash
+        file = self._current
+        if self.path(file).exists() and self.path(file).stat().st_size + len(block) > self.max_file_size:
+            file = self._current = file + 1
+        with open(self.path(file), "ab") as f:
+            offset = f.tell() + PREFIX_SIZE
+            f.write(self.magic + struct.pack("<I", len(block)) + block)
+        stripped_size, stripped_checksum, ranges = _stripped(block)
+        with open(self.path(file, "rng"), "ab") as f:
+            start = f.tell()
+            f.writelines(struct.pack(RANGE_FORMAT, *run) for run in ranges)
+        location = BlockLocation(
+            file, offset, len(block), checksum(block), stripped_size, stripped_checksum, start, len(ranges)
+        )
+        with open(self.path(file, "idx"), "ab") as f:
+            f.write(struct.pack(RECORD_FORMAT, block_hash, *location[1:]))
+        self._index[block_hash] = location
+        self._maps.pop(file, None)  # Remapped with the new size on next read.
+        return block_hash
+
+    def locate(self, block_hash: bytes) -> BlockLocation | None:
+        return self._index.get(block_hash)
+
+    def get(self, block_hash: bytes, witness: bool = True) -> bytes | memoryview | None:
+        """The raw bytes of a block as a read-only view of the mapped file.
+        Without witness, a block that has some is joined from the runs
+        listed in the index instead."""
+        location = self._index.get(block_hash)
+        if location is None:
+            return None
+        view = memoryview(self._map(location.file))
+        view = view[location.offset : location.offset + location.size]
+        if witness or not location.range_count:
+            return view
+        fd = self._range_fds.get(location.file)
+        if fd is None:
+            fd = os.open(self.path(location.file, "rng"), os.O_RDONLY | os.O_CLOEXEC)
+            self._range_fds[location.file] = fd
+        runs = os.pread(fd, location.range_count * RANGE_SIZE, location.ranges)
+        return b"".join(view[start:end] for start, end in struct.iter_unpack(RANGE_FORMAT, runs))
+
+    def fileno(self, file: int) -> int:
+        """A read-only file descriptor for a block file (kept open), as
+        needed by sendfile()."""
+        if file not in self._fds:
+            self._fds[file] = os.open(self.path(file), os.O_RDONLY | os.O_CLOEXEC)
+        return self._fds[file]
+
+    def message_header(self, block_hash: bytes, command: str = "block", witness: bool = True) -> bytes:
+        """The 24-byte header of a message carrying the block (stripped of
+        its witnesses without witness), built from the index alone."""
+        location = self._index[block_hash]
+        if witness:
+            return bytes(Header(self.magic, command, location.size, location.checksum))
+        return bytes(Header(self.magic, command, location.stripped_size, location.stripped_checksum))
+
+    def close(self) -> None:
+        for fd in [*self._fds.values(), *self._range_fds.values()]:
+            os.close(fd)
+        self._fds.clear()
+        self._range_fds.clear()
+        self._maps.clear()
+
+    def _map(self, file: int) -> mmap.mmap:
+        if file not in self._maps:
+            self._maps[file] = mmap.mmap(self.fileno(file), 0, access=mmap.ACCESS_READ)
+        return self._maps[file]
+
+    def _load(self, file: int) -> None:
+        """Loads the index of a block file, rebuilding it (and the list of
+        runs) from the block file if it is missing or incomplete."""
+        self._current = max(self._current, file)
+        size = self.path(file).stat().st_size
+        records = []
+        idx = self.path(file, "idx")
+        if idx.exists():
+            data = idx.read_bytes()
+            usable = len(data) - len(data) % RECORD_SIZE
+            records = [r for r in struct.iter_unpack(RECORD_FORMAT, data[:usable])]
+        end = records[-1][1] + records[-1][2] if records else 0
+        runs = max((r[6] + r[7] * RANGE_SIZE for r in records), default=0)
+        rng = self.path(file, "rng")
+        if end != size or runs > (rng.stat().st_size if rng.exists() else 0):
+            with open(rng, "wb") as f:
+                records = list(self._scan(file, f))
+            with open(idx, "wb") as f:
+                f.writelines(struct.pack(RECORD_FORMAT, *record) for record in records)
+        for block_hash, *location in records:
+            self._index[block_hash] = BlockLocation(file, *location)
+
+    def _scan(self, file: int, ranges: BinaryIO) -> Iterator[tuple]:
+        """Index records of the blocks in a file, writing their runs to
+        ranges as it goes."""
+        with open(self.path(file), "rb") as f:
+            data = f.read()
+        pos = 0
+        while pos + PREFIX_SIZE <= len(data) and data[pos : pos + 4] == self.magic:
+            (length,) = struct.unpack_from("<I", data, pos + 4)
+            start = pos + PREFIX_SIZE
+            if start + length > len(data):
+                break  # Truncated write, ignore the tail.
+            block = data[start : start + length]
+            stripped_size, stripped_checksum, runs = _stripped(block)
+            offset = ranges.tell()
+            ranges.writelines(struct.pack(RANGE_FORMAT, *run) for run in runs)
+            yield (
+                sha256d(block[:80]), start, length, checksum(block),
+                stripped_size, stripped_checksum, offset, len(runs),
+            )
+            pos = start + length
+
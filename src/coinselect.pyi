@@ -0,0 +1,16 @@
+def select(
+    values: bytes,
+    weights: bytes,
+    target: int,
+    fee_rate: float,
+    long_term_fee_rate: float = ...,
+    change_fee: int = ...,
+    cost_of_change: int = ...,
+    min_change: int = ...,
+    max_weight: int = ...,
+    seed: int = ...,
+) -> tuple[str, list[int], int] | None: ...
+
+bnb = select
+srd = select
+knapsack = select
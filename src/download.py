@@ -0,0 +1,474 @@
+# !usr/bin/env python3
+
+"""Headers-first initial block download (IBD).
+
+Headers are downloaded and checked first (proof of work and linkage),
+which gives the full list of blocks to fetch before a single block is
+requested. Blocks are then requested from many peers at once, inside a
+sliding window that starts at the first block not yet handed to
+validation:
+
+    [ delivered ... | window: in flight / received ... | not requested ]
+                    ^ next to validate
+
+Blocks arrive out of order but are fed to validation strictly in order.
+Each peer gets as many requests in flight as its measured throughput
+allows, and a peer that holds up the start of the window for too long
+(stalls) loses its requests to the other peers.
+
+References:
+    - https://bitcoin.org/en/p2p-network-guide#headers-first
+    - https://github.com/bitcoin/bitcoin/pull/4468
+"""
+
+from __future__ import annotations
+
+import heapq
+import random
+import struct
+import threading
+from collections import deque
+from dataclasses import dataclass, field
+from typing import Callable, Iterable
+
+from .header import target, verify
+from .utils import int_to_vint, read_vint, sha256d
+
+WINDOW = 1024                 # Blocks ahead of validation we may request.
+MIN_IN_FLIGHT = 2             # Requests per peer before its speed is known.
+MAX_IN_FLIGHT = 16            # Requests per peer at most (Core uses 16).
+STALL_TIMEOUT = 2.0           # Seconds the window head may be held up.
+REQUEST_TIMEOUT = 10.0        # Seconds before any request is given up on.
+THROUGHPUT_ALPHA = 0.3        # Weight of new samples in the moving average.
+PROTOCOL_VERSION = 70016
+MSG_BLOCK = 2
+RETARGET_INTERVAL = 2016      # Blocks between difficulty adjustments.
+
+
+class HeaderChain:
+    """Block headers accepted so far, indexed by hash. Headers have to
+    connect to a known header, have valid proof of work, and keep the
+    difficulty of their parent except at a retarget (every
+    RETARGET_INTERVAL blocks), where it may change by a factor of 4 at
+    most. No target may be easier than pow_limit, which defaults to the
+    genesis block's. The best chain is the one with the most work.
+
+    The methods may be called from any thread.
+    """
+
+    def __init__(self, genesis: bytes, pow_limit: int | None = None) -> None:
+        genesis_hash = sha256d(genesis)
+        self.pow_limit = target(_bits(genesis)) if pow_limit is None else pow_limit
+        self.headers: dict[bytes, bytes] = {genesis_hash: genesis}
+        self.heights: dict[bytes, int] = {genesis_hash: 0}
+        self.work: dict[bytes, int] = {genesis_hash: _work(_bits(genesis))}  # Cumulative.
+        self.chain: list[bytes] = [genesis_hash]
+        self._lock = threading.RLock()
+
+    def __len__(self) -> int:
+        return len(self.chain)
+
+    @property
+    def tip(self) -> bytes:
+        return self.chain[-1]
+
+    def add(self, header: bytes) -> bool:
+        """Adds a header, returning False if it is invalid. Headers extending
+        a block other than the tip start a fork, which becomes the best
+        chain once it has more work."""
+        if len(header) != 80:
+            return False
+        header_hash = sha256d(header)
+        with self._lock:
+            if header_hash in self.headers:
+                return True
+            previous = header[4:36]
+            if previous not in self.headers or not verify(header):
+                return False
+            height = self.heights[previous] + 1
+            if not self._permitted(_bits(self.headers[previous]), _bits(header), height):
+                return False
+            self.headers[header_hash] = header
+            self.heights[header_hash] = height
+            self.work[header_hash] = self.work[previous] + _work(_bits(header))
+            if previous == self.tip:
+                self.chain.append(header_hash)
+            elif self.work[header_hash] > self.work[self.tip]:
+                self._reorganize(header_hash)
+            return True
+
+    def locator(self) -> list[bytes]:
+        """Block locator (exponentially spaced hashes back to genesis)."""
+        with self._lock:
+            hashes, step, i = [], 1, len(self.chain) - 1
+            while i > 0:
+                hashes.append(self.chain[i])
+                if len(hashes) >= 10:
+                    step *= 2
+                i -= step
+            hashes.append(self.chain[0])
+            return hashes
+
+    def _permitted(self, previous_bits: int, bits: int, height: int) -> bool:
+        new = target(bits)
+        if new > self.pow_limit:
+            return False
+        if height % RETARGET_INTERVAL:
+            return bits == previous_bits
+        old = target(previous_bits)
+        return old // 4 <= new <= old * 4
+
+    def _reorganize(self, tip: bytes) -> None:
+        branch = []
+        while self.heights[tip] >= len(self.chain) or self.chain[self.heights[tip]] != tip:
+            branch.append(tip)
+            tip = self.headers[tip][4:36]
+        del self.chain[self.heights[tip] + 1 :]
+        self.chain.extend(reversed(branch))
+
+
+def _bits(header: bytes) -> int:
+    return struct.unpack_from("<I", header, 72)[0]
+
+
+def _work(bits: int) -> int:
+    """Expected number of hashes to find a block at this difficulty."""
+    return (1 << 256) // (target(bits) + 1)
+
+
+def getheaders_payload(locator: list[bytes], stop: bytes = bytes(32)) -> bytes:
+    return (
+        struct.pack("<I", PROTOCOL_VERSION)
+        + int_to_vint(len(locator))
+        + b"".join(locator)
+        + stop
+    )
+
+
+def parse_headers(payload: bytes) -> list[bytes]:
+    """Headers from a headers message (each followed by a 0 tx count)."""
+    count, offset = read_vint(payload)
+    headers = []
+    for _ in range(count):
+        headers.append(bytes(payload[offset : offset + 80]))
+        _, offset = read_vint(payload, offset + 80)
+    return headers
+
+
+def getdata_payload(hashes: Iterable[bytes]) -> bytes:
+    hashes = list(hashes)
+    inv = b"".join(struct.pack("<I32s", MSG_BLOCK, h) for h in hashes)
+    return int_to_vint(len(hashes)) + inv
+
+
+@dataclass
+class PeerState:
+    in_flight: dict[bytes, float] = field(default_factory=dict)  # hash -> sent at
+    throughput: float = 0.0   # Blocks per second (moving average).
+    received: int = 0
+    bytes: int = 0
+    stalls: int = 0
+    last_seen: float = 0.0
+
+    @property
+    def capacity(self) -> int:
+        """Requests this peer may have in flight. Scales with its measured
+        throughput (roughly one second's worth of blocks)."""
+        if self.received == 0:
+            return MIN_IN_FLIGHT
+        return max(MIN_IN_FLIGHT, min(MAX_IN_FLIGHT, int(self.throughput) + 1))
+
+
+class BlockDownloader:
+    """Schedules block requests across peers. The downloader only keeps
+    state and makes decisions; sending requests and receiving blocks is
+    up to the caller (see IBD below, or simulate() for an offline run).
+
+    validate is called with (hash, block) strictly in chain order.
+    """
+
+    def __init__(
+        self,
+        hashes: Iterable[bytes],
+        validate: Callable[[bytes, bytes], object],
+        window: int = WINDOW,
+        stall_timeout: float = STALL_TIMEOUT,
+        request_timeout: float = REQUEST_TIMEOUT,
+    ) -> None:
+        self.hashes = list(hashes)
+        self.index = {h: i for i, h in enumerate(self.hashes)}
+        self.validate = validate
+        self.window = window
+        self.stall_timeout = stall_timeout
+        self.request_timeout = request_timeout
+        self.peers: dict[object, PeerState] = {}
+        self.owner: dict[bytes, object] = {}      # In flight: hash -> peer.
+        self.received: dict[bytes, bytes] = {}    # Waiting for earlier blocks.
+        self.next_validate = 0
+        self.next_request = 0
+        self.retry: deque[bytes] = deque()        # Requests to hand out again.
+        self.head_since = 0.0                     # When the window head last moved.
+
+    @property
+    def done(self) -> bool:
+        return self.next_validate == len(self.hashes)
+
+    def add_peer(self, peer: object, now: float = 0.0) -> None:
+        self.peers.setdefault(peer, PeerState(last_seen=now))
+
+    def remove_peer(self, peer: object) -> None:
+        state = self.peers.pop(peer, None)
+        if state is not None:
+            self._release(state)
+
+    def assign(self, now: float) -> dict[object, list[bytes]]:
+        """Hands out requests to peers with free capacity, fastest peers
+        first. Returns the hashes each peer should be sent a getdata for."""
+        requests: dict[object, list[bytes]] = {}
+        limit = min(len(self.hashes), self.next_validate + self.window)
+        peers = sorted(self.peers.items(), key=lambda item: -item[1].throughput)
+        for peer, state in peers:
+            while len(state.in_flight) < state.capacity:
+                block_hash = self._next_hash(limit)
+                if block_hash is None:
+                    return requests
+                state.in_flight[block_hash] = now
+                self.owner[block_hash] = peer
+                requests.setdefault(peer, []).append(block_hash)
+        return requests
+
+    def block_received(self, peer: object, block_hash: bytes, block: bytes, now: float) -> int:
+        """Records a block, then validates every block that is now next in
+        order. Returns the number of blocks validated."""
+        state = self.peers.get(peer)
+        if state is not None and block_hash in state.in_flight:
+            sent = state.in_flight.pop(block_hash)
+            # Throughput is measured per completed request, which also
+            # accounts for everything else the peer had in flight.
+            elapsed = max(now - max(sent, state.last_seen), 1e-6)
+            rate = 1.0 / elapsed
+            a = THROUGHPUT_ALPHA if state.received else 1.0
+            state.throughput = a * rate + (1 - a) * state.throughput
+            state.received += 1
+            state.bytes += len(block)
+            state.last_seen = now
+        if self.owner.get(block_hash) is peer:
+            del self.owner[block_hash]
+        if block_hash in self.received or not self._wanted(block_hash):
+            return 0
+        self.received[block_hash] = block
+        validated = 0
+        while not self.done and self.hashes[self.next_validate] in self.received:
+            head = self.hashes[self.next_validate]
+            self.validate(head, self.received.pop(head))
+            self.next_validate += 1
+            self.head_since = now
+            validated += 1
+        return validated
+
+    def check_stalls(self, now: float) -> list[object]:
+        """Takes requests away from peers that are holding up the download.
+        Returns the peers that stalled the window head (callers will
+        usually disconnect them, like Bitcoin Core does)."""
+        stalled = []
+        if not self.done and now - self.head_since > self.stall_timeout:
+            head = self.hashes[self.next_validate]
+            peer = self.owner.get(head)
+            window_full = self.next_request >= min(len(self.hashes), self.next_validate + self.window)
+            if peer is not None and window_full and not self.retry:
+                state = self.peers[peer]
+                state.stalls += 1
+                self._release(state)
+                state.throughput /= 2
+                self.head_since = now
+                stalled.append(peer)
+        for peer, state in self.peers.items():
+            expired = [h for h, sent in state.in_flight.items() if now - sent > self.request_timeout]
+            for block_hash in expired:
+                del state.in_flight[block_hash]
+                self.owner.pop(block_hash, None)
+                self.retry.append(block_hash)
+        return stalled
+
+    def stats(self) -> dict[object, PeerState]:
+        return dict(self.peers)
+
+    def _wanted(self, block_hash: bytes) -> bool:
+        return self.index.get(block_hash, -1) >= self.next_validate
+
+    def _next_hash(self, limit: int) -> bytes | None:
+        while self.retry:
+            block_hash = self.retry.popleft()
+            if block_hash not in self.owner and self._wanted(block_hash) and block_hash not in self.received:
+                return block_hash
+        if self.next_request < limit:
+            block_hash = self.hashes[self.next_request]
+            self.next_request += 1
+            return block_hash
+        return None
+
+    def _release(self, state: PeerState) -> None:
+        # Requests closest to the window head go out again first.
+        for block_hash in sorted(state.in_flight, key=self.index.__getitem__):
+            self.owner.pop(block_hash, None)
+            self.retry.append(block_hash)
+        state.in_flight.clear()
+
+
+# Offline simulation. Each simulated peer has a latency, a bandwidth and
+# optionally a probability of never answering a request, and the
+# downloader is driven by a discrete event queue, so thousands of blocks
+# can be "downloaded" in well under a second of real time.
+
+
+@dataclass
+class SimulatedPeer:
+    name: str
+    latency: float = 0.1          # Seconds, one way.
+    bandwidth: float = 1e6        # Bytes per second.
+    drop_rate: float = 0.0        # Chance that a request is ignored.
+    busy_until: float = 0.0
+
+
+def simulate(
+    peers: list[SimulatedPeer],
+    blocks: int = 10_000,
+    block_size: int | Callable[[int], int] = 500_000,
+    window: int = WINDOW,
+    seed: int = 0,
+) -> dict[str, float]:
+    """Runs a full download in simulated time and reports how long it took
+    and how the work was spread. Stalling peers are disconnected, the
+    same way IBD does it."""
+    rng = random.Random(seed)
+    hashes = [i.to_bytes(32, "little") for i in range(blocks)]
+    sizes = [block_size(i) if callable(block_size) else block_size for i in range(blocks)]
+    order: list[int] = []
+    downloader = BlockDownloader(hashes, lambda h, b: order.append(int.from_bytes(h, "little")), window)
+    for peer in peers:
+        downloader.add_peer(peer.name)
+    by_name = {peer.name: peer for peer in peers}
+    events: list[tuple[float, int, str, bytes]] = []
+    counter = 0
+    now = 0.0
+
+    def send_requests() -> None:
+        nonlocal counter
+        for name, requested in downloader.assign(now).items():
+            peer = by_name[name]
+            for block_hash in requested:
+                if rng.random() < peer.drop_rate:
+                    continue
+                size = sizes[int.from_bytes(block_hash, "little")]
+                start = max(now + peer.latency, peer.busy_until)
+                peer.busy_until = start + size / peer.bandwidth
+                counter += 1
+                heapq.heappush(events, (peer.busy_until + peer.latency, counter, name, block_hash))
+
+    send_requests()
+    disconnected = 0
+    while not downloader.done:
+        if not events:
+            now += downloader.stall_timeout  # Only lost requests are left.
+        else:
+            now, _, name, block_hash = heapq.heappop(events)
+            if name in downloader.peers:
+                downloader.block_received(name, block_hash, b"", now)
+        for name in downloader.check_stalls(now):
+            if len(downloader.peers) > 1:
+                downloader.remove_peer(name)
+                disconnected += 1
+        send_requests()
+    assert order == list(range(blocks))
+    total = sum(sizes)
+    return {
+        "seconds": now,
+        "blocks_per_second": blocks / now,
+        "megabytes_per_second": total / now / 1e6,
+        "disconnected": disconnected,
+        **{f"share_{name}": state.received / blocks for name, state in downloader.peers.items()},
+    }
+
+
+class IBD:
+    """Drives a headers-first download over a network.Node-like object
+    (anything with send(conn, command, payload) and on(command, handler)).
+    Call tick() periodically to hand out requests and detect stalls; it
+    may be called from any thread.
+    """
+
+    def __init__(self, node, genesis: bytes, validate: Callable[[bytes, bytes], object], clock: Callable[[], float]) -> None:
+        self.node = node
+        self.chain = HeaderChain(genesis)
+        self.validate = validate
+        self.clock = clock
+        self.peers: set[int] = set()
+        self.downloader: BlockDownloader | None = None
+        self.syncing_headers = True
+        self._lock = threading.RLock()
+        node.on("headers", self._on_headers)
+        node.on("block", self._on_block)
+
+    def add_peer(self, conn: int) -> None:
+        with self._lock:
+            self.peers.add(conn)
+            if self.downloader is not None:
+                self.downloader.add_peer(conn, self.clock())
+            elif len(self.peers) == 1:
+                self.node.send(conn, "getheaders", getheaders_payload(self.chain.locator()))
+
+    def remove_peer(self, conn: int) -> None:
+        with self._lock:
+            self.peers.discard(conn)
+            if self.downloader is not None:
+                self.downloader.remove_peer(conn)
+
+    def tick(self) -> None:
+        with self._lock:
+            if self.downloader is None:
+                return
+            now = self.clock()
+            for conn in self.downloader.check_stalls(now):
+                if len(self.peers) > 1:
+                    self.node.disconnect(conn)
+                    self.remove_peer(conn)
+            for conn, hashes in self.downloader.assign(now).items():
+                self.node.send(conn, "getdata", getdata_payload(hashes))
+
+    def _on_headers(self, conn: int, payload: bytes) -> None:
+        headers = parse_headers(payload)
+        with self._lock:
+            if not all(map(self.chain.add, headers)):
+                self.node.disconnect(conn)
+                return
+            if len(headers) == 2000:  # Full batch, there are more to fetch.
+                self.node.send(conn, "getheaders", getheaders_payload(self.chain.locator()))
+            elif self.syncing_headers:
+                self.syncing_headers = False
+                self.downloader = BlockDownloader(self.chain.chain[1:], self.validate)
+                for peer in self.peers:
+                    self.downloader.add_peer(peer, self.clock())
+        self.tick()
+
+    def _on_block(self, conn: int, payload: bytes) -> None:
+        block_hash = sha256d(bytes(payload[:80]))
+        with self._lock:
+            if self.downloader is not None:
+                self.downloader.block_received(conn, block_hash, bytes(payload), self.clock())
+        self.tick()
+
+
+def main() -> None:
+    peers = [
+        SimulatedPeer("fast", latency=0.05, bandwidth=10e6),
+        SimulatedPeer("medium", latency=0.1, bandwidth=3e6),
+        SimulatedPeer("slow", latency=0.3, bandwidth=0.5e6),
+        SimulatedPeer("lossy", latency=0.1, bandwidth=5e6, drop_rate=0.05),
+    ]
+    for name, value in simulate(peers, blocks=5000).items():
+        print(f"{name:>24}: {value:.3f}")
+
+
+if __name__ == "__main__":
+    main()
+
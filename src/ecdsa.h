@@ -0,0 +1,190 @@
+/**
+ * @file ecdsa.h
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief Header-only ECDSA over secp256k1 (RFC6979 nonces, DER encoding).
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef PYCOIN_ECDSA_H
+#define PYCOIN_ECDSA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "secp256k1.h"
+#include "sha256.h"
+
+ /* Signing and verifying as Bitcoin does it, on top of secp256k1.h:
+
+        - The nonce is derived from the key and the message hash with
+          HMAC-SHA256 (RFC6979), so signing needs no randomness and the
+          same key and hash always give the same signature.
+        - s is replaced by n - s when it is above n / 2 ("low s"), since
+          nodes do not relay signatures with a high s (BIP62, BIP146).
+        - Signatures are DER encoded: 0x30, the length, then r and s as
+          big-endian integers, each with a 0x02 tag and its length, and a
+          leading zero byte when its top bit is set.
+
+    Verifying computes u1 * G + u2 * P with the fixed-base table for G and
+    a windowed multiplication for P, separately, which is simple but
+    about twice the work of the joint (Strauss) multiplication that
+    libsecp256k1 does.
+
+    References:
+        - https://www.rfc-editor.org/rfc/rfc6979
+        - https://github.com/bitcoin/bips/blob/master/bip-0066.mediawiki
+        - https://github.com/bitcoin/bips/blob/master/bip-0146.mediawiki
+ */
+
+#define ECDSA_MAX_DER_SIZE 72
+
+namespace ecdsa {
+
+using namespace secp256k1;
+
+/**
+ * @brief Deterministic nonces (RFC6979 with HMAC-SHA256). msg must already
+ * be reduced modulo n.
+ */
+struct Rfc6979 {
+    uint8_t v[32], k[32];
+    bool retry = false;
+
+    Rfc6979(const uint8_t key[32], const uint8_t msg[32]) {
+        std::memset(v, 1, 32);
+        std::memset(k, 0, 32);
+        uint8_t buf[97];
+        for (uint8_t round = 0; round < 2; ++round) {
+            std::memcpy(buf, v, 32);
+            buf[32] = round;
+            std::memcpy(buf + 33, key, 32);
+            std::memcpy(buf + 65, msg, 32);
+            sha256::Hmac(k, 32).mac(buf, 97, k);
+            sha256::Hmac(k, 32).mac(v, 32, v);
+        }
+    }
+
+    void next(uint8_t out[32]) {
+        if (retry) {
+            uint8_t buf[33];
+            std::memcpy(buf, v, 32);
+            buf[32] = 0;
+            sha256::Hmac(k, 32).mac(buf, 33, k);
+            sha256::Hmac(k, 32).mac(v, 32, v);
+        }
+        sha256::Hmac(k, 32).mac(v, 32, v);
+        std::memcpy(out, v, 32);
+        retry = true;
+    }
+};
+
+inline size_t der_int(uint8_t *out, const Scalar &a) {
+    uint8_t b[33] = {0};
+    scalar_store(b + 1, a);
+    size_t start = 0;
+    while (start < 32 && b[start] == 0 && !(b[start + 1] & 0x80))
+        ++start;
+    out[0] = 0x02;
+    out[1] = (uint8_t)(33 - start);
+    std::memcpy(out + 2, b + start, 33 - start);
+    return 2 + 33 - start;
+}
+
+/**
+ * @brief DER encodes (r, s) into out (at most ECDSA_MAX_DER_SIZE bytes),
+ * returning its size.
+ */
+inline size_t der_encode(uint8_t *out, const Scalar &r, const Scalar &s) {
+    size_t len = 2;
+    len += der_int(out + len, r);
+    len += der_int(out + len, s);
+    out[0] = 0x30;
+    out[1] = (uint8_t)(len - 2);
+    return len;
+}
+
+inline bool der_read_int(const uint8_t *&p, const uint8_t *end, Scalar &a) {
+    if (end - p < 2 || p[0] != 0x02 || p[1] == 0 || p[1] > 33 || end - p - 2 < p[1])
+        return false;
+    size_t len = p[1];
+    const uint8_t *digits = p + 2;
+    p += 2 + len;
+    if (len == 33 && digits[0] != 0)
+        return false;
+    uint8_t b[32] = {0};
+    if (len == 33)
+        ++digits, --len;
+    std::memcpy(b + 32 - len, digits, len);
+    return scalar_load(a, b);
+}
+
+/**
+ * @brief Parses a DER signature, returning false if it is malformed or r
+ * or s is not below n.
+ */
+inline bool der_decode(const uint8_t *sig, size_t len, Scalar &r, Scalar &s) {
+    if (len < 8 || sig[0] != 0x30 || sig[1] != len - 2)
+        return false;
+    const uint8_t *p = sig + 2, *end = sig + len;
+    return der_read_int(p, end, r) && der_read_int(p, end, s) && p == end;
+}
+
+/**
+ * @brief Signs a 32-byte hash with key d (low s), returning (r, s).
+ */
+inline void sign(const Scalar &d, const uint8_t msg[32], Scalar &r, Scalar &s) {
+    uint8_t key[32], reduced[32], nonce[32], rx[32];
+    Scalar z, k;
+    scalar_store(key, d);
+    scalar_load(z, msg);
+    scalar_store(reduced, z);
+    Rfc6979 rfc(key, reduced);
+    do {
+        rfc.next(nonce);
+        if (!scalar_load(k, nonce) || scalar_is_zero(k))
+            continue;
+        fe_store(rx, to_affine(mul_g_ct(k)).x);
+        scalar_load(r, rx);
+        s = scalar_mul(scalar_inv(k), scalar_add(z, scalar_mul(r, d)));
+    } while (scalar_is_zero(k) || scalar_is_zero(r) || scalar_is_zero(s));
+    if (scalar_is_high(s))
+        s = scalar_neg(s);
+}
+
+/**
+ * @brief Signs a 32-byte hash with key d, DER encoding the signature into
+ * out. Returns its size.
+ */
+inline size_t sign_der(const Scalar &d, const uint8_t msg[32], uint8_t *out) {
+    Scalar r, s;
+    sign(d, msg, r, s);
+    return der_encode(out, r, s);
+}
+
+/**
+ * @brief Whether (r, s) is a signature of a 32-byte hash by public key q
+ * (high s is accepted, as consensus does).
+ */
+inline bool verify(const Ge &q, const uint8_t msg[32], const Scalar &r, const Scalar &s) {
+    if (q.infinity || scalar_is_zero(r) || scalar_is_zero(s))
+        return false;
+    Scalar z, w = scalar_inv(s);
+    scalar_load(z, msg);
+    Gej p = gej_add(mul_g(scalar_mul(z, w)), mul(gej(q), scalar_mul(r, w)));
+    if (p.infinity)
+        return false;
+    uint8_t x[32];
+    Scalar rx;
+    fe_store(x, to_affine(p).x);
+    scalar_load(rx, x);
+    return std::memcmp(rx.n, r.n, sizeof(r.n)) == 0;
+}
+
+}  // namespace ecdsa
+
+#endif  // PYCOIN_ECDSA_H
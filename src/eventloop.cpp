@@ -0,0 +1,1146 @@
+/**
+ * @file eventloop.cpp
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief C++ Python Extension for handling thousands of peer connections.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "framing.h"
+#include "mpmcqueue.h"
+#include "poller.h"
+#include "pymodule.h"
+#include "ringbuffer.h"
+
+ /* One I/O thread per core, each with its own poller (io_uring or epoll)
+    and its own set of connections. A connection never moves between
+    threads, so its receive and send ring buffers are only touched by the
+    thread that owns it and need no locking.
+
+    Python talks to the I/O threads through two kinds of lock-free
+    queues (see mpmcqueue.h):
+
+        - every I/O thread has a command queue (add, listen, send, close),
+          drained whenever its eventfd is signalled, and
+        - all I/O threads push complete, checksummed messages into one
+          shared inbox that any number of validation threads pop from
+          with EventLoop.poll().
+
+    Neither side waits on the other while holding what the other needs.
+    A full inbox does not stop an I/O thread: the messages wait in its
+    backlog and it stops reading its sockets, but keeps running
+    commands, until poll() makes room and wakes it. A full command queue makes the Python caller wait, with
+    the GIL released, for the I/O thread to take its commands.
+
+    Connection ids carry the index of the owning thread in their low
+    byte, so send() goes straight to the right queue. Ids are never
+    reused, which means events for a connection that has since been
+    closed can be recognised and ignored.
+
+    Listening sockets are opened once per I/O thread with SO_REUSEPORT,
+    so the kernel spreads incoming connections across the threads.
+
+    send_file() queues a region of a file (a block in a blk?????.dat
+    file, see blockstore.py) behind whatever is already in the send
+    buffer. It is sent with sendfile(2), so the block goes from the page
+    cache to the socket without ever being copied into user space. Each
+    queued file region remembers how many buffered bytes have to go out
+    before it (its mark), which keeps messages in order. Queued file
+    bytes count against MAX_SEND_BUFFER like buffered ones, and each
+    region holds a descriptor, so at most MAX_FILE_SEGMENTS are queued
+    per connection; a peer that falls further behind is disconnected.
+ */
+
+#define DEFAULT_CAPACITY (256 * 1024)
+#define DEFAULT_INBOX (1 << 16)
+#define COMMAND_QUEUE (1 << 14)
+#define MAX_SEND_BUFFER (64 * 1024 * 1024)
+#define MAX_FILE_SEGMENTS 64
+#define MAX_WORKERS 256
+#define WAKE_TOKEN 0
+
+enum EventKind {
+    EVENT_MESSAGE = 0,
+    EVENT_CONNECTED = 1,
+    EVENT_DISCONNECTED = 2,
+};
+
+enum CommandType {
+    CMD_ADD,
+    CMD_LISTEN,
+    CMD_SEND,
+    CMD_SENDFILE,
+    CMD_CLOSE,
+    CMD_STOP,
+};
+
+/**
+ * @brief A message (or connection event) handed to validation threads.
+ * The payload is stored right after the struct in the same allocation.
+ */
+struct Delivery {
+    int kind;
+    uint64_t conn;
+    char command[COMMAND_SIZE];
+    uint32_t length;
+
+    uint8_t *payload() { return reinterpret_cast<uint8_t *>(this + 1); }
+
+    static Delivery *make(int kind, uint64_t conn, const uint8_t *command, const uint8_t *payload, uint32_t length) {
+        Delivery *d = static_cast<Delivery *>(std::malloc(sizeof(Delivery) + length));
+        if (!d)
+            return nullptr;
+        d->kind = kind;
+        d->conn = conn;
+        std::memset(d->command, 0, COMMAND_SIZE);
+        if (command)
+            std::memcpy(d->command, command, COMMAND_SIZE);
+        d->length = length;
+        if (length)
+            std::memcpy(d->payload(), payload, length);
+        return d;
+    }
+};
+
+struct Command {
+    int type;
+    uint64_t conn;
+    int fd;
+    size_t length;
+    uint8_t *data;
+    off_t offset;
+    size_t file_length;
+};
+
+struct FileSegment {
+    int fd;
+    off_t offset;
+    size_t remaining;
+    uint64_t mark;
+};
+
+struct Connection {
+    uint64_t id;
+    int fd;
+    bool listener;
+    bool spread;
+    bool want_write;
+    bool stalled;  // In its worker's stalled list, and not polled for reading.
+    std::unique_ptr<RingBuffer> rx, tx;
+    std::deque<FileSegment> files;
+    uint64_t queued = 0, sent = 0;  // Bytes put in / taken out of tx.
+    uint64_t file_bytes = 0;        // Left to send of the regions in files.
+};
+
+struct Loop;
+
+struct Worker {
+    Loop *loop;
+    int index;
+    std::thread thread;
+    Poller poller;
+    int wakefd = -1;
+    std::atomic<bool> wake_pending{false};
+    std::atomic<uint64_t> next_seq{1};
+    MPMCQueue<Command *> commands;
+    std::unordered_map<uint64_t, Connection *> conns;
+    std::deque<Delivery *> backlog;  // Waiting for room in the inbox, oldest first.
+    std::vector<uint64_t> stalled;   // Connections not read from until backlog is empty.
+    std::atomic<bool> backlogged{false};  // backlog is not empty: poll() wakes the thread.
+};
+
+struct Loop {
+    uint8_t magic[4];
+    uint32_t max_payload;
+    size_t capacity;
+    int pin;
+    std::vector<std::unique_ptr<Worker>> workers;
+    MPMCQueue<Delivery *> inbox;
+    std::mutex mu;
+    std::condition_variable cv;
+    std::atomic<int> sleepers{0};
+    std::atomic<int> backlogged{0};  // Workers with a backlog.
+    std::atomic<bool> stopping{false};
+    std::atomic<unsigned> next_worker{0};
+    std::atomic<uint64_t> messages{0}, bad_checksums{0}, bytes_in{0}, bytes_out{0}, connections{0};
+};
+
+static inline Worker *owner(Loop *loop, uint64_t conn) {
+    size_t index = conn & 0xFF;
+    return index < loop->workers.size() ? loop->workers[index].get() : nullptr;
+}
+
+static void wake(Worker *w) {
+    if (!w->wake_pending.exchange(true)) {
+        uint64_t one = 1;
+        ssize_t r = write(w->wakefd, &one, sizeof(one));
+        (void)r;
+    }
+}
+
+/**
+ * @brief Queues a command for an I/O thread, waiting for room if its queue
+ * is full. A caller holding the GIL (gil) lets go of it while it waits,
+ * so other Python threads keep polling the inbox meanwhile.
+ */
+static bool submit(Worker *w, const Command &cmd, bool gil = false) {
+    Command *c = new (std::nothrow) Command(cmd);
+    if (!c)
+        return false;
+    bool queued = w->commands.push(c);
+    if (!queued) {
+        PyThreadState *state = gil ? PyEval_SaveThread() : nullptr;
+        while (!(queued = w->commands.push(c)) && !w->loop->stopping.load()) {
+            wake(w);
+            std::this_thread::yield();
+        }
+        if (state)
+            PyEval_RestoreThread(state);
+    }
+    if (!queued) {
+        delete c;
+        return false;
+    }
+    wake(w);
+    return true;
+}
+
+static void notify(Loop *loop) {
+    if (loop->sleepers.load() > 0) {
+        std::lock_guard<std::mutex> lock(loop->mu);
+        loop->cv.notify_one();
+    }
+}
+
+/**
+ * @brief Hands a delivery to the validation threads. If the inbox is full
+ * it waits in the worker's backlog, and the worker stops reading from its
+ * sockets until the backlog has gone out (drain()), which pushes back on
+ * the peers through TCP flow control. The I/O thread itself never waits:
+ * it keeps running commands, which a Python thread may be waiting on
+ * before it polls the inbox again.
+ */
+static void deliver(Worker *w, Delivery *d) {
+    if (!d)
+        return;
+    if (!w->backlog.empty() || !w->loop->inbox.push(d)) {
+        if (w->backlog.empty() && !w->backlogged.exchange(true))
+            w->loop->backlogged.fetch_add(1);
+        w->backlog.push_back(d);
+        return;
+    }
+    notify(w->loop);
+}
+
+static void set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+static std::string peer_name(int fd) {
+    sockaddr_storage addr;
+    socklen_t len = sizeof(addr);
+    char host[INET6_ADDRSTRLEN] = "?";
+    int port = 0;
+    if (getpeername(fd, reinterpret_cast<sockaddr *>(&addr), &len) == 0) {
+        if (addr.ss_family == AF_INET) {
+            sockaddr_in *a = reinterpret_cast<sockaddr_in *>(&addr);
+            inet_ntop(AF_INET, &a->sin_addr, host, sizeof(host));
+            port = ntohs(a->sin_port);
+        } else if (addr.ss_family == AF_INET6) {
+            sockaddr_in6 *a = reinterpret_cast<sockaddr_in6 *>(&addr);
+            inet_ntop(AF_INET6, &a->sin6_addr, host, sizeof(host));
+            port = ntohs(a->sin6_port);
+        }
+    }
+    return std::string(host) + ":" + std::to_string(port);
+}
+
+static void close_connection(Worker *w, Connection *c) {
+    w->poller.remove(c->fd, c->id);
+    close(c->fd);
+    for (const FileSegment &f : c->files)
+        close(f.fd);
+    w->conns.erase(c->id);
+    if (!c->listener) {
+        w->loop->connections.fetch_sub(1);
+        deliver(w, Delivery::make(EVENT_DISCONNECTED, c->id, nullptr, nullptr, 0));
+    }
+    delete c;
+}
+
+static void register_connection(Worker *w, uint64_t id, int fd, bool listener, bool spread = false) {
+    Connection *c = new (std::nothrow) Connection{id, fd, listener, spread, false, false, nullptr, nullptr};
+    if (c && !listener) {
+        c->rx.reset(new (std::nothrow) RingBuffer());
+        c->tx.reset(new (std::nothrow) RingBuffer());
+    }
+    if (!c || (!listener && (!c->rx || !c->tx || !c->rx->init(w->loop->capacity) || !c->tx->init(w->loop->capacity)))) {
+        delete c;
+        close(fd);
+        return;
+    }
+    if (!w->poller.add(fd, id)) {
+        delete c;
+        close(fd);
+        return;
+    }
+    w->conns[id] = c;
+    if (!listener) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        w->loop->connections.fetch_add(1);
+        std::string name = peer_name(fd);
+        deliver(w, Delivery::make(EVENT_CONNECTED, id, nullptr, reinterpret_cast<const uint8_t *>(name.data()),
+                                        (uint32_t)name.size()));
+    }
+}
+
+static uint64_t new_id(Worker *w) {
+    return w->next_seq.fetch_add(1) << 8 | (uint64_t)w->index;
+}
+
+/**
+ * @brief Replaces a ring buffer with a bigger one holding the same data.
+ */
+static bool grow(std::unique_ptr<RingBuffer> &ring, size_t needed) {
+    std::unique_ptr<RingBuffer> bigger(new (std::nothrow) RingBuffer());
+    if (!bigger || !bigger->init(needed))
+        return false;
+    bigger->write(ring->read_ptr(), ring->size());
+    ring.swap(bigger);
+    return true;
+}
+
+/**
+ * @brief Sends as much of the send buffer (and queued file regions) as
+ * the socket takes. Returns false if the connection failed.
+ */
+static bool flush(Worker *w, Connection *c) {
+    RingBuffer &tx = *c->tx;
+    for (;;) {
+        size_t limit = tx.size();
+        ssize_t n;
+        bool file = false;
+        if (!c->files.empty()) {
+            FileSegment &f = c->files.front();
+            if (f.mark == c->sent) {
+                file = true;
+                n = sendfile(c->fd, f.fd, &f.offset, f.remaining);
+                if (n == 0)
+                    return false;  // The file is shorter than promised.
+            } else {
+                limit = f.mark - c->sent;
+            }
+        }
+        if (!file) {
+            if (limit == 0)
+                break;
+            n = send(c->fd, tx.read_ptr(), limit, MSG_NOSIGNAL);
+        }
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                return false;
+            if (!c->want_write) {
+                c->want_write = true;
+                w->poller.want_write(c->fd, c->id, true);
+            }
+            return true;
+        }
+        if (file) {
+            FileSegment &f = c->files.front();
+            c->file_bytes -= n;
+            if ((f.remaining -= n) == 0) {
+                close(f.fd);
+                c->files.pop_front();
+            }
+        } else {
+            tx.consume(n);
+            c->sent += n;
+        }
+        w->loop->bytes_out.fetch_add(n, std::memory_order_relaxed);
+    }
+    if (c->want_write) {
+        c->want_write = false;
+        w->poller.want_write(c->fd, c->id, false);
+    }
+    return true;
+}
+
+/**
+ * @brief Splits the receive buffer into messages and delivers the ones
+ * with a valid checksum, stopping after a batch that filled the inbox.
+ * Returns false if the peer sent garbage.
+ */
+static bool parse(Worker *w, Connection *c) {
+    Loop *loop = w->loop;
+    RingBuffer &rx = *c->rx;
+    Frame frames[MAX_BATCH];
+    bool valid[MAX_BATCH];
+    while (w->backlog.empty()) {
+        int count;
+        size_t used, needed;
+        FrameStatus status = scan_frames(rx.read_ptr(), rx.size(), loop->magic, loop->max_payload, frames, MAX_BATCH,
+                                         &count, &used, &needed);
+        if (count == 0) {
+            if (status != FRAME_OK)
+                return false;
+            if (needed > rx.capacity())
+                return grow(c->rx, needed);
+            return true;
+        }
+        check_frames(frames, count, valid);
+        for (int i = 0; i < count; ++i) {
+            if (!valid[i]) {
+                loop->bad_checksums.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            loop->messages.fetch_add(1, std::memory_order_relaxed);
+            deliver(w, Delivery::make(EVENT_MESSAGE, c->id, frames[i].header + 4, frames[i].payload,
+                                      frames[i].length));
+        }
+        rx.consume(used);
+    }
+    return true;
+}
+
+/**
+ * @brief Reads until the socket is drained, or until the inbox is full,
+ * in which case the connection is read again once it has room (drain()).
+ * Returns false if the connection should be closed.
+ */
+static bool receive(Worker *w, Connection *c) {
+    for (;;) {
+        if (!w->backlog.empty()) {
+            if (!c->stalled)
+                w->stalled.push_back(c->id);
+            c->stalled = true;
+            return true;
+        }
+        size_t space = c->rx->writable();
+        if (space == 0) {
+            if (!parse(w, c))
+                return false;
+            if (!w->backlog.empty())
+                continue;
+            if ((space = c->rx->writable()) == 0 && !grow(c->rx, 2 * c->rx->capacity()))
+                return false;
+            space = c->rx->writable();
+        }
+        ssize_t n = recv(c->fd, c->rx->write_ptr(), space, 0);
+        if (n == 0)
+            return false;
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                return false;
+            if (!parse(w, c))
+                return false;
+            if (w->backlog.empty())
+                return true;
+            continue;
+        }
+        c->rx->commit(n);
+        w->loop->bytes_in.fetch_add(n, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Moves the backlog into the inbox as far as it has room, and once
+ * all of it is in, reads the connections that stopped for it again. Runs
+ * after every wakeup, which poll() causes when it makes room.
+ */
+static void drain(Worker *w) {
+    bool moved = false;
+    while (!w->backlog.empty() && w->loop->inbox.push(w->backlog.front())) {
+        w->backlog.pop_front();
+        moved = true;
+    }
+    if (moved)
+        notify(w->loop);
+    if (!w->backlog.empty())
+        return;
+    if (w->backlogged.exchange(false))
+        w->loop->backlogged.fetch_sub(1);
+    if (w->stalled.empty())
+        return;
+    std::vector<uint64_t> stalled;
+    stalled.swap(w->stalled);
+    for (uint64_t id : stalled) {
+        auto it = w->conns.find(id);
+        if (it == w->conns.end())
+            continue;
+        Connection *c = it->second;
+        c->stalled = false;
+        if (!receive(w, c))
+            close_connection(w, c);
+        else if (!c->stalled)
+            w->poller.rearm(c->fd, c->id);
+    }
+}
+
+static void accept_all(Worker *w, Connection *listener) {
+    Loop *loop = w->loop;
+    for (;;) {
+        int fd = accept4(listener->fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            return;
+        /* With SO_REUSEPORT every thread has its own listener and keeps
+           what it accepts. A lone listener spreads connections out. */
+        Worker *target = w;
+        if (listener->spread)
+            target = loop->workers[loop->next_worker.fetch_add(1) % loop->workers.size()].get();
+        if (target == w)
+            register_connection(w, new_id(w), fd, false);
+        else if (!submit(target, Command{CMD_ADD, new_id(target), fd, 0, nullptr}))
+            close(fd);
+    }
+}
+
+static bool run_command(Worker *w, Command *cmd) {
+    switch (cmd->type) {
+    case CMD_ADD:
+        register_connection(w, cmd->conn, cmd->fd, false);
+        break;
+    case CMD_LISTEN:
+        register_connection(w, cmd->conn, cmd->fd, true, cmd->length != 0);
+        break;
+    case CMD_SEND:
+    case CMD_SENDFILE: {
+        auto it = w->conns.find(cmd->conn);
+        if (it != w->conns.end() && !it->second->listener) {
+            Connection *c = it->second;
+            RingBuffer &tx = *c->tx;
+            size_t file_length = cmd->type == CMD_SENDFILE ? cmd->file_length : 0;
+            bool ok = tx.size() + c->file_bytes + cmd->length + file_length <= MAX_SEND_BUFFER
+                      && (!file_length || c->files.size() < MAX_FILE_SEGMENTS);
+            if (ok && tx.capacity() - tx.size() < cmd->length) {
+                size_t needed = tx.size() + cmd->length;
+                ok = needed <= MAX_SEND_BUFFER && grow(c->tx, needed);
+            }
+            if (ok) {
+                if (cmd->length)
+                    c->tx->write(cmd->data, cmd->length);
+                c->queued += cmd->length;
+                if (cmd->type == CMD_SENDFILE) {
+                    c->files.push_back(FileSegment{cmd->fd, cmd->offset, cmd->file_length, c->queued});
+                    c->file_bytes += cmd->file_length;
+                    cmd->fd = -1;
+                }
+                ok = flush(w, c);
+            }
+            if (!ok)
+                close_connection(w, c);  // Peer is too slow (or gone).
+        }
+        if (cmd->type == CMD_SENDFILE && cmd->fd >= 0)
+            close(cmd->fd);
+        std::free(cmd->data);
+        break;
+    }
+    case CMD_CLOSE: {
+        auto it = w->conns.find(cmd->conn);
+        if (it != w->conns.end())
+            close_connection(w, it->second);
+        break;
+    }
+    case CMD_STOP:
+        return false;
+    }
+    return true;
+}
+
+static void worker_main(Worker *w) {
+    Loop *loop = w->loop;
+    if (loop->pin) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(w->index % std::thread::hardware_concurrency(), &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+    PollEvent events[256];
+    bool running = true;
+    while (running) {
+        int n = w->poller.wait(events, 256, -1);
+        if (n < 0)
+            break;
+        for (int i = 0; i < n; ++i) {
+            const PollEvent &ev = events[i];
+            if (ev.token == WAKE_TOKEN) {
+                uint64_t value;
+                ssize_t r = read(w->wakefd, &value, sizeof(value));
+                (void)r;
+                if (ev.rearm)
+                    w->poller.rearm(w->wakefd, WAKE_TOKEN);
+                continue;
+            }
+            auto it = w->conns.find(ev.token);
+            if (it == w->conns.end())
+                continue;  // Closed since the event was queued.
+            Connection *c = it->second;
+            if (c->listener) {
+                accept_all(w, c);
+                if (ev.rearm)
+                    w->poller.rearm(c->fd, c->id);
+                continue;
+            }
+            bool ok = true;
+            if (ev.writable) {
+                if (w->poller.backend() == Poller::IO_URING)
+                    c->want_write = false;  // The one-shot poll has fired.
+                ok = flush(w, c);
+            }
+            if (ok && (ev.readable || ev.error))
+                ok = receive(w, c);
+            if (!ok)
+                close_connection(w, c);
+            else if (ev.rearm && !c->stalled)
+                w->poller.rearm(c->fd, c->id);  // A stalled one is rearmed by drain().
+        }
+        w->wake_pending.store(false);
+        Command *cmd;
+        while (w->commands.pop(cmd)) {
+            running = run_command(w, cmd) && running;
+            delete cmd;
+        }
+        drain(w);
+    }
+    for (auto &entry : w->conns) {
+        w->poller.remove(entry.second->fd, entry.first);
+        close(entry.second->fd);
+        for (const FileSegment &f : entry.second->files)
+            close(f.fd);
+        delete entry.second;
+    }
+    w->conns.clear();
+    for (Delivery *d : w->backlog)
+        std::free(d);
+    w->backlog.clear();
+}
+
+static void stop_loop(Loop *loop) {
+    if (loop->stopping.exchange(true))
+        return;
+    for (auto &w : loop->workers) {
+        if (w->thread.joinable()) {
+            Command *c = new Command{CMD_STOP, 0, -1, 0, nullptr};
+            while (!w->commands.push(c))
+                std::this_thread::yield();
+            wake(w.get());
+        }
+    }
+    for (auto &w : loop->workers) {
+        if (w->thread.joinable())
+            w->thread.join();
+        Command *cmd;
+        while (w->commands.pop(cmd)) {
+            if (cmd->type == CMD_ADD || cmd->type == CMD_LISTEN || cmd->type == CMD_SENDFILE)
+                close(cmd->fd);
+            std::free(cmd->data);
+            delete cmd;
+        }
+        if (w->wakefd >= 0)
+            close(w->wakefd);
+        w->wakefd = -1;
+    }
+    Delivery *d;
+    while (loop->inbox.pop(d))
+        std::free(d);
+    std::lock_guard<std::mutex> lock(loop->mu);
+    loop->cv.notify_all();
+}
+
+/* EventLoop type. */
+
+typedef struct {
+    PyObject_HEAD
+    Loop *loop;
+} EventLoopObject;
+
+static int EventLoop_init(EventLoopObject *self, PyObject *args, PyObject *kwds) {
+    static const char *kwlist[] = {"magic", "threads", "capacity", "inbox", "max_payload", "pin", NULL};
+    Py_buffer magic;
+    int threads = 0, pin = 0;
+    Py_ssize_t capacity = DEFAULT_CAPACITY, inbox = DEFAULT_INBOX;
+    unsigned long max_payload = DEFAULT_MAX_PAYLOAD;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y*|innkp", const_cast<char **>(kwlist), &magic, &threads,
+                                     &capacity, &inbox, &max_payload, &pin))
+        return -1;
+    if (self->loop) {
+        PyBuffer_Release(&magic);
+        PyErr_SetString(PyExc_RuntimeError, "EventLoop is already initialized.");
+        return -1;
+    }
+    if (magic.len != 4) {
+        PyBuffer_Release(&magic);
+        PyErr_SetString(PyExc_ValueError, "magic must be exactly 4 bytes.");
+        return -1;
+    }
+    if (threads <= 0)
+        threads = (int)std::thread::hardware_concurrency();
+    if (threads <= 0)
+        threads = 1;
+    if (threads > MAX_WORKERS)
+        threads = MAX_WORKERS;
+    Loop *loop = new Loop();
+    std::memcpy(loop->magic, magic.buf, 4);
+    PyBuffer_Release(&magic);
+    loop->max_payload = max_payload > UINT32_MAX ? UINT32_MAX : (uint32_t)max_payload;
+    loop->capacity = capacity;
+    loop->pin = pin;
+    if (!loop->inbox.init(inbox)) {
+        delete loop;
+        PyErr_NoMemory();
+        return -1;
+    }
+    for (int i = 0; i < threads; ++i) {
+        std::unique_ptr<Worker> w(new Worker());
+        w->loop = loop;
+        w->index = i;
+        w->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (w->wakefd < 0 || !w->poller.init() || !w->commands.init(COMMAND_QUEUE)
+            || !w->poller.add(w->wakefd, WAKE_TOKEN)) {
+            if (w->wakefd >= 0)
+                close(w->wakefd);
+            loop->workers.clear();
+            delete loop;
+            PyErr_SetString(PyExc_OSError, "could not set up the I/O threads.");
+            return -1;
+        }
+        loop->workers.push_back(std::move(w));
+    }
+    for (auto &w : loop->workers)
+        w->thread = std::thread(worker_main, w.get());
+    self->loop = loop;
+    return 0;
+}
+
+static void EventLoop_dealloc(EventLoopObject *self) {
+    if (self->loop) {
+        Py_BEGIN_ALLOW_THREADS
+        stop_loop(self->loop);
+        Py_END_ALLOW_THREADS
+        delete self->loop;
+    }
+    heap_free(reinterpret_cast<PyObject *>(self));
+}
+
+static Loop *get_loop(EventLoopObject *self) {
+    if (!self->loop || self->loop->stopping.load()) {
+        PyErr_SetString(PyExc_RuntimeError, "EventLoop is not running.");
+        return nullptr;
+    }
+    return self->loop;
+}
+
+static PyObject *EventLoop_listen(EventLoopObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    const char *host;
+    int port, backlog = 1024;
+    if (!parse_args(args, nargs, "si|i:listen", &host, &port, &backlog))
+        return NULL;
+    Loop *loop = get_loop(self);
+    if (!loop)
+        return NULL;
+    addrinfo hints{}, *res = nullptr;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    std::string service = std::to_string(port);
+    int err = getaddrinfo(*host ? host : nullptr, service.c_str(), &hints, &res);
+    if (err != 0) {
+        PyErr_Format(PyExc_OSError, "getaddrinfo: %s", gai_strerror(err));
+        return NULL;
+    }
+    /* One listener per I/O thread. If SO_REUSEPORT is not available the
+       first listener takes every connection and spreads them out. */
+    int bound_port = port;
+    size_t opened = 0;
+    for (auto &w : loop->workers) {
+        int fd = socket(res->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+            break;
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        bool reuseport = setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) == 0;
+        if (res->ai_family == AF_INET)
+            reinterpret_cast<sockaddr_in *>(res->ai_addr)->sin_port = htons(bound_port);
+        else if (res->ai_family == AF_INET6)
+            reinterpret_cast<sockaddr_in6 *>(res->ai_addr)->sin6_port = htons(bound_port);
+        if (bind(fd, res->ai_addr, res->ai_addrlen) != 0 || ::listen(fd, backlog) != 0) {
+            close(fd);
+            break;
+        }
+        if (bound_port == 0) {
+            sockaddr_storage addr;
+            socklen_t len = sizeof(addr);
+            getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &len);
+            bound_port = ntohs(addr.ss_family == AF_INET ? reinterpret_cast<sockaddr_in *>(&addr)->sin_port
+                                                         : reinterpret_cast<sockaddr_in6 *>(&addr)->sin6_port);
+        }
+        if (!submit(w.get(), Command{CMD_LISTEN, new_id(w.get()), fd, reuseport ? 0u : 1u, nullptr}, true)) {
+            close(fd);
+            break;
+        }
+        ++opened;
+        if (!reuseport)
+            break;
+    }
+    freeaddrinfo(res);
+    if (opened == 0)
+        return PyErr_SetFromErrno(PyExc_OSError);
+    return PyLong_FromLong(bound_port);
+}
+
+static PyObject *EventLoop_add(EventLoopObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    int fd;
+    if (!check_nargs("add", nargs, 1) || !read_i32(args[0], &fd))
+        return NULL;
+    Loop *loop = get_loop(self);
+    if (!loop)
+        return NULL;
+    set_nonblocking(fd);
+    Worker *w = loop->workers[loop->next_worker.fetch_add(1) % loop->workers.size()].get();
+    uint64_t id = new_id(w);
+    if (!submit(w, Command{CMD_ADD, id, fd, 0, nullptr}, true)) {
+        PyErr_SetString(PyExc_RuntimeError, "EventLoop is not running.");
+        return NULL;
+    }
+    return PyLong_FromUnsignedLongLong(id);
+}
+
+static PyObject *send_buffer(Loop *loop, uint64_t conn, uint8_t *data, size_t length) {
+    Worker *w = owner(loop, conn);
+    if (!w) {
+        std::free(data);
+        PyErr_SetString(PyExc_ValueError, "unknown connection.");
+        return NULL;
+    }
+    if (!submit(w, Command{CMD_SEND, conn, -1, length, data}, true)) {
+        std::free(data);
+        PyErr_SetString(PyExc_RuntimeError, "EventLoop is not running.");
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject *EventLoop_send(EventLoopObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    unsigned long long conn;
+    Py_buffer data;
+    if (!check_nargs("send", nargs, 2) || !read_u64(args[0], &conn) || !read_buffer(args[1], &data))
+        return NULL;
+    Loop *loop = get_loop(self);
+    uint8_t *copy = loop ? static_cast<uint8_t *>(std::malloc(data.len + 1)) : nullptr;
+    if (copy)
+        std::memcpy(copy, data.buf, data.len);
+    size_t length = data.len;
+    PyBuffer_Release(&data);
+    if (!loop)
+        return NULL;
+    if (!copy)
+        return PyErr_NoMemory();
+    return send_buffer(loop, conn, copy, length);
+}
+
+static PyObject *EventLoop_send_message(EventLoopObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    unsigned long long conn;
+    const char *command;
+    Py_ssize_t command_len;
+    Py_buffer payload;
+    if (!check_nargs("send_message", nargs, 3) || !read_u64(args[0], &conn)
+        || !read_str(args[1], &command, &command_len) || !read_buffer(args[2], &payload))
+        return NULL;
+    Loop *loop = get_loop(self);
+    if (!loop || command_len > COMMAND_SIZE || payload.len > UINT32_MAX) {
+        PyBuffer_Release(&payload);
+        if (loop)
+            PyErr_SetString(PyExc_ValueError, "invalid command or payload.");
+        return NULL;
+    }
+    uint8_t *buf = static_cast<uint8_t *>(std::malloc(HEADER_SIZE + payload.len));
+    if (!buf) {
+        PyBuffer_Release(&payload);
+        return PyErr_NoMemory();
+    }
+    uint8_t digest[32];
+    sha256::sha256d(static_cast<const uint8_t *>(payload.buf), payload.len, digest);
+    pack_header(buf, loop->magic, command, command_len, (uint32_t)payload.len, digest);
+    std::memcpy(buf + HEADER_SIZE, payload.buf, payload.len);
+    size_t length = HEADER_SIZE + payload.len;
+    PyBuffer_Release(&payload);
+    return send_buffer(loop, conn, buf, length);
+}
+
+static PyObject *EventLoop_send_file(EventLoopObject *self, PyObject *args, PyObject *kwds) {
+    static const char *kwlist[] = {"conn", "fd", "offset", "length", "header", NULL};
+    unsigned long long conn;
+    int fd;
+    long long offset;
+    Py_ssize_t length;
+    Py_buffer header = {NULL, NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "KiLn|y*", const_cast<char **>(kwlist), &conn, &fd, &offset,
+                                     &length, &header))
+        return NULL;
+    Loop *loop = get_loop(self);
+    Worker *w = loop ? owner(loop, conn) : nullptr;
+    uint8_t *copy = nullptr;
+    size_t header_len = header.buf ? header.len : 0;
+    if (header.buf) {
+        if ((copy = static_cast<uint8_t *>(std::malloc(header_len + 1))))
+            std::memcpy(copy, header.buf, header_len);
+        PyBuffer_Release(&header);
+    }
+    if (!loop) {
+        std::free(copy);
+        return NULL;
+    }
+    /* An empty region would make sendfile() return 0, which flush() takes
+       for a file that was cut short. */
+    if (!w || offset < 0 || length <= 0 || length > MAX_SEND_BUFFER) {
+        std::free(copy);
+        PyErr_SetString(PyExc_ValueError, "invalid connection or file region.");
+        return NULL;
+    }
+    if (header_len && !copy)
+        return PyErr_NoMemory();
+    /* The loop gets its own descriptor, so the caller may close theirs. */
+    int dup_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (dup_fd < 0) {
+        std::free(copy);
+        return PyErr_SetFromErrno(PyExc_OSError);
+    }
+    if (!submit(w, Command{CMD_SENDFILE, conn, dup_fd, header_len, copy, (off_t)offset, (size_t)length}, true)) {
+        close(dup_fd);
+        std::free(copy);
+        PyErr_SetString(PyExc_RuntimeError, "EventLoop is not running.");
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject *EventLoop_close(EventLoopObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    unsigned long long conn;
+    if (!check_nargs("close", nargs, 1) || !read_u64(args[0], &conn))
+        return NULL;
+    Loop *loop = get_loop(self);
+    if (!loop)
+        return NULL;
+    Worker *w = owner(loop, conn);
+    if (w)
+        submit(w, Command{CMD_CLOSE, conn, -1, 0, nullptr}, true);
+    Py_RETURN_NONE;
+}
+
+static PyObject *EventLoop_poll(EventLoopObject *self, PyObject *args, PyObject *kwds) {
+    static const char *kwlist[] = {"max_events", "timeout", NULL};
+    Py_ssize_t max_events = 64;
+    double timeout = -1.0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|nd", const_cast<char **>(kwlist), &max_events, &timeout))
+        return NULL;
+    Loop *loop = get_loop(self);
+    if (!loop)
+        return NULL;
+    if (max_events <= 0 || max_events > 65536)
+        max_events = 64;
+    std::vector<Delivery *> got;
+    got.reserve(max_events);
+    Py_BEGIN_ALLOW_THREADS
+    Delivery *d;
+    while ((Py_ssize_t)got.size() < max_events && loop->inbox.pop(d))
+        got.push_back(d);
+    if (got.empty() && timeout != 0.0) {
+        auto ready = [loop] { return loop->inbox.size() > 0 || loop->stopping.load(); };
+        loop->sleepers.fetch_add(1);
+        {
+            std::unique_lock<std::mutex> lock(loop->mu);
+            if (timeout < 0)
+                loop->cv.wait(lock, ready);
+            else
+                loop->cv.wait_for(lock, std::chrono::duration<double>(timeout), ready);
+        }
+        loop->sleepers.fetch_sub(1);
+        while ((Py_ssize_t)got.size() < max_events && loop->inbox.pop(d))
+            got.push_back(d);
+    }
+    /* There is room in the inbox now for what the I/O threads held back. */
+    if (!got.empty() && loop->backlogged.load() > 0) {
+        for (auto &w : loop->workers) {
+            if (w->backlogged.load())
+                wake(w.get());
+        }
+    }
+    Py_END_ALLOW_THREADS
+    PyObject *result = PyList_New(got.size());
+    for (size_t i = 0; i < got.size(); ++i) {
+        Delivery *e = got[i];
+        PyObject *item = NULL;
+        if (result) {
+            item = Py_BuildValue("(iKs#y#)", e->kind, (unsigned long long)e->conn, e->command,
+                                 (Py_ssize_t)command_length(reinterpret_cast<uint8_t *>(e->command)),
+                                 e->payload(), (Py_ssize_t)e->length);
+            if (item)
+                PyList_SET_ITEM(result, i, item);
+            else
+                Py_CLEAR(result);
+        }
+        std::free(e);
+    }
+    return result;
+}
+
+static PyObject *EventLoop_stop(EventLoopObject *self, PyObject *Py_UNUSED(ignored)) {
+    if (self->loop) {
+        Py_BEGIN_ALLOW_THREADS
+        stop_loop(self->loop);
+        Py_END_ALLOW_THREADS
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject *EventLoop_stats(EventLoopObject *self, PyObject *Py_UNUSED(ignored)) {
+    Loop *loop = self->loop;
+    if (!loop) {
+        PyErr_SetString(PyExc_RuntimeError, "EventLoop is not initialized.");
+        return NULL;
+    }
+    return Py_BuildValue("{sKsKsKsKsKsn}", "messages", (unsigned long long)loop->messages.load(), "bad_checksums",
+                         (unsigned long long)loop->bad_checksums.load(), "bytes_in",
+                         (unsigned long long)loop->bytes_in.load(), "bytes_out",
+                         (unsigned long long)loop->bytes_out.load(), "connections",
+                         (unsigned long long)loop->connections.load(), "queued", (Py_ssize_t)loop->inbox.size());
+}
+
+static PyObject *EventLoop_get_backend(EventLoopObject *self, void *closure) {
+    if (!self->loop || self->loop->workers.empty())
+        Py_RETURN_NONE;
+    return PyUnicode_FromString(self->loop->workers[0]->poller.name());
+}
+
+static PyObject *EventLoop_get_threads(EventLoopObject *self, void *closure) {
+    return PyLong_FromSize_t(self->loop ? self->loop->workers.size() : 0);
+}
+
+static PyMethodDef EventLoop_methods[] = {
+    {"listen", (PyCFunction)(void (*)(void))EventLoop_listen, METH_FASTCALL,
+     "Listen on host:port (one socket per I/O thread), returning the bound port."},
+    {"add", (PyCFunction)(void (*)(void))EventLoop_add, METH_FASTCALL,
+     "Hand a connected socket file descriptor to the loop (which takes ownership), returning its id."},
+    {"send", (PyCFunction)(void (*)(void))EventLoop_send, METH_FASTCALL, "Queue raw bytes for a connection."},
+    {"send_message", (PyCFunction)(void (*)(void))EventLoop_send_message, METH_FASTCALL,
+     "Frame and queue a message (command, payload) for a connection."},
+    {"send_file", (PyCFunction)(void (*)(void))EventLoop_send_file, METH_VARARGS | METH_KEYWORDS,
+     "Queue header bytes followed by length bytes of a file (from offset), sent with sendfile(2)."},
+    {"close", (PyCFunction)(void (*)(void))EventLoop_close, METH_FASTCALL, "Close a connection."},
+    {"poll", (PyCFunction)(void (*)(void))EventLoop_poll, METH_VARARGS | METH_KEYWORDS,
+     "Pop up to max_events (kind, conn, command, payload) tuples, waiting up to timeout seconds (< 0 waits forever)."},
+    {"stop", (PyCFunction)EventLoop_stop, METH_NOARGS, "Stop the I/O threads and close every connection."},
+    {"stats", (PyCFunction)EventLoop_stats, METH_NOARGS, "Counters for messages, bytes and connections."},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyGetSetDef EventLoop_getset[] = {
+    {"backend", (getter)EventLoop_get_backend, NULL, "Either 'io_uring' or 'epoll'.", NULL},
+    {"threads", (getter)EventLoop_get_threads, NULL, "Number of I/O threads.", NULL},
+    {NULL}
+};
+
+static PyType_Slot EventLoop_slots[] = {
+    {Py_tp_dealloc, (void *)EventLoop_dealloc},
+    {Py_tp_doc, (void *)"Multi-threaded network event loop (io_uring or epoll)."},
+    {Py_tp_methods, EventLoop_methods},
+    {Py_tp_getset, EventLoop_getset},
+    {Py_tp_init, (void *)EventLoop_init},
+    {Py_tp_new, (void *)PyType_GenericNew},
+    {0, NULL}
+};
+
+static PyType_Spec EventLoop_spec = {
+    "eventloop.EventLoop",
+    sizeof(EventLoopObject),
+    0,
+    Py_TPFLAGS_DEFAULT,
+    EventLoop_slots
+};
+
+/* Module. */
+
+typedef struct {
+    PyObject *event_loop_type;
+} EventLoopState;
+
+static EventLoopState *get_state(PyObject *m) {
+    return static_cast<EventLoopState *>(PyModule_GetState(m));
+}
+
+static int eventloop_exec(PyObject *m) {
+    if (module_add_type(m, &EventLoop_spec, &get_state(m)->event_loop_type) < 0
+        || PyModule_AddIntConstant(m, "EVENT_MESSAGE", EVENT_MESSAGE) < 0
+        || PyModule_AddIntConstant(m, "EVENT_CONNECTED", EVENT_CONNECTED) < 0
+        || PyModule_AddIntConstant(m, "EVENT_DISCONNECTED", EVENT_DISCONNECTED) < 0)
+        return -1;
+    return 0;
+}
+
+static int eventloop_traverse(PyObject *m, visitproc visit, void *arg) {
+    Py_VISIT(get_state(m)->event_loop_type);
+    return 0;
+}
+
+static int eventloop_clear(PyObject *m) {
+    Py_CLEAR(get_state(m)->event_loop_type);
+    return 0;
+}
+
+static void eventloop_free(void *m) {
+    eventloop_clear(static_cast<PyObject *>(m));
+}
+
+static PyModuleDef_Slot eventloop_slots[] = {
+    {Py_mod_exec, (void *)eventloop_exec},
+    MODULE_SLOTS
+    {0, NULL}
+};
+
+static struct PyModuleDef eventloop = {
+    PyModuleDef_HEAD_INIT,
+    "eventloop",
+    NULL,
+    sizeof(EventLoopState),
+    NULL,
+    eventloop_slots,
+    eventloop_traverse,
+    eventloop_clear,
+    eventloop_free
+};
+
+PyMODINIT_FUNC PyInit_eventloop(void) {
+    return PyModuleDef_Init(&eventloop);
+}
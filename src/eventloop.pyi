@@ -0,0 +1,25 @@
+EVENT_MESSAGE: int
+EVENT_CONNECTED: int
+EVENT_DISCONNECTED: int
+
+class EventLoop:
+    backend: str
+    threads: int
+    def __init__(
+        self,
+        magic: bytes,
+        threads: int = ...,
+        capacity: int = ...,
+        inbox: int = ...,
+        max_payload: int = ...,
+        pin: bool = ...,
+    ) -> None: ...
+    def listen(self, host: str, port: int, backlog: int = ...) -> int: ...
+    def add(self, fd: int) -> int: ...
+    def send(self, conn: int, data: bytes) -> None: ...
+    def send_message(self, conn: int, command: str, payload: bytes) -> None: ...
+    def send_file(self, conn: int, fd: int, offset: int, length: int, header: bytes = ...) -> None: ...
+    def close(self, conn: int) -> None: ...
+    def poll(self, max_events: int = ..., timeout: float = ...) -> list[tuple[int, int, str, bytes]]: ...
+    def stop(self) -> None: ...
+    def stats(self) -> dict[str, int]: ...
@@ -1,7 +1,7 @@
 /**
  * @file fastinv.cpp
  * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
- * @brief Fast modular inversion (WIP -- not added).
+ * @brief Fast modular inversion and exponentiation for small operands.
  * @version 0.1
  * @date 2022-04-03
  *
@@ -11,49 +11,63 @@
 
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
-#include <iostream>
 #include <tuple>
 
- /* The intention of all the code below was to provide a faster way
-    to calculate modular inverses through a C++ Python extension.
-    While calculations are roughly an order of magnitude faster for
-    smaller integers (unsigned long long range in C/C++), multiprecision
-    arithmetic has fairly bad performance due to reference counting
-    not being completely fixed, as well multiprecision arithmetic being
-    fairly slow in Python (Python only uses Karatsuba for large integer
-    multiplication, as opposed to GMP's various algorithms).
-
-    Only the plain extended euclidian algorithm is used. Some speed can
-    be gained from using the prime version of modinv, although it suffers
-    from memory leaks for Python long types.
- */
+#include "metrics.h"
+#include "pymodule.h"
 
- /**
-  * @brief Returns the bit length of an integer, which is the position of
-  * the most significant bit that is set.
-  *
-  * @param n
-  * @return int64_t
-  */
-int64_t bit_length(int64_t n) {
-    return (n >= 2) ? bit_length(n >> 1) + 1 : 1;
-}
+ /* Modular inverses and powers through a C++ Python extension. For
+    operands in the signed 64-bit range, the arithmetic itself takes a
+    few nanoseconds, so almost all of a call is the call: the functions
+    are METH_FASTCALL (no argument tuple is built), and each argument is
+    read once with PyLong_AsLongLongAndOverflow, which also tells
+    whether it fits.
+
+    Larger operands go to Python's own pow(), which already runs the
+    extended Euclidean algorithm (and windowed exponentiation) on its
+    digits in C, faster than doing the same through the number protocol
+    one operation at a time.
+
+    Bad arguments raise: TypeError for a wrong count or a non-integer,
+    ValueError for a modulus that is not positive. An element without an
+    inverse gives 0, as in the Python equivalent below.
+ */
 
-int64_t modexp_64(int64_t g, int64_t k, int64_t p) {
-    int64_t r = g;
-    k %= (p - 1);
-    int64_t bits = bit_length(k) - 2;
-    int64_t mask = 1 << bits;
-    for (int i = 0; i <= bits; ++i) {
-        r = r * r % p;
-        if (k & mask)
-            r = r * g % p;
-        mask >>= 1;
+/**
+ * @brief g**k mod p by square-and-multiply, for 0 <= g < p and p > 0.
+ * Products are taken in 128 bits, so any 63-bit modulus works.
+ */
+static int64_t modexp_64(uint64_t g, uint64_t k, uint64_t p) {
+    unsigned __int128 r = 1 % p, b = g;
+    for (; k; k >>= 1) {
+        if (k & 1)
+            r = r * b % p;
+        b = b * b % p;
     }
-    return r;
+    return static_cast<int64_t>(r);
 }
 
-int64_t modinv_64(int64_t a, int64_t n) {
+/*
+    Regular extended euclidean algorithm for modular inverse.
+    This can also be viewed in the test framework for the Bitcoin Core repository.
+
+    Python equivalent:
+
+    def modinv(a: int, n: int) -> int:
+        t1, t2, r1, r2 = 0, 1, n, a
+        while r2 != 0:
+            q = r1 // r2
+            t1, t2 = t2, t1 - q*t2
+            r1, r2 = r2, r1 - q*r2
+        if r1 > 1:
+            return 0
+        if t1 < 0:
+            t1 += n
+        return t1
+
+*/
+
+static int64_t modinv_64(int64_t a, int64_t n) {
     int64_t t1 = 0, t2 = 1, r1 = n, r2 = a, q;
     while (r2 != 0) {
         q = r1 / r2;
@@ -67,7 +81,11 @@ int64_t modinv_64(int64_t a, int64_t n) {
     return t1;
 }
 
-int64_t modinv_64_prime(int64_t a, int64_t n) {
+/**
+ * @brief The inverse of a mod n for a prime n, skipping the gcd check
+ * (0 for a = 0).
+ */
+static int64_t modinv_64_prime(int64_t a, int64_t n) {
     int64_t u = 1, w = 0, c = n, q, r, old_u;
     while (c != 0) {
         q = a / c, r = a % c;
@@ -76,163 +94,117 @@ int64_t modinv_64_prime(int64_t a, int64_t n) {
         u = w;
         w = old_u - q * w;
     }
-    return u;
+    return u < 0 ? u + n : u;
 }
 
-static PyObject *modexp(PyObject *self, PyObject *args) {
-    PyObject *g, *k, *p;
-    if (PyArg_ParseTuple(args, "OOO", &g, &k, &p)) {
-        if (_PyLong_NumBits(g) <= 64 && _PyLong_NumBits(k) <= 64) {
-            if (_PyLong_NumBits(p) <= 64) {
-                int64_t result = modexp_64(PyLong_AsLongLong(g), PyLong_AsLongLong(k), PyLong_AsLongLong(p));
-                return PyLong_FromLongLong(result);
-            }
-        }
-    }
-    return NULL;
+/**
+ * @brief Reads an integer argument. Returns false with an exception set
+ * if it is not one; *overflow is nonzero if it does not fit in 64 bits.
+ */
+static bool read_int(PyObject *arg, long long *value, int *overflow) {
+    *value = PyLong_AsLongLongAndOverflow(arg, overflow);
+    return !(*value == -1 && PyErr_Occurred());
 }
 
-PyObject *_primeinv(PyObject *a, PyObject *n) {
-    PyObject *u, *w, *c, *q, *r, *old_u, *d_r, *z, *o, *qw;
-    u = PyLong_FromLong(1);
-    w = PyLong_FromLong(0);
-    Py_INCREF(a);
-    Py_INCREF(n);
-    z = Py_NewRef(w);
-    o = Py_NewRef(u);
-    c = Py_NewRef(n);
-    while (PyObject_RichCompareBool(c, z, Py_NE)) {
-        d_r = PyNumber_Divmod(a, c);
-        q = PyTuple_GetItem(d_r, 0);
-        r = PyTuple_GetItem(d_r, 1);
-        Py_DECREF(a);
-        a = c, c = r;  // Avoid increasing reference count (adds overhead).
-        old_u = u;
-        u = w;
-        qw = PyNumber_Multiply(q, u);
-        w = PyNumber_Subtract(old_u, qw);
-        Py_DECREF(qw);
-        Py_DECREF(old_u);
-        /* This is where the memory leak is. Decrementing the
-           reference count results in the function not returning
-           properly, so this has to be fixed. */
-
-           /* Py_DECREF(d_r); */
+static bool check_modulus(const char *name, long long n, int overflow) {
+    if (overflow > 0 || (!overflow && n > 0))
+        return true;
+    PyErr_Format(PyExc_ValueError, "%s() modulus must be positive.", name);
+    return false;
+}
+
+/**
+ * @brief pow(base, exp, mod) for operands too large for the fast path. For
+ * an inverse (exp = -1) of an element that has none, returns 0 rather
+ * than pow's ValueError.
+ */
+static PyObject *big_pow(PyObject *base, PyObject *exp, PyObject *mod, bool inverse) {
+    PyObject *result = PyNumber_Power(base, exp, mod);
+    if (!result && inverse && PyErr_ExceptionMatches(PyExc_ValueError)) {
+        PyErr_Clear();
+        return PyLong_FromLong(0);
     }
-    Py_DECREF(w);
-    Py_DECREF(z);
-    Py_DECREF(o);
-    Py_DECREF(c);
-    return u;
+    return result;
 }
 
-PyObject *primeinv(PyObject *self, PyObject *args) {
-    PyObject *a, *n;
-    if (!PyArg_ParseTuple(args, "OO", &a, &n))
+static PyObject *inverse(const char *name, PyObject *const *args, Py_ssize_t nargs, bool prime) {
+    long long a, n;
+    int a_overflow, n_overflow;
+    if (!check_nargs(name, nargs, 2) || !read_int(args[0], &a, &a_overflow)
+        || !read_int(args[1], &n, &n_overflow) || !check_modulus(name, n, n_overflow))
         return NULL;
-    if (PyLong_CheckExact(a) && PyLong_CheckExact(n)) {
-        if (_PyLong_NumBits(a) <= 64 && _PyLong_NumBits(n) <= 64) {
-            int64_t result = modinv_64_prime(PyLong_AsLongLong(a), PyLong_AsLongLong(n));
-            return PyLong_FromLongLong(result);
-        }
-        return _primeinv(a, n);
+    METRICS_INC(MODULAR_INVERSES);
+    if (!a_overflow && !n_overflow) {
+        a %= n;
+        if (a < 0)
+            a += n;
+        return PyLong_FromLongLong(prime ? modinv_64_prime(a, n) : modinv_64(a, n));
     }
-    return NULL;
+    PyObject *minus_one = PyLong_FromLong(-1);
+    PyObject *result = big_pow(args[0], minus_one, args[1], true);
+    Py_DECREF(minus_one);
+    return result;
 }
 
-/*
-    Regular extended euclidean algorithm for modular inverse.
-    This can also be viewed in the test framework for the Bitcoin Core repository.
-
-    Python equivalent:
-
-    def modinv(a: int, n: int) -> int:
-        t1, t2, r1, r2 = 0, 1, n, a
-        while r2 != 0:
-            q = r1 // r2
-            t1, t2 = t2, t1 - q*t2
-            r1, r2 = r2, r1 - q*r2
-        if r1 > 1:
-            return 0
-        if t1 < 0:
-            t1 += n
-        return t1
+static PyObject *modinv(PyObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    return inverse("modinv", args, nargs, false);
+}
 
-*/
+static PyObject *primeinv(PyObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    return inverse("primeinv", args, nargs, true);
+}
 
-static PyObject *modinv(PyObject *self, PyObject *args) {
-    PyObject *ar, *nr;
-    if (PyArg_ParseTuple(args, "OO", &ar, &nr)) {
-        if (PyLong_CheckExact(ar) && PyLong_CheckExact(nr)) {
-            if (_PyLong_NumBits(ar) <= 64 && _PyLong_NumBits(nr) <= 64) {
-                int64_t result = modinv_64(PyLong_AsLongLong(ar), PyLong_AsLongLong(nr));
-                return PyLong_FromLongLong(result);
-            }
-            PyObject *r1, *old_r1, *r2, *old_r2, *t1, *old_t1, *t2, *old_t2, *z, *q, *o;
-            o = PyLong_FromLong(1);
-            z = PyLong_FromLong(0);
-            t1 = Py_NewRef(z);
-            t2 = Py_NewRef(o);
-            r1 = Py_NewRef(nr);
-            r2 = Py_NewRef(ar);
-            while (PyObject_RichCompareBool(r2, z, Py_NE)) {
-                q = PyNumber_FloorDivide(r1, r2);
-                old_t1 = t1;
-                t1 = t2;
-                t2 = PyNumber_Multiply(q, t1);
-                old_t2 = t2;
-                t2 = PyNumber_Subtract(old_t1, t2);
-                Py_DECREF(old_t1);
-                Py_DECREF(old_t2);
-                old_r1 = r1;
-                r1 = r2;
-                r2 = PyNumber_Multiply(q, r1);
-                old_r2 = r2;
-                Py_DECREF(q);
-                r2 = PyNumber_Subtract(old_r1, r2);
-                Py_DECREF(old_r1);
-                Py_DECREF(old_r2);
-            }
-            Py_DECREF(t2);
-            Py_DECREF(r2);
-            if (PyObject_RichCompareBool(r1, o, Py_GT)) {
-                Py_DECREF(t1);
-                Py_DECREF(r1);
-                Py_DECREF(o);
-                Py_DECREF(z);
-                return Py_None;
-            }
-            if (PyObject_RichCompareBool(t1, z, Py_LT)) {
-                old_t1 = t1;
-                t1 = PyNumber_Add(t1, nr);
-                Py_DECREF(old_t1);
-            }
-            Py_DECREF(r1);
-            Py_DECREF(o);
-            Py_DECREF(z);
-            return t1;
-        } else {
-            return NULL;
-        }
+static PyObject *modexp(PyObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    long long g, k, p;
+    int g_overflow, k_overflow, p_overflow;
+    if (!check_nargs("modexp", nargs, 3) || !read_int(args[0], &g, &g_overflow)
+        || !read_int(args[1], &k, &k_overflow) || !read_int(args[2], &p, &p_overflow)
+        || !check_modulus("modexp", p, p_overflow))
+        return NULL;
+    // A negative exponent is a power of the inverse, which pow() handles.
+    if (!g_overflow && !k_overflow && !p_overflow && k >= 0) {
+        g %= p;
+        if (g < 0)
+            g += p;
+        return PyLong_FromLongLong(modexp_64(g, k, p));
     }
-    return NULL;
-};
+    return big_pow(args[0], args[1], args[2], false);
+}
 
 static PyMethodDef FastInvMethods[] = {
-    {"modinv", modinv, METH_VARARGS, "Find the modular inverse of a mod n."},
-    {"modexp", modexp, METH_VARARGS, "Find the modular exponentiation of g**k mod p."},
-    {"primeinv", primeinv, METH_VARARGS, "Find the modular inverse of a mod n, given that n is prime."},
+    {"modinv", (PyCFunction)(void (*)(void))modinv, METH_FASTCALL,
+     "The inverse of a mod n, or 0 if there is none."},
+    {"modexp", (PyCFunction)(void (*)(void))modexp, METH_FASTCALL, "g**k mod p."},
+    {"primeinv", (PyCFunction)(void (*)(void))primeinv, METH_FASTCALL,
+     "The inverse of a mod n, given that n is prime."},
+    METRICS_METHODS,
     {NULL, NULL, 0, NULL}
 };
 
+static const Backend fastinv_backends[] = {
+    {"field", "modinv", ""},
+    {NULL, NULL, NULL}
+};
+
+static int fastinv_exec(PyObject *m) {
+    return module_add_backends(m, fastinv_backends);
+}
+
+static PyModuleDef_Slot fastinv_slots[] = {
+    {Py_mod_exec, (void *)fastinv_exec},
+    MODULE_SLOTS
+    {0, NULL}
+};
+
 static struct PyModuleDef fastinv = {
     PyModuleDef_HEAD_INIT,
     "fastinv",
     NULL,
-    -1,
-    FastInvMethods
+    0,
+    FastInvMethods,
+    fastinv_slots
 };
 
 PyMODINIT_FUNC PyInit_fastinv(void) {
-    return PyModule_Create(&fastinv);
+    return PyModuleDef_Init(&fastinv);
 }
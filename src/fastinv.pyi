@@ -1,3 +1,8 @@
 def modinv(a: int, n: int) -> int: ...
 def modexp(g: int, k: int, p: int) -> int: ...
 def primeinv(a: int, n: int) -> int: ...
+def _metrics() -> dict: ...
+def _metrics_reset() -> None: ...
+def _metrics_enable(flag: bool) -> None: ...
+
+BACKENDS: tuple[tuple[str, str, str], ...]
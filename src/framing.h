@@ -0,0 +1,130 @@
+/**
+ * @file framing.h
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief Wire message framing (header layout, scanning and batched checksums).
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef PYCOIN_FRAMING_H
+#define PYCOIN_FRAMING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "sha256.h"
+
+ /* Every message on the network starts with a 24-byte header:
+
+        magic       4 bytes     network identifier (f9beb4d9 on mainnet)
+        command    12 bytes     ASCII, NUL padded
+        length      4 bytes     payload size, little-endian
+        checksum    4 bytes     first 4 bytes of sha256d(payload)
+ */
+
+#define HEADER_SIZE 24
+#define COMMAND_SIZE 12
+#define MAX_BATCH 64
+#define DEFAULT_MAX_PAYLOAD 33554432  // MAX_BLOCK_SIZE in consensus.py.
+
+inline uint32_t load_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+inline void store_le32(uint8_t *p, uint32_t v) {
+    p[0] = v, p[1] = v >> 8, p[2] = v >> 16, p[3] = v >> 24;
+}
+
+/**
+ * @brief Writes a message header for the given payload digest.
+ * Returns false if the command does not fit in 12 bytes.
+ */
+inline bool pack_header(uint8_t *out, const uint8_t magic[4], const char *command, size_t command_len,
+                        uint32_t length, const uint8_t digest[32]) {
+    if (command_len > COMMAND_SIZE)
+        return false;
+    std::memcpy(out, magic, 4);
+    std::memset(out + 4, 0, COMMAND_SIZE);
+    std::memcpy(out + 4, command, command_len);
+    store_le32(out + 16, length);
+    std::memcpy(out + 20, digest, 4);
+    return true;
+}
+
+/**
+ * @brief Length of a NUL padded command (the position of the first NUL).
+ */
+inline size_t command_length(const uint8_t *command) {
+    size_t n = 0;
+    while (n < COMMAND_SIZE && command[n])
+        ++n;
+    return n;
+}
+
+struct Frame {
+    const uint8_t *header;
+    const uint8_t *payload;
+    uint32_t length;
+};
+
+enum FrameStatus {
+    FRAME_OK,
+    FRAME_BAD_MAGIC,
+    FRAME_TOO_LARGE,
+};
+
+/**
+ * @brief Finds up to max complete messages at the start of data. The
+ * number found goes in *count and the bytes they span in *used. If the
+ * next message is incomplete, *needed is set to its full size (header
+ * included) so the caller knows whether its buffer is big enough.
+ */
+inline FrameStatus scan_frames(const uint8_t *data, size_t len, const uint8_t magic[4], uint32_t max_payload,
+                               Frame *frames, int max, int *count, size_t *used, size_t *needed) {
+    size_t pos = 0;
+    int n = 0;
+    FrameStatus status = FRAME_OK;
+    *needed = 0;
+    while (n < max && len - pos >= HEADER_SIZE) {
+        const uint8_t *h = data + pos;
+        if (std::memcmp(h, magic, 4) != 0) {
+            status = FRAME_BAD_MAGIC;
+            break;
+        }
+        uint32_t length = load_le32(h + 16);
+        if (length > max_payload) {
+            status = FRAME_TOO_LARGE;
+            break;
+        }
+        if (len - pos < HEADER_SIZE + (size_t)length) {
+            *needed = HEADER_SIZE + (size_t)length;
+            break;
+        }
+        frames[n++] = Frame{h, h + HEADER_SIZE, length};
+        pos += HEADER_SIZE + length;
+    }
+    *count = n;
+    *used = pos;
+    return status;
+}
+
+/**
+ * @brief Checks the checksums of count frames (count <= MAX_BATCH) with
+ * a single multi-buffer sha256d pass.
+ */
+inline void check_frames(const Frame *frames, int count, bool *valid) {
+    const uint8_t *ptrs[MAX_BATCH];
+    size_t lens[MAX_BATCH];
+    uint8_t digests[32 * MAX_BATCH];
+    for (int i = 0; i < count; ++i)
+        ptrs[i] = frames[i].payload, lens[i] = frames[i].length;
+    sha256::sha256d_batch(ptrs, lens, count, digests);
+    for (int i = 0; i < count; ++i)
+        valid[i] = std::memcmp(frames[i].header + 20, digests + 32 * i, 4) == 0;
+}
+
+#endif  // PYCOIN_FRAMING_H
@@ -0,0 +1,226 @@
+/**
+ * @file gcs.h
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief Header-only Golomb-coded sets (BIP158 compact block filters).
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef PYCOIN_GCS_H
+#define PYCOIN_GCS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "siphash.h"
+
+ /* A BIP158 filter is a probabilistic set of the scripts a block pays
+    to or spends from. Each of the N scripts is hashed with SipHash (keyed
+    by the block hash) into [0, N * M), the values are sorted, and the
+    gaps between them are written with Golomb-Rice coding: the gap >> P
+    in unary, then its low P bits. With P = 19 and M = 784931 a filter
+    takes about 20 bits per script, and a script that is not in the block
+    matches with probability 1 / M.
+
+    Matching a wallet against a filter hashes every wallet script the
+    same way, sorts them and walks both sorted lists together, so it
+    costs one pass over the filter however many scripts the wallet has.
+
+    References:
+        - https://github.com/bitcoin/bips/blob/master/bip-0158.mediawiki
+        - https://github.com/bitcoin/bitcoin/blob/master/src/blockfilter.cpp
+ */
+
+#define GCS_P 19
+#define GCS_M 784931ULL
+
+namespace gcs {
+
+typedef unsigned __int128 u128;
+
+struct Key {
+    uint64_t k0, k1;
+};
+
+/**
+ * @brief The SipHash key of a block's filter: the first 16 bytes of the
+ * block hash (in internal byte order).
+ */
+inline Key block_key(const uint8_t block_hash[32]) {
+    return Key{siphash::load_le64(block_hash), siphash::load_le64(block_hash + 8)};
+}
+
+/**
+ * @brief Maps an item to [0, range) without a division: the 64-bit hash
+ * times range, shifted down by 64.
+ */
+inline uint64_t hash_to_range(const Key &key, const uint8_t *item, size_t len, uint64_t range) {
+    return (uint64_t)(((u128)siphash::hash(key.k0, key.k1, item, len) * range) >> 64);
+}
+
+struct BitWriter {
+    std::string &out;
+    uint8_t byte = 0;
+    int bits = 0;
+
+    explicit BitWriter(std::string &out) : out(out) {}
+
+    void write(uint64_t value, int n) {
+        while (n > 0) {
+            int take = std::min(8 - bits, n);
+            byte |= (uint8_t)(((value >> (n - take)) & ((1u << take) - 1)) << (8 - bits - take));
+            bits += take, n -= take;
+            if (bits == 8) {
+                out.push_back((char)byte);
+                byte = 0, bits = 0;
+            }
+        }
+    }
+
+    void flush() {
+        if (bits)
+            out.push_back((char)byte);
+        byte = 0, bits = 0;
+    }
+};
+
+struct BitReader {
+    const uint8_t *p, *end;
+    int bit = 0;  // Next bit of *p, from the most significant.
+    bool ok = true;
+
+    BitReader(const uint8_t *data, size_t len) : p(data), end(data + len) {}
+
+    uint64_t read(int n) {
+        uint64_t v = 0;
+        while (n > 0) {
+            if (p == end) {
+                ok = false;
+                return 0;
+            }
+            int take = std::min(8 - bit, n);
+            v = v << take | ((*p >> (8 - bit - take)) & ((1u << take) - 1));
+            bit += take, n -= take;
+            if (bit == 8)
+                ++p, bit = 0;
+        }
+        return v;
+    }
+
+    uint64_t golomb_rice() {
+        uint64_t q = 0;
+        while (ok && read(1))
+            ++q;
+        return q << GCS_P | read(GCS_P);
+    }
+};
+
+inline void write_varint(std::string &out, uint64_t n) {
+    int size = n < 0xFD ? 0 : n <= 0xFFFF ? 2 : n <= 0xFFFFFFFF ? 4 : 8;
+    if (size)
+        out.push_back((char)(size == 2 ? 0xFD : size == 4 ? 0xFE : 0xFF));
+    else
+        size = 1;
+    for (int i = 0; i < size; ++i)
+        out.push_back((char)(n >> (8 * i)));
+}
+
+inline bool read_varint(const uint8_t *&p, const uint8_t *end, uint64_t &n) {
+    if (p == end)
+        return false;
+    uint8_t first = *p++;
+    int size = first < 0xFD ? 0 : first == 0xFD ? 2 : first == 0xFE ? 4 : 8;
+    if (end - p < size)
+        return false;
+    n = size ? 0 : first;
+    for (int i = size - 1; i >= 0; --i)
+        n = n << 8 | p[i];
+    p += size;
+    return true;
+}
+
+/**
+ * @brief Builds a filter from distinct items (the caller removes
+ * duplicates; empty items are allowed but never useful).
+ */
+inline std::string build(const Key &key, const std::vector<std::string> &items) {
+    uint64_t range = items.size() * GCS_M;
+    std::vector<uint64_t> values;
+    values.reserve(items.size());
+    for (const std::string &item : items)
+        values.push_back(hash_to_range(key, reinterpret_cast<const uint8_t *>(item.data()), item.size(), range));
+    std::sort(values.begin(), values.end());
+    std::string out;
+    write_varint(out, items.size());
+    BitWriter w(out);
+    uint64_t last = 0;
+    for (uint64_t value : values) {
+        uint64_t delta = value - last;
+        last = value;
+        for (uint64_t q = delta >> GCS_P; q; --q)
+            w.write(1, 1);
+        w.write(0, 1);
+        w.write(delta, GCS_P);
+    }
+    w.flush();
+    return out;
+}
+
+/**
+ * @brief The number of items in a filter (0 if it is malformed).
+ */
+inline uint64_t size(const uint8_t *filter, size_t len) {
+    uint64_t n = 0;
+    return read_varint(filter, filter + len, n) ? n : 0;
+}
+
+/**
+ * @brief Whether any of queries (already hashed into [0, size * M) with
+ * the filter's key, and sorted) is in the filter.
+ */
+inline bool match_sorted(const uint8_t *filter, size_t len, const std::vector<uint64_t> &queries) {
+    const uint8_t *p = filter;
+    uint64_t n;
+    if (!read_varint(p, filter + len, n) || queries.empty())
+        return false;
+    BitReader r(p, filter + len - p);
+    uint64_t value = 0;
+    size_t q = 0;
+    for (uint64_t i = 0; i < n; ++i) {
+        value += r.golomb_rice();
+        if (!r.ok)
+            return false;
+        while (queries[q] < value)
+            if (++q == queries.size())
+                return false;
+        if (queries[q] == value)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Whether any of the items is in the filter of the block with
+ * this key. hashed is scratch space, reused between calls.
+ */
+inline bool match_any(const Key &key, const uint8_t *filter, size_t len, const std::string *items, size_t count,
+                      std::vector<uint64_t> &hashed) {
+    uint64_t range = size(filter, len) * GCS_M;
+    if (!range)
+        return false;
+    hashed.clear();
+    for (size_t i = 0; i < count; ++i)
+        hashed.push_back(hash_to_range(key, reinterpret_cast<const uint8_t *>(items[i].data()), items[i].size(), range));
+    std::sort(hashed.begin(), hashed.end());
+    return match_sorted(filter, len, hashed);
+}
+
+}  // namespace gcs
+
+#endif  // PYCOIN_GCS_H
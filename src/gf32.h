@@ -0,0 +1,92 @@
+/**
+ * @file gf32.h
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief Arithmetic in GF(2^32), with carryless multiplication when available.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef PYCOIN_GF32_H
+#define PYCOIN_GF32_H
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GF32_HAVE_CLMUL 1
+#endif
+
+ /* Elements are polynomials over GF(2) of degree < 32, stored as the
+    bits of a uint32_t, and multiplied modulo the irreducible polynomial
+
+        x^32 + x^7 + x^3 + x^2 + 1,
+
+    the field minisketch (and so BIP330) uses for 32-bit elements.
+    Addition is xor. A product is a 63-bit carryless product folded back
+    into 32 bits twice: x^32 = x^7 + x^3 + x^2 + 1, so the high half
+    times those few terms is just shifts and xors.
+
+    Two implementations with the same interface are provided. Clmul
+    uses the PCLMULQDQ instruction for the product. Portable does it
+    with 32 conditional xors. Code that multiplies in bulk is written
+    as a template over the field and dispatched once (see clmul()).
+ */
+
+namespace gf32 {
+
+inline uint32_t reduce(uint64_t t) {
+    for (int i = 0; i < 2; ++i) {
+        uint64_t hi = t >> 32;
+        t = (t & 0xFFFFFFFFULL) ^ hi ^ hi << 2 ^ hi << 3 ^ hi << 7;
+    }
+    return (uint32_t)t;
+}
+
+struct Portable {
+    static uint32_t mul(uint32_t a, uint32_t b) {
+        uint64_t t = 0, x = a;
+        for (int i = 0; i < 32; ++i)
+            t ^= (x << i) & (0 - (uint64_t)((b >> i) & 1));
+        return reduce(t);
+    }
+    static const char *name() { return "portable"; }
+};
+
+#ifdef GF32_HAVE_CLMUL
+struct Clmul {
+    __attribute__((target("pclmul,sse2"))) static uint32_t mul(uint32_t a, uint32_t b) {
+        __m128i p = _mm_clmulepi64_si128(_mm_cvtsi32_si128((int)a), _mm_cvtsi32_si128((int)b), 0);
+        return reduce((uint64_t)_mm_cvtsi128_si64(p));
+    }
+    static const char *name() { return "clmul"; }
+};
+
+inline bool clmul() {
+    static const bool supported = __builtin_cpu_supports("pclmul");
+    return supported;
+}
+#else
+typedef Portable Clmul;
+
+inline bool clmul() { return false; }
+#endif
+
+/**
+ * @brief a^-1 as a^(2^32 - 2) (a must not be 0).
+ */
+template <class F>
+uint32_t inv(uint32_t a) {
+    uint32_t r = a, sq = a;
+    for (int i = 1; i < 31; ++i) {  // r = a^(2^(i + 1) - 1) after step i.
+        sq = F::mul(sq, sq);
+        r = F::mul(r, sq);
+    }
+    return F::mul(r, r);
+}
+
+}  // namespace gf32
+
+#endif  // PYCOIN_GF32_H
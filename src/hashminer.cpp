@@ -0,0 +1,143 @@
+/**
+ * @file hashminer.cpp
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief C++ Python Extension for Bitcoin mining.
+ * @version 0.1
+ * @date 2022-04-01
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "metrics.h"
+#include "mining.h"
+#include "pymodule.h"
+#include "trace.h"
+
+ /* The native side of miner.py. The nonce range is handed out to the
+    threads in chunks through an atomic counter (so a slow or descheduled
+    thread does not hold up the rest), and each chunk is scanned with
+    mining::scan(). Once a nonce is found, chunks past it are no longer
+    handed out, but the ones before it are still finished, so the result
+    is always the lowest nonce in the range that meets the target, no
+    matter how many threads there are.
+
+    Threads can be pinned to CPUs (bench::pin_thread()), which scaling.py
+    uses to get repeatable numbers. Jobs and found nonces are tracepoints
+    (see trace.h).
+ */
+
+#define MINER_CHUNK (1 << 16)
+#define NONCE_RANGE (1ULL << 32)
+
+struct Search {
+    mining::Job job;
+    uint64_t stop;
+    std::atomic<uint64_t> next;
+    std::atomic<uint64_t> found{NONCE_RANGE};  // Nonce, or NONCE_RANGE if none yet.
+    std::atomic<uint64_t> hashes{0};
+};
+
+static void worker(Search *s, int id, int cpu) {
+    if (cpu >= 0)
+        bench::pin_thread(cpu);
+    uint64_t done = 0;
+    for (;;) {
+        uint64_t start = s->next.fetch_add(MINER_CHUNK, std::memory_order_relaxed);
+        if (start >= s->stop || start >= s->found.load(std::memory_order_relaxed))
+            break;
+        uint64_t count = std::min<uint64_t>(MINER_CHUNK, s->stop - start);
+        uint32_t nonce;
+        done += count;
+        if (!mining::scan(s->job, (uint32_t)start, count, nonce))
+            continue;
+        TRACE2(mining, share, nonce, id);
+        uint64_t found = s->found.load();
+        while (nonce < found && !s->found.compare_exchange_weak(found, nonce))
+            ;
+    }
+    s->hashes.fetch_add(done);
+    METRICS_ADD(HASHES, done);
+}
+
+static PyObject *hashminer_mine(PyObject *self, PyObject *args, PyObject *kwds) {
+    static const char *kwlist[] = {"header", "start", "stop", "threads", "cpus", NULL};
+    Py_buffer header;
+    unsigned long long start = 0, stop = NONCE_RANGE;
+    int threads = 1;
+    PyObject *cpus_arg = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y*|KKiO", const_cast<char **>(kwlist), &header, &start, &stop,
+                                     &threads, &cpus_arg))
+        return NULL;
+    std::vector<int> cpus;
+    PyObject *seq = cpus_arg == Py_None ? NULL : PySequence_Fast(cpus_arg, "cpus must be a sequence of CPU numbers.");
+    for (Py_ssize_t i = 0; seq && i < PySequence_Fast_GET_SIZE(seq); ++i)
+        cpus.push_back((int)PyLong_AsLong(PySequence_Fast_GET_ITEM(seq, i)));
+    Py_XDECREF(seq);
+    if (!PyErr_Occurred() && header.len != 80)
+        PyErr_SetString(PyExc_ValueError, "header must be 80 bytes.");
+    else if (!PyErr_Occurred() && (start > stop || stop > NONCE_RANGE || threads <= 0))
+        PyErr_SetString(PyExc_ValueError, "need 0 <= start <= stop <= 2**32 and a positive number of threads.");
+    if (PyErr_Occurred()) {
+        PyBuffer_Release(&header);
+        return NULL;
+    }
+    Search s;
+    mining::make_job(static_cast<const uint8_t *>(header.buf), s.job);
+    TRACE4(mining, job, start, stop, threads, (uint32_t)s.job.block[8] | (uint32_t)s.job.block[9] << 8
+           | (uint32_t)s.job.block[10] << 16 | (uint32_t)s.job.block[11] << 24);
+    PyBuffer_Release(&header);
+    s.stop = stop;
+    s.next = start;
+    Py_BEGIN_ALLOW_THREADS
+    [[maybe_unused]] std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; ++i)
+        workers.emplace_back(worker, &s, i, cpus.empty() ? -1 : cpus[i % cpus.size()]);
+    worker(&s, 0, cpus.empty() ? -1 : cpus[0]);
+    for (std::thread &w : workers)
+        w.join();
+    TRACE3(mining, job_end, s.found.load() == NONCE_RANGE ? -1 : (int64_t)s.found.load(), s.hashes.load(),
+           (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0)
+               .count());
+    Py_END_ALLOW_THREADS
+    uint64_t found = s.found.load();
+    if (found == NONCE_RANGE)
+        return Py_BuildValue("(OK)", Py_None, (unsigned long long)s.hashes.load());
+    return Py_BuildValue("(KK)", (unsigned long long)found, (unsigned long long)s.hashes.load());
+}
+
+static PyMethodDef MinerMethods[] = {
+    {"mine", (PyCFunction)(void (*)(void))hashminer_mine, METH_VARARGS | METH_KEYWORDS,
+     "Search nonces in [start, stop) for a header meeting its target, on threads (optionally pinned to cpus). "
+     "Returns the lowest such nonce (or None) and the number of hashes done."},
+    METRICS_METHODS,
+    {NULL, NULL, 0, NULL}
+};
+
+static PyModuleDef_Slot hashminer_slots[] = {
+    MODULE_SLOTS
+    {0, NULL}
+};
+
+static struct PyModuleDef hashminer = {
+    PyModuleDef_HEAD_INIT,
+    "hashminer",
+    NULL,
+    0,
+    MinerMethods,
+    hashminer_slots
+};
+
+PyMODINIT_FUNC PyInit_hashminer(void) {
+    return PyModuleDef_Init(&hashminer);
+}
@@ -0,0 +1,8 @@
+from typing import Sequence
+
+def mine(
+    header: bytes, start: int = ..., stop: int = ..., threads: int = ..., cpus: Sequence[int] | None = ...
+) -> tuple[int | None, int]: ...
+def _metrics() -> dict: ...
+def _metrics_reset() -> None: ...
+def _metrics_enable(flag: bool) -> None: ...
@@ -0,0 +1,229 @@
+/**
+ * @file memory.h
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief Header-only tagged allocators and arenas, accounting heap usage per subsystem.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef PYCOIN_MEMORY_H
+#define PYCOIN_MEMORY_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <vector>
+
+ /* Every native container that can grow large is given an allocator
+    tagged with the subsystem it belongs to, which counts the bytes it
+    asks for and gives back, so the heap used by each subsystem is known
+    exactly (less malloc's own overhead of a word or two per block)
+    instead of estimated from element counts. For each tag there is the
+    current usage, its high-water mark since the last reset_peak(), and
+    the number and total size of the allocations.
+
+    Memory that is only needed while a block is being connected comes
+    from an Arena instead: it is carved out of large chunks with a bump
+    pointer, never freed piece by piece, and released all at once when
+    the arena goes; node based containers (the in-block maps and sets)
+    allocate far faster that way. The chunks are what is counted.
+
+    As with metrics.h, each extension has its own counts (the unnamed
+    namespace), exposed with MEMORY_METHODS; memory.py adds them up by
+    tag.
+
+    References:
+        - https://github.com/bitcoin/bitcoin/blob/master/src/support/allocators/pool.h
+        - https://en.cppreference.com/w/cpp/named_req/Allocator
+ */
+
+#define MEMORY_ARENA_CHUNK (64 * 1024)
+
+namespace memory {
+
+namespace {
+
+enum Tag { COINS, BLOCK, MERKLE, ADDRMAN, TAG_COUNT };
+
+static const char *const TAG_NAMES[TAG_COUNT] = {"coins", "block", "merkle", "addrman"};
+
+struct Stats {
+    std::atomic<uint64_t> current{0}, peak{0}, allocations{0}, allocated{0};
+};
+
+inline Stats *stats() {
+    static Stats s[TAG_COUNT];
+    return s;
+}
+
+inline void charge(Tag tag, size_t bytes) {
+    Stats &s = stats()[tag];
+    uint64_t now = s.current.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    uint64_t peak = s.peak.load(std::memory_order_relaxed);
+    while (now > peak && !s.peak.compare_exchange_weak(peak, now, std::memory_order_relaxed))
+        ;
+    s.allocations.fetch_add(1, std::memory_order_relaxed);
+    s.allocated.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+inline void credit(Tag tag, size_t bytes) { stats()[tag].current.fetch_sub(bytes, std::memory_order_relaxed); }
+
+/**
+ * @brief Resets the high-water marks to the current usage.
+ */
+inline void reset_peak() {
+    for (int t = 0; t < TAG_COUNT; ++t)
+        stats()[t].peak.store(stats()[t].current.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+/**
+ * @brief A std allocator that counts against a tag.
+ */
+template <class T, Tag tag>
+struct Allocator {
+    typedef T value_type;
+
+    template <class U>
+    struct rebind {
+        typedef Allocator<U, tag> other;
+    };
+
+    Allocator() = default;
+    template <class U>
+    Allocator(const Allocator<U, tag> &) {}
+
+    T *allocate(size_t n) {
+        T *p = static_cast<T *>(::operator new(n * sizeof(T)));
+        charge(tag, n * sizeof(T));
+        return p;
+    }
+
+    void deallocate(T *p, size_t n) {
+        credit(tag, n * sizeof(T));
+        ::operator delete(p);
+    }
+
+    template <class U>
+    bool operator==(const Allocator<U, tag> &) const { return true; }
+    template <class U>
+    bool operator!=(const Allocator<U, tag> &) const { return false; }
+};
+
+template <Tag tag>
+using String = std::basic_string<char, std::char_traits<char>, Allocator<char, tag>>;
+
+template <class T, Tag tag>
+using Vector = std::vector<T, Allocator<T, tag>>;
+
+/**
+ * @brief Bump allocation out of chunks, all freed together. Not thread
+ * safe: one arena per thread.
+ */
+class Arena {
+  public:
+    explicit Arena(Tag tag, size_t chunk = MEMORY_ARENA_CHUNK) : tag_(tag), chunk_(chunk) {}
+
+    ~Arena() { release(); }
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    void *allocate(size_t bytes, size_t align) {
+        size_t at = (used_ + align - 1) & ~(align - 1);
+        if (chunks_.empty() || at + bytes > size_) {
+            size_ = std::max(chunk_, bytes + align);
+            chunks_.push_back(static_cast<uint8_t *>(::operator new(size_)));
+            charge(tag_, size_);
+            reserved_ += size_;
+            at = 0;
+        }
+        used_ = at + bytes;
+        return chunks_.back() + at;
+    }
+
+    /**
+     * @brief Frees every chunk.
+     */
+    void release() {
+        for (uint8_t *c : chunks_)
+            ::operator delete(c);
+        credit(tag_, reserved_);
+        chunks_.clear();
+        reserved_ = used_ = size_ = 0;
+    }
+
+    size_t reserved() const { return reserved_; }
+
+  private:
+    Tag tag_;
+    size_t chunk_, size_ = 0, used_ = 0, reserved_ = 0;
+    std::vector<uint8_t *> chunks_;
+};
+
+/**
+ * @brief A std allocator out of an arena; deallocate() does nothing.
+ */
+template <class T>
+struct ArenaAllocator {
+    typedef T value_type;
+
+    Arena *arena;
+
+    explicit ArenaAllocator(Arena &a) : arena(&a) {}
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+
+    T *allocate(size_t n) { return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T))); }
+
+    void deallocate(T *, size_t) {}
+
+    template <class U>
+    bool operator==(const ArenaAllocator<U> &other) const { return arena == other.arena; }
+    template <class U>
+    bool operator!=(const ArenaAllocator<U> &other) const { return arena != other.arena; }
+};
+
+}  // namespace
+
+}  // namespace memory
+
+#ifdef Py_PYTHON_H
+
+ /* _memory() returns {tag: {"current", "peak", "allocations",
+    "allocated"}} (bytes, and a count) for this extension, and
+    _memory_reset_peak() starts the high-water marks again. Extensions
+    that only use the allocators need not expose them. */
+
+[[maybe_unused]] static PyObject *memory_stats_py(PyObject *self, PyObject *Py_UNUSED(ignored)) {
+    PyObject *result = PyDict_New();
+    for (int t = 0; result && t < memory::TAG_COUNT; ++t) {
+        const memory::Stats &s = memory::stats()[t];
+        PyObject *v = Py_BuildValue("{s:K,s:K,s:K,s:K}", "current", (unsigned long long)s.current.load(), "peak",
+                                    (unsigned long long)s.peak.load(), "allocations",
+                                    (unsigned long long)s.allocations.load(), "allocated",
+                                    (unsigned long long)s.allocated.load());
+        if (!v || PyDict_SetItemString(result, memory::TAG_NAMES[t], v) < 0)
+            Py_CLEAR(result);
+        Py_XDECREF(v);
+    }
+    return result;
+}
+
+[[maybe_unused]] static PyObject *memory_reset_peak_py(PyObject *self, PyObject *Py_UNUSED(ignored)) {
+    memory::reset_peak();
+    Py_RETURN_NONE;
+}
+
+#define MEMORY_METHODS                                                                        \
+    {"_memory", memory_stats_py, METH_NOARGS, "Heap usage of this extension, by subsystem."}, \
+        {"_memory_reset_peak", memory_reset_peak_py, METH_NOARGS, "Start the high-water marks again."}
+
+#endif  // Py_PYTHON_H
+
+#endif  // PYCOIN_MEMORY_H
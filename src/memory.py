@@ -0,0 +1,137 @@
+"""Heap usage of the native caches, by subsystem.
+
+The extensions allocate their large containers through tagged
+allocators (see memory.h), so the bytes each subsystem holds are
+counted exactly, with a high-water mark:
+
+    coins     the UTXO sets of validation.Chainstate.
+    block     per-block scratch while connecting (txids, the coins
+              spent, and the arenas of the in-block maps).
+    merkle    the levels of Merkle trees being hashed.
+    addrman   the tables and index of addrman.AddrMan.
+
+memory_report() adds up every extension's counts. Next to the cgroup
+memory limit, if there is one (budget()), it shows how much room the
+caches have.
+
+    python -m src.memory                  # After connecting the example block.
+"""
+
+from __future__ import annotations
+
+import argparse
+import json
+import sys
+from pathlib import Path
+from typing import NamedTuple
+
+try:
+    from . import addrman  # type: ignore
+except ImportError:
+    addrman = None
+try:
+    from . import validation  # type: ignore
+except ImportError:
+    validation = None
+
+TAGS = ("coins", "block", "merkle", "addrman")
+CGROUP = Path("/sys/fs/cgroup")
+
+
+class Usage(NamedTuple):
+    current: int  # Bytes.
+    peak: int  # Bytes, since the last reset_peak().
+    allocations: int
+    allocated: int  # Bytes, ever.
+
+
+def modules() -> list:
+    """The extensions that account their memory."""
+    return [m for m in (addrman, validation) if m is not None]
+
+
+def memory_report() -> dict[str, Usage]:
+    """Usage by tag, over all the extensions, and the total. Peaks are
+    added up, so the total peak is an upper bound."""
+    totals = {tag: [0, 0, 0, 0] for tag in TAGS}
+    for module in modules():
+        for tag, usage in module._memory().items():
+            t = totals.setdefault(tag, [0, 0, 0, 0])
+            for i, key in enumerate(Usage._fields):
+                t[i] += usage[key]
+    report = {tag: Usage(*t) for tag, t in totals.items()}
+    report["total"] = Usage(*(sum(u[i] for u in report.values()) for i in range(len(Usage._fields))))
+    return report
+
+
+def reset_peak() -> None:
+    for module in modules():
+        module._memory_reset_peak()
+
+
+def budget(root: Path = CGROUP) -> tuple[int | None, int | None]:
+    """The cgroup memory limit and usage in bytes (None if unknown or
+    unlimited), from cgroup v2 or v1."""
+
+    def read(*names: str) -> int | None:
+        for name in names:
+            try:
+                value = (root / name).read_text().strip()
+            except OSError:
+                continue
+            # v1 reports "no limit" as a huge number, v2 as "max".
+            return None if value == "max" or int(value) >= 1 << 60 else int(value)
+        return None
+
+    return (
+        read("memory.max", "memory/memory.limit_in_bytes"),
+        read("memory.current", "memory/memory.usage_in_bytes"),
+    )
+
+
+def _format_bytes(n: float) -> str:
+    for suffix, scale in (("GiB", 1 << 30), ("MiB", 1 << 20), ("KiB", 1 << 10)):
+        if n >= scale:
+            return f"{n / scale:.1f} {suffix}"
+    return f"{n:.0f} B"
+
+
+def report(usage: dict[str, Usage], limit: int | None = None) -> str:
+    lines = [f"{'tag':<8} {'current':>12} {'peak':>12} {'allocations':>12} {'allocated':>12}"]
+    for tag, u in usage.items():
+        cells = (_format_bytes(u.current), _format_bytes(u.peak), str(u.allocations), _format_bytes(u.allocated))
+        lines.append(f"{tag:<8} " + " ".join(f"{c:>12}" for c in cells))
+    if limit is not None:
+        lines.append(f"cgroup limit {_format_bytes(limit)}, caches {usage['total'].current / limit:.1%} of it")
+    return "\n".join(lines)
+
+
+def main(argv: list[str] | None = None) -> None:
+    from . import blockbench
+
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--block", default=blockbench.BLOCK, help="example block to connect")
+    parser.add_argument("--json", metavar="PATH", help="write the report as JSON ('-' for stdout)")
+    args = parser.parse_args(argv)
+    if validation is None:
+        raise RuntimeError("the validation extension is not built.")
+    prepared = blockbench.prepare(args.block)
+    chainstate = prepared.chainstate()
+    reset_peak()
+    chainstate.connect(prepared.block, apply=True)
+    usage = memory_report()
+    limit, used = budget()
+    if args.json is None:
+        print(report(usage, limit))
+        return
+    document = {"usage": {tag: u._asdict() for tag, u in usage.items()}, "cgroup_limit": limit, "cgroup_usage": used}
+    if args.json == "-":
+        json.dump(document, sys.stdout, indent=2)
+        print()
+    else:
+        with open(args.json, "w") as f:
+            json.dump(document, f, indent=2)
+
+
+if __name__ == "__main__":
+    main()
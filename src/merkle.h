@@ -0,0 +1,67 @@
+/**
+ * @file merkle.h
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief Header-only Merkle roots of transaction hashes.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef PYCOIN_MERKLE_H
+#define PYCOIN_MERKLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "memory.h"
+#include "sha256.h"
+
+ /* The same tree as merkle.py: each level pairs up the hashes of the one
+    below (duplicating the last when there is an odd number) and double
+    hashes each 64-byte pair, until one hash is left. All the pairs of a
+    level are independent, so each level is hashed with sha256d_batch,
+    eight at a time. The levels count against memory::MERKLE.
+
+    References:
+        - https://en.bitcoin.it/wiki/Protocol_documentation#Merkle_Trees
+ */
+
+namespace merkle {
+
+/**
+ * @brief The root of count 32-byte hashes (in internal byte order), or 32
+ * zero bytes for none.
+ */
+inline void root(const uint8_t *hashes, size_t count, uint8_t out[32]) {
+    if (count == 0) {
+        std::memset(out, 0, 32);
+        return;
+    }
+    memory::Vector<uint8_t, memory::MERKLE> level(hashes, hashes + 32 * count);
+    memory::Vector<const uint8_t *, memory::MERKLE> pairs;
+    memory::Vector<size_t, memory::MERKLE> lens;
+    while (count > 1) {
+        if (count % 2) {
+            level.resize(32 * (count + 1));
+            std::memcpy(level.data() + 32 * count, level.data() + 32 * (count - 1), 32);
+            ++count;
+        }
+        pairs.clear();
+        for (size_t i = 0; i < count; i += 2)
+            pairs.push_back(level.data() + 32 * i);
+        lens.assign(pairs.size(), 64);
+        memory::Vector<uint8_t, memory::MERKLE> next(32 * pairs.size());
+        sha256::sha256d_batch(pairs.data(), lens.data(), pairs.size(), next.data());
+        level.swap(next);
+        count = pairs.size();
+    }
+    std::memcpy(out, level.data(), 32);
+}
+
+}  // namespace merkle
+
+#endif  // PYCOIN_MERKLE_H
@@ -1,5 +1,8 @@
 """The merkle tree for Bitcoin. Later on, regular hashing may be
 swapped for update functions to speed up hashing and concatenation.
+
+Roots are computed by the fastest merkle implementation registered
+with backends.py, the native one (merkle.h) when it is built.
 """
 
 import doctest
@@ -7,7 +10,8 @@ from functools import lru_cache
 from itertools import starmap, zip_longest
 from typing import Iterable, Iterator, Literal, Sequence, TypeVar
 
-from utils import sha256d
+from . import backends
+from .utils import sha256d
 
 Direction = Literal["left", "right"]
 ProofElement = tuple[Direction, bytes]
@@ -41,6 +45,21 @@ def hash_pair(v1: bytes, v2: bytes) -> bytes:
     return ret
 
 
+def py_merkle_root(hashes: Sequence[bytes]) -> bytes:
+    """The merkle root of 32-byte hashes in internal byte order (as
+    the native one takes them), 32 zero bytes for none."""
+    level = list(hashes) or [bytes(32)]
+    while len(level) > 1:
+        if len(level) % 2:
+            level.append(level[-1])
+        level = [sha256d(level[i] + level[i + 1]) for i in range(0, len(level), 2)]
+    return level[0]
+
+
+backends.register("merkle", backends.REFERENCE, py_merkle_root, origin=__file__)
+merkle_root = backends.select("merkle")
+
+
 def hash_tree(merkle_tree: Iterable[bytes]) -> bytes:
     """Hashes all the transactions in a merkle tree, and returns the root hash.
 
@@ -63,11 +82,10 @@ def hash_tree(merkle_tree: Iterable[bytes]) -> bytes:
         - https://gutier.io/post/programming-tutorial-blockchain-haskell-merkle-tree/
         - https://en.bitcoin.it/wiki/Protocol_documentation#Merkle%5FTrees
     """
-    tree = list(merkle_tree)
-    while len(tree) > 1:
-        tree[:] = pairs(tree)
-        tree[:] = starmap(hash_pair, tree)
-    return tree.pop()
+    tree = [bytes(value)[::-1] for value in merkle_tree]
+    if not tree:
+        raise ValueError("A merkle tree needs at least one hash.")
+    return merkle_root(tree)[::-1]
 
 
 def create_proof(merkle_tree: Sequence[bytes], tx: bytes) -> MerkleProof:
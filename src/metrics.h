@@ -0,0 +1,340 @@
+/**
+ * @file metrics.h
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief Header-only counters and latency histograms for the native hot paths.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef PYCOIN_METRICS_H
+#define PYCOIN_METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+ /* Every thread that records anything gets its own slot: a cache line
+    aligned block of counters and histograms that only it writes (with
+    relaxed loads and stores, no read-modify-write), so recording costs
+    a few instructions and never bounces a cache line between cores.
+    Reading adds up all the slots. A slot outlives its thread (its
+    counts still count), and is reused by the next new thread.
+
+    The histograms are log-linear, like HdrHistogram: 16 buckets for
+    each power of two, so any value is within 1/16 (6.25%) of its
+    bucket's bounds, from 1 ns to 2^64 ns, in under 1000 buckets.
+
+    Each extension that includes this header has its own registry (the
+    extensions are separate shared objects), and exposes it to Python
+    with METRICS_METHODS; metrics.py adds them up. Recording can be
+    turned off at run time (set_enabled()), and compiled out entirely
+    with -DPYCOIN_NO_METRICS, which turns the METRICS_* macros into
+    nothing.
+
+    References:
+        - http://hdrhistogram.org/
+        - https://prometheus.io/docs/instrumenting/exposition_formats/
+ */
+
+#define METRICS_SUB_BUCKET_BITS 4
+#define METRICS_SUB_BUCKETS (1 << METRICS_SUB_BUCKET_BITS)
+#define METRICS_BUCKETS ((64 - METRICS_SUB_BUCKET_BITS + 1) * METRICS_SUB_BUCKETS)
+#define METRICS_CACHE_LINE 64
+
+namespace metrics {
+
+// Internal linkage: the dynamic linker merges inline functions (and their
+// statics) between shared objects, which would give every extension the
+// same registry.
+namespace {
+
+enum Counter {
+    SIG_VERIFIES,
+    SIG_FAILURES,
+    SCRIPT_EVALS,
+    CACHE_HITS,
+    CACHE_MISSES,
+    UTXO_LOOKUPS,
+    HASHES,
+    MODULAR_INVERSES,
+    COUNTER_COUNT
+};
+
+enum Histogram { SIG_VERIFY, SCRIPT_EVAL, BLOCK_CONNECT, HISTOGRAM_COUNT };
+
+static const char *const COUNTER_NAMES[COUNTER_COUNT] = {
+    "sig_verifies", "sig_failures", "script_evals", "cache_hits",
+    "cache_misses", "utxo_lookups", "hashes",       "modular_inverses",
+};
+
+static const char *const HISTOGRAM_NAMES[HISTOGRAM_COUNT] = {"sig_verify", "script_eval", "block_connect"};
+
+/**
+ * @brief The bucket of a value: values below 16 have their own, and
+ * above that each power of two is split into 16.
+ */
+inline size_t bucket(uint64_t v) {
+    if (v < METRICS_SUB_BUCKETS)
+        return (size_t)v;
+    int e = 63 - __builtin_clzll(v);
+    size_t sub = (size_t)(v >> (e - METRICS_SUB_BUCKET_BITS)) & (METRICS_SUB_BUCKETS - 1);
+    return (size_t)(e - METRICS_SUB_BUCKET_BITS + 1) * METRICS_SUB_BUCKETS + sub;
+}
+
+/**
+ * @brief The largest value in a bucket.
+ */
+inline uint64_t bucket_upper(size_t b) {
+    if (b < METRICS_SUB_BUCKETS)
+        return b;
+    int e = (int)(b / METRICS_SUB_BUCKETS) + METRICS_SUB_BUCKET_BITS - 1;
+    uint64_t sub = b % METRICS_SUB_BUCKETS, width = 1ULL << (e - METRICS_SUB_BUCKET_BITS);
+    return ((METRICS_SUB_BUCKETS + sub) << (e - METRICS_SUB_BUCKET_BITS)) + (width - 1);
+}
+
+struct HistogramData {
+    uint64_t count = 0, sum = 0, max = 0;
+    uint64_t buckets[METRICS_BUCKETS] = {0};
+};
+
+struct Snapshot {
+    uint64_t counters[COUNTER_COUNT] = {0};
+    HistogramData histograms[HISTOGRAM_COUNT];
+};
+
+/**
+ * @brief Single-writer increment: only the owning thread writes, so a
+ * load and a store are enough (readers may see it a little late).
+ */
+inline void bump(std::atomic<uint64_t> &a, uint64_t n) {
+    a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+struct alignas(METRICS_CACHE_LINE) Slot {
+    std::atomic<uint64_t> counters[COUNTER_COUNT];
+    struct {
+        std::atomic<uint64_t> count, sum, max;
+        std::atomic<uint64_t> buckets[METRICS_BUCKETS];
+    } histograms[HISTOGRAM_COUNT];
+    bool in_use = false;
+
+    Slot() { clear(); }
+
+    void clear() {
+        for (auto &c : counters)
+            c.store(0, std::memory_order_relaxed);
+        for (auto &h : histograms) {
+            h.count.store(0, std::memory_order_relaxed);
+            h.sum.store(0, std::memory_order_relaxed);
+            h.max.store(0, std::memory_order_relaxed);
+            for (auto &b : h.buckets)
+                b.store(0, std::memory_order_relaxed);
+        }
+    }
+};
+
+class Registry {
+  public:
+    std::atomic<bool> enabled{true};
+
+    Slot *acquire() {
+        std::lock_guard<std::mutex> lock(mu_);
+        for (Slot *s : slots_) {
+            if (!s->in_use) {
+                s->in_use = true;
+                return s;
+            }
+        }
+        slots_.push_back(new Slot());  // Never freed: readers may still be adding it up.
+        slots_.back()->in_use = true;
+        return slots_.back();
+    }
+
+    void release(Slot *s) {
+        std::lock_guard<std::mutex> lock(mu_);
+        s->in_use = false;
+    }
+
+    void snapshot(Snapshot &out) {
+        std::lock_guard<std::mutex> lock(mu_);
+        out = Snapshot();
+        for (const Slot *s : slots_) {
+            for (int c = 0; c < COUNTER_COUNT; ++c)
+                out.counters[c] += s->counters[c].load(std::memory_order_relaxed);
+            for (int h = 0; h < HISTOGRAM_COUNT; ++h) {
+                HistogramData &d = out.histograms[h];
+                d.count += s->histograms[h].count.load(std::memory_order_relaxed);
+                d.sum += s->histograms[h].sum.load(std::memory_order_relaxed);
+                uint64_t max = s->histograms[h].max.load(std::memory_order_relaxed);
+                d.max = max > d.max ? max : d.max;
+                for (size_t b = 0; b < METRICS_BUCKETS; ++b)
+                    d.buckets[b] += s->histograms[h].buckets[b].load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Zeroes every slot. Counts recorded at the same time by other
+     * threads may be lost.
+     */
+    void reset() {
+        std::lock_guard<std::mutex> lock(mu_);
+        for (Slot *s : slots_)
+            s->clear();
+    }
+
+  private:
+    std::mutex mu_;
+    std::vector<Slot *> slots_;
+};
+
+inline Registry &registry() {
+    static Registry *r = new Registry();  // Leaked, so threads exiting late can still release.
+    return *r;
+}
+
+inline Slot &local() {
+    struct Local {
+        Slot *slot = registry().acquire();
+        ~Local() { registry().release(slot); }
+    };
+    thread_local Local l;
+    return *l.slot;
+}
+
+inline bool enabled() { return registry().enabled.load(std::memory_order_relaxed); }
+
+inline void set_enabled(bool on) { registry().enabled.store(on, std::memory_order_relaxed); }
+
+inline void add(Counter c, uint64_t n = 1) {
+    if (enabled())
+        bump(local().counters[c], n);
+}
+
+inline void record(Histogram h, uint64_t ns) {
+    if (!enabled())
+        return;
+    auto &d = local().histograms[h];
+    bump(d.count, 1);
+    bump(d.sum, ns);
+    if (ns > d.max.load(std::memory_order_relaxed))
+        d.max.store(ns, std::memory_order_relaxed);
+    bump(d.buckets[bucket(ns)], 1);
+}
+
+/**
+ * @brief Records the time from construction to destruction.
+ */
+class Timer {
+  public:
+    explicit Timer(Histogram h) : h_(h), on_(enabled()) {
+        if (on_)
+            start_ = std::chrono::steady_clock::now();
+    }
+
+    ~Timer() {
+        if (on_)
+            record(h_, (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now() - start_)
+                           .count());
+    }
+
+    Timer(const Timer &) = delete;
+    Timer &operator=(const Timer &) = delete;
+
+  private:
+    Histogram h_;
+    bool on_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace
+}  // namespace metrics
+
+#define METRICS_CONCAT_(a, b) a##b
+#define METRICS_CONCAT(a, b) METRICS_CONCAT_(a, b)
+
+#ifdef PYCOIN_NO_METRICS
+#define METRICS_ADD(counter, n) ((void)0)
+#define METRICS_INC(counter) ((void)0)
+#define METRICS_TIMER(histogram) ((void)0)
+#else
+#define METRICS_ADD(counter, n) metrics::add(metrics::counter, (n))
+#define METRICS_INC(counter) metrics::add(metrics::counter)
+#define METRICS_TIMER(histogram) metrics::Timer METRICS_CONCAT(metrics_timer_, __LINE__)(metrics::histogram)
+#endif
+
+#ifdef Py_PYTHON_H
+
+ /* The Python side, for the extensions: _metrics() returns the totals of
+    this extension's registry, as {"counters": {name: count},
+    "histograms": {name: {"count", "sum_ns", "max_ns", "buckets"}}} with
+    buckets a list of (upper bound in ns, count) for the non-empty ones.
+    _metrics_reset() zeroes them, and _metrics_enable(flag) turns
+    recording on or off. */
+
+static PyObject *metrics_snapshot_py(PyObject *self, PyObject *Py_UNUSED(ignored)) {
+    metrics::Snapshot s;
+    metrics::registry().snapshot(s);
+    PyObject *counters = PyDict_New(), *histograms = PyDict_New();
+    for (int c = 0; counters && c < metrics::COUNTER_COUNT; ++c) {
+        PyObject *v = PyLong_FromUnsignedLongLong(s.counters[c]);
+        if (!v || PyDict_SetItemString(counters, metrics::COUNTER_NAMES[c], v) < 0)
+            Py_CLEAR(counters);
+        Py_XDECREF(v);
+    }
+    for (int h = 0; histograms && h < metrics::HISTOGRAM_COUNT; ++h) {
+        const metrics::HistogramData &d = s.histograms[h];
+        PyObject *buckets = PyList_New(0);
+        for (size_t b = 0; buckets && b < METRICS_BUCKETS; ++b) {
+            if (!d.buckets[b])
+                continue;
+            PyObject *item = Py_BuildValue("(KK)", (unsigned long long)metrics::bucket_upper(b),
+                                           (unsigned long long)d.buckets[b]);
+            if (!item || PyList_Append(buckets, item) < 0)
+                Py_CLEAR(buckets);
+            Py_XDECREF(item);
+        }
+        PyObject *v = buckets ? Py_BuildValue("{s:K,s:K,s:K,s:N}", "count", (unsigned long long)d.count, "sum_ns",
+                                              (unsigned long long)d.sum, "max_ns", (unsigned long long)d.max,
+                                              "buckets", buckets)
+                              : NULL;
+        if (!v || PyDict_SetItemString(histograms, metrics::HISTOGRAM_NAMES[h], v) < 0)
+            Py_CLEAR(histograms);
+        Py_XDECREF(v);
+    }
+    if (!counters || !histograms) {
+        Py_XDECREF(counters);
+        Py_XDECREF(histograms);
+        return NULL;
+    }
+    return Py_BuildValue("{s:N,s:N}", "counters", counters, "histograms", histograms);
+}
+
+static PyObject *metrics_reset_py(PyObject *self, PyObject *Py_UNUSED(ignored)) {
+    metrics::registry().reset();
+    Py_RETURN_NONE;
+}
+
+static PyObject *metrics_enable_py(PyObject *self, PyObject *arg) {
+    int on = PyObject_IsTrue(arg);
+    if (on < 0)
+        return NULL;
+    metrics::set_enabled(on);
+    Py_RETURN_NONE;
+}
+
+#define METRICS_METHODS                                                                                     \
+    {"_metrics", metrics_snapshot_py, METH_NOARGS, "Totals of this extension's counters and histograms."}, \
+        {"_metrics_reset", metrics_reset_py, METH_NOARGS, "Zero this extension's metrics."},               \
+        {"_metrics_enable", metrics_enable_py, METH_O, "Turn recording of metrics on or off."}
+
+#endif  // Py_PYTHON_H
+
+#endif  // PYCOIN_METRICS_H
@@ -0,0 +1,458 @@
+/**
+ * @file microbench.cpp
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief C++ Python Extension for micro-benchmarks of the native primitives.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <cstring>
+#include <functional>
+
+#include "bench.h"
+#include "ecdsa.h"
+#include "merkle.h"
+#include "mining.h"
+#include "pymodule.h"
+#include "secp256k1.h"
+#include "sha256.h"
+#include "siphash.h"
+
+ /* The native side of benchmark.py. Each kernel below is one primitive
+    from the headers, run in a loop by the harness in bench.h; measure()
+    runs a Python callable in the same harness, so that the pure-Python
+    versions are timed the same way and the two can be compared.
+
+    Kernels chain their iterations (the output of one is the input of
+    the next) so that nothing can be hoisted out of the loop, and the
+    native ones run with the GIL released.
+
+    scale() is the native side of scaling.py: throughput of the miner,
+    ECDSA verification and Merkle roots on a number of threads (see
+    run_threads() in bench.h). Every thread works on its own data, as
+    it would on separate jobs, signatures or blocks.
+ */
+
+#define MINE_BATCH 4096
+#define VERIFY_BATCH 16
+#define MERKLE_LEAVES 2048
+
+using namespace secp256k1;
+
+typedef std::function<void(uint64_t)> Run;
+
+static const uint8_t KEY[32] = {
+    0x18, 0xE1, 0x4A, 0x7B, 0x6A, 0x30, 0x7F, 0x42, 0x6A, 0x94, 0xF8, 0x11, 0x47, 0x01, 0xE7, 0xC8,
+    0xE7, 0x74, 0xE7, 0xF9, 0xA4, 0x7E, 0x2C, 0x20, 0x35, 0xDB, 0x29, 0xA2, 0x06, 0x32, 0x17, 0x25,
+};
+
+static Scalar key(uint8_t tweak = 0) {
+    uint8_t b[32];
+    std::memcpy(b, KEY, 32);
+    b[31] ^= tweak;
+    Scalar k;
+    scalar_load(k, b);
+    return k;
+}
+
+static Run affine_point_add() {
+    Ge a = to_affine(mul_g(key(1))), b = to_affine(mul_g(key(2)));
+    return [=](uint64_t n) mutable {
+        for (uint64_t i = 0; i < n; ++i)
+            a = to_affine(gej_add_ge(gej(a), b));
+        bench::do_not_optimize(&a);
+    };
+}
+
+static Run affine_point_multiply() {
+    Ge a = to_affine(mul_g(key(1)));
+    Scalar k = key(2);
+    return [=](uint64_t n) mutable {
+        for (uint64_t i = 0; i < n; ++i)
+            a = to_affine(mul(gej(a), k));
+        bench::do_not_optimize(&a);
+    };
+}
+
+static Run point_add() {
+    Gej a = mul_g(key(1)), b = mul_g(key(2));
+    return [=](uint64_t n) mutable {
+        for (uint64_t i = 0; i < n; ++i)
+            a = gej_add(a, b);
+        bench::do_not_optimize(&a);
+    };
+}
+
+static Run point_multiply() {
+    Gej a = mul_g(key(1));
+    Scalar k = key(2);
+    return [=](uint64_t n) mutable {
+        for (uint64_t i = 0; i < n; ++i)
+            a = mul(a, k);
+        bench::do_not_optimize(&a);
+    };
+}
+
+static Run signature_encode() {
+    Scalar r, s;
+    ecdsa::sign(key(), KEY, r, s);
+    return [=](uint64_t n) mutable {
+        uint8_t sig[ECDSA_MAX_DER_SIZE];
+        for (uint64_t i = 0; i < n; ++i) {
+            r.n[0] ^= ecdsa::der_encode(sig, r, s);
+            bench::do_not_optimize(sig);
+        }
+    };
+}
+
+static Run signature_decode() {
+    uint8_t sig[ECDSA_MAX_DER_SIZE];
+    size_t len = ecdsa::sign_der(key(), KEY, sig);
+    return [=](uint64_t n) mutable {
+        Scalar r, s;
+        for (uint64_t i = 0; i < n; ++i) {
+            sig[len - 1] ^= (uint8_t)ecdsa::der_decode(sig, len, r, s);
+            bench::do_not_optimize(&s);
+        }
+    };
+}
+
+static Run ecdsa_generate() {
+    Scalar d = key();
+    uint8_t msg[32];
+    sha256::hash(KEY, 32, msg);
+    return [=](uint64_t n) mutable {
+        Scalar r, s;
+        for (uint64_t i = 0; i < n; ++i) {
+            ecdsa::sign(d, msg, r, s);
+            scalar_store(msg, s);
+        }
+    };
+}
+
+static Run ecdsa_verify() {
+    Ge q = to_affine(mul_g(key()));
+    uint8_t msg[32];
+    sha256::hash(KEY, 32, msg);
+    Scalar r, s;
+    ecdsa::sign(key(), msg, r, s);
+    return [=](uint64_t n) mutable {
+        for (uint64_t i = 0; i < n; ++i)
+            msg[0] ^= (uint8_t)!ecdsa::verify(q, msg, r, s) << 1;  // Stays valid.
+        bench::do_not_optimize(msg);
+    };
+}
+
+static Run double_hash_sha256() {
+    uint8_t header[80] = {1};
+    return [=](uint64_t n) mutable {
+        for (uint64_t i = 0; i < n; ++i)
+            sha256::sha256d(header, 80, header + 4);  // Like a new prev block hash.
+        bench::do_not_optimize(header);
+    };
+}
+
+static Run siphash_2_4() {
+    uint8_t data[32];
+    std::memcpy(data, KEY, 32);
+    return [=](uint64_t n) mutable {
+        for (uint64_t i = 0; i < n; ++i) {
+            uint64_t h = siphash::hash(0x0706050403020100ULL, 0x0F0E0D0C0B0A0908ULL, data, 32);
+            std::memcpy(data, &h, 8);
+        }
+        bench::do_not_optimize(data);
+    };
+}
+
+static Run invert() {
+    Fe x;
+    fe_load(x, KEY);
+    return [=](uint64_t n) mutable {
+        for (uint64_t i = 0; i < n; ++i)
+            x = fe_inv(x);
+        bench::do_not_optimize(&x);
+    };
+}
+
+struct Kernel {
+    const char *name;
+    Run (*make)();
+};
+
+static const Kernel KERNELS[] = {
+    {"affine_point_add", affine_point_add},
+    {"affine_point_multiply", affine_point_multiply},
+    {"point_add", point_add},
+    {"point_multiply", point_multiply},
+    {"signature_encode", signature_encode},
+    {"signature_decode", signature_decode},
+    {"ecdsa_generate", ecdsa_generate},
+    {"ecdsa_verify", ecdsa_verify},
+    {"double_hash_sha256", double_hash_sha256},
+    {"siphash_2_4", siphash_2_4},
+    {"invert", invert},
+};
+
+typedef std::function<uint64_t()> Batch;
+
+static Batch mine(int thread) {
+    uint8_t header[80] = {1};
+    uint32_t bits = 0x03000001;  // A target of 1, never met.
+    std::memcpy(header + 68, &thread, 4);  // Each thread has its own timestamp.
+    std::memcpy(header + 72, &bits, 4);
+    mining::Job job;
+    mining::make_job(header, job);
+    uint32_t start = 0;
+    return [=]() mutable {
+        uint32_t nonce = 0;
+        bool found = mining::scan(job, start, MINE_BATCH, nonce);
+        bench::do_not_optimize(&found);
+        start += MINE_BATCH;
+        return (uint64_t)MINE_BATCH;
+    };
+}
+
+static Batch ecdsa_verify_batch(int thread) {
+    struct Item {
+        Ge q;
+        uint8_t msg[32];
+        Scalar r, s;
+    };
+    std::vector<Item> items(VERIFY_BATCH);
+    for (int i = 0; i < VERIFY_BATCH; ++i) {
+        Scalar d = key((uint8_t)(thread * VERIFY_BATCH + i));
+        Item &item = items[i];
+        item.q = to_affine(mul_g(d));
+        scalar_store(item.msg, d);
+        sha256::hash(item.msg, 32, item.msg);
+        ecdsa::sign(d, item.msg, item.r, item.s);
+    }
+    return [items]() {
+        int valid = 0;
+        for (const Item &item : items)
+            valid += ecdsa::verify(item.q, item.msg, item.r, item.s);
+        bench::do_not_optimize(&valid);
+        return (uint64_t)VERIFY_BATCH;
+    };
+}
+
+static Batch merkle_root(int thread) {
+    std::vector<uint8_t> txids(32 * MERKLE_LEAVES);
+    for (uint32_t i = 0; i < MERKLE_LEAVES; ++i) {
+        uint32_t seed[2] = {(uint32_t)thread, i};
+        sha256::hash(reinterpret_cast<const uint8_t *>(seed), sizeof(seed), &txids[32 * i]);
+    }
+    return [txids]() mutable {
+        merkle::root(txids.data(), MERKLE_LEAVES, txids.data());  // Like a new coinbase.
+        return (uint64_t)MERKLE_LEAVES;
+    };
+}
+
+struct Scalable {
+    const char *name;
+    const char *unit;
+    Batch (*make)(int);
+};
+
+static const Scalable SCALABLE[] = {
+    {"mine", "hashes", mine},
+    {"ecdsa_verify", "verifications", ecdsa_verify_batch},
+    {"merkle", "txids", merkle_root},
+};
+
+static PyObject *stats_dict(const bench::Stats &s, const bench::CycleCounter &counter) {
+    PyObject *cycles = counter.source() == bench::CycleCounter::NONE ? Py_None : NULL;
+    if (cycles)
+        return Py_BuildValue("{s:K,s:n,s:d,s:d,s:d,s:d,s:O,s:O,s:s}", "iterations", (unsigned long long)s.iterations,
+                             "samples", (Py_ssize_t)s.samples, "median_ns", s.median_ns, "p99_ns", s.p99_ns, "min_ns",
+                             s.min_ns, "mean_ns", s.mean_ns, "median_cycles", cycles, "p99_cycles", cycles, "counter",
+                             counter.name());
+    return Py_BuildValue("{s:K,s:n,s:d,s:d,s:d,s:d,s:d,s:d,s:s}", "iterations", (unsigned long long)s.iterations,
+                         "samples", (Py_ssize_t)s.samples, "median_ns", s.median_ns, "p99_ns", s.p99_ns, "min_ns",
+                         s.min_ns, "mean_ns", s.mean_ns, "median_cycles", s.median_cycles, "p99_cycles", s.p99_cycles,
+                         "counter", counter.name());
+}
+
+static bool get_options(double min_time, Py_ssize_t samples, bench::Options &options) {
+    if (!(min_time > 0) || samples <= 0) {
+        PyErr_SetString(PyExc_ValueError, "min_time and samples must be positive.");
+        return false;
+    }
+    options.min_time = min_time;
+    options.samples = (size_t)samples;
+    options.warmup = std::min(BENCH_WARMUP_TIME, min_time / 4);
+    return true;
+}
+
+static PyObject *microbench_run(PyObject *self, PyObject *args, PyObject *kwds) {
+    static const char *kwlist[] = {"name", "min_time", "samples", "perf", NULL};
+    const char *name;
+    double min_time = BENCH_DEFAULT_MIN_TIME;
+    Py_ssize_t samples = BENCH_DEFAULT_SAMPLES;
+    int perf = 1;
+    bench::Options options;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "s|dnp", const_cast<char **>(kwlist), &name, &min_time, &samples,
+                                     &perf)
+        || !get_options(min_time, samples, options))
+        return NULL;
+    const Kernel *kernel = NULL;
+    for (const Kernel &k : KERNELS)
+        if (std::strcmp(k.name, name) == 0)
+            kernel = &k;
+    if (!kernel) {
+        PyErr_Format(PyExc_ValueError, "unknown benchmark %s.", name);
+        return NULL;
+    }
+    bench::CycleCounter counter(perf);
+    bench::Stats stats;
+    Py_BEGIN_ALLOW_THREADS
+    Run run = kernel->make();
+    bench::measure([&](uint64_t n) { return run(n), true; }, options, counter, stats);
+    Py_END_ALLOW_THREADS
+    return stats_dict(stats, counter);
+}
+
+static PyObject *microbench_measure(PyObject *self, PyObject *args, PyObject *kwds) {
+    static const char *kwlist[] = {"func", "min_time", "samples", "perf", NULL};
+    PyObject *func;
+    double min_time = BENCH_DEFAULT_MIN_TIME;
+    Py_ssize_t samples = BENCH_DEFAULT_SAMPLES;
+    int perf = 1;
+    bench::Options options;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|dnp", const_cast<char **>(kwlist), &func, &min_time, &samples,
+                                     &perf)
+        || !get_options(min_time, samples, options))
+        return NULL;
+    if (!PyCallable_Check(func)) {
+        PyErr_SetString(PyExc_TypeError, "func must be callable.");
+        return NULL;
+    }
+    bench::CycleCounter counter(perf);
+    bench::Stats stats;
+    auto run = [func](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            PyObject *result = PyObject_CallNoArgs(func);
+            if (!result)
+                return false;
+            Py_DECREF(result);
+        }
+        return true;
+    };
+    if (!bench::measure(run, options, counter, stats))
+        return NULL;
+    return stats_dict(stats, counter);
+}
+
+static PyObject *microbench_scale(PyObject *self, PyObject *args, PyObject *kwds) {
+    static const char *kwlist[] = {"name", "threads", "min_time", "cpus", NULL};
+    const char *name;
+    int threads = 1;
+    double min_time = BENCH_DEFAULT_MIN_TIME;
+    PyObject *cpus_arg = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "s|idO", const_cast<char **>(kwlist), &name, &threads, &min_time,
+                                     &cpus_arg))
+        return NULL;
+    if (threads <= 0 || !(min_time > 0)) {
+        PyErr_SetString(PyExc_ValueError, "threads and min_time must be positive.");
+        return NULL;
+    }
+    const Scalable *kernel = NULL;
+    for (const Scalable &k : SCALABLE)
+        if (std::strcmp(k.name, name) == 0)
+            kernel = &k;
+    if (!kernel) {
+        PyErr_Format(PyExc_ValueError, "unknown benchmark %s.", name);
+        return NULL;
+    }
+    std::vector<int> cpus;
+    if (cpus_arg != Py_None) {
+        PyObject *seq = PySequence_Fast(cpus_arg, "cpus must be a sequence of CPU numbers.");
+        if (!seq)
+            return NULL;
+        for (Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(seq); ++i)
+            cpus.push_back((int)PyLong_AsLong(PySequence_Fast_GET_ITEM(seq, i)));
+        Py_DECREF(seq);
+        if (PyErr_Occurred())
+            return NULL;
+    }
+    bench::Throughput result;
+    Py_BEGIN_ALLOW_THREADS
+    result = bench::run_threads(threads, cpus, min_time, kernel->make);
+    Py_END_ALLOW_THREADS
+    return Py_BuildValue("{s:s,s:s,s:i,s:K,s:d,s:d,s:O}", "name", kernel->name, "unit", kernel->unit, "threads",
+                         threads, "items", (unsigned long long)result.items, "seconds", result.seconds, "rate",
+                         result.items / result.seconds, "pinned",
+                         !cpus.empty() && result.pinned ? Py_True : Py_False);
+}
+
+static PyObject *list_names(const char *const *names, size_t count) {
+    PyObject *list = PyList_New(0);
+    for (size_t i = 0; list && i < count; ++i) {
+        PyObject *name = PyUnicode_FromString(names[i]);
+        if (!name || PyList_Append(list, name) < 0) {
+            Py_XDECREF(name);
+            Py_DECREF(list);
+            return NULL;
+        }
+        Py_DECREF(name);
+    }
+    return list;
+}
+
+static PyObject *microbench_scale_names(PyObject *self, PyObject *Py_UNUSED(ignored)) {
+    std::vector<const char *> names;
+    for (const Scalable &k : SCALABLE)
+        names.push_back(k.name);
+    return list_names(names.data(), names.size());
+}
+
+static PyObject *microbench_names(PyObject *self, PyObject *Py_UNUSED(ignored)) {
+    std::vector<const char *> names;
+    for (const Kernel &k : KERNELS)
+        names.push_back(k.name);
+    return list_names(names.data(), names.size());
+}
+
+static PyObject *microbench_counter(PyObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    int perf = 1;
+    if (!parse_args(args, nargs, "|p:counter", &perf))
+        return NULL;
+    return PyUnicode_FromString(bench::CycleCounter(perf).name());
+}
+
+static PyMethodDef microbench_methods[] = {
+    {"run", (PyCFunction)(void (*)(void))microbench_run, METH_VARARGS | METH_KEYWORDS,
+     "Benchmark a native primitive by name, returning statistics per iteration."},
+    {"measure", (PyCFunction)(void (*)(void))microbench_measure, METH_VARARGS | METH_KEYWORDS,
+     "Benchmark calls of a Python callable (without arguments) in the same harness."},
+    {"scale", (PyCFunction)(void (*)(void))microbench_scale, METH_VARARGS | METH_KEYWORDS,
+     "Throughput of a benchmark on a number of threads (optionally pinned to cpus), in items per second."},
+    {"names", microbench_names, METH_NOARGS, "Names of the native benchmarks."},
+    {"scale_names", microbench_scale_names, METH_NOARGS, "Names of the benchmarks scale() runs."},
+    {"counter", (PyCFunction)(void (*)(void))microbench_counter, METH_FASTCALL,
+     "The cycle counter in use: perf, rdtsc or none."},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyModuleDef_Slot microbench_slots[] = {
+    MODULE_SLOTS
+    {0, NULL}
+};
+
+static struct PyModuleDef microbench = {
+    PyModuleDef_HEAD_INIT,
+    "microbench",
+    NULL,
+    0,
+    microbench_methods,
+    microbench_slots
+};
+
+PyMODINIT_FUNC PyInit_microbench(void) {
+    return PyModuleDef_Init(&microbench);
+}
@@ -0,0 +1,12 @@
+from typing import Any, Callable, Sequence
+
+def run(name: str, min_time: float = ..., samples: int = ..., perf: bool = ...) -> dict[str, Any]: ...
+def measure(
+    func: Callable[[], object], min_time: float = ..., samples: int = ..., perf: bool = ...
+) -> dict[str, Any]: ...
+def scale(
+    name: str, threads: int = ..., min_time: float = ..., cpus: Sequence[int] | None = ...
+) -> dict[str, Any]: ...
+def names() -> list[str]: ...
+def scale_names() -> list[str]: ...
+def counter(perf: bool = ...) -> str: ...
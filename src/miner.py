@@ -7,19 +7,30 @@ target amount.
 Transaction validation and full blocks will be added later on,
 along with merkle tree hashing, difficulty adjustment, and
 timestamp updates -- the whole thing.
+
+When the hashminer extension is built, mine() searches on native
+threads (see hashminer.cpp); scaling.py measures how its hashrate
+grows with the number of threads. Otherwise it searches slices of the
+range on the worker pool (see workers.py).
 """
 
 import json
-import multiprocessing as mp
 import struct
 import time
 from datetime import datetime
-from functools import partial, singledispatch
+from functools import singledispatch
+
+from . import workers
+from .header import target, verify
 
-from header import target, verify
+try:
+    from . import hashminer  # type: ignore
+except ImportError:
+    hashminer = None
 
 UINT32_MAX = 0xFFFFFFFF
-WORKERS = mp.cpu_count()
+WORKERS = workers.cpu_count()
+SLICE = 1 << 16  # Nonces per task on the worker pool.
 
 
 def update_timestamp(block_header: bytearray) -> None:
@@ -73,29 +84,71 @@ def check_nonce(block: bytearray, nonce: int) -> bool:
     return verify(block)
 
 
-if __name__ == "__main__":
+def py_mine(header: bytes, start: int = 0, stop: int = UINT32_MAX + 1) -> tuple[int | None, int]:
+    block = bytearray(header)
+    for nonce in range(start, stop):
+        if check_nonce(block, nonce):
+            return nonce, nonce - start + 1
+    return None, stop - start
+
+
+def _py_mine(args: tuple[bytes, int, int]) -> tuple[int | None, int]:
+    return py_mine(*args)
+
+
+def pool_mine(
+    header: bytes, start: int = 0, stop: int = UINT32_MAX + 1, pool: workers.Pool | None = None
+) -> tuple[int | None, int]:
+    """py_mine() on the worker pool, a slice of the range per task.
+    Slices are handed out in order and the rest are dropped once a
+    nonce is found, so the lowest one is returned."""
+    pool = pool or workers.default()
+    slices = ((header, i, min(i + SLICE, stop)) for i in range(start, stop, SLICE))
+    hashes = 0
+    results = pool.map(_py_mine, slices)
+    for nonce, done in results:
+        hashes += done
+        if nonce is not None:
+            results.close()  # Cancels the slices not started yet.
+            return nonce, hashes
+    return None, hashes
+
+
+def mine(
+    header: bytes,
+    start: int = 0,
+    stop: int = UINT32_MAX + 1,
+    threads: int = WORKERS,
+    cpus: list[int] | None = None,
+) -> tuple[int | None, int]:
+    """Returns the lowest nonce in [start, stop) for which the header
+    meets its target (or None), and how many hashes were done."""
+    if hashminer is None:
+        return py_mine(header, start, stop) if threads <= 1 else pool_mine(header, start, stop)
+    return hashminer.mine(header, start, stop, threads=threads, cpus=cpus)
+
+
+if __name__ == "__main__" and hashminer is not None:
+    block = parse_block_json("example_blocks/genesis.json")
+    t1 = time.perf_counter()
+    nonce, hashes = mine(bytes(block), 2_080_000_000)
+    t2 = time.perf_counter()
+    print(f"Found {nonce=} after {hashes} hashes in {t2-t1:.8f} seconds")
+    print(f"Hashrate was ~{hashes//(t2-t1)} H/s")
+elif __name__ == "__main__":
     # This is just an example of mining the genesis block.
     # Mining works, but it is slow since looping in Python
-    # is expensive. Later on, this might be changed into
-    # a C++ extension to speed up looping. The GIL also
-    # makes this less than ideal since the overhead for
-    # running a process is much more than that of running
-    # a thread.
+    # is expensive, which is why there is a C++ extension
+    # (hashminer.cpp) for it. Without it, the search is
+    # spread over the worker pool, which is kept across
+    # calls so only the first one pays for starting it.
     block = parse_block_json("example_blocks/genesis.json")
     start = 2_080_000_000
     iterations = 2_083_236_893 - start
-    check_block = partial(check_nonce, block)
     t1 = time.perf_counter()
-    with mp.Pool(processes=WORKERS) as pool:
-        results = pool.imap(
-            check_block,
-            range(start, UINT32_MAX),
-            chunksize=20_000,
-        )
-        for result in filter(None, results):
-            break
-        else:
-            print("Nonce not found.")
+    nonce, hashes = pool_mine(bytes(block), start)
     t2 = time.perf_counter()
+    if nonce is None:
+        print("Nonce not found.")
     print(f"Done {iterations=} in {t2-t1:.8f} seconds")
     print(f"Hashrate was ~{iterations//(t2-t1)} H/s")
@@ -0,0 +1,141 @@
+/**
+ * @file mining.h
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief Header-only proof of work search over the nonces of a block header.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef PYCOIN_MINING_H
+#define PYCOIN_MINING_H
+
+#include <cstdint>
+#include <cstring>
+
+#include "sha256.h"
+
+ /* The header is 80 bytes, so its first hash takes two blocks, and the
+    nonce is in the second. The first block (version, previous hash and
+    most of the Merkle root) never changes while the nonce does, so it
+    is compressed once into a midstate (Job), and each nonce costs two
+    compressions: the second block of the header from the midstate,
+    then the 32-byte digest. Nonces are tried SHA256_LANES at a time
+    with the multi-buffer compression function.
+
+    A hash meets the target when, read as a little-endian number, it is
+    below the target (as in header.verify()), which is compared a 32-bit
+    word at a time, most significant first.
+
+    References:
+        - https://en.bitcoin.it/wiki/Block_hashing_algorithm
+        - https://en.bitcoin.it/wiki/Difficulty
+ */
+
+namespace mining {
+
+struct Job {
+    uint32_t midstate[8];
+    uint8_t block[64];   // The second block of the header, padded; the nonce is at 12.
+    uint32_t target[8];  // Most significant word first.
+};
+
+/**
+ * @brief The target of compact bits (as header.target()), saturating at
+ * 2^256 - 1.
+ */
+inline void expand_target(uint32_t bits, uint32_t target[8]) {
+    uint8_t be[32] = {0};
+    int exponent = bits >> 24;
+    uint32_t mantissa = bits & 0xFFFFFF;
+    for (int i = 0; i < 3; ++i) {
+        int pos = exponent - 3 + i;  // Byte position from the least significant end.
+        uint8_t byte = (uint8_t)(mantissa >> (8 * i));
+        if (pos >= 32 && byte) {
+            std::memset(be, 0xFF, 32);
+            break;
+        }
+        if (pos >= 0 && pos < 32)
+            be[31 - pos] = byte;
+    }
+    for (int i = 0; i < 8; ++i)
+        target[i] = sha256::load_be32(be + 4 * i);
+}
+
+inline void make_job(const uint8_t header[80], Job &job) {
+    std::memcpy(job.midstate, sha256::IV, sizeof(job.midstate));
+    sha256::transform(job.midstate, header);
+    std::memset(job.block, 0, 64);
+    std::memcpy(job.block, header + 64, 16);
+    job.block[16] = 0x80;
+    job.block[62] = 0x02;  // 640 bits, big-endian.
+    job.block[63] = 0x80;
+    uint32_t bits;
+    std::memcpy(&bits, header + 72, 4);  // Little-endian hosts only, as everywhere here.
+    expand_target(bits, job.target);
+}
+
+inline uint32_t bswap32(uint32_t x) { return __builtin_bswap32(x); }
+
+/**
+ * @brief Whether a hash, given as the final state words of sha256d, is
+ * below the target.
+ */
+inline bool meets_target(const uint32_t s[8], const uint32_t target[8]) {
+    for (int i = 0; i < 8; ++i) {
+        uint32_t word = bswap32(s[7 - i]);
+        if (word != target[i])
+            return word < target[i];
+    }
+    return false;
+}
+
+/**
+ * @brief Tries count nonces from start (wrapping at 2^32). Returns true
+ * and the first nonce found in nonce if one meets the target.
+ */
+inline bool scan(const Job &job, uint32_t start, uint64_t count, uint32_t &nonce) {
+    uint8_t blocks[SHA256_LANES][64], digests[SHA256_LANES][64];
+    const uint8_t *first[SHA256_LANES], *second[SHA256_LANES];
+    uint32_t s[8][SHA256_LANES];
+    for (int l = 0; l < SHA256_LANES; ++l) {
+        std::memcpy(blocks[l], job.block, 64);
+        std::memset(digests[l], 0, 64);
+        digests[l][32] = 0x80;
+        digests[l][62] = 0x01;  // 256 bits.
+        first[l] = blocks[l];
+        second[l] = digests[l];
+    }
+    for (uint64_t done = 0; done < count; done += SHA256_LANES) {
+        for (int l = 0; l < SHA256_LANES; ++l) {
+            uint32_t n = start + (uint32_t)(done + l);
+            std::memcpy(blocks[l] + 12, &n, 4);
+            for (int i = 0; i < 8; ++i)
+                s[i][l] = job.midstate[i];
+        }
+        sha256::transform_lanes(s, first);
+        for (int l = 0; l < SHA256_LANES; ++l) {
+            for (int i = 0; i < 8; ++i) {
+                sha256::store_be32(digests[l] + 4 * i, s[i][l]);
+                s[i][l] = sha256::IV[i];
+            }
+        }
+        sha256::transform_lanes(s, second);
+        for (int l = 0; l < SHA256_LANES && done + l < count; ++l) {
+            uint32_t h[8];
+            for (int i = 0; i < 8; ++i)
+                h[i] = s[i][l];
+            if (meets_target(h, job.target)) {
+                nonce = start + (uint32_t)(done + l);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+}  // namespace mining
+
+#endif  // PYCOIN_MINING_H
@@ -0,0 +1,509 @@
+/**
+ * @file minisketch.cpp
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief C++ Python Extension for set sketches (BCH, PinSketch) over GF(2^32).
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <random>
+#include <vector>
+
+#include "gf32.h"
+#include "pymodule.h"
+
+ /* A sketch of capacity c summarizes a set of non-zero 32-bit elements
+    as the odd power sums s1, s3, ..., s(2c-1), where sk is the sum of
+    x^k over the elements x. Adding an element twice removes it again,
+    so xoring the sketches of two sets gives the sketch of their
+    symmetric difference, and that can be decoded as long as the
+    difference has at most c elements. This is what makes Erlay work:
+    peers exchange sketches the size of what they disagree on, not of
+    what they have.
+
+    Decoding (all in GF(2^32)):
+
+        1. The even power sums follow from the odd ones, since in
+           characteristic 2 s(2k) = sk^2.
+        2. Berlekamp-Massey finds the shortest linear recurrence of the
+           power sums, whose connection polynomial has the inverses of
+           the elements as roots. Reversing it gives a polynomial with
+           the elements themselves as roots.
+        3. That polynomial must split into distinct linear factors,
+           which is the case exactly when it divides x^(2^32) - x.
+           Otherwise the difference was bigger than the capacity.
+        4. The roots are found by repeatedly splitting the polynomial
+           with gcd(P, Tr(b x)) for random b, where Tr is the trace map
+           (Berlekamp's trace algorithm).
+
+    Serialized sketches are the c odd power sums as little-endian
+    32-bit words.
+
+    References:
+        - https://github.com/sipa/minisketch
+        - https://github.com/bitcoin/bips/blob/master/bip-0330.mediawiki
+ */
+
+#define MAX_CAPACITY 65536
+#define MAX_SPLIT_TRIES 256
+
+typedef std::vector<uint32_t> Poly;  // Coefficients, lowest degree first.
+
+static void trim(Poly &p) {
+    while (!p.empty() && p.back() == 0)
+        p.pop_back();
+}
+
+template <class F>
+static void make_monic(Poly &p) {
+    uint32_t inv = gf32::inv<F>(p.back());
+    for (uint32_t &c : p)
+        c = F::mul(c, inv);
+}
+
+/**
+ * @brief a mod m, where m is monic.
+ */
+template <class F>
+static void poly_mod(Poly &a, const Poly &m) {
+    size_t dm = m.size() - 1;
+    while (a.size() > dm) {
+        uint32_t lead = a.back();
+        size_t shift = a.size() - 1 - dm;
+        if (lead)
+            for (size_t i = 0; i < dm; ++i)
+                a[shift + i] ^= F::mul(lead, m[i]);
+        a.pop_back();
+    }
+    trim(a);
+}
+
+/**
+ * @brief a / m (exactly divisible), where m is monic.
+ */
+template <class F>
+static Poly poly_div(Poly a, const Poly &m) {
+    size_t dm = m.size() - 1;
+    Poly q(a.size() - dm, 0);
+    while (a.size() > dm) {
+        uint32_t lead = a.back();
+        size_t shift = a.size() - 1 - dm;
+        q[shift] = lead;
+        if (lead)
+            for (size_t i = 0; i < dm; ++i)
+                a[shift + i] ^= F::mul(lead, m[i]);
+        a.pop_back();
+    }
+    return q;
+}
+
+/**
+ * @brief a^2 mod m. Squaring is linear in characteristic 2, so only the
+ * coefficients get squared (and spread out).
+ */
+template <class F>
+static void poly_sqr_mod(Poly &a, const Poly &m) {
+    Poly r(a.empty() ? 0 : 2 * a.size() - 1, 0);
+    for (size_t i = 0; i < a.size(); ++i)
+        r[2 * i] = F::mul(a[i], a[i]);
+    poly_mod<F>(r, m);
+    a.swap(r);
+}
+
+template <class F>
+static Poly poly_gcd(Poly a, Poly b) {
+    trim(a), trim(b);
+    while (!b.empty()) {
+        make_monic<F>(b);
+        poly_mod<F>(a, b);
+        a.swap(b);
+    }
+    if (!a.empty())
+        make_monic<F>(a);
+    return a;
+}
+
+/**
+ * @brief Berlekamp-Massey on the power sums s1..s2c, returning the
+ * connection polynomial C with C[0] = 1.
+ */
+template <class F>
+static Poly berlekamp_massey(const std::vector<uint32_t> &s) {
+    Poly c{1}, b{1};
+    size_t l = 0, m = 1;
+    uint32_t bd = 1;
+    for (size_t n = 0; n < s.size(); ++n) {
+        uint32_t d = s[n];
+        for (size_t i = 1; i <= l && i < c.size(); ++i)
+            d ^= F::mul(c[i], s[n - i]);
+        if (d == 0) {
+            ++m;
+            continue;
+        }
+        uint32_t factor = F::mul(d, gf32::inv<F>(bd));
+        Poly t = c;
+        if (c.size() < b.size() + m)
+            c.resize(b.size() + m, 0);
+        for (size_t i = 0; i < b.size(); ++i)
+            c[i + m] ^= F::mul(factor, b[i]);
+        if (2 * l <= n) {
+            l = n + 1 - l;
+            b.swap(t);
+            bd = d;
+            m = 1;
+        } else {
+            ++m;
+        }
+    }
+    c.resize(l + 1, 0);
+    return c;
+}
+
+/**
+ * @brief Appends the roots of p (monic, with distinct roots that are all
+ * in the field) to roots. Returns false if p could not be split.
+ */
+template <class F>
+static bool find_roots(const Poly &p, std::mt19937 &rng, std::vector<uint32_t> &roots) {
+    size_t d = p.size() - 1;
+    if (d == 0)
+        return true;
+    if (d == 1) {
+        roots.push_back(p[0]);
+        return true;
+    }
+    for (int attempt = 0; attempt < MAX_SPLIT_TRIES; ++attempt) {
+        uint32_t b = rng() | 1;
+        Poly t{0, b}, trace{0, b};
+        poly_mod<F>(t, p);
+        trace = t;
+        for (int i = 1; i < 32; ++i) {
+            poly_sqr_mod<F>(t, p);
+            if (trace.size() < t.size())
+                trace.resize(t.size(), 0);
+            for (size_t j = 0; j < t.size(); ++j)
+                trace[j] ^= t[j];
+        }
+        trim(trace);
+        Poly g = poly_gcd<F>(p, trace);
+        if (g.size() > 1 && g.size() < p.size())
+            return find_roots<F>(g, rng, roots) && find_roots<F>(poly_div<F>(p, g), rng, roots);
+    }
+    return false;
+}
+
+template <class F>
+static void sketch_add(uint32_t *syndromes, size_t capacity, uint32_t x) {
+    uint32_t x2 = F::mul(x, x), p = x;
+    for (size_t i = 0; i < capacity; ++i) {
+        syndromes[i] ^= p;
+        p = F::mul(p, x2);
+    }
+}
+
+/**
+ * @brief Decodes the elements of a sketch, returning false if there are
+ * more than max of them (or more than the capacity).
+ */
+template <class F>
+static bool sketch_decode(const std::vector<uint32_t> &odd, size_t max, std::vector<uint32_t> &out) {
+    size_t c = odd.size();
+    std::vector<uint32_t> s(2 * c);
+    for (size_t i = 0; i < c; ++i)
+        s[2 * i] = odd[i];
+    for (size_t k = 1; k <= c; ++k)  // s[k - 1] holds the k-th power sum.
+        s[2 * k - 1] = F::mul(s[k - 1], s[k - 1]);
+    Poly conn = berlekamp_massey<F>(s);
+    size_t degree = conn.size() - 1;
+    if (degree > max || degree > c)
+        return false;
+    out.clear();
+    if (degree == 0)
+        return true;
+    if (conn.back() == 0)
+        return false;
+    Poly p(conn.rbegin(), conn.rend());
+    make_monic<F>(p);
+    /* All roots are distinct and in the field iff x^(2^32) = x mod p. */
+    Poly x{0, 1};
+    poly_mod<F>(x, p);
+    Poly y = x;
+    for (int i = 0; i < 32; ++i)
+        poly_sqr_mod<F>(y, p);
+    if (y != x)
+        return false;
+    std::mt19937 rng((uint32_t)degree * 2654435761u ^ odd[0]);
+    return find_roots<F>(p, rng, out) && out.size() == degree;
+}
+
+/* Sketch type. */
+
+typedef struct {
+    PyObject_HEAD
+    std::vector<uint32_t> *syndromes;
+    std::mutex *mu;  // Guards syndromes, which __init__ may replace.
+} SketchObject;
+
+static int Sketch_init(SketchObject *self, PyObject *args, PyObject *kwds) {
+    static const char *kwlist[] = {"capacity", "data", NULL};
+    Py_ssize_t capacity;
+    Py_buffer data = {NULL, NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "n|y*", const_cast<char **>(kwlist), &capacity, &data))
+        return -1;
+    if (capacity <= 0 || capacity > MAX_CAPACITY || (data.buf && data.len != 4 * capacity)) {
+        if (data.buf)
+            PyBuffer_Release(&data);
+        PyErr_SetString(PyExc_ValueError, "invalid capacity (or data is not 4 * capacity bytes).");
+        return -1;
+    }
+    std::vector<uint32_t> *syndromes = new (std::nothrow) std::vector<uint32_t>(capacity, 0);
+    if (!syndromes) {
+        if (data.buf)
+            PyBuffer_Release(&data);
+        PyErr_NoMemory();
+        return -1;
+    }
+    if (data.buf) {
+        const uint8_t *p = static_cast<const uint8_t *>(data.buf);
+        for (Py_ssize_t i = 0; i < capacity; ++i, p += 4)
+            (*syndromes)[i] = (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+        PyBuffer_Release(&data);
+    }
+    if (!self->mu)
+        self->mu = new std::mutex();
+    ObjectLock lock(*self->mu);
+    delete self->syndromes;
+    self->syndromes = syndromes;
+    return 0;
+}
+
+static void Sketch_dealloc(SketchObject *self) {
+    delete self->syndromes;
+    delete self->mu;
+    heap_free(reinterpret_cast<PyObject *>(self));
+}
+
+static bool ready(SketchObject *self) {
+    if (!self->syndromes)
+        PyErr_SetString(PyExc_RuntimeError, "Sketch is not initialized.");
+    return self->syndromes != NULL;
+}
+
+static bool get_element(PyObject *obj, uint32_t *x) {
+    unsigned long long v = PyLong_AsUnsignedLongLong(obj);
+    if (v == (unsigned long long)-1 && PyErr_Occurred())
+        return false;
+    if (v == 0 || v > 0xFFFFFFFFULL) {
+        PyErr_SetString(PyExc_ValueError, "elements must be in [1, 2**32).");
+        return false;
+    }
+    *x = (uint32_t)v;
+    return true;
+}
+
+static void add_all(std::vector<uint32_t> &s, const std::vector<uint32_t> &xs) {
+    if (gf32::clmul())
+        for (uint32_t x : xs)
+            sketch_add<gf32::Clmul>(s.data(), s.size(), x);
+    else
+        for (uint32_t x : xs)
+            sketch_add<gf32::Portable>(s.data(), s.size(), x);
+}
+
+static PyObject *Sketch_add(SketchObject *self, PyObject *arg) {
+    uint32_t x;
+    if (!ready(self) || !get_element(arg, &x))
+        return NULL;
+    ObjectLock lock(*self->mu);
+    add_all(*self->syndromes, {x});
+    Py_RETURN_NONE;
+}
+
+static PyObject *Sketch_add_many(SketchObject *self, PyObject *arg) {
+    if (!ready(self))
+        return NULL;
+    PyObject *seq = PySequence_Fast(arg, "expected a sequence of integers.");
+    if (!seq)
+        return NULL;
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    std::vector<uint32_t> xs(n);
+    for (Py_ssize_t i = 0; i < n; ++i) {
+        if (!get_element(PySequence_Fast_GET_ITEM(seq, i), &xs[i])) {
+            Py_DECREF(seq);
+            return NULL;
+        }
+    }
+    Py_DECREF(seq);
+    ObjectLock lock(*self->mu);
+    Py_BEGIN_ALLOW_THREADS
+    add_all(*self->syndromes, xs);
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+}
+
+static PyObject *Sketch_merge(SketchObject *self, PyObject *arg) {
+    if (!ready(self))
+        return NULL;
+    SketchObject *sketch = reinterpret_cast<SketchObject *>(arg);
+    if (!Py_IS_TYPE(arg, Py_TYPE(self)) || !sketch->syndromes) {
+        PyErr_SetString(PyExc_TypeError, "expected a Sketch.");
+        return NULL;
+    }
+    // A copy, so the two sketches are never locked at once.
+    std::vector<uint32_t> other;
+    {
+        ObjectLock lock(*sketch->mu);
+        other = *sketch->syndromes;
+    }
+    ObjectLock lock(*self->mu);
+    std::vector<uint32_t> *s = self->syndromes;
+    if (other.size() < s->size())
+        s->resize(other.size());
+    for (size_t i = 0; i < s->size(); ++i)
+        (*s)[i] ^= other[i];
+    Py_RETURN_NONE;
+}
+
+static PyObject *Sketch_decode(SketchObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    Py_ssize_t max = -1;
+    if (!ready(self) || !parse_args(args, nargs, "|n:decode", &max))
+        return NULL;
+    std::vector<uint32_t> out;
+    bool ok;
+    {
+        ObjectLock lock(*self->mu);
+        const std::vector<uint32_t> &s = *self->syndromes;
+        if (max < 0 || (size_t)max > s.size())
+            max = s.size();
+        Py_BEGIN_ALLOW_THREADS
+        ok = gf32::clmul() ? sketch_decode<gf32::Clmul>(s, max, out) : sketch_decode<gf32::Portable>(s, max, out);
+        Py_END_ALLOW_THREADS
+    }
+    if (!ok)
+        Py_RETURN_NONE;
+    PyObject *result = PyList_New(out.size());
+    for (size_t i = 0; result && i < out.size(); ++i) {
+        PyObject *item = PyLong_FromUnsignedLong(out[i]);
+        if (!item) {
+            Py_CLEAR(result);
+            break;
+        }
+        PyList_SET_ITEM(result, i, item);
+    }
+    return result;
+}
+
+static PyObject *Sketch_serialize(SketchObject *self, PyObject *Py_UNUSED(ignored)) {
+    if (!ready(self))
+        return NULL;
+    ObjectLock lock(*self->mu);
+    const std::vector<uint32_t> *s = self->syndromes;
+    PyObject *result = PyBytes_FromStringAndSize(NULL, 4 * s->size());
+    if (!result)
+        return NULL;
+    uint8_t *p = reinterpret_cast<uint8_t *>(PyBytes_AS_STRING(result));
+    for (uint32_t v : *s)
+        *p++ = v, *p++ = v >> 8, *p++ = v >> 16, *p++ = v >> 24;
+    return result;
+}
+
+static PyObject *Sketch_get_capacity(SketchObject *self, void *closure) {
+    if (!self->syndromes)
+        return PyLong_FromLong(0);
+    ObjectLock lock(*self->mu);
+    return PyLong_FromSize_t(self->syndromes->size());
+}
+
+static PyMethodDef Sketch_methods[] = {
+    {"add", (PyCFunction)Sketch_add, METH_O, "Add (or, if present, remove) an element in [1, 2**32)."},
+    {"add_many", (PyCFunction)Sketch_add_many, METH_O, "Add every element of a sequence."},
+    {"merge", (PyCFunction)Sketch_merge, METH_O,
+     "Xor another sketch into this one (giving the sketch of the symmetric difference)."},
+    {"decode", (PyCFunction)(void (*)(void))Sketch_decode, METH_FASTCALL,
+     "The elements of the sketch, or None if there are more than max_elements (default: the capacity)."},
+    {"serialize", (PyCFunction)Sketch_serialize, METH_NOARGS, "The sketch as 4 * capacity bytes."},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyGetSetDef Sketch_getset[] = {
+    {"capacity", (getter)Sketch_get_capacity, NULL, "Number of elements that can be decoded.", NULL},
+    {NULL}
+};
+
+static PyType_Slot Sketch_slots[] = {
+    {Py_tp_dealloc, (void *)Sketch_dealloc},
+    {Py_tp_doc, (void *)"Sketch of a set of 32-bit elements that decodes set differences up to its capacity."},
+    {Py_tp_methods, Sketch_methods},
+    {Py_tp_getset, Sketch_getset},
+    {Py_tp_init, (void *)Sketch_init},
+    {Py_tp_new, (void *)PyType_GenericNew},
+    {0, NULL}
+};
+
+static PyType_Spec Sketch_spec = {
+    "minisketch.Sketch",
+    sizeof(SketchObject),
+    0,
+    Py_TPFLAGS_DEFAULT,
+    Sketch_slots
+};
+
+/* Module. */
+
+typedef struct {
+    PyObject *sketch_type;
+} MinisketchState;
+
+static MinisketchState *get_state(PyObject *m) {
+    return static_cast<MinisketchState *>(PyModule_GetState(m));
+}
+
+static int minisketch_exec(PyObject *m) {
+    if (module_add_type(m, &Sketch_spec, &get_state(m)->sketch_type) < 0)
+        return -1;
+    return PyModule_AddStringConstant(m, "IMPLEMENTATION", gf32::clmul() ? "clmul" : "portable");
+}
+
+static int minisketch_traverse(PyObject *m, visitproc visit, void *arg) {
+    Py_VISIT(get_state(m)->sketch_type);
+    return 0;
+}
+
+static int minisketch_clear(PyObject *m) {
+    Py_CLEAR(get_state(m)->sketch_type);
+    return 0;
+}
+
+static void minisketch_free(void *m) {
+    minisketch_clear(static_cast<PyObject *>(m));
+}
+
+static PyModuleDef_Slot minisketch_slots[] = {
+    {Py_mod_exec, (void *)minisketch_exec},
+    MODULE_SLOTS
+    {0, NULL}
+};
+
+static struct PyModuleDef minisketch = {
+    PyModuleDef_HEAD_INIT,
+    "minisketch",
+    NULL,
+    sizeof(MinisketchState),
+    NULL,
+    minisketch_slots,
+    minisketch_traverse,
+    minisketch_clear,
+    minisketch_free
+};
+
+PyMODINIT_FUNC PyInit_minisketch(void) {
+    return PyModuleDef_Init(&minisketch);
+}
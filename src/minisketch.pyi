@@ -0,0 +1,12 @@
+from typing import Sequence
+
+IMPLEMENTATION: str
+
+class Sketch:
+    capacity: int
+    def __init__(self, capacity: int, data: bytes = ...) -> None: ...
+    def add(self, x: int) -> None: ...
+    def add_many(self, xs: Sequence[int]) -> None: ...
+    def merge(self, other: Sketch) -> None: ...
+    def decode(self, max_elements: int = ...) -> list[int] | None: ...
+    def serialize(self) -> bytes: ...
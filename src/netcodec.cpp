@@ -0,0 +1,740 @@
+/**
+ * @file netcodec.cpp
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief C++ Python Extension for P2P message framing.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <structmember.h>
+#include <cerrno>
+#include <mutex>
+#include <new>
+#include <sys/socket.h>
+
+#include "framing.h"
+#include "metrics.h"
+#include "pymodule.h"
+#include "ringbuffer.h"
+
+ /* The FrameReader keeps the bytes received from a peer in a mirrored
+    ring buffer (see ringbuffer.h). Headers are read in place, payloads
+    are checksummed in groups with sha256d_batch, and each payload is
+    given to its handler through the reader's one Payload object, which
+    points at the message in the ring buffer for the duration of the
+    call. Nothing is allocated per message: the Payload exposes the
+    bytes through the buffer protocol (so bytes(), struct.unpack_from()
+    and memoryview() work on it), and only slicing it makes a view.
+    Outside its handler it refuses to export anything, and a handler
+    that returns while something still holds an export (a memoryview
+    or slice of it) fails the dispatch with a BufferError. Until that
+    export is released the ring is left as it is: feed(), recv() and
+    growing it fail with a BufferError, and a reader freed meanwhile
+    leaves the ring to the Payload, so the view never reads memory
+    that was overwritten or freed. Anything kept past the handler has
+    to be copied with bytes() first.
+
+    The strings of the commands in KNOWN_COMMANDS are made once per
+    reader and reused. Any other command is decoded for each message,
+    so made-up commands from a peer cannot take their place.
+ */
+
+#define DEFAULT_CAPACITY (1 << 20)
+
+static const char *const KNOWN_COMMANDS[] = {
+    "version", "verack", "addr", "addrv2", "sendaddrv2", "inv", "getdata", "notfound", "getblocks",
+    "getheaders", "headers", "tx", "block", "getaddr", "mempool", "ping", "pong", "sendheaders",
+    "feefilter", "sendcmpct", "cmpctblock", "getblocktxn", "blocktxn", "merkleblock", "filterload",
+    "filteradd", "filterclear", "getcfilters", "cfilter", "getcfheaders", "cfheaders", "getcfcheckpt",
+    "cfcheckpt", "wtxidrelay", "sendtxrcncl", "reqrecon", "sketch", "reqsketchext", "reconcildiff",
+};
+#define KNOWN_COMMAND_COUNT (sizeof(KNOWN_COMMANDS) / sizeof(*KNOWN_COMMANDS))
+
+static bool get_magic(PyObject *obj, uint8_t magic[4]) {
+    Py_buffer view;
+    if (PyObject_GetBuffer(obj, &view, PyBUF_SIMPLE) < 0)
+        return false;
+    bool ok = view.len == 4;
+    if (ok)
+        std::memcpy(magic, view.buf, 4);
+    else
+        PyErr_SetString(PyExc_ValueError, "magic must be exactly 4 bytes.");
+    PyBuffer_Release(&view);
+    return ok;
+}
+
+static PyObject *sha256d(PyObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    Py_buffer data;
+    if (!check_nargs("sha256d", nargs, 1) || !read_buffer(args[0], &data))
+        return NULL;
+    uint8_t digest[32];
+    METRICS_INC(HASHES);
+    Py_BEGIN_ALLOW_THREADS
+    sha256::sha256d(static_cast<const uint8_t *>(data.buf), data.len, digest);
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&data);
+    return PyBytes_FromStringAndSize(reinterpret_cast<char *>(digest), 32);
+}
+
+static PyObject *checksum(PyObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    Py_buffer data;
+    if (!check_nargs("checksum", nargs, 1) || !read_buffer(args[0], &data))
+        return NULL;
+    uint8_t digest[32];
+    METRICS_INC(HASHES);
+    sha256::sha256d(static_cast<const uint8_t *>(data.buf), data.len, digest);
+    PyBuffer_Release(&data);
+    return PyBytes_FromStringAndSize(reinterpret_cast<char *>(digest), 4);
+}
+
+/**
+ * @brief Collects the buffers of a sequence of bytes-like objects. On
+ * success the caller must release every view in views[0, count).
+ */
+static bool get_buffers(PyObject *seq, Py_buffer *views, Py_ssize_t count, Py_ssize_t item) {
+    for (Py_ssize_t i = 0; i < count; ++i) {
+        PyObject *obj = PySequence_Fast_GET_ITEM(seq, i);
+        if (item >= 0) {
+            if (!PyTuple_Check(obj) || PyTuple_GET_SIZE(obj) != 2) {
+                PyErr_SetString(PyExc_TypeError, "expected (command, payload) pairs.");
+                obj = NULL;
+            } else {
+                obj = PyTuple_GET_ITEM(obj, item);
+            }
+        }
+        if (obj == NULL || PyObject_GetBuffer(obj, &views[i], PyBUF_SIMPLE) < 0) {
+            while (i--)
+                PyBuffer_Release(&views[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Hashes the views in fixed size groups with the multi-buffer
+ * sha256d, writing 32 bytes per view into digests.
+ */
+static void batch_digests(const Py_buffer *views, Py_ssize_t count, uint8_t *digests) {
+    const uint8_t *ptrs[MAX_BATCH];
+    size_t lens[MAX_BATCH];
+    METRICS_ADD(HASHES, count);
+    for (Py_ssize_t base = 0; base < count; base += MAX_BATCH) {
+        Py_ssize_t n = count - base < MAX_BATCH ? count - base : MAX_BATCH;
+        for (Py_ssize_t i = 0; i < n; ++i) {
+            ptrs[i] = static_cast<const uint8_t *>(views[base + i].buf);
+            lens[i] = views[base + i].len;
+        }
+        sha256::sha256d_batch(ptrs, lens, n, digests + 32 * base);
+    }
+}
+
+static PyObject *checksum_batch(PyObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    PyObject *payloads, *seq, *result = NULL;
+    if (!parse_args(args, nargs, "O:checksum_batch", &payloads))
+        return NULL;
+    if (!(seq = PySequence_Fast(payloads, "payloads must be a sequence.")))
+        return NULL;
+    Py_ssize_t count = PySequence_Fast_GET_SIZE(seq);
+    Py_buffer *views = PyMem_New(Py_buffer, count);
+    uint8_t *digests = static_cast<uint8_t *>(PyMem_Malloc(32 * count + 1));
+    if (!views || !digests) {
+        PyErr_NoMemory();
+    } else if (get_buffers(seq, views, count, -1)) {
+        Py_BEGIN_ALLOW_THREADS
+        batch_digests(views, count, digests);
+        Py_END_ALLOW_THREADS
+        for (Py_ssize_t i = 0; i < count; ++i)
+            PyBuffer_Release(&views[i]);
+        if ((result = PyBytes_FromStringAndSize(NULL, 4 * count))) {
+            char *out = PyBytes_AS_STRING(result);
+            for (Py_ssize_t i = 0; i < count; ++i)
+                std::memcpy(out + 4 * i, digests + 32 * i, 4);
+        }
+    }
+    PyMem_Free(views);
+    PyMem_Free(digests);
+    Py_DECREF(seq);
+    return result;
+}
+
+static PyObject *frame(PyObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    PyObject *magic_obj;
+    const char *command;
+    Py_ssize_t command_len;
+    Py_buffer payload;
+    uint8_t magic[4], digest[32];
+    if (!check_nargs("frame", nargs, 3) || !read_str(args[1], &command, &command_len)
+        || !read_buffer(args[2], &payload))
+        return NULL;
+    magic_obj = args[0];
+    PyObject *result = NULL;
+    if (get_magic(magic_obj, magic)) {
+        if (payload.len > UINT32_MAX) {
+            PyErr_SetString(PyExc_OverflowError, "payload is too large.");
+        } else if ((result = PyBytes_FromStringAndSize(NULL, HEADER_SIZE + payload.len))) {
+            uint8_t *out = reinterpret_cast<uint8_t *>(PyBytes_AS_STRING(result));
+            METRICS_INC(HASHES);
+            sha256::sha256d(static_cast<const uint8_t *>(payload.buf), payload.len, digest);
+            if (pack_header(out, magic, command, command_len, (uint32_t)payload.len, digest)) {
+                std::memcpy(out + HEADER_SIZE, payload.buf, payload.len);
+            } else {
+                PyErr_SetString(PyExc_ValueError, "command must be at most 12 bytes.");
+                Py_CLEAR(result);
+            }
+        }
+    }
+    PyBuffer_Release(&payload);
+    return result;
+}
+
+static PyObject *frame_batch(PyObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    PyObject *magic_obj, *messages, *seq, *result = NULL;
+    uint8_t magic[4];
+    if (!parse_args(args, nargs, "OO:frame_batch", &magic_obj, &messages))
+        return NULL;
+    if (!get_magic(magic_obj, magic))
+        return NULL;
+    if (!(seq = PySequence_Fast(messages, "messages must be a sequence.")))
+        return NULL;
+    Py_ssize_t count = PySequence_Fast_GET_SIZE(seq);
+    Py_buffer *views = PyMem_New(Py_buffer, count);
+    uint8_t *digests = static_cast<uint8_t *>(PyMem_Malloc(32 * count + 1));
+    if (!views || !digests) {
+        PyErr_NoMemory();
+    } else if (get_buffers(seq, views, count, 1)) {
+        Py_ssize_t total = 0;
+        for (Py_ssize_t i = 0; i < count; ++i)
+            total += HEADER_SIZE + views[i].len;
+        batch_digests(views, count, digests);
+        if ((result = PyBytes_FromStringAndSize(NULL, total))) {
+            uint8_t *out = reinterpret_cast<uint8_t *>(PyBytes_AS_STRING(result));
+            for (Py_ssize_t i = 0; i < count; ++i) {
+                PyObject *cmd = PyTuple_GET_ITEM(PySequence_Fast_GET_ITEM(seq, i), 0);
+                Py_ssize_t cmd_len;
+                const char *cmd_str = PyUnicode_Check(cmd) ? PyUnicode_AsUTF8AndSize(cmd, &cmd_len) : NULL;
+                if (!cmd_str || views[i].len > UINT32_MAX
+                    || !pack_header(out, magic, cmd_str, cmd_len, (uint32_t)views[i].len, digests + 32 * i)) {
+                    if (!PyErr_Occurred())
+                        PyErr_SetString(PyExc_ValueError, "invalid command or payload.");
+                    Py_CLEAR(result);
+                    break;
+                }
+                std::memcpy(out + HEADER_SIZE, views[i].buf, views[i].len);
+                out += HEADER_SIZE + views[i].len;
+            }
+        }
+        for (Py_ssize_t i = 0; i < count; ++i)
+            PyBuffer_Release(&views[i]);
+    }
+    PyMem_Free(views);
+    PyMem_Free(digests);
+    Py_DECREF(seq);
+    return result;
+}
+
+static PyObject *parse_header(PyObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    Py_buffer data;
+    if (!check_nargs("parse_header", nargs, 1) || !read_buffer(args[0], &data))
+        return NULL;
+    PyObject *result = NULL;
+    if (data.len < HEADER_SIZE) {
+        PyErr_SetString(PyExc_ValueError, "header must be at least 24 bytes.");
+    } else {
+        const uint8_t *p = static_cast<const uint8_t *>(data.buf);
+        result = Py_BuildValue("(y#s#Iy#)", p, (Py_ssize_t)4, p + 4, (Py_ssize_t)command_length(p + 4),
+                               load_le32(p + 16), p + 20, (Py_ssize_t)4);
+    }
+    PyBuffer_Release(&data);
+    return result;
+}
+
+typedef struct {
+    PyObject *frame_reader_type;
+    PyObject *payload_type;
+} NetCodecState;
+
+static NetCodecState *get_state(PyObject *m) {
+    return static_cast<NetCodecState *>(PyModule_GetState(m));
+}
+
+/* Payload type. */
+
+typedef struct {
+    PyObject_HEAD
+    const uint8_t *data;  // NULL outside a handler.
+    Py_ssize_t len;
+    Py_ssize_t exports;
+    RingBuffer *ring;  // The ring of a FrameReader freed while views into it remained.
+} PayloadObject;
+
+static bool Payload_active(PayloadObject *self) {
+    if (self->data)
+        return true;
+    PyErr_SetString(PyExc_ValueError, "payload used after its handler returned, copy it with bytes().");
+    return false;
+}
+
+static int Payload_getbuffer(PayloadObject *self, Py_buffer *view, int flags) {
+    if (!Payload_active(self)) {
+        view->obj = NULL;
+        return -1;
+    }
+    if (PyBuffer_FillInfo(view, reinterpret_cast<PyObject *>(self), const_cast<uint8_t *>(self->data), self->len, 1,
+                          flags) < 0)
+        return -1;
+    ++self->exports;
+    return 0;
+}
+
+static void Payload_releasebuffer(PayloadObject *self, Py_buffer *view) {
+    if (--self->exports == 0 && self->ring) {
+        delete self->ring;
+        self->ring = NULL;
+    }
+}
+
+static Py_ssize_t Payload_length(PayloadObject *self) {
+    return Payload_active(self) ? self->len : -1;
+}
+
+static PyObject *Payload_subscript(PayloadObject *self, PyObject *key) {
+    if (!Payload_active(self))
+        return NULL;
+    if (PyIndex_Check(key)) {
+        Py_ssize_t i = PyNumber_AsSsize_t(key, PyExc_IndexError);
+        if (i == -1 && PyErr_Occurred())
+            return NULL;
+        if (i < 0)
+            i += self->len;
+        if (i < 0 || i >= self->len) {
+            PyErr_SetString(PyExc_IndexError, "payload index out of range.");
+            return NULL;
+        }
+        return PyLong_FromLong(self->data[i]);
+    }
+    /* A slice is a view, which has to be gone by the time the handler returns. */
+    PyObject *view = PyMemoryView_FromObject(reinterpret_cast<PyObject *>(self));
+    if (!view)
+        return NULL;
+    PyObject *result = PyObject_GetItem(view, key);
+    Py_DECREF(view);
+    return result;
+}
+
+static void Payload_dealloc(PayloadObject *self) {
+    delete self->ring;
+    heap_free(reinterpret_cast<PyObject *>(self));
+}
+
+static PyType_Slot Payload_slots[] = {
+    {Py_tp_dealloc, (void *)Payload_dealloc},
+    {Py_tp_doc, (void *)"The payload of the message being dispatched, readable until its handler returns."},
+    {Py_bf_getbuffer, (void *)Payload_getbuffer},
+    {Py_bf_releasebuffer, (void *)Payload_releasebuffer},
+    {Py_sq_length, (void *)Payload_length},
+    {Py_mp_length, (void *)Payload_length},
+    {Py_mp_subscript, (void *)Payload_subscript},
+    {0, NULL}
+};
+
+static PyType_Spec Payload_spec = {
+    "netcodec.Payload",
+    sizeof(PayloadObject),
+    0,
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_DISALLOW_INSTANTIATION,
+    Payload_slots
+};
+
+/* FrameReader type. */
+
+typedef struct {
+    PyObject_HEAD
+    RingBuffer *ring;
+    uint8_t magic[4];
+    uint32_t max_payload;
+    unsigned long long messages;
+    unsigned long long bad_checksums;
+    int dispatching;
+    PyObject *commands[KNOWN_COMMAND_COUNT];  // Strings of KNOWN_COMMANDS, made on first use.
+    PyObject *payload;                        // The Payload every handler is given.
+    std::mutex *mu;  // Guards ring and dispatching; not held while handlers run.
+} FrameReaderObject;
+
+/**
+ * @brief Fails with a BufferError while a handler's view of its payload is
+ * still alive. The view points into the ring, so until it is released the
+ * ring is not written, moved or freed.
+ */
+static bool FrameReader_unpinned(FrameReaderObject *self) {
+    if (!self->payload || reinterpret_cast<PayloadObject *>(self->payload)->exports == 0)
+        return true;
+    PyErr_SetString(PyExc_BufferError, "a view of a payload is still alive, release it first.");
+    return false;
+}
+
+static int FrameReader_init(FrameReaderObject *self, PyObject *args, PyObject *kwds) {
+    static const char *kwlist[] = {"magic", "capacity", "max_payload", NULL};
+    PyObject *magic_obj;
+    Py_ssize_t capacity = DEFAULT_CAPACITY;
+    unsigned long max_payload = DEFAULT_MAX_PAYLOAD;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|nk", const_cast<char **>(kwlist),
+                                     &magic_obj, &capacity, &max_payload))
+        return -1;
+    if (!get_magic(magic_obj, self->magic))
+        return -1;
+    if (capacity < HEADER_SIZE) {
+        PyErr_SetString(PyExc_ValueError, "capacity is too small.");
+        return -1;
+    }
+    if (!self->payload) {
+        PyObject *m = PyType_GetModule(Py_TYPE(self));
+        if (!m)
+            return -1;
+        PyTypeObject *type = reinterpret_cast<PyTypeObject *>(get_state(m)->payload_type);
+        self->payload = type->tp_alloc(type, 0);
+        if (!self->payload)
+            return -1;
+    }
+    if (!self->mu)
+        self->mu = new std::mutex();
+    ObjectLock lock(*self->mu);
+    if (!FrameReader_unpinned(self))
+        return -1;
+    delete self->ring;
+    self->ring = new (std::nothrow) RingBuffer();
+    if (!self->ring || !self->ring->init(capacity)) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    self->max_payload = max_payload > UINT32_MAX ? UINT32_MAX : (uint32_t)max_payload;
+    return 0;
+}
+
+static void FrameReader_dealloc(FrameReaderObject *self) {
+    /* Views of the payload keep the ring alive, through the payload. */
+    PayloadObject *payload = reinterpret_cast<PayloadObject *>(self->payload);
+    if (payload && payload->exports)
+        payload->ring = self->ring;
+    else
+        delete self->ring;
+    for (PyObject *command : self->commands)
+        Py_XDECREF(command);
+    Py_XDECREF(self->payload);
+    delete self->mu;
+    heap_free(reinterpret_cast<PyObject *>(self));
+}
+
+/**
+ * @brief Replaces the ring buffer with a larger one. Only happens when a
+ * peer announces a payload bigger than the current capacity, so the
+ * steady state does not allocate. Called with the lock held.
+ */
+static bool FrameReader_grow(FrameReaderObject *self, size_t needed) {
+    if (!FrameReader_unpinned(self))
+        return false;
+    RingBuffer *ring = new (std::nothrow) RingBuffer();
+    if (!ring || !ring->init(needed)) {
+        delete ring;
+        PyErr_NoMemory();
+        return false;
+    }
+    ring->write(self->ring->read_ptr(), self->ring->size());
+    delete self->ring;
+    self->ring = ring;
+    return true;
+}
+
+static bool FrameReader_writable(FrameReaderObject *self) {
+    if (self->dispatching) {
+        PyErr_SetString(PyExc_RuntimeError, "cannot add data while dispatching.");
+        return false;
+    }
+    if (!FrameReader_unpinned(self))
+        return false;
+    if (self->ring->writable() == 0)
+        return FrameReader_grow(self, 2 * self->ring->capacity());
+    return true;
+}
+
+static PyObject *FrameReader_feed(FrameReaderObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    Py_buffer data;
+    if (!check_nargs("feed", nargs, 1) || !read_buffer(args[0], &data))
+        return NULL;
+    const uint8_t *p = static_cast<const uint8_t *>(data.buf);
+    Py_ssize_t left = data.len;
+    ObjectLock lock(*self->mu);
+    while (left > 0) {
+        if (!FrameReader_writable(self)) {
+            PyBuffer_Release(&data);
+            return NULL;
+        }
+        size_t n = self->ring->write(p, left);
+        p += n, left -= n;
+    }
+    PyBuffer_Release(&data);
+    return PyLong_FromSsize_t(data.len);
+}
+
+static PyObject *FrameReader_recv(FrameReaderObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    int fd;
+    if (!check_nargs("recv", nargs, 1) || !read_i32(args[0], &fd))
+        return NULL;
+    ObjectLock lock(*self->mu);
+    if (!FrameReader_writable(self))
+        return NULL;
+    size_t space = self->ring->writable();
+    uint8_t *dst = self->ring->write_ptr();
+    ssize_t n;
+    Py_BEGIN_ALLOW_THREADS
+    n = ::recv(fd, dst, space, 0);
+    Py_END_ALLOW_THREADS
+    if (n < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return PyLong_FromLong(-1);
+        return PyErr_SetFromErrno(PyExc_OSError);
+    }
+    self->ring->commit(n);
+    return PyLong_FromSsize_t(n);
+}
+
+static PyObject *FrameReader_command(FrameReaderObject *self, const uint8_t *name) {
+    size_t len = command_length(name);
+    for (size_t i = 0; i < KNOWN_COMMAND_COUNT; ++i) {
+        const char *known = KNOWN_COMMANDS[i];
+        if (std::strlen(known) != len || std::memcmp(known, name, len) != 0)
+            continue;
+        if (!self->commands[i])
+            self->commands[i] = PyUnicode_InternFromString(known);
+        return Py_XNewRef(self->commands[i]);
+    }
+    return PyUnicode_DecodeASCII(reinterpret_cast<const char *>(name), len, "replace");
+}
+
+static PyObject *FrameReader_dispatch(FrameReaderObject *self, PyObject *args, PyObject *kwds) {
+    static const char *kwlist[] = {"handlers", "default", NULL};
+    PyObject *handlers, *fallback = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!|O", const_cast<char **>(kwlist),
+                                     &PyDict_Type, &handlers, &fallback))
+        return NULL;
+    {
+        /* Once dispatching is set, feed() and recv() leave the ring
+           alone, so the lock is not needed while the handlers run. */
+        ObjectLock lock(*self->mu);
+        if (self->dispatching) {
+            PyErr_SetString(PyExc_RuntimeError, "dispatch is not reentrant.");
+            return NULL;
+        }
+        self->dispatching = 1;
+    }
+    Frame frames[MAX_BATCH];
+    bool valid[MAX_BATCH];
+    Py_ssize_t dispatched = 0;
+    bool failed = false;
+
+    while (!failed) {
+        /* Gather every complete message currently buffered (up to
+           MAX_BATCH), then checksum them in one multi-buffer pass. */
+        int count;
+        size_t used, needed;
+        FrameStatus status = scan_frames(self->ring->read_ptr(), self->ring->size(), self->magic,
+                                         self->max_payload, frames, MAX_BATCH, &count, &used, &needed);
+        if (status == FRAME_BAD_MAGIC && count == 0) {
+            PyErr_SetString(PyExc_ValueError, "message has the wrong network magic.");
+            failed = true;
+        } else if (status == FRAME_TOO_LARGE && count == 0) {
+            PyErr_SetString(PyExc_ValueError, "payload exceeds the limit.");
+            failed = true;
+        } else if (count == 0 && needed > self->ring->capacity()) {
+            /* Growing moves the buffer, so it only happens once every
+               earlier message has been handed out. */
+            ObjectLock lock(*self->mu);
+            failed = !FrameReader_grow(self, needed);
+        }
+        if (count == 0)
+            break;
+        METRICS_ADD(HASHES, count);
+        check_frames(frames, count, valid);
+
+        size_t consumed = 0;
+        for (int i = 0; i < count && !failed; ++i) {
+            const Frame &f = frames[i];
+            consumed += HEADER_SIZE + f.length;
+            if (!valid[i]) {
+                ++self->bad_checksums;
+                continue;
+            }
+            ++self->messages;
+            PyObject *command = FrameReader_command(self, f.header + 4);
+            if (!command) {
+                failed = true;
+                break;
+            }
+            PyObject *handler = PyDict_GetItemWithError(handlers, command);
+            PyObject *res = NULL;
+            if (handler || (!PyErr_Occurred() && fallback != Py_None)) {
+                PayloadObject *payload = reinterpret_cast<PayloadObject *>(self->payload);
+                Py_ssize_t exports = payload->exports;
+                payload->data = f.payload;
+                payload->len = f.length;
+                if (handler) {
+                    res = PyObject_CallOneArg(handler, self->payload);
+                } else {
+                    PyObject *call_args[] = {command, self->payload};
+                    res = PyObject_Vectorcall(fallback, call_args, 2, NULL);
+                }
+                payload->data = NULL;
+                payload->len = 0;
+                /* A handler that raised keeps its own exception; either way
+                   the ring stays as it is until the view is released. */
+                if (payload->exports > exports && res) {
+                    PyErr_SetString(PyExc_BufferError, "a handler kept a view of its payload, copy it with bytes().");
+                    Py_CLEAR(res);
+                }
+                if (!res)
+                    failed = true;
+                Py_XDECREF(res);
+                ++dispatched;
+            } else if (PyErr_Occurred()) {
+                failed = true;
+            }
+            Py_DECREF(command);
+        }
+        self->ring->consume(consumed);
+    }
+    {
+        ObjectLock lock(*self->mu);
+        self->dispatching = 0;
+    }
+    if (failed)
+        return NULL;
+    return PyLong_FromSsize_t(dispatched);
+}
+
+static PyObject *FrameReader_get_pending(FrameReaderObject *self, void *closure) {
+    ObjectLock lock(*self->mu);
+    return PyLong_FromSize_t(self->ring->size());
+}
+
+static PyObject *FrameReader_get_mirrored(FrameReaderObject *self, void *closure) {
+    ObjectLock lock(*self->mu);
+    return PyBool_FromLong(self->ring->mirrored());
+}
+
+static PyObject *FrameReader_get_capacity(FrameReaderObject *self, void *closure) {
+    ObjectLock lock(*self->mu);
+    return PyLong_FromSize_t(self->ring->capacity());
+}
+
+static PyMethodDef FrameReader_methods[] = {
+    {"feed", (PyCFunction)(void (*)(void))FrameReader_feed, METH_FASTCALL, "Append received bytes to the buffer."},
+    {"recv", (PyCFunction)(void (*)(void))FrameReader_recv, METH_FASTCALL,
+     "Receive directly from a socket file descriptor into the buffer. Returns 0 on EOF, -1 if it would block."},
+    {"dispatch", (PyCFunction)(void (*)(void))FrameReader_dispatch, METH_VARARGS | METH_KEYWORDS,
+     "Call handlers[command](payload) for every complete message, returning the number dispatched."},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyMemberDef FrameReader_members[] = {
+    {"messages", T_ULONGLONG, offsetof(FrameReaderObject, messages), READONLY, "Messages with a valid checksum."},
+    {"bad_checksums", T_ULONGLONG, offsetof(FrameReaderObject, bad_checksums), READONLY,
+     "Messages dropped because of a checksum mismatch."},
+    {NULL}
+};
+
+static PyGetSetDef FrameReader_getset[] = {
+    {"pending", (getter)FrameReader_get_pending, NULL, "Bytes buffered but not yet dispatched.", NULL},
+    {"mirrored", (getter)FrameReader_get_mirrored, NULL, "True if the buffer is double mapped.", NULL},
+    {"capacity", (getter)FrameReader_get_capacity, NULL, "Size of the ring buffer.", NULL},
+    {NULL}
+};
+
+static PyType_Slot FrameReader_slots[] = {
+    {Py_tp_dealloc, (void *)FrameReader_dealloc},
+    {Py_tp_doc, (void *)"Parses framed messages out of a ring buffer."},
+    {Py_tp_methods, FrameReader_methods},
+    {Py_tp_members, FrameReader_members},
+    {Py_tp_getset, FrameReader_getset},
+    {Py_tp_init, (void *)FrameReader_init},
+    {Py_tp_new, (void *)PyType_GenericNew},
+    {0, NULL}
+};
+
+static PyType_Spec FrameReader_spec = {
+    "netcodec.FrameReader",
+    sizeof(FrameReaderObject),
+    0,
+    Py_TPFLAGS_DEFAULT,
+    FrameReader_slots
+};
+
+/* Module. */
+
+static const Backend netcodec_backends[] = {
+    {"hash", "sha256d", "releases_gil"},
+    {NULL, NULL, NULL}
+};
+
+static int netcodec_exec(PyObject *m) {
+    if (module_add_type(m, &Payload_spec, &get_state(m)->payload_type) < 0
+        || module_add_type(m, &FrameReader_spec, &get_state(m)->frame_reader_type) < 0)
+        return -1;
+    return module_add_backends(m, netcodec_backends);
+}
+
+static int netcodec_traverse(PyObject *m, visitproc visit, void *arg) {
+    Py_VISIT(get_state(m)->frame_reader_type);
+    Py_VISIT(get_state(m)->payload_type);
+    return 0;
+}
+
+static int netcodec_clear(PyObject *m) {
+    Py_CLEAR(get_state(m)->frame_reader_type);
+    Py_CLEAR(get_state(m)->payload_type);
+    return 0;
+}
+
+static void netcodec_free(void *m) {
+    netcodec_clear(static_cast<PyObject *>(m));
+}
+
+static PyMethodDef NetCodecMethods[] = {
+    {"sha256d", (PyCFunction)(void (*)(void))sha256d, METH_FASTCALL, "Two rounds of sha256."},
+    {"checksum", (PyCFunction)(void (*)(void))checksum, METH_FASTCALL, "The 4-byte message checksum of a payload."},
+    {"checksum_batch", (PyCFunction)(void (*)(void))checksum_batch, METH_FASTCALL,
+     "Checksums of a sequence of payloads, concatenated (4 bytes each)."},
+    {"frame", (PyCFunction)(void (*)(void))frame, METH_FASTCALL, "Frame a single message (header + payload)."},
+    {"frame_batch", (PyCFunction)(void (*)(void))frame_batch, METH_FASTCALL,
+     "Frame a sequence of (command, payload) pairs into one buffer, checksumming them in batches."},
+    {"parse_header", (PyCFunction)(void (*)(void))parse_header, METH_FASTCALL,
+     "Unpack a header into (magic, command, length, checksum)."},
+    METRICS_METHODS,
+    {NULL, NULL, 0, NULL}
+};
+
+static PyModuleDef_Slot netcodec_slots[] = {
+    {Py_mod_exec, (void *)netcodec_exec},
+    MODULE_SLOTS
+    {0, NULL}
+};
+
+static struct PyModuleDef netcodec = {
+    PyModuleDef_HEAD_INIT,
+    "netcodec",
+    NULL,
+    sizeof(NetCodecState),
+    NetCodecMethods,
+    netcodec_slots,
+    netcodec_traverse,
+    netcodec_clear,
+    netcodec_free
+};
+
+PyMODINIT_FUNC PyInit_netcodec(void) {
+    return PyModuleDef_Init(&netcodec);
+}
@@ -0,0 +1,33 @@
+from typing import Callable, Sequence
+
+def sha256d(data: bytes) -> bytes: ...
+def checksum(payload: bytes) -> bytes: ...
+def checksum_batch(payloads: Sequence[bytes]) -> bytes: ...
+def frame(magic: bytes, command: str, payload: bytes) -> bytes: ...
+def frame_batch(magic: bytes, messages: Sequence[tuple[str, bytes]]) -> bytes: ...
+def parse_header(data: bytes) -> tuple[bytes, str, int, bytes]: ...
+def _metrics() -> dict: ...
+def _metrics_reset() -> None: ...
+def _metrics_enable(flag: bool) -> None: ...
+
+class Payload:
+    def __buffer__(self, flags: int) -> memoryview: ...
+    def __len__(self) -> int: ...
+    def __getitem__(self, key: int | slice) -> int | memoryview: ...
+
+class FrameReader:
+    messages: int
+    bad_checksums: int
+    pending: int
+    mirrored: bool
+    capacity: int
+    def __init__(self, magic: bytes, capacity: int = ..., max_payload: int = ...) -> None: ...
+    def feed(self, data: bytes) -> int: ...
+    def recv(self, fd: int) -> int: ...
+    def dispatch(
+        self,
+        handlers: dict[str, Callable[[Payload], object]],
+        default: Callable[[str, Payload], object] | None = ...,
+    ) -> int: ...
+
+BACKENDS: tuple[tuple[str, str, str], ...]
@@ -0,0 +1,306 @@
+"""Loopback network simulation, so networking can be tested and measured
+without a network. The peersim C++ extension runs any number of fake
+peers that connect to a node over loopback and speak the wire protocol
+(see peersim.cpp); this module prepares what they serve and runs the
+benchmarks.
+
+Blocks are seeded from the JSON files in example_blocks/. Those come
+from a block explorer and leave out the txids of the outputs being
+spent, so the exact raw bytes can only be rebuilt for blocks whose
+transactions spend nothing in earlier blocks (such as the genesis block).
+Elsewhere the outpoints are made up, consistently, from the explorer's
+tx_index. The transactions are still the right size and shape, which is
+what matters here.
+
+Since the example blocks are not a chain, synthetic_chain() builds one:
+their transactions are packed into blocks that link up and are mined at
+the lowest regtest difficulty, so the headers pass header.verify().
+"""
+
+from __future__ import annotations
+
+import itertools
+import json
+import struct
+import tempfile
+import time
+from pathlib import Path
+from typing import Iterable, Sequence
+
+from .blockstore import BlockStore
+from .download import IBD
+from .header import verify
+from .network import MAGIC
+from .node import Node
+from .utils import int_to_vint, read_vint, sha256d
+
+try:
+    from . import peersim  # type: ignore
+except ImportError:
+    peersim = None
+
+EXAMPLE_BLOCKS = Path(__file__).resolve().parent.parent / "example_blocks"
+REGTEST_BITS = 0x207FFFFF
+NULL_OUTPOINT = (0, 0xFFFFFFFF)  # (tx_index, n) of a coinbase input.
+
+
+def tx_from_json(tx: dict, txids: dict[int, bytes] | None = None) -> bytes:
+    """Serializes a transaction. Outpoints are looked up by tx_index in
+    txids (and made up if missing), and the txid of the transaction is
+    added to it."""
+    if txids is None:
+        txids = {}
+    inputs, outputs = tx["inputs"], tx["out"]
+    body = int_to_vint(len(inputs))
+    for i in inputs:
+        prev = i["prev_out"]
+        if (prev["tx_index"], prev["n"]) == NULL_OUTPOINT:
+            prev_hash = bytes(32)
+        else:
+            prev_hash = txids.get(prev["tx_index"]) or sha256d(struct.pack("<Q", prev["tx_index"]))
+        script = bytes.fromhex(i["script"])
+        body += prev_hash + struct.pack("<I", prev["n"]) + int_to_vint(len(script)) + script
+        body += struct.pack("<I", i["sequence"])
+    body += int_to_vint(len(outputs))
+    for o in outputs:
+        script = bytes.fromhex(o["script"])
+        body += struct.pack("<q", o["value"]) + int_to_vint(len(script)) + script
+    version = struct.pack("<I", tx["ver"] & 0xFFFFFFFF)
+    locktime = struct.pack("<I", tx["lock_time"])
+    txids[tx["tx_index"]] = sha256d(version + body + locktime)
+    if not any(i["witness"] for i in inputs):
+        return version + body + locktime
+    witness = b"".join(bytes.fromhex(i["witness"]) or b"\x00" for i in inputs)
+    return version + b"\x00\x01" + body + witness + locktime
+
+
+def header_from_json(block: dict) -> bytes:
+    return struct.pack(
+        "<I32s32sIII",
+        block["ver"],
+        bytes.fromhex(block["prev_block"])[::-1],
+        bytes.fromhex(block["mrkl_root"])[::-1],
+        block["time"],
+        block["bits"],
+        block["nonce"],
+    )
+
+
+def block_from_json(block: dict, txids: dict[int, bytes] | None = None) -> bytes:
+    """Serializes a block (header, transaction count, transactions)."""
+    if txids is None:
+        txids = {}
+    txs = [tx_from_json(tx, txids) for tx in block["tx"]]
+    return header_from_json(block) + int_to_vint(len(txs)) + b"".join(txs)
+
+
+def load_example_blocks(directory: str | Path = EXAMPLE_BLOCKS) -> list[bytes]:
+    """Every example block, serialized, in order of height."""
+    blocks = []
+    for path in Path(directory).glob("*.json"):
+        with open(path) as f:
+            blocks.append(json.load(f))
+    txids: dict[int, bytes] = {}
+    return [block_from_json(block, txids) for block in sorted(blocks, key=lambda b: b["height"])]
+
+
+def example_transactions(directory: str | Path = EXAMPLE_BLOCKS) -> list[bytes]:
+    """The (non-coinbase) transactions of every example block."""
+    txs = []
+    for path in sorted(Path(directory).glob("*.json")):
+        with open(path) as f:
+            block = json.load(f)
+        txids: dict[int, bytes] = {}
+        txs.extend(tx_from_json(tx, txids) for tx in block["tx"][1:])
+    return txs
+
+
+def merkle_root(txids: Sequence[bytes]) -> bytes:
+    level = list(txids)
+    while len(level) > 1:
+        if len(level) % 2:
+            level.append(level[-1])
+        level = [sha256d(level[i] + level[i + 1]) for i in range(0, len(level), 2)]
+    return level[0]
+
+
+def coinbase(height: int) -> bytes:
+    script = int_to_vint(4) + struct.pack("<I", height)
+    return (
+        struct.pack("<I", 1)
+        + int_to_vint(1)
+        + bytes(32)
+        + struct.pack("<I", 0xFFFFFFFF)
+        + int_to_vint(len(script))
+        + script
+        + struct.pack("<I", 0xFFFFFFFF)
+        + int_to_vint(1)
+        + struct.pack("<q", 50 * 10**8)
+        + int_to_vint(1)
+        + b"\x51"  # OP_TRUE
+        + struct.pack("<I", 0)
+    )
+
+
+def synthetic_chain(
+    count: int,
+    transactions: Sequence[bytes] = (),
+    per_block: int = 100,
+    bits: int = REGTEST_BITS,
+    start: int = 1_600_000_000,
+) -> list[bytes]:
+    """A valid chain of count blocks (the first being its genesis block),
+    filled with the given transactions (reused round-robin)."""
+    pool = itertools.cycle(transactions) if transactions else iter(())
+    blocks, previous = [], bytes(32)
+    for height in range(count):
+        txs = [coinbase(height)] + [next(pool) for _ in range(per_block if transactions and height else 0)]
+        root = merkle_root([sha256d(_strip_witness(tx)) for tx in txs])
+        for nonce in itertools.count():
+            header = struct.pack("<I32s32sIII", 1, previous, root, start + 600 * height, bits, nonce)
+            if verify(header):
+                break
+        blocks.append(header + int_to_vint(len(txs)) + b"".join(txs))
+        previous = sha256d(header)
+    return blocks
+
+
+def _strip_witness(tx: bytes) -> bytes:
+    """Serialization of a transaction without its witness (for the txid)."""
+    if tx[4:6] != b"\x00\x01":
+        return tx
+    pos = 6
+    count, pos = read_vint(tx, pos)
+    for _ in range(count):
+        length, pos = read_vint(tx, pos + 36)
+        pos += length + 4
+    count, pos = read_vint(tx, pos)
+    for _ in range(count):
+        length, pos = read_vint(tx, pos + 8)
+        pos += length
+    return tx[:4] + tx[6:pos] + tx[-4:]
+
+
+def seed_store(store: BlockStore, blocks: Iterable[bytes]) -> list[bytes]:
+    return [store.put(block) for block in blocks]
+
+
+class Simulation:
+    """Fake peers serving the blocks of a block store (in the order they
+    were stored). See peersim.Simulator for what the peers do."""
+
+    def __init__(self, store: BlockStore, magic: bytes = MAGIC, threads: int = 1, seed: int = 0) -> None:
+        if peersim is None:
+            raise RuntimeError("the peersim extension has not been built.")
+        self.simulator = peersim.Simulator(magic, threads=threads, seed=seed)
+        for block_hash in store.hashes():
+            location = store.locate(block_hash)
+            header = bytes(store.get(block_hash)[:80])
+            self.simulator.add_block(
+                header, store.fileno(location.file), location.offset, location.size, location.checksum
+            )
+
+    def __enter__(self) -> Simulation:
+        return self
+
+    def __exit__(self, *exc: object) -> None:
+        self.stop()
+
+    def connect(self, host: str, port: int, count: int = 1, **shaping: float) -> list[int]:
+        return self.simulator.connect(host, port, count, **shaping)
+
+    def start(self) -> None:
+        self.simulator.start()
+
+    def stop(self) -> None:
+        self.simulator.stop()
+
+    def stats(self) -> dict[str, float]:
+        return self.simulator.stats()
+
+
+def relay_benchmark(
+    peers: int = 8,
+    seconds: float = 2.0,
+    inv_rate: float = 50.0,
+    tx_per_inv: int = 10,
+    latency: float = 0.0,
+    io_threads: int = 0,
+) -> dict[str, float]:
+    """Floods a relaying node with transaction announcements and measures
+    how fast it passes them on to every other peer."""
+    with tempfile.TemporaryDirectory() as tmp, BlockStore(tmp) as store, Node(io_threads=io_threads) as node:
+        def relay(conn: int, payload: bytes) -> None:
+            for other in list(node.peers):
+                if other != conn:
+                    node.send(other, "inv", payload)
+
+        node.on("inv", relay)
+        port = node.listen("127.0.0.1", 0)
+        with Simulation(store) as sim:
+            sim.connect("127.0.0.1", port, peers, latency=latency, inv_rate=inv_rate, tx_per_inv=tx_per_inv)
+            _wait(lambda: len(node.peers) == peers)
+            sim.start()
+            time.sleep(seconds)
+            stats = sim.stats()
+    stats["node_messages"] = node.loop.stats()["messages"]
+    stats["announced_per_second"] = stats["txs_announced"] / seconds
+    return stats
+
+
+def ibd_benchmark(
+    blocks: Sequence[bytes],
+    peers: int = 4,
+    latency: float = 0.02,
+    bandwidth: float = 0.0,
+    io_threads: int = 0,
+    timeout: float = 120.0,
+) -> dict[str, float]:
+    """Downloads a chain from simulated peers with download.IBD and
+    measures how long it takes."""
+    validated = []
+    with tempfile.TemporaryDirectory() as tmp, BlockStore(tmp) as store, Node(io_threads=io_threads) as node:
+        seed_store(store, blocks)
+        ibd = IBD(node, blocks[0][:80], lambda h, b: validated.append(h), time.monotonic)
+        node.on_connect = lambda conn, name: ibd.add_peer(conn)
+        node.on_disconnect = lambda conn, name: ibd.remove_peer(conn)
+        port = node.listen("127.0.0.1", 0)
+        with Simulation(store) as sim:
+            sim.connect("127.0.0.1", port, peers, latency=latency, bandwidth=bandwidth)
+            sim.start()
+            begin = time.monotonic()
+            _wait(lambda: len(validated) == len(blocks) - 1, timeout, ibd.tick)
+            elapsed = time.monotonic() - begin
+            stats = sim.stats()
+    size = sum(map(len, blocks[1:]))
+    stats.update(
+        seconds=elapsed,
+        validated=len(validated),
+        blocks_per_second=len(validated) / elapsed,
+        megabytes_per_second=size / elapsed / 1e6,
+    )
+    return stats
+
+
+def _wait(condition, timeout: float = 10.0, tick=None) -> None:
+    deadline = time.monotonic() + timeout
+    while not condition():
+        if time.monotonic() > deadline:
+            raise TimeoutError
+        if tick is not None:
+            tick()
+        time.sleep(0.01)
+
+
+def main() -> None:
+    print("relay:")
+    for name, value in relay_benchmark().items():
+        print(f"{name:>24}: {value}")
+    chain = synthetic_chain(200, example_transactions(), per_block=500)
+    print("ibd:")
+    for name, value in ibd_benchmark(chain, latency=0.02, bandwidth=50e6).items():
+        print(f"{name:>24}: {value}")
+
+
+if __name__ == "__main__":
+    main()
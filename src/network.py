@@ -1,9 +1,385 @@
+"""Peer-to-peer networking for Bitcoin. Every message is framed with a
+24-byte header (magic, command, payload length and checksum) followed
+by the payload itself.
+
+Framing is done by the netcodec C++ extension when it has been built,
+and by the pure Python code below otherwise. Both have the same
+interface, so nothing else needs to know which one is in use.
+
+References:
+    - https://en.bitcoin.it/wiki/Protocol_documentation#Message_structure
+"""
+
+from __future__ import annotations
+
+import itertools
+import os
+import queue
+import selectors
 import socket
+import struct
+import threading
+from typing import Any, Callable, Iterable, NamedTuple, Sequence
+
+from .consensus import MAX_BLOCK_SIZE
+from .utils import sha256d
+
+try:
+    from . import netcodec  # type: ignore
+except ImportError:
+    netcodec = None
+
+MAGIC = bytes.fromhex("f9beb4d9")  # Mainnet.
+HEADER_SIZE = 24
+HEADER_FORMAT = "<4s12sI4s"
+
+Handler = Callable[[Any], object]  # Given a bytes-like payload, readable until it returns.
+
+
+def checksum(payload: bytes) -> bytes:
+    """The first 4 bytes of the double sha256 of a payload."""
+    if netcodec is not None:
+        return netcodec.checksum(payload)
+    return sha256d(payload)[:4]
+
+
+def checksums(payloads: Sequence[bytes]) -> list[bytes]:
+    """Checksums of many payloads at once. The native version hashes
+    them in multi-buffer batches, which is a lot faster than hashing
+    small payloads one at a time.
+    """
+    if netcodec is not None:
+        packed = netcodec.checksum_batch(payloads)
+        return [packed[i : i + 4] for i in range(0, len(packed), 4)]
+    return [sha256d(payload)[:4] for payload in payloads]
+
+
+class Header(NamedTuple):
+    magic: bytes
+    command: str
+    length: int
+    checksum: bytes
+
+    @classmethod
+    def from_bytes(cls, data: bytes) -> Header:
+        magic, command, length, check = struct.unpack_from(HEADER_FORMAT, data)
+        command = command.rstrip(b"\x00").decode("ascii", "replace")
+        return cls(magic, command, length, check)
+
+    def __bytes__(self) -> bytes:
+        command = self.command.encode("ascii")
+        return struct.pack(HEADER_FORMAT, self.magic, command, self.length, self.checksum)
 
 
 class Message:
-    def __init__(self) -> None:
-        ...
+    """A single network message (command and payload)."""
+
+    def __init__(self, command: str, payload: bytes = b"", magic: bytes = MAGIC) -> None:
+        if len(command) > 12:
+            raise ValueError("Command must be at most 12 characters.")
+        self.command = command
+        self.payload = payload
+        self.magic = magic
+
+    def __repr__(self) -> str:
+        command, length = self.command, len(self.payload)
+        return f"{self.__class__.__name__}({command=}, {length=})"
+
+    def __eq__(self, other: object) -> bool:
+        if not isinstance(other, Message):
+            return NotImplemented
+        return (self.magic, self.command, self.payload) == (
+            other.magic,
+            other.command,
+            other.payload,
+        )
+
+    def __bytes__(self) -> bytes:
+        if netcodec is not None:
+            return netcodec.frame(self.magic, self.command, self.payload)
+        return bytes(self.header()) + self.payload
+
+    @classmethod
+    def from_bytes(cls, data: bytes) -> Message:
+        header = Header.from_bytes(data)
+        payload = bytes(data[HEADER_SIZE : HEADER_SIZE + header.length])
+        if len(payload) != header.length:
+            raise ValueError("Message is truncated.")
+        if checksum(payload) != header.checksum:
+            raise ValueError("Message has an invalid checksum.")
+        return cls(header.command, payload, header.magic)
+
+    @property
+    def checksum(self) -> bytes:
+        return checksum(self.payload)
+
+    def header(self) -> Header:
+        return Header(self.magic, self.command, len(self.payload), self.checksum)
+
+    def size(self) -> int:
+        return HEADER_SIZE + len(self.payload)
+
+
+def frame_batch(messages: Iterable[Message | tuple[str, bytes]], magic: bytes = MAGIC) -> bytes:
+    """Frames many messages into one buffer, ready to be sent with a
+    single call. Checksums are computed in batches.
+    """
+    pairs = [
+        (m.command, m.payload) if isinstance(m, Message) else tuple(m)
+        for m in messages
+    ]
+    if netcodec is not None:
+        return netcodec.frame_batch(magic, pairs)
+    sums = checksums([payload for _, payload in pairs])
+    return b"".join(
+        bytes(Header(magic, command, len(payload), check)) + payload
+        for (command, payload), check in zip(pairs, sums)
+    )
+
+
+class PyFrameReader:
+    """Pure Python version of netcodec.FrameReader.
+
+    Received bytes are appended with feed() (or recv()), and dispatch()
+    calls handlers[command](payload) for every complete message. The
+    payload is a memoryview that is only valid until the handler returns
+    (netcodec.FrameReader passes a netcodec.Payload, which behaves the
+    same way).
+    """
+
+    def __init__(
+        self,
+        magic: bytes = MAGIC,
+        capacity: int = 1 << 20,
+        max_payload: int = MAX_BLOCK_SIZE,
+    ) -> None:
+        if len(magic) != 4:
+            raise ValueError("magic must be exactly 4 bytes.")
+        self.magic = magic
+        self.capacity = capacity
+        self.max_payload = max_payload
+        self.messages = 0
+        self.bad_checksums = 0
+        self.mirrored = False
+        self._buffer = bytearray()
+        self._dispatching = False
+
+    @property
+    def pending(self) -> int:
+        return len(self._buffer)
+
+    def feed(self, data: bytes) -> int:
+        if self._dispatching:
+            raise RuntimeError("cannot add data while dispatching.")
+        self._buffer += data
+        return len(data)
+
+    def recv(self, fd: int) -> int:
+        """Receives from a socket file descriptor. Returns 0 on EOF and
+        -1 if the call would block."""
+        try:
+            data = os.read(fd, self.capacity)
+        except BlockingIOError:
+            return -1
+        return self.feed(data)
+
+    def dispatch(self, handlers: dict[str, Handler], default: Callable | None = None) -> int:
+        if self._dispatching:
+            raise RuntimeError("dispatch is not reentrant.")
+        buf, offset, dispatched = self._buffer, 0, 0
+        self._dispatching = True
+        try:
+            while len(buf) - offset >= HEADER_SIZE:
+                header = Header.from_bytes(buf[offset : offset + HEADER_SIZE])
+                if header.magic != self.magic:
+                    raise ValueError("message has the wrong network magic.")
+                if header.length > self.max_payload:
+                    raise ValueError(f"payload of {header.length} bytes exceeds the limit.")
+                end = offset + HEADER_SIZE + header.length
+                if end > len(buf):
+                    break
+                start, offset = offset + HEADER_SIZE, end
+                with memoryview(buf)[start:end] as payload:
+                    if sha256d(payload)[:4] != header.checksum:
+                        self.bad_checksums += 1
+                        continue
+                    self.messages += 1
+                    handler = handlers.get(header.command)
+                    if handler is not None:
+                        handler(payload)
+                    elif default is not None:
+                        default(header.command, payload)
+                    else:
+                        continue
+                    dispatched += 1
+        finally:
+            del buf[:offset]
+            self._dispatching = False
+        return dispatched
+
+
+FrameReader = PyFrameReader if netcodec is None else netcodec.FrameReader
+
+EVENT_MESSAGE, EVENT_CONNECTED, EVENT_DISCONNECTED = range(3)
+
+Event = tuple[int, int, str, bytes]
+
+
+class SelectorLoop:
+    """Pure Python stand-in for eventloop.EventLoop.
+
+    Every socket is serviced by a single background thread through the
+    selectors module, which is still much better than a thread per
+    socket, but it cannot use more than one core. Complete messages are
+    queued as (kind, conn, command, payload) tuples for poll().
+    """
+
+    backend = "selectors"
+    threads = 1
+
+    def __init__(self, magic: bytes = MAGIC, threads: int = 0, **kwargs: object) -> None:
+        self.magic = magic
+        self._selector = selectors.DefaultSelector()
+        self._inbox: queue.SimpleQueue[Event] = queue.SimpleQueue()
+        self._commands: queue.SimpleQueue[tuple] = queue.SimpleQueue()
+        self._wake_r, self._wake_w = socket.socketpair()
+        self._wake_r.setblocking(False)
+        self._selector.register(self._wake_r, selectors.EVENT_READ, None)
+        self._conns: dict[int, tuple[socket.socket, PyFrameReader, bytearray]] = {}
+        self._next_id = itertools.count(1)
+        self._stats = dict.fromkeys(("messages", "bad_checksums", "bytes_in", "bytes_out"), 0)
+        self._running = True
+        self._thread = threading.Thread(target=self._run, daemon=True)
+        self._thread.start()
+
+    def listen(self, host: str, port: int, backlog: int = 1024) -> int:
+        server = socket.create_server((host, port), backlog=backlog)
+        server.setblocking(False)
+        self._submit("listen", server)
+        return server.getsockname()[1]
+
+    def add(self, fd: int) -> int:
+        conn = next(self._next_id)
+        self._submit("add", conn, socket.socket(fileno=fd))
+        return conn
+
+    def send(self, conn: int, data: bytes) -> None:
+        self._submit("send", conn, bytes(data))
+
+    def send_message(self, conn: int, command: str, payload: bytes) -> None:
+        self.send(conn, bytes(Message(command, bytes(payload), self.magic)))
+
+    def send_file(self, conn: int, fd: int, offset: int, length: int, header: bytes = b"") -> None:
+        """Queues header followed by a region of a file. Unlike the native
+        loop (which uses sendfile), the region is read into memory here."""
+        if offset < 0 or length <= 0:
+            raise ValueError("invalid connection or file region.")
+        self.send(conn, bytes(header) + os.pread(fd, length, offset))
+
+    def close(self, conn: int) -> None:
+        self._submit("close", conn)
+
+    def poll(self, max_events: int = 64, timeout: float = -1.0) -> list[Event]:
+        events: list[Event] = []
+        try:
+            block = timeout != 0
+            events.append(self._inbox.get(block, None if timeout < 0 else timeout))
+            while len(events) < max_events:
+                events.append(self._inbox.get_nowait())
+        except queue.Empty:
+            pass
+        return events
+
+    def stop(self) -> None:
+        if self._running:
+            self._running = False
+            self._wake_w.send(b"\x00")
+            self._thread.join()
+
+    def stats(self) -> dict[str, int]:
+        return {**self._stats, "connections": len(self._conns), "queued": self._inbox.qsize()}
+
+    def _submit(self, *command: object) -> None:
+        self._commands.put(command)
+        self._wake_w.send(b"\x00")
+
+    def _register(self, conn: int, sock: socket.socket) -> None:
+        sock.setblocking(False)
+        self._conns[conn] = (sock, PyFrameReader(self.magic), bytearray())
+        self._selector.register(sock, selectors.EVENT_READ, conn)
+        host, port, *_ = sock.getpeername()
+        self._inbox.put((EVENT_CONNECTED, conn, "", f"{host}:{port}".encode()))
+
+    def _close(self, conn: int) -> None:
+        sock, *_ = self._conns.pop(conn)
+        self._selector.unregister(sock)
+        sock.close()
+        self._inbox.put((EVENT_DISCONNECTED, conn, "", b""))
+
+    def _flush(self, conn: int) -> None:
+        sock, _, out = self._conns[conn]
+        try:
+            sent = sock.send(out)
+        except BlockingIOError:
+            sent = 0
+        self._stats["bytes_out"] += sent
+        del out[:sent]
+        events = selectors.EVENT_READ | (selectors.EVENT_WRITE if out else 0)
+        self._selector.modify(sock, events, conn)
+
+    def _receive(self, conn: int) -> None:
+        sock, reader, _ = self._conns[conn]
+        data = sock.recv(1 << 16)
+        if not data:
+            raise ConnectionError("peer closed the connection.")
+        self._stats["bytes_in"] += len(data)
+        reader.feed(data)
+        before = reader.bad_checksums
+        reader.dispatch({}, lambda command, payload: self._inbox.put(
+            (EVENT_MESSAGE, conn, command, bytes(payload))
+        ))
+        self._stats["messages"] += reader.messages
+        self._stats["bad_checksums"] += reader.bad_checksums - before
+        reader.messages = 0
+
+    def _run(self) -> None:
+        while self._running:
+            for key, mask in self._selector.select():
+                conn = key.data
+                if key.fileobj is self._wake_r:
+                    self._wake_r.recv(4096)
+                elif isinstance(conn, socket.socket):  # Listener.
+                    client, _ = conn.accept()
+                    self._register(next(self._next_id), client)
+                elif conn in self._conns:
+                    try:
+                        if mask & selectors.EVENT_WRITE:
+                            self._flush(conn)
+                        if mask & selectors.EVENT_READ:
+                            self._receive(conn)
+                    except (OSError, ValueError):
+                        self._close(conn)
+            while not self._commands.empty():
+                name, *args = self._commands.get()
+                if name == "listen":
+                    self._selector.register(args[0], selectors.EVENT_READ, args[0])
+                elif name == "add":
+                    self._register(*args)
+                elif args[0] in self._conns:
+                    try:
+                        if name == "send":
+                            self._conns[args[0]][2].extend(args[1])
+                            self._flush(args[0])
+                        elif name == "close":
+                            self._close(args[0])
+                    except OSError:
+                        self._close(args[0])
+        for conn in list(self._conns):
+            self._conns.pop(conn)[0].close()
+        for key in list(self._selector.get_map().values()):
+            if isinstance(key.data, socket.socket):
+                key.data.close()
+        self._selector.close()
 
 
 def main() -> None:
@@ -1,3 +1,234 @@
+"""A peer-to-peer node. Sockets are serviced by an event loop and
+complete messages are handed to a small pool of validation threads.
+
+When the eventloop extension is built, there is one native I/O thread
+per core (io_uring or epoll), so a node can carry thousands of peers
+without a Python thread per socket. Otherwise network.SelectorLoop
+services every socket from a single Python thread.
+
+A handler that raises on a message (a malformed payload, usually) does
+not stop the node: the error is logged and counts against the peer that
+sent it, which is disconnected once its score reaches MISBEHAVIOR_LIMIT.
+"""
+
+from __future__ import annotations
+
+import logging
+import socket
+import struct
+import threading
+from typing import Callable
+
+from .blockstore import BlockStore, stripped_ranges
+from .network import (
+    EVENT_CONNECTED,
+    EVENT_DISCONNECTED,
+    MAGIC,
+    SelectorLoop,
+)
+from .utils import int_to_vint, read_vint
+
+try:
+    from . import eventloop  # type: ignore
+except ImportError:
+    eventloop = None
+
+log = logging.getLogger(__name__)
+
+MSG_BLOCK = 2
+MSG_WITNESS_BLOCK = 0x40000002
+IPV4_PREFIX = bytes(10) + b"\xff\xff"
+
+MAX_INV = 50_000  # Entries in an inv or getdata message.
+MISBEHAVIOR_PENALTY = 20  # For each message a handler fails on.
+MISBEHAVIOR_LIMIT = 100
+
+MessageHandler = Callable[[int, bytes], None]
+PeerHandler = Callable[[int, str], None]
+
+
+def strip_witnesses(block: bytes) -> bytes:
+    """The serialization of a block without its transactions' witnesses
+    (BIP 144). A block without witnesses comes back unchanged. Blocks in
+    a BlockStore have theirs cached in the index instead."""
+    view = memoryview(block)
+    return b"".join(view[start:end] for start, end in stripped_ranges(block))
+
+
+def make_loop(magic: bytes = MAGIC, threads: int = 0, **kwargs: object):
+    """Returns the native event loop if it is available."""
+    if eventloop is not None:
+        return eventloop.EventLoop(magic, threads=threads, **kwargs)
+    return SelectorLoop(magic, threads=threads)
+
+
 class Node:
-    def __init__(self) -> None:
-        ...
+    def __init__(
+        self,
+        magic: bytes = MAGIC,
+        io_threads: int = 0,
+        validation_threads: int = 1,
+    ) -> None:
+        self.loop = make_loop(magic, io_threads)
+        self.handlers: dict[str, MessageHandler] = {}
+        self.on_connect: PeerHandler | None = None
+        self.on_disconnect: PeerHandler | None = None
+        self.peers: dict[int, str] = {}
+        self.misbehavior: dict[int, int] = {}
+        self._getaddr_answered: set[int] = set()
+        self._lock = threading.Lock()
+        self._running = False
+        self._workers = [
+            threading.Thread(target=self._validate, daemon=True)
+            for _ in range(validation_threads)
+        ]
+
+    def __enter__(self) -> Node:
+        self.start()
+        return self
+
+    def __exit__(self, *exc: object) -> None:
+        self.stop()
+
+    def on(self, command: str, handler: MessageHandler) -> None:
+        """Registers handler(conn, payload) for a command."""
+        self.handlers[command] = handler
+
+    def listen(self, host: str = "", port: int = 8333) -> int:
+        return self.loop.listen(host, port)
+
+    def connect(self, host: str, port: int = 8333, timeout: float = 10.0) -> int:
+        sock = socket.create_connection((host, port), timeout=timeout)
+        return self.loop.add(sock.detach())
+
+    def send(self, conn: int, command: str, payload: bytes = b"") -> None:
+        self.loop.send_message(conn, command, payload)
+
+    def broadcast(self, command: str, payload: bytes = b"") -> None:
+        with self._lock:
+            peers = list(self.peers)
+        for conn in peers:
+            self.send(conn, command, payload)
+
+    def serve_blocks(self, store: BlockStore) -> None:
+        """Answers getdata requests for blocks from a block store. Blocks
+        asked for with MSG_WITNESS_BLOCK are sent straight from the block
+        files (sendfile with the native loop), using the checksum kept in
+        the store's index. So are those asked for with MSG_BLOCK when they
+        have no witnesses; the others are joined from the runs of the
+        stripped block listed in the index, with no parsing."""
+
+        def getdata(conn: int, payload: bytes) -> None:
+            count, offset = read_vint(payload) if payload else (0, 1)
+            if count > MAX_INV or len(payload) != offset + 36 * count:
+                raise ValueError("malformed getdata message.")
+            missing = []
+            for _ in range(count):
+                kind, block_hash = struct.unpack_from("<I32s", payload, offset)
+                offset += 36
+                location = store.locate(block_hash)
+                if kind not in {MSG_BLOCK, MSG_WITNESS_BLOCK} or location is None:
+                    missing.append(payload[offset - 36 : offset])
+                    continue
+                if kind == MSG_BLOCK and location.range_count:
+                    header = store.message_header(block_hash, witness=False)
+                    self.loop.send(conn, header + store.get(block_hash, witness=False))
+                    continue
+                header = store.message_header(block_hash)
+                fd = store.fileno(location.file)
+                self.loop.send_file(conn, fd, location.offset, location.size, header)
+            if missing:
+                self.send(conn, "notfound", int_to_vint(len(missing)) + b"".join(missing))
+
+        self.on("getdata", getdata)
+
+    def track_addresses(self, addrman) -> None:
+        """Feeds addresses from addr messages into an address manager
+        (addrman.AddrMan), with the sending peer as their source, and
+        answers the first getaddr of each connection with a sample of it
+        (later ones are ignored, as in Bitcoin Core)."""
+
+        def addr(conn: int, payload: bytes) -> None:
+            with self._lock:
+                source = self.peers.get(conn, "").rpartition(":")[0]
+            count, offset = read_vint(payload)
+            entries = []
+            for _ in range(min(count, 1000)):
+                time, services, ip = struct.unpack_from("<IQ16s", payload, offset)
+                (port,) = struct.unpack_from(">H", payload, offset + 28)
+                offset += 30
+                if ip[:12] == IPV4_PREFIX:
+                    host = socket.inet_ntop(socket.AF_INET, ip[12:])
+                else:
+                    host = socket.inet_ntop(socket.AF_INET6, ip)
+                entries.append((host, port, services, time))
+            addrman.add_many(entries, source.strip("[]") or "0.0.0.0")
+
+        def getaddr(conn: int, payload: bytes) -> None:
+            with self._lock:
+                if conn in self._getaddr_answered:
+                    return
+                self._getaddr_answered.add(conn)
+            entries = []
+            for host, port, services, time in addrman.addresses():
+                if ":" in host:
+                    ip = socket.inet_pton(socket.AF_INET6, host)
+                else:
+                    ip = IPV4_PREFIX + socket.inet_pton(socket.AF_INET, host)
+                entries.append(struct.pack("<IQ16s", time, services, ip) + struct.pack(">H", port))
+            self.send(conn, "addr", int_to_vint(len(entries)) + b"".join(entries))
+
+        self.on("addr", addr)
+        self.on("getaddr", getaddr)
+
+    def disconnect(self, conn: int) -> None:
+        self.loop.close(conn)
+
+    def misbehaving(self, conn: int, score: int) -> None:
+        """Adds to a peer's misbehavior score, disconnecting it once the
+        score reaches MISBEHAVIOR_LIMIT."""
+        with self._lock:
+            total = self.misbehavior[conn] = self.misbehavior.get(conn, 0) + score
+        if total >= MISBEHAVIOR_LIMIT:
+            log.info("disconnecting peer %d, misbehavior score %d", conn, total)
+            self.disconnect(conn)
+
+    def start(self) -> None:
+        self._running = True
+        for worker in self._workers:
+            worker.start()
+
+    def stop(self) -> None:
+        self._running = False
+        for worker in self._workers:
+            if worker.is_alive():
+                worker.join()
+        self.loop.stop()
+
+    def _validate(self) -> None:
+        while self._running:
+            for kind, conn, command, payload in self.loop.poll(64, 0.1):
+                if kind == EVENT_CONNECTED:
+                    with self._lock:
+                        self.peers[conn] = payload.decode()
+                    if self.on_connect is not None:
+                        try:
+                            self.on_connect(conn, payload.decode())
+                        except Exception:
+                            log.warning("on_connect failed for peer %d", conn, exc_info=True)
+                elif kind == EVENT_DISCONNECTED:
+                    with self._lock:
+                        name = self.peers.pop(conn, "")
+                        self.misbehavior.pop(conn, None)
+                        self._getaddr_answered.discard(conn)
+                    if self.on_disconnect is not None:
+                        try:
+                            self.on_disconnect(conn, name)
+                        except Exception:
+                            log.warning("on_disconnect failed for peer %d", conn, exc_info=True)
+                elif (handler := self.handlers.get(command)) is not None:
+                    try:
+                        handler(conn, payload)
+                    except Exception:
+                        log.warning("peer %d sent a %s message that failed", conn, command, exc_info=True)
+                        self.misbehaving(conn, MISBEHAVIOR_PENALTY)
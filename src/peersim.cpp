@@ -0,0 +1,1108 @@
+/**
+ * @file peersim.cpp
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief C++ Python Extension simulating many peers over loopback.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "framing.h"
+#include "poller.h"
+#include "pymodule.h"
+#include "ringbuffer.h"
+
+ /* Fake peers for testing a node without a network. Every peer is a TCP
+    connection to the node under test that speaks the wire protocol:
+
+        - it sends version on start and answers version with verack and
+          ping with pong,
+        - it serves headers (getheaders) and blocks (getdata) from the
+          blocks added with add_block(), which are read straight from
+          the block files of a blockstore.BlockStore,
+        - it floods the node with inv and tx messages for made up
+          transactions at a fixed rate, and serves them on getdata.
+
+    Everything a peer sends is shaped: a message occupies the peer's
+    link for size / bandwidth seconds and arrives latency seconds after
+    it has been sent. Messages are held back in a per-peer queue until
+    they are due, and a timerfd wakes the I/O thread for the earliest
+    one (so shaping works with both poller backends).
+
+    Relay latency is measured with the flooded transactions: the time a
+    transaction is announced by one peer is remembered, and every other
+    peer that is later told about it (inv or tx) records how long it took.
+
+    Peers are spread over a few I/O threads. A peer never changes thread,
+    so only the shared transaction pool needs a lock.
+ */
+
+#define DEFAULT_CAPACITY (256 * 1024)
+#define MAX_SEND_BUFFER (256 * 1024 * 1024)
+#define MAX_HEADERS 2000
+#define MAX_WORKERS 64
+#define TX_POOL (1 << 17)
+#define MAX_SAMPLES (1 << 20)
+#define MAX_CATCH_UP 1000  // Timer ticks made up for at once.
+#define WAKE_TOKEN 0
+#define TIMER_TOKEN 1
+#define PEER_TOKEN 2  // Peer tokens are PEER_TOKEN + peer id.
+
+#define MSG_TX 1
+#define MSG_BLOCK 2
+#define PROTOCOL_VERSION 70016
+#define USER_AGENT "/pycoin-peersim:0.1/"
+
+typedef std::array<uint8_t, 32> Hash;
+
+struct HashHasher {
+    size_t operator()(const Hash &h) const {
+        size_t v;
+        std::memcpy(&v, h.data(), sizeof(v));
+        return v;
+    }
+};
+
+struct BlockRef {
+    int fd;
+    off_t offset;
+    uint32_t size;
+    uint8_t checksum[4];
+};
+
+struct TxEntry {
+    std::vector<uint8_t> tx;
+    uint32_t origin;
+    uint64_t sent;
+};
+
+struct Outgoing {
+    uint64_t due;
+    std::vector<uint8_t> data;
+};
+
+struct PeerConfig {
+    uint64_t latency;   // Nanoseconds.
+    double bandwidth;   // Bytes per second, 0 for unlimited.
+    double inv_rate;    // inv messages per second.
+    int tx_per_inv;
+    double tx_rate;     // tx messages per second.
+};
+
+struct Peer {
+    uint32_t id;
+    int fd;
+    PeerConfig config;
+    std::unique_ptr<RingBuffer> rx, tx;
+    std::deque<Outgoing> delayed;
+    uint64_t link_free = 0, next_inv = 0, next_tx = 0;
+    bool want_write = false;
+    bool closed = false;
+};
+
+struct Sim;
+
+typedef std::pair<uint64_t, uint32_t> Timer;  // (due, peer id)
+
+struct Worker {
+    Sim *sim;
+    int index;
+    std::thread thread;
+    Poller poller;
+    int wakefd = -1, timerfd = -1;
+    uint64_t armed = 0;
+    std::mt19937_64 rng;
+    std::vector<std::unique_ptr<Peer>> peers;
+    std::unordered_map<uint32_t, Peer *> by_id;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+};
+
+struct Sim {
+    uint8_t magic[4];
+    uint64_t seed;
+    std::vector<std::array<uint8_t, 80>> headers;
+    std::unordered_map<Hash, uint32_t, HashHasher> heights;
+    std::unordered_map<Hash, BlockRef, HashHasher> blocks;
+    std::unordered_map<int, int> fds;  // Caller's descriptor -> our duplicate.
+    std::vector<std::unique_ptr<Worker>> workers;
+    uint32_t next_peer = 0;
+    bool started = false;
+    std::mutex setup;  // Guards all of the above until start(), when the workers take over.
+    std::atomic<bool> stopping{false};
+    std::atomic<uint64_t> tx_counter{0};
+
+    std::mutex mu;  // Guards the transaction pool and the samples.
+    std::unordered_map<Hash, TxEntry, HashHasher> pool;
+    std::deque<Hash> pool_order;
+    std::vector<uint32_t> samples;  // Relay latencies in microseconds.
+
+    std::atomic<uint64_t> messages_in{0}, messages_out{0}, bytes_in{0}, bytes_out{0}, bad_checksums{0},
+        headers_served{0}, blocks_served{0}, txs_announced{0}, txs_sent{0}, txs_heard{0}, disconnected{0};
+};
+
+static uint64_t now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void put_le(std::vector<uint8_t> &out, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i)
+        out.push_back((uint8_t)(v >> (8 * i)));
+}
+
+static void put_vint(std::vector<uint8_t> &out, uint64_t v) {
+    if (v < 0xFD) {
+        out.push_back((uint8_t)v);
+    } else if (v <= 0xFFFF) {
+        out.push_back(0xFD);
+        put_le(out, v, 2);
+    } else if (v <= 0xFFFFFFFF) {
+        out.push_back(0xFE);
+        put_le(out, v, 4);
+    } else {
+        out.push_back(0xFF);
+        put_le(out, v, 8);
+    }
+}
+
+static bool get_vint(const uint8_t *data, size_t len, size_t &pos, uint64_t &v) {
+    if (pos >= len)
+        return false;
+    uint8_t first = data[pos++];
+    int bytes = first == 0xFD ? 2 : first == 0xFE ? 4 : first == 0xFF ? 8 : 0;
+    if (bytes == 0) {
+        v = first;
+        return true;
+    }
+    if (len - pos < (size_t)bytes)
+        return false;
+    v = 0;
+    for (int i = 0; i < bytes; ++i)
+        v |= (uint64_t)data[pos + i] << (8 * i);
+    pos += bytes;
+    return true;
+}
+
+static bool grow(std::unique_ptr<RingBuffer> &ring, size_t needed) {
+    std::unique_ptr<RingBuffer> bigger(new (std::nothrow) RingBuffer());
+    if (!bigger || !bigger->init(needed))
+        return false;
+    bigger->write(ring->read_ptr(), ring->size());
+    ring.swap(bigger);
+    return true;
+}
+
+static void arm(Worker *w, uint64_t due) {
+    itimerspec spec{};
+    spec.it_value.tv_sec = due / 1000000000ull;
+    spec.it_value.tv_nsec = due % 1000000000ull;
+    if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0)
+        spec.it_value.tv_nsec = 1;  // Zero would disarm the timer.
+    timerfd_settime(w->timerfd, TFD_TIMER_ABSTIME, &spec, nullptr);
+    w->armed = due;
+}
+
+static void schedule(Worker *w, uint64_t due, uint32_t peer) {
+    w->timers.push(Timer{due, peer});
+    if (w->armed == 0 || due < w->armed)
+        arm(w, due);
+}
+
+static void close_peer(Worker *w, Peer *p) {
+    if (p->closed)
+        return;
+    w->poller.remove(p->fd, PEER_TOKEN + p->id);
+    close(p->fd);
+    p->closed = true;
+    p->delayed.clear();
+    w->sim->disconnected.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Writes as much of the send buffer as the socket takes. Returns
+ * false if the connection failed.
+ */
+static bool flush(Worker *w, Peer *p) {
+    RingBuffer &tx = *p->tx;
+    while (!tx.empty()) {
+        ssize_t n = send(p->fd, tx.read_ptr(), tx.size(), MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                return false;
+            if (!p->want_write) {
+                p->want_write = true;
+                w->poller.want_write(p->fd, PEER_TOKEN + p->id, true);
+            }
+            return true;
+        }
+        tx.consume(n);
+        w->sim->bytes_out.fetch_add(n, std::memory_order_relaxed);
+    }
+    if (p->want_write) {
+        p->want_write = false;
+        w->poller.want_write(p->fd, PEER_TOKEN + p->id, false);
+    }
+    return true;
+}
+
+static bool release(Worker *w, Peer *p, const std::vector<uint8_t> &data) {
+    RingBuffer &tx = *p->tx;
+    if (tx.capacity() - tx.size() < data.size()) {
+        size_t needed = tx.size() + data.size();
+        if (needed > MAX_SEND_BUFFER || !grow(p->tx, needed))
+            return false;
+    }
+    p->tx->write(data.data(), data.size());
+    w->sim->messages_out.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+/**
+ * @brief Queues a framed message behind the peer's shaped link. Returns
+ * when the message will arrive at the node.
+ */
+static uint64_t queue_frame(Worker *w, Peer *p, std::vector<uint8_t> data, uint64_t now) {
+    uint64_t due = now;
+    if (p->config.bandwidth > 0) {
+        uint64_t start = std::max(now, p->link_free);
+        p->link_free = start + (uint64_t)(data.size() * 1e9 / p->config.bandwidth);
+        due = p->link_free;
+    }
+    due += p->config.latency;
+    if (due <= now && p->delayed.empty()) {
+        if (!release(w, p, data))
+            close_peer(w, p);
+        return due;
+    }
+    if (p->delayed.empty())
+        schedule(w, due, p->id);
+    p->delayed.push_back(Outgoing{due, std::move(data)});
+    return due;
+}
+
+static uint64_t send_message(Worker *w, Peer *p, const char *command, const std::vector<uint8_t> &payload,
+                             uint64_t now) {
+    std::vector<uint8_t> data(HEADER_SIZE + payload.size());
+    uint8_t digest[32];
+    sha256::sha256d(payload.data(), payload.size(), digest);
+    pack_header(data.data(), w->sim->magic, command, std::strlen(command), (uint32_t)payload.size(), digest);
+    if (!payload.empty())
+        std::memcpy(data.data() + HEADER_SIZE, payload.data(), payload.size());
+    return queue_frame(w, p, std::move(data), now);
+}
+
+static std::vector<uint8_t> version_payload(Sim *sim, uint64_t nonce) {
+    std::vector<uint8_t> out;
+    put_le(out, PROTOCOL_VERSION, 4);
+    put_le(out, 1, 8);  // NODE_NETWORK
+    put_le(out, (uint64_t)time(nullptr), 8);
+    for (int i = 0; i < 2; ++i) {  // addr_recv and addr_from, left empty.
+        put_le(out, 1, 8);
+        out.insert(out.end(), 16, 0);
+        put_le(out, 0, 2);
+    }
+    put_le(out, nonce, 8);
+    put_vint(out, sizeof(USER_AGENT) - 1);
+    out.insert(out.end(), USER_AGENT, USER_AGENT + sizeof(USER_AGENT) - 1);
+    put_le(out, sim->headers.empty() ? 0 : sim->headers.size() - 1, 4);
+    out.push_back(1);  // relay
+    return out;
+}
+
+/**
+ * @brief Makes up a fresh transaction (one input spending a random
+ * outpoint, one P2WPKH output) and adds it to the pool.
+ */
+static Hash new_transaction(Worker *w, Peer *p, uint64_t arrival) {
+    Sim *sim = w->sim;
+    std::vector<uint8_t> tx;
+    put_le(tx, 2, 4);
+    tx.push_back(1);
+    for (int i = 0; i < 4; ++i)
+        put_le(tx, w->rng(), 8);
+    put_le(tx, sim->tx_counter.fetch_add(1, std::memory_order_relaxed), 4);
+    tx.push_back(0);
+    put_le(tx, 0xFFFFFFFF, 4);
+    tx.push_back(1);
+    put_le(tx, 1000 + w->rng() % 100000, 8);
+    tx.push_back(22);
+    tx.push_back(0x00);
+    tx.push_back(0x14);
+    for (int i = 0; i < 20; ++i)
+        tx.push_back((uint8_t)w->rng());
+    put_le(tx, 0, 4);
+    Hash txid;
+    sha256::sha256d(tx.data(), tx.size(), txid.data());
+    std::lock_guard<std::mutex> lock(sim->mu);
+    sim->pool[txid] = TxEntry{std::move(tx), p->id, arrival};
+    sim->pool_order.push_back(txid);
+    if (sim->pool_order.size() > TX_POOL) {
+        sim->pool.erase(sim->pool_order.front());
+        sim->pool_order.pop_front();
+    }
+    return txid;
+}
+
+static void heard(Worker *w, Peer *p, const uint8_t *txid, uint64_t now) {
+    Sim *sim = w->sim;
+    Hash key;
+    std::memcpy(key.data(), txid, 32);
+    sim->txs_heard.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(sim->mu);
+    auto it = sim->pool.find(key);
+    if (it != sim->pool.end() && it->second.origin != p->id && now > it->second.sent
+        && sim->samples.size() < MAX_SAMPLES)
+        sim->samples.push_back((uint32_t)std::min<uint64_t>((now - it->second.sent) / 1000, UINT32_MAX));
+}
+
+static void flood(Worker *w, Peer *p, uint64_t now) {
+    Sim *sim = w->sim;
+    if (p->config.inv_rate > 0) {
+        uint64_t interval = (uint64_t)(1e9 / p->config.inv_rate);
+        for (int i = 0; i < MAX_CATCH_UP && p->next_inv <= now; ++i) {
+            p->next_inv += interval ? interval : 1;
+            std::vector<uint8_t> inv;
+            std::vector<Hash> txids;
+            put_vint(inv, p->config.tx_per_inv);
+            /* The arrival time is only known once the message is queued,
+               so the entries are stamped afterwards. */
+            for (int j = 0; j < p->config.tx_per_inv; ++j) {
+                txids.push_back(new_transaction(w, p, UINT64_MAX));
+                put_le(inv, MSG_TX, 4);
+                inv.insert(inv.end(), txids.back().begin(), txids.back().end());
+            }
+            uint64_t due = send_message(w, p, "inv", inv, now);
+            std::lock_guard<std::mutex> lock(sim->mu);
+            for (const Hash &txid : txids) {
+                auto it = sim->pool.find(txid);
+                if (it != sim->pool.end())
+                    it->second.sent = due;
+            }
+            sim->txs_announced.fetch_add(p->config.tx_per_inv, std::memory_order_relaxed);
+        }
+    }
+    if (p->config.tx_rate > 0) {
+        uint64_t interval = (uint64_t)(1e9 / p->config.tx_rate);
+        for (int i = 0; i < MAX_CATCH_UP && p->next_tx <= now; ++i) {
+            p->next_tx += interval ? interval : 1;
+            Hash txid = new_transaction(w, p, UINT64_MAX);
+            std::vector<uint8_t> tx;
+            {
+                std::lock_guard<std::mutex> lock(sim->mu);
+                tx = sim->pool[txid].tx;
+            }
+            uint64_t due = send_message(w, p, "tx", tx, now);
+            std::lock_guard<std::mutex> lock(sim->mu);
+            auto it = sim->pool.find(txid);
+            if (it != sim->pool.end())
+                it->second.sent = due;
+            sim->txs_sent.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * @brief Releases whatever is due, sends flood messages and schedules
+ * the peer's next wake up.
+ */
+static void tick(Worker *w, Peer *p, uint64_t now) {
+    if (p->closed)
+        return;
+    flood(w, p, now);
+    while (!p->closed && !p->delayed.empty() && p->delayed.front().due <= now) {
+        if (!release(w, p, p->delayed.front().data)) {
+            close_peer(w, p);
+            return;
+        }
+        p->delayed.pop_front();
+    }
+    if (p->closed || !flush(w, p)) {
+        close_peer(w, p);
+        return;
+    }
+    uint64_t next = UINT64_MAX;
+    if (!p->delayed.empty())
+        next = p->delayed.front().due;
+    if (p->config.inv_rate > 0)
+        next = std::min(next, p->next_inv);
+    if (p->config.tx_rate > 0)
+        next = std::min(next, p->next_tx);
+    if (next != UINT64_MAX)
+        schedule(w, next, p->id);
+}
+
+static void serve_headers(Worker *w, Peer *p, const uint8_t *payload, size_t len, uint64_t now) {
+    Sim *sim = w->sim;
+    size_t pos = 4;
+    uint64_t count;
+    if (len < 4 || !get_vint(payload, len, pos, count) || len - pos < 32 * (count + 1))
+        return;
+    size_t start = 0;
+    for (uint64_t i = 0; i < count; ++i, pos += 32) {
+        Hash h;
+        std::memcpy(h.data(), payload + pos, 32);
+        auto it = sim->heights.find(h);
+        if (it != sim->heights.end()) {
+            start = it->second + 1;
+            break;
+        }
+    }
+    Hash stop;
+    std::memcpy(stop.data(), payload + len - 32, 32);
+    std::vector<uint8_t> out;
+    size_t end = std::min(sim->headers.size(), start + MAX_HEADERS);
+    auto it = sim->heights.find(stop);
+    if (it != sim->heights.end() && it->second + 1 < end)
+        end = std::max(start, (size_t)it->second + 1);
+    put_vint(out, end - start);
+    for (size_t i = start; i < end; ++i) {
+        out.insert(out.end(), sim->headers[i].begin(), sim->headers[i].end());
+        out.push_back(0);  // Transaction count.
+    }
+    sim->headers_served.fetch_add(end - start, std::memory_order_relaxed);
+    send_message(w, p, "headers", out, now);
+}
+
+static void serve_data(Worker *w, Peer *p, const uint8_t *payload, size_t len, uint64_t now) {
+    Sim *sim = w->sim;
+    size_t pos = 0;
+    uint64_t count;
+    if (!get_vint(payload, len, pos, count) || len - pos < 36 * count)
+        return;
+    std::vector<uint8_t> missing;
+    uint64_t missed = 0;
+    for (uint64_t i = 0; i < count && !p->closed; ++i, pos += 36) {
+        uint32_t type = load_le32(payload + pos) & 0x7FFFFFFF;  // Without the witness flag.
+        Hash h;
+        std::memcpy(h.data(), payload + pos + 4, 32);
+        if (type == MSG_BLOCK) {
+            auto it = sim->blocks.find(h);
+            if (it != sim->blocks.end()) {
+                const BlockRef &b = it->second;
+                std::vector<uint8_t> data(HEADER_SIZE + b.size);
+                ssize_t n = pread(b.fd, data.data() + HEADER_SIZE, b.size, b.offset);
+                if (n == (ssize_t)b.size) {
+                    /* The checksum comes from the block store's index, so
+                       blocks are not hashed again here. */
+                    pack_header(data.data(), sim->magic, "block", 5, b.size, b.checksum);
+                    queue_frame(w, p, std::move(data), now);
+                    sim->blocks_served.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+            }
+        } else if (type == MSG_TX) {
+            std::vector<uint8_t> tx;
+            {
+                std::lock_guard<std::mutex> lock(sim->mu);
+                auto it = sim->pool.find(h);
+                if (it != sim->pool.end())
+                    tx = it->second.tx;
+            }
+            if (!tx.empty()) {
+                send_message(w, p, "tx", tx, now);
+                continue;
+            }
+        }
+        missing.insert(missing.end(), payload + pos, payload + pos + 36);
+        ++missed;
+    }
+    if (missed) {
+        std::vector<uint8_t> out;
+        put_vint(out, missed);
+        out.insert(out.end(), missing.begin(), missing.end());
+        send_message(w, p, "notfound", out, now);
+    }
+}
+
+static void handle(Worker *w, Peer *p, const Frame &f, uint64_t now) {
+    const uint8_t *command = f.header + 4;
+    size_t n = command_length(command);
+    auto is = [&](const char *name) { return n == std::strlen(name) && std::memcmp(command, name, n) == 0; };
+    if (is("version")) {
+        send_message(w, p, "verack", {}, now);
+    } else if (is("ping")) {
+        send_message(w, p, "pong", std::vector<uint8_t>(f.payload, f.payload + f.length), now);
+    } else if (is("getheaders")) {
+        serve_headers(w, p, f.payload, f.length, now);
+    } else if (is("getdata")) {
+        serve_data(w, p, f.payload, f.length, now);
+    } else if (is("inv")) {
+        size_t pos = 0;
+        uint64_t count;
+        if (!get_vint(f.payload, f.length, pos, count) || f.length - pos < 36 * count)
+            return;
+        for (uint64_t i = 0; i < count; ++i, pos += 36) {
+            if ((load_le32(f.payload + pos) & 0x7FFFFFFF) == MSG_TX)
+                heard(w, p, f.payload + pos + 4, now);
+        }
+    } else if (is("tx")) {
+        uint8_t txid[32];
+        sha256::sha256d(f.payload, f.length, txid);
+        heard(w, p, txid, now);
+    }
+}
+
+/**
+ * @brief Reads and handles every complete message. Returns false if the
+ * connection should be closed.
+ */
+static bool receive(Worker *w, Peer *p) {
+    Sim *sim = w->sim;
+    for (;;) {
+        size_t space = p->rx->writable();
+        if (space == 0 && !grow(p->rx, 2 * p->rx->capacity()))
+            return false;
+        space = p->rx->writable();
+        ssize_t n = recv(p->fd, p->rx->write_ptr(), space, 0);
+        if (n == 0)
+            return false;
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            return false;
+        }
+        p->rx->commit(n);
+        sim->bytes_in.fetch_add(n, std::memory_order_relaxed);
+    }
+    uint64_t now = now_ns();
+    Frame frames[MAX_BATCH];
+    bool valid[MAX_BATCH];
+    for (;;) {
+        int count;
+        size_t used, needed;
+        FrameStatus status = scan_frames(p->rx->read_ptr(), p->rx->size(), sim->magic, DEFAULT_MAX_PAYLOAD, frames,
+                                         MAX_BATCH, &count, &used, &needed);
+        if (count == 0) {
+            if (status != FRAME_OK)
+                return false;
+            if (needed > p->rx->capacity())
+                return grow(p->rx, needed);
+            break;
+        }
+        check_frames(frames, count, valid);
+        for (int i = 0; i < count && !p->closed; ++i) {
+            if (!valid[i]) {
+                sim->bad_checksums.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            sim->messages_in.fetch_add(1, std::memory_order_relaxed);
+            handle(w, p, frames[i], now);
+        }
+        p->rx->consume(used);
+        if (p->closed)
+            return true;
+    }
+    return flush(w, p);
+}
+
+static void worker_main(Worker *w) {
+    uint64_t start = now_ns();
+    for (auto &p : w->peers) {
+        /* Start flooding at a random point of the first interval, so the
+           peers do not all send at the same moment. */
+        if (p->config.inv_rate > 0)
+            p->next_inv = start + w->rng() % (uint64_t)(1e9 / p->config.inv_rate + 1);
+        if (p->config.tx_rate > 0)
+            p->next_tx = start + w->rng() % (uint64_t)(1e9 / p->config.tx_rate + 1);
+        send_message(w, p.get(), "version", version_payload(w->sim, w->rng()), start);
+        tick(w, p.get(), start);
+        if (!p->closed && !flush(w, p.get()))
+            close_peer(w, p.get());
+    }
+    PollEvent events[256];
+    while (!w->sim->stopping.load()) {
+        int n = w->poller.wait(events, 256, -1);
+        if (n < 0)
+            break;
+        for (int i = 0; i < n; ++i) {
+            const PollEvent &ev = events[i];
+            if (ev.token == WAKE_TOKEN || ev.token == TIMER_TOKEN) {
+                int fd = ev.token == WAKE_TOKEN ? w->wakefd : w->timerfd;
+                uint64_t value;
+                ssize_t r = read(fd, &value, sizeof(value));
+                (void)r;
+                if (ev.token == TIMER_TOKEN)
+                    w->armed = 0;
+                if (ev.rearm)
+                    w->poller.rearm(fd, ev.token);
+                continue;
+            }
+            auto it = w->by_id.find((uint32_t)(ev.token - PEER_TOKEN));
+            if (it == w->by_id.end() || it->second->closed)
+                continue;
+            Peer *p = it->second;
+            bool ok = true;
+            if (ev.writable) {
+                if (w->poller.backend() == Poller::IO_URING)
+                    p->want_write = false;
+                ok = flush(w, p);
+            }
+            if (ok && (ev.readable || ev.error))
+                ok = receive(w, p);
+            if (!ok)
+                close_peer(w, p);
+            else if (ev.rearm && !p->closed)
+                w->poller.rearm(p->fd, ev.token);
+        }
+        uint64_t now = now_ns();
+        while (!w->timers.empty() && w->timers.top().first <= now) {
+            uint32_t id = w->timers.top().second;
+            w->timers.pop();
+            auto it = w->by_id.find(id);
+            if (it != w->by_id.end())
+                tick(w, it->second, now);
+        }
+        if (!w->timers.empty() && (w->armed == 0 || w->timers.top().first < w->armed))
+            arm(w, w->timers.top().first);
+    }
+}
+
+static void stop_sim(Sim *sim) {
+    if (sim->stopping.exchange(true))
+        return;
+    for (auto &w : sim->workers) {
+        if (w->thread.joinable()) {
+            uint64_t one = 1;
+            ssize_t r = write(w->wakefd, &one, sizeof(one));
+            (void)r;
+            w->thread.join();
+        }
+    }
+    for (auto &w : sim->workers) {
+        for (auto &p : w->peers) {
+            if (!p->closed) {
+                w->poller.remove(p->fd, PEER_TOKEN + p->id);
+                close(p->fd);
+                p->closed = true;
+            }
+        }
+    }
+}
+
+static void free_sim(Sim *sim) {
+    stop_sim(sim);
+    for (auto &w : sim->workers) {
+        if (w->wakefd >= 0)
+            close(w->wakefd);
+        if (w->timerfd >= 0)
+            close(w->timerfd);
+    }
+    for (auto &entry : sim->fds)
+        close(entry.second);
+    delete sim;
+}
+
+/* Simulator type. */
+
+typedef struct {
+    PyObject_HEAD
+    Sim *sim;
+} SimulatorObject;
+
+static int Simulator_init(SimulatorObject *self, PyObject *args, PyObject *kwds) {
+    static const char *kwlist[] = {"magic", "threads", "seed", NULL};
+    Py_buffer magic;
+    int threads = 1;
+    unsigned long long seed = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y*|iK", const_cast<char **>(kwlist), &magic, &threads, &seed))
+        return -1;
+    if (self->sim) {
+        PyBuffer_Release(&magic);
+        PyErr_SetString(PyExc_RuntimeError, "Simulator is already initialized.");
+        return -1;
+    }
+    if (magic.len != 4) {
+        PyBuffer_Release(&magic);
+        PyErr_SetString(PyExc_ValueError, "magic must be exactly 4 bytes.");
+        return -1;
+    }
+    if (threads <= 0)
+        threads = 1;
+    if (threads > MAX_WORKERS)
+        threads = MAX_WORKERS;
+    Sim *sim = new Sim();
+    std::memcpy(sim->magic, magic.buf, 4);
+    PyBuffer_Release(&magic);
+    sim->seed = seed;
+    for (int i = 0; i < threads; ++i) {
+        std::unique_ptr<Worker> w(new Worker());
+        w->sim = sim;
+        w->index = i;
+        w->rng.seed(seed * MAX_WORKERS + i);
+        w->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        w->timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        bool ok = w->wakefd >= 0 && w->timerfd >= 0 && w->poller.init() && w->poller.add(w->wakefd, WAKE_TOKEN)
+                  && w->poller.add(w->timerfd, TIMER_TOKEN);
+        sim->workers.push_back(std::move(w));
+        if (!ok) {
+            free_sim(sim);
+            PyErr_SetString(PyExc_OSError, "could not set up the simulator threads.");
+            return -1;
+        }
+    }
+    self->sim = sim;
+    return 0;
+}
+
+static void Simulator_dealloc(SimulatorObject *self) {
+    if (self->sim) {
+        Py_BEGIN_ALLOW_THREADS
+        free_sim(self->sim);
+        Py_END_ALLOW_THREADS
+    }
+    heap_free(reinterpret_cast<PyObject *>(self));
+}
+
+static Sim *get_sim(SimulatorObject *self) {
+    if (!self->sim)
+        PyErr_SetString(PyExc_RuntimeError, "Simulator is not initialized.");
+    return self->sim;
+}
+
+/**
+ * @brief Whether peers and blocks can still be added. Checked with
+ * sim->setup held.
+ */
+static bool configurable(Sim *sim) {
+    if (sim->started)
+        PyErr_SetString(PyExc_RuntimeError, "Simulator has already been started.");
+    return !sim->started;
+}
+
+static PyObject *Simulator_add_block(SimulatorObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    Py_buffer header, checksum;
+    int fd;
+    long long offset;
+    unsigned long size;
+    if (!parse_args(args, nargs, "y*iLky*:add_block", &header, &fd, &offset, &size, &checksum))
+        return NULL;
+    Sim *sim = get_sim(self);
+    bool valid = header.len == 80 && checksum.len == 4 && offset >= 0 && size <= UINT32_MAX;
+    std::array<uint8_t, 80> raw;
+    BlockRef ref{-1, (off_t)offset, (uint32_t)size, {0}};
+    if (valid) {
+        std::memcpy(raw.data(), header.buf, 80);
+        std::memcpy(ref.checksum, checksum.buf, 4);
+    }
+    PyBuffer_Release(&header);
+    PyBuffer_Release(&checksum);
+    if (!sim)
+        return NULL;
+    if (!valid) {
+        PyErr_SetString(PyExc_ValueError, "expected an 80-byte header, a file region and a 4-byte checksum.");
+        return NULL;
+    }
+    ObjectLock lock(sim->setup);
+    if (!configurable(sim))
+        return NULL;
+    /* Each block file is duplicated once, so the caller may close theirs. */
+    auto it = sim->fds.find(fd);
+    if (it == sim->fds.end()) {
+        int dup_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+        if (dup_fd < 0)
+            return PyErr_SetFromErrno(PyExc_OSError);
+        it = sim->fds.emplace(fd, dup_fd).first;
+    }
+    ref.fd = it->second;
+    Hash h;
+    sha256::sha256d(raw.data(), 80, h.data());
+    if (sim->heights.emplace(h, (uint32_t)sim->headers.size()).second)
+        sim->headers.push_back(raw);
+    sim->blocks[h] = ref;
+    return PyLong_FromSize_t(sim->headers.size());
+}
+
+static PyObject *Simulator_connect(SimulatorObject *self, PyObject *args, PyObject *kwds) {
+    static const char *kwlist[] = {"host", "port", "count", "latency", "bandwidth", "inv_rate", "tx_per_inv",
+                                   "tx_rate", NULL};
+    const char *host;
+    int port, count = 1, tx_per_inv = 1;
+    double latency = 0.0, bandwidth = 0.0, inv_rate = 0.0, tx_rate = 0.0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "si|idddid", const_cast<char **>(kwlist), &host, &port, &count,
+                                     &latency, &bandwidth, &inv_rate, &tx_per_inv, &tx_rate))
+        return NULL;
+    Sim *sim = get_sim(self);
+    if (!sim)
+        return NULL;
+    if (count < 0 || latency < 0 || bandwidth < 0 || inv_rate < 0 || tx_rate < 0 || tx_per_inv < 1
+        || tx_per_inv > 50000) {
+        PyErr_SetString(PyExc_ValueError, "invalid peer configuration.");
+        return NULL;
+    }
+    ObjectLock lock(sim->setup);
+    if (!configurable(sim))
+        return NULL;
+    PeerConfig config{(uint64_t)(latency * 1e9), bandwidth, inv_rate, tx_per_inv, tx_rate};
+    addrinfo hints{}, *res = nullptr;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    std::string service = std::to_string(port);
+    int err;
+    Py_BEGIN_ALLOW_THREADS
+    err = getaddrinfo(host, service.c_str(), &hints, &res);
+    Py_END_ALLOW_THREADS
+    if (err != 0) {
+        PyErr_Format(PyExc_OSError, "getaddrinfo: %s", gai_strerror(err));
+        return NULL;
+    }
+    std::vector<int> fds;
+    int saved = 0;
+    Py_BEGIN_ALLOW_THREADS
+    for (int i = 0; i < count; ++i) {
+        int fd = socket(res->ai_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || connect(fd, res->ai_addr, res->ai_addrlen) != 0) {
+            saved = errno;
+            if (fd >= 0)
+                close(fd);
+            break;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+        fds.push_back(fd);
+    }
+    Py_END_ALLOW_THREADS
+    freeaddrinfo(res);
+    if ((int)fds.size() < count) {
+        for (int fd : fds)
+            close(fd);
+        errno = saved;
+        return PyErr_SetFromErrno(PyExc_OSError);
+    }
+    PyObject *ids = PyList_New(0);
+    if (!ids) {
+        for (int fd : fds)
+            close(fd);
+        return NULL;
+    }
+    for (size_t i = 0; i < fds.size(); ++i) {
+        uint32_t id = sim->next_peer++;
+        Worker *w = sim->workers[id % sim->workers.size()].get();
+        std::unique_ptr<Peer> p(new Peer());
+        p->id = id;
+        p->fd = fds[i];
+        p->config = config;
+        p->rx.reset(new RingBuffer());
+        p->tx.reset(new RingBuffer());
+        PyObject *item = PyLong_FromUnsignedLong(id);
+        if (!p->rx->init(DEFAULT_CAPACITY) || !p->tx->init(DEFAULT_CAPACITY)
+            || !w->poller.add(p->fd, PEER_TOKEN + id) || !item || PyList_Append(ids, item) < 0) {
+            Py_XDECREF(item);
+            for (size_t j = i; j < fds.size(); ++j)
+                close(fds[j]);
+            Py_DECREF(ids);
+            return PyErr_Occurred() ? NULL : PyErr_NoMemory();
+        }
+        Py_DECREF(item);
+        w->by_id[id] = p.get();
+        w->peers.push_back(std::move(p));
+    }
+    return ids;
+}
+
+static PyObject *Simulator_start(SimulatorObject *self, PyObject *Py_UNUSED(ignored)) {
+    Sim *sim = get_sim(self);
+    if (!sim)
+        return NULL;
+    ObjectLock lock(sim->setup);
+    if (!configurable(sim))
+        return NULL;
+    sim->started = true;
+    for (auto &w : sim->workers)
+        w->thread = std::thread(worker_main, w.get());
+    Py_RETURN_NONE;
+}
+
+static PyObject *Simulator_stop(SimulatorObject *self, PyObject *Py_UNUSED(ignored)) {
+    if (self->sim) {
+        Py_BEGIN_ALLOW_THREADS
+        stop_sim(self->sim);
+        Py_END_ALLOW_THREADS
+    }
+    Py_RETURN_NONE;
+}
+
+static double percentile(std::vector<uint32_t> &samples, double q) {
+    if (samples.empty())
+        return 0.0;
+    size_t k = std::min(samples.size() - 1, (size_t)(q * samples.size()));
+    std::nth_element(samples.begin(), samples.begin() + k, samples.end());
+    return samples[k] / 1e6;
+}
+
+static PyObject *Simulator_stats(SimulatorObject *self, PyObject *Py_UNUSED(ignored)) {
+    Sim *sim = get_sim(self);
+    if (!sim)
+        return NULL;
+    std::vector<uint32_t> samples;
+    {
+        std::lock_guard<std::mutex> lock(sim->mu);
+        samples = sim->samples;
+    }
+    size_t relayed = samples.size();
+    double p50 = percentile(samples, 0.5), p90 = percentile(samples, 0.9), p99 = percentile(samples, 0.99);
+    double worst = percentile(samples, 1.0);
+    return Py_BuildValue("{sKsKsKsKsKsKsKsKsKsKsKsnsdsdsdsd}", "peers",
+                         (unsigned long long)(sim->next_peer - sim->disconnected.load()), "messages_in",
+                         (unsigned long long)sim->messages_in.load(), "messages_out",
+                         (unsigned long long)sim->messages_out.load(), "bytes_in",
+                         (unsigned long long)sim->bytes_in.load(), "bytes_out",
+                         (unsigned long long)sim->bytes_out.load(), "bad_checksums",
+                         (unsigned long long)sim->bad_checksums.load(), "headers_served",
+                         (unsigned long long)sim->headers_served.load(), "blocks_served",
+                         (unsigned long long)sim->blocks_served.load(), "txs_announced",
+                         (unsigned long long)sim->txs_announced.load(), "txs_sent",
+                         (unsigned long long)sim->txs_sent.load(), "txs_heard",
+                         (unsigned long long)sim->txs_heard.load(), "relayed", (Py_ssize_t)relayed,
+                         "latency_p50", p50, "latency_p90", p90, "latency_p99", p99, "latency_max", worst);
+}
+
+static PyObject *Simulator_latencies(SimulatorObject *self, PyObject *Py_UNUSED(ignored)) {
+    Sim *sim = get_sim(self);
+    if (!sim)
+        return NULL;
+    std::vector<uint32_t> samples;
+    {
+        std::lock_guard<std::mutex> lock(sim->mu);
+        samples = sim->samples;
+    }
+    PyObject *result = PyList_New(samples.size());
+    for (size_t i = 0; result && i < samples.size(); ++i) {
+        PyObject *item = PyFloat_FromDouble(samples[i] / 1e6);
+        if (!item) {
+            Py_CLEAR(result);
+            break;
+        }
+        PyList_SET_ITEM(result, i, item);
+    }
+    return result;
+}
+
+static PyObject *Simulator_get_backend(SimulatorObject *self, void *closure) {
+    if (!self->sim || self->sim->workers.empty())
+        Py_RETURN_NONE;
+    return PyUnicode_FromString(self->sim->workers[0]->poller.name());
+}
+
+static PyObject *Simulator_get_blocks(SimulatorObject *self, void *closure) {
+    return PyLong_FromSize_t(self->sim ? self->sim->headers.size() : 0);
+}
+
+static PyMethodDef Simulator_methods[] = {
+    {"add_block", (PyCFunction)(void (*)(void))Simulator_add_block, METH_FASTCALL,
+     "Serve a block (80-byte header, fd, offset, size, checksum), appending it to the simulated chain."},
+    {"connect", (PyCFunction)(void (*)(void))Simulator_connect, METH_VARARGS | METH_KEYWORDS,
+     "Connect count peers to host:port with the given shaping and flood rates, returning their ids."},
+    {"start", (PyCFunction)Simulator_start, METH_NOARGS, "Start the peers (handshake, then flooding)."},
+    {"stop", (PyCFunction)Simulator_stop, METH_NOARGS, "Stop the I/O threads and disconnect every peer."},
+    {"stats", (PyCFunction)Simulator_stats, METH_NOARGS,
+     "Counters for messages, bytes and served data, plus relay latency percentiles in seconds."},
+    {"latencies", (PyCFunction)Simulator_latencies, METH_NOARGS, "Every relay latency sample in seconds."},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyGetSetDef Simulator_getset[] = {
+    {"backend", (getter)Simulator_get_backend, NULL, "Either 'io_uring' or 'epoll'.", NULL},
+    {"blocks", (getter)Simulator_get_blocks, NULL, "Number of blocks in the simulated chain.", NULL},
+    {NULL}
+};
+
+static PyType_Slot Simulator_slots[] = {
+    {Py_tp_dealloc, (void *)Simulator_dealloc},
+    {Py_tp_doc, (void *)"Loopback peers speaking the wire protocol, with shaped links and transaction floods."},
+    {Py_tp_methods, Simulator_methods},
+    {Py_tp_getset, Simulator_getset},
+    {Py_tp_init, (void *)Simulator_init},
+    {Py_tp_new, (void *)PyType_GenericNew},
+    {0, NULL}
+};
+
+static PyType_Spec Simulator_spec = {
+    "peersim.Simulator",
+    sizeof(SimulatorObject),
+    0,
+    Py_TPFLAGS_DEFAULT,
+    Simulator_slots
+};
+
+/* Module. */
+
+typedef struct {
+    PyObject *simulator_type;
+} PeerSimState;
+
+static PeerSimState *get_state(PyObject *m) {
+    return static_cast<PeerSimState *>(PyModule_GetState(m));
+}
+
+static int peersim_exec(PyObject *m) {
+    return module_add_type(m, &Simulator_spec, &get_state(m)->simulator_type);
+}
+
+static int peersim_traverse(PyObject *m, visitproc visit, void *arg) {
+    Py_VISIT(get_state(m)->simulator_type);
+    return 0;
+}
+
+static int peersim_clear(PyObject *m) {
+    Py_CLEAR(get_state(m)->simulator_type);
+    return 0;
+}
+
+static void peersim_free(void *m) {
+    peersim_clear(static_cast<PyObject *>(m));
+}
+
+static PyModuleDef_Slot peersim_slots[] = {
+    {Py_mod_exec, (void *)peersim_exec},
+    MODULE_SLOTS
+    {0, NULL}
+};
+
+static struct PyModuleDef peersim = {
+    PyModuleDef_HEAD_INIT,
+    "peersim",
+    NULL,
+    sizeof(PeerSimState),
+    NULL,
+    peersim_slots,
+    peersim_traverse,
+    peersim_clear,
+    peersim_free
+};
+
+PyMODINIT_FUNC PyInit_peersim(void) {
+    return PyModuleDef_Init(&peersim);
+}
@@ -0,0 +1,20 @@
+class Simulator:
+    backend: str
+    blocks: int
+    def __init__(self, magic: bytes, threads: int = ..., seed: int = ...) -> None: ...
+    def add_block(self, header: bytes, fd: int, offset: int, size: int, checksum: bytes) -> int: ...
+    def connect(
+        self,
+        host: str,
+        port: int,
+        count: int = ...,
+        latency: float = ...,
+        bandwidth: float = ...,
+        inv_rate: float = ...,
+        tx_per_inv: int = ...,
+        tx_rate: float = ...,
+    ) -> list[int]: ...
+    def start(self) -> None: ...
+    def stop(self) -> None: ...
+    def stats(self) -> dict[str, float]: ...
+    def latencies(self) -> list[float]: ...
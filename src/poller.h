@@ -0,0 +1,295 @@
+/**
+ * @file poller.h
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief Socket readiness notification through io_uring, falling back to epoll.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef PYCOIN_POLLER_H
+#define PYCOIN_POLLER_H
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+ /* Both backends are used the same way: a socket is added once with a
+    64-bit token, wait() reports which tokens are readable/writable, and
+    the caller reads or writes until EAGAIN.
+
+    With io_uring, interest is registered as one-shot IORING_OP_POLL_ADD
+    requests, so after handling a readable socket the caller has to call
+    rearm() (PollEvent::rearm says so). Requests are only queued in the
+    submission ring and go to the kernel together with the next wait(),
+    which means a whole round of rearms, write polls and removals costs
+    a single io_uring_enter call. One-shot polls work on every kernel
+    with io_uring (5.1+), unlike multishot polls.
+
+    With epoll, sockets are registered edge-triggered and rearm() is a
+    no-op. io_uring is tried first unless PYCOIN_POLLER=epoll is set, or
+    the kernel (or a seccomp filter) refuses io_uring_setup.
+ */
+
+struct PollEvent {
+    uint64_t token;
+    bool readable;
+    bool writable;
+    bool error;
+    bool rearm;
+};
+
+class Poller {
+public:
+    enum Backend { NONE, EPOLL, IO_URING };
+
+    Poller() = default;
+    Poller(const Poller &) = delete;
+    Poller &operator=(const Poller &) = delete;
+
+    ~Poller() { release(); }
+
+    bool init(unsigned entries = 4096) {
+        const char *forced = std::getenv("PYCOIN_POLLER");
+        if (!(forced && std::strcmp(forced, "epoll") == 0) && init_uring(entries))
+            return true;
+        epfd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epfd_ < 0)
+            return false;
+        backend_ = EPOLL;
+        return true;
+    }
+
+    Backend backend() const { return backend_; }
+    const char *name() const { return backend_ == IO_URING ? "io_uring" : "epoll"; }
+
+    /** Registers read interest for fd. */
+    bool add(int fd, uint64_t token) {
+        if (backend_ == IO_URING)
+            return poll_add(fd, token << 1, POLLIN);
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+        ev.data.u64 = token;
+        return epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev) == 0;
+    }
+
+    /** Read interest has to be renewed after every io_uring event. */
+    bool rearm(int fd, uint64_t token) {
+        if (backend_ == IO_URING)
+            return poll_add(fd, token << 1, POLLIN);
+        return true;
+    }
+
+    /** Asks for (or stops asking for) a writable notification. */
+    bool want_write(int fd, uint64_t token, bool on) {
+        if (backend_ == IO_URING)
+            return on ? poll_add(fd, token << 1 | 1, POLLOUT) : true;
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET | (on ? (uint32_t)EPOLLOUT : 0u);
+        ev.data.u64 = token;
+        return epoll_ctl(epfd_, EPOLL_CTL_MOD, fd, &ev) == 0;
+    }
+
+    /** Drops all interest in fd. Must be called before fd is closed. */
+    void remove(int fd, uint64_t token) {
+        if (backend_ == IO_URING) {
+            poll_remove(token << 1);
+            poll_remove(token << 1 | 1);
+        } else {
+            epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr);
+        }
+    }
+
+    /**
+     * @brief Waits for events (timeout_ms < 0 blocks, 0 polls), returning
+     * the number stored in events or -1 on error.
+     */
+    int wait(PollEvent *events, int max, int timeout_ms) {
+        if (backend_ == IO_URING)
+            return wait_uring(events, max, timeout_ms);
+        epoll_event evs[256];
+        int n = epoll_wait(epfd_, evs, max < 256 ? max : 256, timeout_ms);
+        if (n < 0)
+            return errno == EINTR ? 0 : -1;
+        for (int i = 0; i < n; ++i) {
+            uint32_t e = evs[i].events;
+            events[i] = PollEvent{evs[i].data.u64, (e & (EPOLLIN | EPOLLRDHUP)) != 0, (e & EPOLLOUT) != 0,
+                                  (e & (EPOLLERR | EPOLLHUP)) != 0, false};
+        }
+        return n;
+    }
+
+private:
+    Backend backend_ = NONE;
+    int epfd_ = -1;
+
+    /* io_uring state (rings are shared with the kernel). */
+    int ring_fd_ = -1;
+    void *sq_ptr_ = nullptr, *cq_ptr_ = nullptr;
+    size_t sq_size_ = 0, cq_size_ = 0, sqes_size_ = 0;
+    unsigned *sq_head_, *sq_tail_, *sq_mask_, *sq_array_, sq_entries_ = 0;
+    unsigned *cq_head_, *cq_tail_, *cq_mask_;
+    io_uring_sqe *sqes_ = nullptr;
+    io_uring_cqe *cqes_ = nullptr;
+    unsigned queued_ = 0;
+
+    static int uring_setup(unsigned entries, io_uring_params *p) {
+        return (int)syscall(__NR_io_uring_setup, entries, p);
+    }
+
+    int uring_enter(unsigned submit, unsigned min_complete, unsigned flags) {
+        return (int)syscall(__NR_io_uring_enter, ring_fd_, submit, min_complete, flags, nullptr, 0);
+    }
+
+    bool init_uring(unsigned entries) {
+        io_uring_params p;
+        std::memset(&p, 0, sizeof(p));
+        int fd = uring_setup(entries, &p);
+        if (fd < 0)
+            return false;
+        ring_fd_ = fd;
+        sq_size_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cq_size_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+        if (single)
+            sq_size_ = cq_size_ = sq_size_ > cq_size_ ? sq_size_ : cq_size_;
+        sq_ptr_ = mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sq_ptr_ == MAP_FAILED) {
+            sq_ptr_ = nullptr;
+            release();
+            return false;
+        }
+        if (single) {
+            cq_ptr_ = sq_ptr_;
+        } else {
+            cq_ptr_ = mmap(nullptr, cq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                           IORING_OFF_CQ_RING);
+            if (cq_ptr_ == MAP_FAILED) {
+                cq_ptr_ = nullptr;
+                release();
+                return false;
+            }
+        }
+        sqes_size_ = p.sq_entries * sizeof(io_uring_sqe);
+        void *sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                          IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            release();
+            return false;
+        }
+        uint8_t *sq = static_cast<uint8_t *>(sq_ptr_), *cq = static_cast<uint8_t *>(cq_ptr_);
+        sq_head_ = reinterpret_cast<unsigned *>(sq + p.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+        sq_mask_ = reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+        sq_entries_ = p.sq_entries;
+        cq_head_ = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+        cq_mask_ = reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe *>(cq + p.cq_off.cqes);
+        sqes_ = static_cast<io_uring_sqe *>(sqes);
+        backend_ = IO_URING;
+        return true;
+    }
+
+    io_uring_sqe *next_sqe() {
+        unsigned tail = *sq_tail_;
+        if (tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_) {
+            /* Submission ring is full, hand what we have to the kernel. */
+            if (uring_enter(queued_, 0, 0) < 0)
+                return nullptr;
+            queued_ = 0;
+            if (tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_)
+                return nullptr;
+        }
+        unsigned idx = tail & *sq_mask_;
+        io_uring_sqe *sqe = &sqes_[idx];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sq_array_[idx] = idx;
+        return sqe;
+    }
+
+    void queue_sqe() {
+        __atomic_store_n(sq_tail_, *sq_tail_ + 1, __ATOMIC_RELEASE);
+        ++queued_;
+    }
+
+    bool poll_add(int fd, uint64_t user_data, unsigned events) {
+        io_uring_sqe *sqe = next_sqe();
+        if (!sqe)
+            return false;
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = fd;
+        sqe->poll32_events = events;
+        sqe->user_data = user_data;
+        queue_sqe();
+        return true;
+    }
+
+    void poll_remove(uint64_t user_data) {
+        io_uring_sqe *sqe = next_sqe();
+        if (!sqe)
+            return;
+        sqe->opcode = IORING_OP_POLL_REMOVE;
+        sqe->fd = -1;
+        sqe->addr = user_data;
+        sqe->user_data = UINT64_MAX;  // Completions of removals are ignored.
+        queue_sqe();
+    }
+
+    int wait_uring(PollEvent *events, int max, int timeout_ms) {
+        unsigned head = *cq_head_;
+        if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE) || queued_) {
+            /* Only block when nothing is already complete. Timeouts other
+               than "forever" and "don't wait" are not needed by callers
+               (they wake the loop through an eventfd instead). */
+            bool block = timeout_ms != 0 && head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+            int r = uring_enter(queued_, block ? 1 : 0, block ? IORING_ENTER_GETEVENTS : 0);
+            if (r < 0 && errno != EINTR)
+                return -1;
+            if (r >= 0)
+                queued_ = 0;
+        }
+        int n = 0;
+        unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        for (; head != tail && n < max; ++head) {
+            const io_uring_cqe &cqe = cqes_[head & *cq_mask_];
+            if (cqe.user_data == UINT64_MAX || cqe.res == -ECANCELED || cqe.res == -ENOENT)
+                continue;
+            bool write = cqe.user_data & 1;
+            int res = cqe.res;
+            bool error = res < 0 || (res & (POLLERR | POLLHUP));
+            events[n++] = PollEvent{cqe.user_data >> 1, !write && (res < 0 || (res & (POLLIN | POLLRDHUP | POLLHUP))),
+                                    write, error, !write};
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+        return n;
+    }
+
+    void release() {
+        if (sqes_)
+            munmap(sqes_, sqes_size_);
+        if (cq_ptr_ && cq_ptr_ != sq_ptr_)
+            munmap(cq_ptr_, cq_size_);
+        if (sq_ptr_)
+            munmap(sq_ptr_, sq_size_);
+        if (ring_fd_ >= 0)
+            close(ring_fd_);
+        if (epfd_ >= 0)
+            close(epfd_);
+        sqes_ = nullptr, sq_ptr_ = cq_ptr_ = nullptr;
+        ring_fd_ = epfd_ = -1;
+        backend_ = NONE;
+    }
+};
+
+#endif  // PYCOIN_POLLER_H
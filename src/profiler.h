@@ -0,0 +1,244 @@
+/**
+ * @file profiler.h
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief Header-only scoped zone profiler for the native code.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef PYCOIN_PROFILER_H
+#define PYCOIN_PROFILER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <functional>
+#include <thread>
+#endif
+
+ /* A zone is a named scope: PROFILE_ZONE("scripts") at the top of a
+    block records when the block was entered and how long it ran, when
+    it is left. There is no sampling, so every zone is seen, and nesting
+    follows from the times (a zone inside another starts after and ends
+    before it), which is how profiler.py builds stacks, and how the
+    Chrome trace viewer draws them.
+
+    Each thread writes its zones into its own ring buffer of
+    PROFILER_CAPACITY events, with no locks; once full, the oldest are
+    overwritten (and counted as dropped). Times are CLOCK_MONOTONIC
+    nanoseconds and threads are OS thread ids, the same as
+    time.monotonic_ns() and threading.get_native_id() in Python, so
+    zones from the extensions and from profiler.zone() line up.
+
+    Profiling is off until started (a zone then costs a relaxed load),
+    and is compiled out with -DPYCOIN_NO_PROFILE. As with metrics.h,
+    every extension including this header has its own buffers (hence
+    the unnamed namespace), exposed with PROFILER_METHODS. Events should
+    be read once the zones being profiled have ended.
+
+    References:
+        - https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+        - https://github.com/brendangregg/FlameGraph#2-fold-stacks
+ */
+
+#define PROFILER_CAPACITY (1 << 16)  // Events per thread.
+
+namespace profiler {
+
+namespace {
+
+struct Event {
+    const char *name;  // A string literal.
+    uint64_t start, duration;
+    uint64_t thread;
+};
+
+struct Buffer {
+    std::vector<Event> events;
+    std::atomic<uint64_t> written{0};  // Ever, so the ring holds the last min(written, capacity).
+    bool in_use = false;
+
+    Buffer() : events(PROFILER_CAPACITY) {}
+};
+
+inline uint64_t now() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+inline uint64_t thread_id() {
+#ifdef __linux__
+    return (uint64_t)syscall(SYS_gettid);
+#else
+    return (uint64_t)std::hash<std::thread::id>()(std::this_thread::get_id());
+#endif
+}
+
+class Registry {
+  public:
+    std::atomic<bool> enabled{false};
+
+    Buffer *acquire() {
+        std::lock_guard<std::mutex> lock(mu_);
+        for (Buffer *b : buffers_) {
+            if (!b->in_use) {
+                b->in_use = true;
+                return b;
+            }
+        }
+        buffers_.push_back(new Buffer());  // Never freed, like the metrics slots.
+        buffers_.back()->in_use = true;
+        return buffers_.back();
+    }
+
+    void release(Buffer *b) {
+        std::lock_guard<std::mutex> lock(mu_);
+        b->in_use = false;
+    }
+
+    /**
+     * @brief Forgets all the events recorded so far.
+     */
+    void clear() {
+        std::lock_guard<std::mutex> lock(mu_);
+        for (Buffer *b : buffers_)
+            b->written.store(0, std::memory_order_release);
+    }
+
+    /**
+     * @brief Appends the events in every buffer to out, and returns how
+     * many were overwritten before they could be.
+     */
+    uint64_t collect(std::vector<Event> &out) {
+        std::lock_guard<std::mutex> lock(mu_);
+        uint64_t dropped = 0;
+        for (const Buffer *b : buffers_) {
+            uint64_t written = b->written.load(std::memory_order_acquire);
+            uint64_t first = written > PROFILER_CAPACITY ? written - PROFILER_CAPACITY : 0;
+            for (uint64_t i = first; i < written; ++i)
+                out.push_back(b->events[i % PROFILER_CAPACITY]);
+            dropped += first;
+        }
+        return dropped;
+    }
+
+  private:
+    std::mutex mu_;
+    std::vector<Buffer *> buffers_;
+};
+
+inline Registry &registry() {
+    static Registry *r = new Registry();
+    return *r;
+}
+
+struct Local {
+    Buffer *buffer = registry().acquire();
+    uint64_t thread = thread_id();
+    ~Local() { registry().release(buffer); }
+};
+
+inline Local &local() {
+    thread_local Local l;
+    return l;
+}
+
+inline bool enabled() { return registry().enabled.load(std::memory_order_relaxed); }
+
+inline void record(const char *name, uint64_t start, uint64_t end) {
+    Local &l = local();
+    uint64_t n = l.buffer->written.load(std::memory_order_relaxed);
+    l.buffer->events[n % PROFILER_CAPACITY] = Event{name, start, end - start, l.thread};
+    l.buffer->written.store(n + 1, std::memory_order_release);
+}
+
+/**
+ * @brief Records a zone from construction to destruction, if profiling
+ * was on when it was entered.
+ */
+class Zone {
+  public:
+    explicit Zone(const char *name) : name_(name), start_(enabled() ? now() : 0) {}
+
+    ~Zone() {
+        if (start_)
+            record(name_, start_, now());
+    }
+
+    Zone(const Zone &) = delete;
+    Zone &operator=(const Zone &) = delete;
+
+  private:
+    const char *name_;
+    uint64_t start_;
+};
+
+}  // namespace
+
+}  // namespace profiler
+
+#define PROFILER_CONCAT_(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_(a, b)
+
+#ifdef PYCOIN_NO_PROFILE
+#define PROFILE_ZONE(name) ((void)0)
+#else
+#define PROFILE_ZONE(name) profiler::Zone PROFILER_CONCAT(profiler_zone_, __LINE__)(name)
+#endif
+
+#ifdef Py_PYTHON_H
+
+ /* _profile_start() clears the buffers and starts recording,
+    _profile_stop() stops, and _profile_events() returns
+    ([(name, thread, start_ns, duration_ns)], dropped) for the events
+    recorded, sorted by start. */
+
+static PyObject *profiler_start_py(PyObject *self, PyObject *Py_UNUSED(ignored)) {
+    profiler::registry().clear();
+    profiler::registry().enabled.store(true);
+    Py_RETURN_NONE;
+}
+
+static PyObject *profiler_stop_py(PyObject *self, PyObject *Py_UNUSED(ignored)) {
+    profiler::registry().enabled.store(false);
+    Py_RETURN_NONE;
+}
+
+static PyObject *profiler_events_py(PyObject *self, PyObject *Py_UNUSED(ignored)) {
+    std::vector<profiler::Event> events;
+    uint64_t dropped = profiler::registry().collect(events);
+    std::sort(events.begin(), events.end(),
+              [](const profiler::Event &a, const profiler::Event &b) { return a.start < b.start; });
+    PyObject *list = PyList_New((Py_ssize_t)events.size());
+    for (size_t i = 0; list && i < events.size(); ++i) {
+        const profiler::Event &e = events[i];
+        PyObject *item = Py_BuildValue("(sKKK)", e.name, (unsigned long long)e.thread, (unsigned long long)e.start,
+                                       (unsigned long long)e.duration);
+        if (!item) {
+            Py_CLEAR(list);
+            break;
+        }
+        PyList_SET_ITEM(list, (Py_ssize_t)i, item);
+    }
+    return list ? Py_BuildValue("(NK)", list, (unsigned long long)dropped) : NULL;
+}
+
+#define PROFILER_METHODS                                                                                  \
+    {"_profile_start", profiler_start_py, METH_NOARGS, "Clear this extension's zones and record new ones."}, \
+        {"_profile_stop", profiler_stop_py, METH_NOARGS, "Stop recording zones."},                          \
+        {"_profile_events", profiler_events_py, METH_NOARGS, "The zones recorded, and how many were dropped."}
+
+#endif  // Py_PYTHON_H
+
+#endif  // PYCOIN_PROFILER_H
@@ -0,0 +1,199 @@
+"""Scoped zone profiling of block processing, across threads, exported
+as a Chrome trace or as collapsed stacks for a flame graph.
+
+Zones are named, timed scopes: PROFILE_ZONE in the extensions (see
+profiler.h) and zone() here. Every zone entered while profiling is
+recorded, with its thread, so the trace shows exactly how a block's
+time is split between parsing, hashing, the script checks and the
+signature checks inside them, on every thread. Nesting follows from
+the times.
+
+    python -m src.profiler --threads 4 --chrome trace.json
+    python -m src.profiler --collapsed block.folded && flamegraph.pl block.folded > block.svg
+
+chrome://tracing or https://ui.perfetto.dev open the trace.
+"""
+
+from __future__ import annotations
+
+import argparse
+import collections
+import contextlib
+import json
+import os
+import threading
+import time
+from pathlib import Path
+from typing import Iterator, NamedTuple, Sequence
+
+try:
+    from . import validation  # type: ignore
+except ImportError:
+    validation = None
+
+CAPACITY = 1 << 16  # Python zones kept, like PROFILER_CAPACITY per native thread.
+
+
+class Event(NamedTuple):
+    name: str
+    thread: int  # OS thread id.
+    start: int  # time.monotonic_ns().
+    duration: int  # Nanoseconds.
+
+    @property
+    def end(self) -> int:
+        return self.start + self.duration
+
+
+_events: collections.deque[Event] = collections.deque(maxlen=CAPACITY)
+_recording = False
+
+
+def modules() -> list:
+    """The extensions with zones."""
+    return [m for m in (validation,) if m is not None]
+
+
+def start() -> None:
+    """Clears the zones recorded so far and starts recording."""
+    global _recording
+    _events.clear()
+    for module in modules():
+        module._profile_start()
+    _recording = True
+
+
+def stop() -> None:
+    global _recording
+    _recording = False
+    for module in modules():
+        module._profile_stop()
+
+
+@contextlib.contextmanager
+def zone(name: str) -> Iterator[None]:
+    """Records the with block as a zone, if profiling."""
+    if not _recording:
+        yield
+        return
+    begin = time.monotonic_ns()
+    try:
+        yield
+    finally:
+        _events.append(Event(name, threading.get_native_id(), begin, time.monotonic_ns() - begin))
+
+
+def events() -> tuple[list[Event], int]:
+    """Every zone recorded (Python and native), by start time, and how
+    many were dropped when a ring buffer filled up."""
+    recorded = list(_events)
+    dropped = 0
+    for module in modules():
+        native, lost = module._profile_events()
+        recorded += [Event(*e) for e in native]
+        dropped += lost
+    recorded.sort(key=lambda e: (e.start, -e.duration))
+    return recorded, dropped
+
+
+def chrome_trace(recorded: Sequence[Event]) -> dict:
+    """The zones as complete ("X") events in the Chrome trace event
+    format, with times in microseconds."""
+    pid = os.getpid()
+    origin = min((e.start for e in recorded), default=0)
+    main_thread = threading.main_thread().native_id
+    trace: list[dict] = [
+        {"name": e.name, "ph": "X", "pid": pid, "tid": e.thread,
+         "ts": (e.start - origin) / 1e3, "dur": e.duration / 1e3}
+        for e in recorded
+    ]
+    for thread in sorted({e.thread for e in recorded}):
+        name = "main" if thread == main_thread else f"thread {thread}"
+        trace.append({"name": "thread_name", "ph": "M", "pid": pid, "tid": thread, "args": {"name": name}})
+    return {"traceEvents": trace, "displayTimeUnit": "ms"}
+
+
+def stacks(recorded: Sequence[Event]) -> dict[tuple[str, ...], int]:
+    """The self time (ns) of every stack of zones, over all threads: a
+    zone's self time is its duration less that of the zones inside it."""
+    folded: dict[tuple[str, ...], int] = collections.Counter()
+    by_thread: dict[int, list[Event]] = collections.defaultdict(list)
+    for e in recorded:
+        by_thread[e.thread].append(e)
+    for thread_events in by_thread.values():
+        thread_events.sort(key=lambda e: (e.start, -e.duration))
+        open_zones: list[tuple[Event, tuple[str, ...]]] = []
+        for e in thread_events:
+            while open_zones and open_zones[-1][0].end <= e.start:
+                open_zones.pop()
+            parent = open_zones[-1][1] if open_zones else ()
+            stack = parent + (e.name,)
+            folded[stack] += e.duration
+            if parent:
+                folded[parent] -= e.duration
+            open_zones.append((e, stack))
+    return {stack: ns for stack, ns in folded.items() if ns > 0}
+
+
+def collapsed(recorded: Sequence[Event]) -> str:
+    """The stacks in the folded format of flamegraph.pl and speedscope,
+    one "a;b;c microseconds" line each."""
+    folded = sorted(stacks(recorded).items())
+    return "".join(f"{';'.join(stack)} {ns // 1000}\n" for stack, ns in folded if ns >= 1000)
+
+
+def report(recorded: Sequence[Event], dropped: int = 0) -> str:
+    totals: dict[str, list[int]] = collections.defaultdict(lambda: [0, 0])
+    for e in recorded:
+        totals[e.name][0] += 1
+        totals[e.name][1] += e.duration
+    self_times: dict[str, int] = collections.Counter()
+    for stack, ns in stacks(recorded).items():
+        self_times[stack[-1]] += ns
+    threads = len({e.thread for e in recorded})
+    lines = [f"{'zone':<16} {'count':>8} {'total':>12} {'self':>12}"]
+    for name, (count, total) in sorted(totals.items(), key=lambda item: -item[1][1]):
+        lines.append(f"{name:<16} {count:>8} {total / 1e6:>10.2f}ms {self_times[name] / 1e6:>10.2f}ms")
+    lines.append(f"{len(recorded)} zones on {threads} threads, {dropped} dropped")
+    return "\n".join(lines)
+
+
+def profile_block(path: str | Path | None = None, threads: int = 1) -> tuple[list[Event], int]:
+    """Profiles connecting one of the example blocks (see blockbench.py)."""
+    from . import blockbench
+
+    if validation is None:
+        raise RuntimeError("the validation extension is not built.")
+    prepared = blockbench.prepare(path or blockbench.BLOCK)
+    chainstate = prepared.chainstate()
+    start()
+    try:
+        with zone("block"):
+            chainstate.connect(prepared.block, threads=threads)
+    finally:
+        stop()
+    return events()
+
+
+def main(argv: list[str] | None = None) -> None:
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--block", default=None, help="example block to connect (default 727056)")
+    parser.add_argument("--threads", type=int, default=1)
+    parser.add_argument("--chrome", metavar="PATH", help="write a Chrome trace (JSON)")
+    parser.add_argument("--collapsed", metavar="PATH", help="write collapsed stacks ('-' for stdout)")
+    args = parser.parse_args(argv)
+    recorded, dropped = profile_block(args.block, args.threads)
+    if args.chrome:
+        with open(args.chrome, "w") as f:
+            json.dump(chrome_trace(recorded), f)
+    if args.collapsed == "-":
+        print(collapsed(recorded), end="")
+        return
+    if args.collapsed:
+        with open(args.collapsed, "w") as f:
+            f.write(collapsed(recorded))
+    print(report(recorded, dropped))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,245 @@
+/**
+ * @file pymodule.h
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief Multi-phase module initialization and object locking shared by the extensions.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef PYCOIN_PYMODULE_H
+#define PYCOIN_PYMODULE_H
+
+#include <Python.h>
+#include <climits>
+#include <cstdarg>
+#include <mutex>
+
+ /* Every extension uses multi-phase initialization (PEP 489): PyInit_*
+    returns the module definition, and the types are created per module
+    from specs (PEP 630) and kept in the module's state, so nothing in
+    the extensions is shared between interpreters except plain C++ data
+    (tables computed once, and the metrics, memory and profiler
+    counters, which are all atomic or locked).
+
+    That lets the modules declare, through MODULE_SLOTS, that each
+    interpreter may have its own GIL (3.12+), and that they do not need
+    the GIL at all (free-threaded 3.13+). The functions only read their
+    arguments, and the types with state guard it with an ObjectLock,
+    except EventLoop and Simulator, which lock their own state.
+
+    Functions and methods with positional arguments are METH_FASTCALL:
+    they get the caller's argument array instead of a tuple built for
+    the call. The ones called most, with small arguments (hashing one
+    message, framing one, feeding a FrameReader, queueing a send on the
+    EventLoop, looking up a coin), read the array directly with
+    check_nargs(), read_buffer(), read_u64(), read_i32() and read_str();
+    for them, building and parsing the tuple was most of the cost of a
+    call (frame_call in benchmark.py measures one). The others parse
+    it with parse_args() (the format strings of PyArg_ParseTuple), which
+    builds the tuple after all: CPython has no public function parsing
+    an argument array. Only the batch functions that take keywords are
+    still METH_VARARGS | METH_KEYWORDS; their calls are few and long.
+
+    Modules that implement one of the primitives of backends.py list
+    them in a BACKENDS attribute (module_add_backends()), which
+    backends.py reads to register them next to the Python versions.
+
+    References:
+        - https://peps.python.org/pep-0489/
+        - https://peps.python.org/pep-0630/
+        - https://peps.python.org/pep-0684/
+        - https://peps.python.org/pep-0703/
+        - https://docs.python.org/3/c-api/structures.html#c.METH_FASTCALL
+ */
+
+#if PY_VERSION_HEX >= 0x030C0000
+#define MODULE_SLOT_INTERPRETERS {Py_mod_multiple_interpreters, Py_MOD_PER_INTERPRETER_GIL_SUPPORTED},
+#else
+#define MODULE_SLOT_INTERPRETERS
+#endif
+
+#ifdef Py_mod_gil
+#define MODULE_SLOT_GIL {Py_mod_gil, Py_MOD_GIL_NOT_USED},
+#else
+#define MODULE_SLOT_GIL
+#endif
+
+#define MODULE_SLOTS MODULE_SLOT_INTERPRETERS MODULE_SLOT_GIL
+
+/**
+ * @brief Creates a type from its spec for a module, keeps it in *slot
+ * (in the module state) and adds it to the module. Returns -1 with an
+ * exception set on failure.
+ */
+static inline int module_add_type(PyObject *m, PyType_Spec *spec, PyObject **slot) {
+    *slot = PyType_FromModuleAndSpec(m, spec, NULL);
+    if (!*slot)
+        return -1;
+    return PyModule_AddType(m, reinterpret_cast<PyTypeObject *>(*slot));
+}
+
+/**
+ * @brief Frees an instance of a heap type and drops its reference to the
+ * type, for the end of a tp_dealloc.
+ */
+static inline void heap_free(PyObject *self) {
+    PyTypeObject *type = Py_TYPE(self);
+    type->tp_free(self);
+    Py_DECREF(type);
+}
+
+/**
+ * @brief Checks the argument count of a METH_FASTCALL function that reads
+ * its arguments itself. Returns false with a TypeError set if it is wrong.
+ */
+static inline bool check_nargs(const char *name, Py_ssize_t nargs, Py_ssize_t expected) {
+    if (nargs == expected)
+        return true;
+    PyErr_Format(PyExc_TypeError, "%s() takes %zd arguments (%zd given).", name, expected, nargs);
+    return false;
+}
+
+/**
+ * @brief Reads a bytes-like argument of a METH_FASTCALL function, as "y*"
+ * does. Returns false with a TypeError set if obj has no contiguous
+ * buffer; otherwise the caller must release view.
+ */
+static inline bool read_buffer(PyObject *obj, Py_buffer *view) {
+    return PyObject_GetBuffer(obj, view, PyBUF_SIMPLE) == 0;
+}
+
+/**
+ * @brief Reads an int argument of a METH_FASTCALL function as 64 bits, as
+ * "K" does: modulo 2**64, without an overflow check. Returns false with a
+ * TypeError set if obj is not an int.
+ */
+static inline bool read_u64(PyObject *obj, unsigned long long *value) {
+    if (!PyLong_Check(obj)) {
+        PyErr_Format(PyExc_TypeError, "expected an int, not %.100s.", Py_TYPE(obj)->tp_name);
+        return false;
+    }
+    *value = PyLong_AsUnsignedLongLongMask(obj);
+    return *value != (unsigned long long)-1 || !PyErr_Occurred();
+}
+
+/**
+ * @brief Reads an int argument of a METH_FASTCALL function that has to fit
+ * a C int, as "i" does. Returns false with an exception set otherwise.
+ */
+static inline bool read_i32(PyObject *obj, int *value) {
+    if (!PyLong_Check(obj)) {
+        PyErr_Format(PyExc_TypeError, "expected an int, not %.100s.", Py_TYPE(obj)->tp_name);
+        return false;
+    }
+    long v = PyLong_AsLong(obj);
+    if (v == -1 && PyErr_Occurred())
+        return false;
+    if (v < INT_MIN || v > INT_MAX) {
+        PyErr_SetString(PyExc_OverflowError, "signed integer is out of range for a C int.");
+        return false;
+    }
+    *value = (int)v;
+    return true;
+}
+
+/**
+ * @brief Reads a str argument of a METH_FASTCALL function as UTF-8, as "s#"
+ * does for a str. The text belongs to obj. Returns false with a TypeError
+ * set if obj is not a str.
+ */
+static inline bool read_str(PyObject *obj, const char **text, Py_ssize_t *len) {
+    if (!PyUnicode_Check(obj)) {
+        PyErr_Format(PyExc_TypeError, "expected a str, not %.100s.", Py_TYPE(obj)->tp_name);
+        return false;
+    }
+    *text = PyUnicode_AsUTF8AndSize(obj, len);
+    return *text != NULL;
+}
+
+/**
+ * @brief PyArg_ParseTuple for the arguments of a METH_FASTCALL function:
+ * parse_args(args, nargs, "y*n:name", &buffer, &size). The arguments are
+ * copied into a tuple, which costs what METH_VARARGS did and no more.
+ */
+static inline int parse_args(PyObject *const *args, Py_ssize_t nargs, const char *format, ...) {
+    PyObject *tuple = PyTuple_New(nargs);
+    if (!tuple)
+        return 0;
+    for (Py_ssize_t i = 0; i < nargs; i++)
+        PyTuple_SET_ITEM(tuple, i, Py_NewRef(args[i]));
+    va_list va;
+    va_start(va, format);
+    int ok = PyArg_VaParse(tuple, format, va);
+    va_end(va);
+    Py_DECREF(tuple);
+    return ok;
+}
+
+/**
+ * @brief An implementation of one of the primitives of backends.py: the
+ * primitive ("field", "point", "hash", "merkle" or "siphash"), the module
+ * function that implements it (with the signature backends.py documents
+ * for the primitive), and its capabilities, space separated.
+ */
+struct Backend {
+    const char *primitive;
+    const char *function;
+    const char *capabilities;
+};
+
+/**
+ * @brief Adds BACKENDS to a module from a table of Backend ending in a
+ * null primitive, as a tuple of (primitive, function, capabilities). For
+ * the module's Py_mod_exec slot.
+ */
+static inline int module_add_backends(PyObject *m, const Backend *backends) {
+    Py_ssize_t count = 0;
+    while (backends[count].primitive)
+        ++count;
+    PyObject *tuple = PyTuple_New(count);
+    if (!tuple)
+        return -1;
+    for (Py_ssize_t i = 0; i < count; i++) {
+        const Backend &b = backends[i];
+        PyObject *item = Py_BuildValue("(sss)", b.primitive, b.function, b.capabilities);
+        if (!item) {
+            Py_DECREF(tuple);
+            return -1;
+        }
+        PyTuple_SET_ITEM(tuple, i, item);
+    }
+    int result = PyModule_AddObjectRef(m, "BACKENDS", tuple);
+    Py_DECREF(tuple);
+    return result;
+}
+
+/**
+ * @brief Holds an object's mutex for the rest of the scope. If another
+ * thread has it, the wait is done without the GIL (as ENTER_BUFFERED in
+ * CPython's _io does), since that thread may need the GIL to finish. So
+ * a method can go on to release the GIL with the lock held, which a
+ * critical section (PEP 703) would not survive.
+ */
+class ObjectLock {
+  public:
+    explicit ObjectLock(std::mutex &mu) : mu_(mu) {
+        if (!mu_.try_lock()) {
+            Py_BEGIN_ALLOW_THREADS
+            mu_.lock();
+            Py_END_ALLOW_THREADS
+        }
+    }
+
+    ~ObjectLock() { mu_.unlock(); }
+
+    ObjectLock(const ObjectLock &) = delete;
+    ObjectLock &operator=(const ObjectLock &) = delete;
+
+  private:
+    std::mutex &mu_;
+};
+
+#endif  // PYCOIN_PYMODULE_H
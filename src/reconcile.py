@@ -0,0 +1,459 @@
+"""Transaction relay by set reconciliation (Erlay, BIP330).
+
+Announcing every transaction to every peer with inv costs bandwidth in
+proportion to the number of peers. With reconciliation, transactions
+are collected per peer instead, and every so often the two sides work
+out the difference between their sets:
+
+    initiator                               responder
+        reqrecon(set size, q)      ->
+                                   <-       sketch(capacity ~ estimated difference)
+        merge with own sketch, decode the difference
+        reconcildiff(ok, ids we lack) ->    inv for what we asked for
+        inv for what they lack
+
+Sketches only need room for the difference, so bandwidth grows with how
+much the sets differ, not with how many peers there are. Transactions
+are identified by 32-bit short ids, SipHash of the wtxid under a key
+both peers derive from their salts. If a difference turns out to be
+bigger than the sketch, both sides fall back to announcing their whole
+set.
+
+The sketches and SipHash come from the minisketch and siphash C++
+extensions when they are built. The Python versions below give the
+same results, only a lot slower. Single hashes (siphash24, also used
+by rescan.py) go through backends.py, which picks whichever is faster.
+
+References:
+    - https://github.com/bitcoin/bips/blob/master/bip-0330.mediawiki
+    - https://arxiv.org/abs/1905.10518
+"""
+
+from __future__ import annotations
+
+import hashlib
+import os
+import random
+import struct
+import threading
+from dataclasses import dataclass, field
+from typing import Iterable, Sequence
+
+from . import backends
+from .utils import int_to_vint, read_vint
+
+try:
+    from . import minisketch  # type: ignore
+except ImportError:
+    minisketch = None
+
+try:
+    from . import siphash  # type: ignore
+except ImportError:
+    siphash = None
+
+RECON_VERSION = 1
+DEFAULT_Q = 0.25
+MAX_Q = 2.0
+MSG_WTX = 5
+MASK64 = (1 << 64) - 1
+MAX_SKETCH_CAPACITY = 256  # Larger differences are flooded instead.
+
+
+def _rotl(x: int, b: int) -> int:
+    return ((x << b) | (x >> (64 - b))) & MASK64
+
+
+def py_siphash(k0: int, k1: int, data: bytes) -> int:
+    """SipHash-2-4 of data under the key (k0, k1)."""
+    v0, v1 = k0 ^ 0x736F6D6570736575, k1 ^ 0x646F72616E646F6D
+    v2, v3 = k0 ^ 0x6C7967656E657261, k1 ^ 0x7465646279746573
+
+    def rounds(n: int) -> None:
+        nonlocal v0, v1, v2, v3
+        for _ in range(n):
+            v0 = (v0 + v1) & MASK64
+            v1 = _rotl(v1, 13) ^ v0
+            v0 = _rotl(v0, 32)
+            v2 = (v2 + v3) & MASK64
+            v3 = _rotl(v3, 16) ^ v2
+            v0 = (v0 + v3) & MASK64
+            v3 = _rotl(v3, 21) ^ v0
+            v2 = (v2 + v1) & MASK64
+            v1 = _rotl(v1, 17) ^ v2
+            v2 = _rotl(v2, 32)
+
+    end = len(data) - len(data) % 8
+    for (m,) in struct.iter_unpack("<Q", data[:end]):
+        v3 ^= m
+        rounds(2)
+        v0 ^= m
+    last = int.from_bytes(data[end:], "little") | (len(data) & 0xFF) << 56
+    v3 ^= last
+    rounds(2)
+    v0 ^= last
+    v2 ^= 0xFF
+    rounds(4)
+    return v0 ^ v1 ^ v2 ^ v3
+
+
+backends.register("siphash", backends.REFERENCE, py_siphash, origin=__file__)
+siphash24 = backends.select("siphash")
+
+
+def short_ids(k0: int, k1: int, wtxids: Sequence[bytes]) -> list[int]:
+    """BIP330 short ids (never 0) of a list of wtxids."""
+    if siphash is not None:
+        return siphash.short_ids(k0, k1, wtxids)  # One call for all of them.
+    return [1 + siphash24(k0, k1, wtxid) % 0xFFFFFFFF for wtxid in wtxids]
+
+
+def salt_keys(salt1: int, salt2: int) -> tuple[int, int]:
+    """SipHash key shared by two peers, from the salts they exchanged."""
+    tag = hashlib.sha256(b"Tx Relay Salting").digest()
+    salts = struct.pack("<QQ", *sorted((salt1, salt2)))
+    h = hashlib.sha256(tag + tag + salts).digest()
+    return struct.unpack_from("<QQ", h)
+
+
+def gf_mul(a: int, b: int) -> int:
+    """Product in GF(2^32) modulo x^32 + x^7 + x^3 + x^2 + 1 (the field
+    of minisketch, and of gf32.h)."""
+    r = 0
+    while b:
+        if b & 1:
+            r ^= a
+        b >>= 1
+        a <<= 1
+    for _ in range(2):
+        hi = r >> 32
+        r = (r & 0xFFFFFFFF) ^ hi ^ hi << 2 ^ hi << 3 ^ hi << 7
+    return r
+
+
+def gf_inv(a: int) -> int:
+    r, sq = a, a
+    for _ in range(30):
+        sq = gf_mul(sq, sq)
+        r = gf_mul(r, sq)
+    return gf_mul(r, r)
+
+
+class PySketch:
+    """Pure Python stand-in for minisketch.Sketch."""
+
+    def __init__(self, capacity: int, data: bytes | None = None) -> None:
+        if capacity <= 0 or (data is not None and len(data) != 4 * capacity):
+            raise ValueError("invalid capacity (or data is not 4 * capacity bytes).")
+        self.syndromes = list(struct.unpack(f"<{capacity}I", data)) if data else [0] * capacity
+
+    @property
+    def capacity(self) -> int:
+        return len(self.syndromes)
+
+    def add(self, x: int) -> None:
+        if not 0 < x < 1 << 32:
+            raise ValueError("elements must be in [1, 2**32).")
+        x2, p = gf_mul(x, x), x
+        for i in range(len(self.syndromes)):
+            self.syndromes[i] ^= p
+            p = gf_mul(p, x2)
+
+    def add_many(self, xs: Iterable[int]) -> None:
+        for x in xs:
+            self.add(x)
+
+    def merge(self, other: PySketch) -> None:
+        del self.syndromes[len(other.syndromes) :]
+        self.syndromes = [a ^ b for a, b in zip(self.syndromes, other.syndromes)]
+
+    def serialize(self) -> bytes:
+        return struct.pack(f"<{len(self.syndromes)}I", *self.syndromes)
+
+    def decode(self, max_elements: int = -1) -> list[int] | None:
+        c = len(self.syndromes)
+        if max_elements < 0 or max_elements > c:
+            max_elements = c
+        s = [0] * (2 * c)
+        s[0::2] = self.syndromes
+        for k in range(1, c + 1):
+            s[2 * k - 1] = gf_mul(s[k - 1], s[k - 1])
+        conn = _berlekamp_massey(s)
+        degree = len(conn) - 1
+        if degree > max_elements:
+            return None
+        if degree == 0:
+            return []
+        if conn[-1] == 0:
+            return None
+        p = _monic(conn[::-1])
+        x = _pmod([0, 1], p)
+        y = x
+        for _ in range(32):
+            y = _psqrmod(y, p)
+        if y != x:
+            return None
+        roots: list[int] = []
+        if not _find_roots(p, random.Random(degree), roots):
+            return None
+        return roots
+
+
+def _trim(p: list[int]) -> list[int]:
+    while p and p[-1] == 0:
+        p.pop()
+    return p
+
+
+def _monic(p: list[int]) -> list[int]:
+    inv = gf_inv(p[-1])
+    return [gf_mul(c, inv) for c in p]
+
+
+def _pmod(a: list[int], m: list[int]) -> list[int]:
+    a, dm = list(a), len(m) - 1
+    while len(a) > dm:
+        lead, shift = a[-1], len(a) - 1 - dm
+        if lead:
+            for i in range(dm):
+                a[shift + i] ^= gf_mul(lead, m[i])
+        a.pop()
+    return _trim(a)
+
+
+def _pdiv(a: list[int], m: list[int]) -> list[int]:
+    a, dm = list(a), len(m) - 1
+    q = [0] * (len(a) - dm)
+    while len(a) > dm:
+        lead, shift = a[-1], len(a) - 1 - dm
+        q[shift] = lead
+        if lead:
+            for i in range(dm):
+                a[shift + i] ^= gf_mul(lead, m[i])
+        a.pop()
+    return q
+
+
+def _psqrmod(a: list[int], m: list[int]) -> list[int]:
+    r = [0] * max(0, 2 * len(a) - 1)
+    r[0::2] = [gf_mul(c, c) for c in a]
+    return _pmod(r, m)
+
+
+def _pgcd(a: list[int], b: list[int]) -> list[int]:
+    a, b = _trim(list(a)), _trim(list(b))
+    while b:
+        b = _monic(b)
+        a, b = b, _pmod(a, b)
+    return _monic(a) if a else a
+
+
+def _berlekamp_massey(s: list[int]) -> list[int]:
+    c, b, l, m, bd = [1], [1], 0, 1, 1
+    for n in range(len(s)):
+        d = s[n]
+        for i in range(1, min(l, len(c) - 1) + 1):
+            d ^= gf_mul(c[i], s[n - i])
+        if d == 0:
+            m += 1
+            continue
+        factor = gf_mul(d, gf_inv(bd))
+        t = list(c)
+        c += [0] * max(0, len(b) + m - len(c))
+        for i, coefficient in enumerate(b):
+            c[i + m] ^= gf_mul(factor, coefficient)
+        if 2 * l <= n:
+            l, b, bd, m = n + 1 - l, t, d, 1
+        else:
+            m += 1
+    return (c + [0] * (l + 1))[: l + 1]
+
+
+def _find_roots(p: list[int], rng: random.Random, roots: list[int]) -> bool:
+    d = len(p) - 1
+    if d == 0:
+        return True
+    if d == 1:
+        roots.append(p[0])
+        return True
+    for _ in range(256):
+        t = _pmod([0, rng.getrandbits(32) | 1], p)
+        trace = list(t)
+        for _ in range(31):
+            t = _psqrmod(t, p)
+            trace += [0] * (len(t) - len(trace))
+            for j, coefficient in enumerate(t):
+                trace[j] ^= coefficient
+        g = _pgcd(p, _trim(trace))
+        if 1 < len(g) < len(p):
+            return _find_roots(g, rng, roots) and _find_roots(_pdiv(p, g), rng, roots)
+    return False
+
+
+Sketch = minisketch.Sketch if minisketch is not None else PySketch
+
+
+def sendtxrcncl_payload(salt: int) -> bytes:
+    return struct.pack("<IQ", RECON_VERSION, salt)
+
+
+def inv_payload(wtxids: Sequence[bytes]) -> bytes:
+    return int_to_vint(len(wtxids)) + b"".join(struct.pack("<I", MSG_WTX) + w for w in wtxids)
+
+
+@dataclass
+class ReconciliationState:
+    """Reconciliation with one peer. The initiator calls request() and
+    finish(), the responder respond() and diff(). Every call returns the
+    payload to send (if any) and the wtxids to announce with inv."""
+
+    k0: int
+    k1: int
+    initiator: bool
+    q: float = DEFAULT_Q
+    local: dict[int, bytes] = field(default_factory=dict)       # short id -> wtxid
+    snapshot: dict[int, bytes] | None = None                    # Set being reconciled.
+    sketch_bytes: int = 0
+    failures: int = 0
+
+    def add(self, wtxids: Sequence[bytes]) -> None:
+        self.local.update(zip(short_ids(self.k0, self.k1, wtxids), wtxids))
+
+    def request(self) -> bytes:
+        """Set size and q (as 16-bit fixed point over [0, MAX_Q])."""
+        self.snapshot, self.local = self.local, {}
+        return struct.pack("<HH", min(len(self.snapshot), 0xFFFF), int(self.q / MAX_Q * 0xFFFF))
+
+    def respond(self, payload: bytes) -> bytes:
+        """A sketch sized for the expected difference, or an empty one
+        (asking to fall back to flooding) if that needs more than
+        MAX_SKETCH_CAPACITY."""
+        remote_size, q = struct.unpack_from("<HH", payload)
+        self.snapshot, self.local = self.local, {}
+        local_size = len(self.snapshot)
+        q = q / 0xFFFF * MAX_Q
+        capacity = abs(local_size - remote_size) + int(q * min(local_size, remote_size)) + 1
+        if capacity > MAX_SKETCH_CAPACITY:
+            return int_to_vint(0)
+        sketch = Sketch(capacity)
+        sketch.add_many(list(self.snapshot))
+        data = sketch.serialize()
+        self.sketch_bytes += len(data)
+        return int_to_vint(len(data)) + data
+
+    def finish(self, payload: bytes) -> tuple[bytes, list[bytes]]:
+        length, offset = read_vint(payload)
+        data = bytes(payload[offset : offset + length])
+        snapshot = self.snapshot or {}
+        self.snapshot = None
+        self.sketch_bytes += len(data)
+        valid = 0 < len(data) == length and len(data) % 4 == 0 and len(data) // 4 <= MAX_SKETCH_CAPACITY
+        theirs = Sketch(len(data) // 4, data) if valid else None
+        difference = None
+        if theirs is not None:
+            ours = Sketch(theirs.capacity)
+            ours.add_many(list(snapshot))
+            ours.merge(theirs)
+            difference = ours.decode()
+        if difference is None:
+            self.failures += 1
+            self.q = min(MAX_Q, self.q * 2)
+            return b"\x00" + int_to_vint(0), list(snapshot.values())
+        ask = [x for x in difference if x not in snapshot]
+        announce = [snapshot[x] for x in difference if x in snapshot]
+        smaller = min(len(snapshot), len(snapshot) - len(announce) + len(ask))
+        if smaller:
+            self.q = min(MAX_Q, max(0.0, (len(difference) - abs(len(announce) - len(ask))) / smaller))
+        return b"\x01" + int_to_vint(len(ask)) + b"".join(struct.pack("<I", x) for x in ask), announce
+
+    def diff(self, payload: bytes) -> list[bytes]:
+        snapshot = self.snapshot or {}
+        self.snapshot = None
+        if payload[0] == 0:
+            return list(snapshot.values())
+        count, offset = read_vint(payload, 1)
+        ask = struct.unpack_from(f"<{count}I", payload, offset)
+        return [snapshot[x] for x in ask if x in snapshot]
+
+
+class Reconciler:
+    """Runs reconciliation over a node.Node. Transactions passed to
+    add_transaction() are reconciled with every peer instead of being
+    flooded; call tick() every few seconds to start a round with each
+    peer we initiate with. What a peer turns out to be missing is
+    announced to it with inv (MSG_WTX), which the node handles as usual.
+    """
+
+    def __init__(self, node, salt: int | None = None) -> None:
+        self.node = node
+        self.salt = salt if salt is not None else int.from_bytes(os.urandom(8), "little")
+        self.pending: dict[int, bool] = {}  # conn -> initiator, until their salt arrives.
+        self.states: dict[int, ReconciliationState] = {}
+        self._lock = threading.Lock()
+        node.on("sendtxrcncl", self._on_sendtxrcncl)
+        node.on("reqrecon", self._on_reqrecon)
+        node.on("sketch", self._on_sketch)
+        node.on("reconcildiff", self._on_reconcildiff)
+
+    def add_peer(self, conn: int, initiator: bool) -> None:
+        """Registers a peer. By convention the side that made the
+        connection is the initiator."""
+        with self._lock:
+            self.pending[conn] = initiator
+        self.node.send(conn, "sendtxrcncl", sendtxrcncl_payload(self.salt))
+
+    def remove_peer(self, conn: int) -> None:
+        with self._lock:
+            self.pending.pop(conn, None)
+            self.states.pop(conn, None)
+
+    def add_transaction(self, *wtxids: bytes) -> None:
+        with self._lock:
+            for state in self.states.values():
+                state.add(wtxids)
+
+    def tick(self) -> None:
+        with self._lock:
+            requests = [
+                (conn, state.request())
+                for conn, state in self.states.items()
+                if state.initiator and state.snapshot is None
+            ]
+        for conn, payload in requests:
+            self.node.send(conn, "reqrecon", payload)
+
+    def _announce(self, conn: int, wtxids: list[bytes]) -> None:
+        if wtxids:
+            self.node.send(conn, "inv", inv_payload(wtxids))
+
+    def _on_sendtxrcncl(self, conn: int, payload: bytes) -> None:
+        version, salt = struct.unpack_from("<IQ", payload)
+        with self._lock:
+            initiator = self.pending.pop(conn, None)
+            if initiator is not None and version >= RECON_VERSION:
+                self.states[conn] = ReconciliationState(*salt_keys(self.salt, salt), initiator)
+
+    def _on_reqrecon(self, conn: int, payload: bytes) -> None:
+        with self._lock:
+            state = self.states.get(conn)
+            if state is None or state.initiator:
+                return
+            reply = state.respond(payload)
+        self.node.send(conn, "sketch", reply)
+
+    def _on_sketch(self, conn: int, payload: bytes) -> None:
+        with self._lock:
+            state = self.states.get(conn)
+            if state is None or not state.initiator or state.snapshot is None:
+                return
+            reply, announce = state.finish(payload)
+        self.node.send(conn, "reconcildiff", reply)
+        self._announce(conn, announce)
+
+    def _on_reconcildiff(self, conn: int, payload: bytes) -> None:
+        with self._lock:
+            state = self.states.get(conn)
+            if state is None or state.initiator or state.snapshot is None:
+                return
+            announce = state.diff(payload)
+        self._announce(conn, announce)
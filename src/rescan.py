@@ -0,0 +1,267 @@
+"""Wallet rescans over BIP158 compact block filters and the block store.
+
+A rescan looks for the outputs paying to a wallet's scripts, and the
+inputs spending them, in a range of stored blocks. Instead of parsing
+every block, the wallet's scripts are first matched against the filter
+of each block (a Golomb-coded set of the scripts the block pays to or
+spends from); only blocks whose filter matches are read, through the
+mmap of BlockStore.get(), and parsed.
+
+When the blockfilter extension is built, matching runs natively over
+several threads and blocks are parsed in place without copying (see
+blockfilter.cpp). Otherwise the pure-Python versions below are used.
+
+Filters are built once per block, with build_filters(), which needs the
+scripts of the outputs each block spends; it takes them from the blocks
+before it in the same pass, and from the prevouts it is given for the
+outputs of earlier blocks. A wallet's spends are found through those
+spent scripts, so the filters have to have them.
+
+References:
+    - https://github.com/bitcoin/bips/blob/master/bip-0158.mediawiki
+"""
+
+from __future__ import annotations
+
+import os
+import struct
+from typing import Iterable, Mapping, NamedTuple, Sequence
+
+from .blockstore import BlockStore
+from .reconcile import siphash24
+from .utils import int_to_vint, read_vint, sha256d
+
+try:
+    from . import blockfilter  # type: ignore
+except ImportError:
+    blockfilter = None
+
+P, M = 19, 784931
+OP_RETURN = 0x6A
+
+
+class Output(NamedTuple):
+    block_hash: bytes
+    txid: bytes
+    index: int
+    value: int
+    script: bytes
+
+    @property
+    def outpoint(self) -> bytes:
+        return self.txid + struct.pack("<I", self.index)
+
+
+class Spend(NamedTuple):
+    block_hash: bytes
+    txid: bytes
+    input: int
+    outpoint: bytes
+
+
+class RescanResult(NamedTuple):
+    blocks: list[bytes]  # Hashes of the blocks read (see rescan()).
+    outputs: list[Output]
+    spends: list[Spend]
+
+    def unspent(self) -> list[Output]:
+        spent = {spend.outpoint for spend in self.spends}
+        return [output for output in self.outputs if output.outpoint not in spent]
+
+    def balance(self) -> int:
+        return sum(output.value for output in self.unspent())
+
+
+# Pure-Python versions of the functions in blockfilter.cpp.
+
+
+def py_transactions(block: bytes) -> list[tuple[bytes, list[bytes], list[tuple[int, bytes]]]]:
+    data = bytes(block)
+    count, pos = read_vint(data, 80)
+    txs = []
+    for _ in range(count):
+        start = pos
+        segwit = data[pos + 4 : pos + 6] == b"\x00\x01"
+        pos += 6 if segwit else 4
+        body = pos
+        inputs, outputs = [], []
+        n, pos = read_vint(data, pos)
+        for _ in range(n):
+            inputs.append(data[pos : pos + 36])
+            length, pos = read_vint(data, pos + 36)
+            pos += length + 4
+        n, pos = read_vint(data, pos)
+        for _ in range(n):
+            (value,) = struct.unpack_from("<q", data, pos)
+            length, pos = read_vint(data, pos + 8)
+            outputs.append((value, data[pos : pos + length]))
+            pos += length
+        body_end = pos
+        if segwit:
+            for _ in inputs:
+                items, pos = read_vint(data, pos)
+                for _ in range(items):
+                    length, pos = read_vint(data, pos)
+                    pos += length
+        pos += 4
+        if pos > len(data):
+            raise ValueError("malformed block.")
+        txid = sha256d(data[start : start + 4] + data[body:body_end] + data[pos - 4 : pos])
+        txs.append((txid, inputs, outputs))
+    if pos != len(data):
+        raise ValueError("malformed block.")
+    return txs
+
+
+def _key(block_hash: bytes) -> tuple[int, int]:
+    return struct.unpack_from("<QQ", block_hash)
+
+
+def _hash_to_range(key: tuple[int, int], item: bytes, f: int) -> int:
+    return siphash24(*key, item) * f >> 64
+
+
+def py_build(block: bytes, spent: Iterable[bytes] = ()) -> bytes:
+    items: dict[bytes, None] = {}
+    for _, _, outputs in py_transactions(block):
+        for _, script in outputs:
+            if script and script[0] != OP_RETURN:
+                items[script] = None
+    items.update((script, None) for script in spent if script)
+    key, f = _key(sha256d(bytes(block[:80]))), len(items) * M
+    values = sorted(_hash_to_range(key, item, f) for item in items)
+    bits, last = [], 0
+    for value in values:
+        delta, last = value - last, value
+        bits.append("1" * (delta >> P) + "0" + format(delta & (1 << P) - 1, f"0{P}b"))
+    stream = "".join(bits)
+    stream += "0" * (-len(stream) % 8)
+    return int_to_vint(len(items)) + int(stream or "0", 2).to_bytes(len(stream) // 8, "big")
+
+
+def _decode(filter: bytes) -> tuple[int, Iterable[int]]:
+    n, pos = read_vint(filter, 0)
+    stream = "".join(format(byte, "08b") for byte in filter[pos:])
+
+    def values() -> Iterable[int]:
+        value, i = 0, 0
+        for _ in range(n):
+            q = stream.index("0", i) - i
+            value += q << P | int(stream[i + q + 1 : i + q + 1 + P], 2)
+            i += q + 1 + P
+            yield value
+
+    return n, values()
+
+
+def py_match_any(filter: bytes, block_hash: bytes, scripts: Iterable[bytes]) -> bool:
+    n, values = _decode(filter)
+    key = _key(block_hash)
+    queries = {_hash_to_range(key, script, n * M) for script in scripts}
+    return any(value in queries for value in values)
+
+
+class PyScanner:
+    def __init__(self, scripts: Iterable[bytes] = (), outpoints: Iterable[bytes] = ()) -> None:
+        self.scripts = set(map(bytes, scripts))
+        self._outpoints = set(map(bytes, outpoints))
+
+    def __len__(self) -> int:
+        return len(self.scripts)
+
+    def add_scripts(self, scripts: Iterable[bytes]) -> None:
+        self.scripts.update(map(bytes, scripts))
+
+    def add_outpoints(self, outpoints: Iterable[bytes]) -> None:
+        self._outpoints.update(map(bytes, outpoints))
+
+    def match(self, filters: Sequence[bytes], block_hashes: Sequence[bytes], threads: int = 1) -> list[int]:
+        return [i for i, (f, h) in enumerate(zip(filters, block_hashes)) if py_match_any(f, h, self.scripts)]
+
+    def scan(self, block: bytes) -> tuple[list, list]:
+        outputs, spends = [], []
+        for txid, inputs, outs in py_transactions(block):
+            for i, outpoint in enumerate(inputs):
+                if outpoint in self._outpoints:
+                    self._outpoints.remove(outpoint)
+                    spends.append((txid, i, outpoint))
+            for i, (value, script) in enumerate(outs):
+                if script in self.scripts:
+                    self._outpoints.add(txid + struct.pack("<I", i))
+                    outputs.append((txid, i, value, script))
+        return outputs, spends
+
+    def outpoints(self) -> list[bytes]:
+        return list(self._outpoints)
+
+
+if blockfilter is not None:
+    transactions = blockfilter.transactions
+    build = blockfilter.build
+    match_any = blockfilter.match_any
+    Scanner = blockfilter.Scanner
+else:
+    transactions = py_transactions
+    build = py_build
+    match_any = py_match_any
+    Scanner = PyScanner  # type: ignore
+
+
+def build_filters(
+    store: BlockStore, block_hashes: Iterable[bytes], prevouts: Mapping[bytes, bytes] | None = None
+) -> list[bytes]:
+    """Filters of blocks in chain order. The scripts of the outputs a block
+    spends are looked up among the outputs of the blocks before it, then
+    in prevouts (outpoint -> script, for outputs from before the first
+    block). Spends of outputs found in neither are left out."""
+    scripts: dict[bytes, bytes] = dict(prevouts or {})
+    filters = []
+    for block_hash in block_hashes:
+        block = store.get(block_hash)
+        if block is None:
+            raise KeyError(block_hash.hex())
+        spent = []
+        for txid, inputs, outputs in transactions(block):
+            spent.extend(scripts.pop(outpoint, b"") for outpoint in inputs)
+            for i, (_, script) in enumerate(outputs):
+                scripts[txid + struct.pack("<I", i)] = script
+        filters.append(build(block, spent))
+    return filters
+
+
+def rescan(
+    store: BlockStore,
+    block_hashes: Sequence[bytes],
+    filters: Sequence[bytes],
+    scripts: Iterable[bytes],
+    outpoints: Iterable[bytes] | Mapping[bytes, bytes] = (),
+    threads: int = 0,
+) -> RescanResult:
+    """Finds the outputs paying to scripts and the spends of them (or of
+    outpoints, from before the first block) in the blocks, in order.
+
+    Only the blocks whose filter matches one of the scripts are read. A
+    filter holds the scripts its block spends from, so a spend of one of
+    outpoints is found when the outpoint pays to one of scripts (or, with
+    outpoints mapping each to its script, to that script) and the
+    filters know that script: build_filters() has to be given the
+    outpoints as prevouts, unless it started before them."""
+    scripts = list(map(bytes, scripts))
+    scanner = Scanner(scripts, list(outpoints))
+    threads = threads or os.cpu_count() or 1
+    spent_scripts = set(map(bytes, outpoints.values())) - set(scripts) if isinstance(outpoints, Mapping) else set()
+    matcher = Scanner([*scripts, *spent_scripts]) if spent_scripts else scanner
+    matched = set(matcher.match(filters, block_hashes, threads=threads))
+    result = RescanResult([], [], [])
+    for i, block_hash in enumerate(block_hashes):
+        if i not in matched:
+            continue
+        block = store.get(block_hash)
+        if block is None:
+            raise KeyError(block_hash.hex())
+        outputs, spends = scanner.scan(block)
+        result.blocks.append(block_hash)
+        result.outputs.extend(Output(block_hash, *output) for output in outputs)
+        result.spends.extend(Spend(block_hash, *spend) for spend in spends)
+        del block  # Release the view, so the store can remap the file.
+    return result
@@ -0,0 +1,168 @@
+/**
+ * @file ringbuffer.h
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief Byte ring buffer for socket I/O, mapped twice so reads and writes
+ * are always contiguous.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef PYCOIN_RINGBUFFER_H
+#define PYCOIN_RINGBUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+ /* On Linux the same memfd is mapped at [base, base + cap) and again at
+    [base + cap, base + 2*cap), so the region starting at any offset is
+    contiguous for up to cap bytes. A message that wraps around the end
+    of the buffer can then be handed out as a single pointer, which is
+    what lets payloads be parsed (and given to Python) without copying.
+
+    Everywhere else (or if the mapping fails) a plain linear buffer is
+    used, and unread data is moved to the front when the free space at
+    the end runs out. The interface is the same either way.
+ */
+
+class RingBuffer {
+public:
+    RingBuffer() = default;
+    RingBuffer(const RingBuffer &) = delete;
+    RingBuffer &operator=(const RingBuffer &) = delete;
+
+    ~RingBuffer() { release(); }
+
+    /**
+     * @brief Allocates the buffer, rounding the capacity up to a power of
+     * two that is a multiple of the page size. Returns false on failure.
+     */
+    bool init(size_t capacity) {
+        release();
+        size_t cap = 4096;
+        while (cap < capacity)
+            cap <<= 1;
+        cap_ = cap;
+#ifdef __linux__
+        if (map_mirrored())
+            return true;
+#endif
+        base_ = static_cast<uint8_t *>(std::malloc(cap_));
+        mirrored_ = false;
+        return base_ != nullptr;
+    }
+
+    size_t capacity() const { return cap_; }
+    size_t size() const { return (size_t)(tail_ - head_); }
+    bool empty() const { return head_ == tail_; }
+    bool mirrored() const { return mirrored_; }
+
+    /** Pointer to the unread data, valid for size() bytes. */
+    const uint8_t *read_ptr() const { return base_ + offset(head_); }
+
+    /** Pointer to free space, valid for writable() bytes. */
+    uint8_t *write_ptr() { return base_ + offset(tail_); }
+
+    /**
+     * @brief Number of bytes that can be written at write_ptr(). Call this
+     * before write_ptr(), since the linear fallback may move data here.
+     */
+    size_t writable() {
+        if (mirrored_)
+            return cap_ - size();
+        if (head_ != 0 && cap_ - tail_ < cap_ / 2)
+            compact();
+        return cap_ - (size_t)tail_;
+    }
+
+    void commit(size_t n) { tail_ += n; }
+
+    void consume(size_t n) {
+        head_ += n;
+        if (head_ == tail_ && !mirrored_)
+            head_ = tail_ = 0;  // Cheap reset, nothing to move.
+    }
+
+    /**
+     * @brief Copies up to len bytes into the buffer, returning the number
+     * of bytes actually stored.
+     */
+    size_t write(const uint8_t *data, size_t len) {
+        size_t n = writable();
+        if (len < n)
+            n = len;
+        std::memcpy(write_ptr(), data, n);
+        commit(n);
+        return n;
+    }
+
+    void clear() { head_ = tail_ = 0; }
+
+private:
+    uint8_t *base_ = nullptr;
+    size_t cap_ = 0;
+    uint64_t head_ = 0, tail_ = 0;
+    bool mirrored_ = false;
+
+    size_t offset(uint64_t pos) const { return mirrored_ ? (size_t)(pos & (cap_ - 1)) : (size_t)pos; }
+
+    void compact() {
+        size_t n = size();
+        std::memmove(base_, base_ + head_, n);
+        head_ = 0, tail_ = n;
+    }
+
+#ifdef __linux__
+    bool map_mirrored() {
+        int fd = memfd_create("pycoin-ring", MFD_CLOEXEC);
+        if (fd < 0)
+            return false;
+        if (ftruncate(fd, (off_t)cap_) != 0) {
+            close(fd);
+            return false;
+        }
+        void *region = mmap(nullptr, 2 * cap_, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (region == MAP_FAILED) {
+            close(fd);
+            return false;
+        }
+        uint8_t *p = static_cast<uint8_t *>(region);
+        void *lo = mmap(p, cap_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+        void *hi = mmap(p + cap_, cap_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+        close(fd);
+        if (lo == MAP_FAILED || hi == MAP_FAILED) {
+            munmap(region, 2 * cap_);
+            return false;
+        }
+        base_ = p;
+        mirrored_ = true;
+        return true;
+    }
+#endif
+
+    void release() {
+        if (!base_)
+            return;
+#ifdef __linux__
+        if (mirrored_)
+            munmap(base_, 2 * cap_);
+        else
+            std::free(base_);
+#else
+        std::free(base_);
+#endif
+        base_ = nullptr;
+        head_ = tail_ = 0;
+    }
+};
+
+#endif  // PYCOIN_RINGBUFFER_H
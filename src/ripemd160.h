@@ -0,0 +1,130 @@
+/**
+ * @file ripemd160.h
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief Header-only RIPEMD-160 and HASH160 shared by the extensions.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef PYCOIN_RIPEMD160_H
+#define PYCOIN_RIPEMD160_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "sha256.h"
+
+ /* HASH160 (RIPEMD-160 of SHA-256) is what P2PKH and P2WPKH commit to.
+    hashlib only has RIPEMD-160 when OpenSSL still ships it (it is in
+    the legacy provider since OpenSSL 3.0), so it is implemented here.
+
+    RIPEMD-160 runs two lines of 80 steps over each block in parallel
+    (with different message orders, rotations and functions) and mixes
+    them into the state at the end. Words and the length are little
+    endian, unlike SHA-256.
+
+    References:
+        - https://homes.esat.kuleuven.be/~bosselae/ripemd160.html
+ */
+
+namespace ripemd160 {
+
+inline uint32_t rol(uint32_t x, int n) { return (x << n) | (x >> (32 - n)); }
+
+inline uint32_t f(int round, uint32_t x, uint32_t y, uint32_t z) {
+    switch (round) {
+        case 0: return x ^ y ^ z;
+        case 1: return (x & y) | (~x & z);
+        case 2: return (x | ~y) ^ z;
+        case 3: return (x & z) | (y & ~z);
+        default: return x ^ (y | ~z);
+    }
+}
+
+inline void transform(uint32_t s[5], const uint8_t *block) {
+    static const uint8_t RL[80] = {
+        0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+        7, 4, 13, 1, 10, 6, 15, 3, 12, 0, 9, 5, 2, 14, 11, 8,
+        3, 10, 14, 4, 9, 15, 8, 1, 2, 7, 0, 6, 13, 11, 5, 12,
+        1, 9, 11, 10, 0, 8, 12, 4, 13, 3, 7, 15, 14, 5, 6, 2,
+        4, 0, 5, 9, 7, 12, 2, 10, 14, 1, 3, 8, 11, 6, 15, 13,
+    };
+    static const uint8_t RR[80] = {
+        5, 14, 7, 0, 9, 2, 11, 4, 13, 6, 15, 8, 1, 10, 3, 12,
+        6, 11, 3, 7, 0, 13, 5, 10, 14, 15, 8, 12, 4, 9, 1, 2,
+        15, 5, 1, 3, 7, 14, 6, 9, 11, 8, 12, 2, 10, 0, 4, 13,
+        8, 6, 4, 1, 3, 11, 15, 0, 5, 12, 2, 13, 9, 7, 10, 14,
+        12, 15, 10, 4, 1, 5, 8, 7, 6, 2, 13, 14, 0, 3, 9, 11,
+    };
+    static const uint8_t SL[80] = {
+        11, 14, 15, 12, 5, 8, 7, 9, 11, 13, 14, 15, 6, 7, 9, 8,
+        7, 6, 8, 13, 11, 9, 7, 15, 7, 12, 15, 9, 11, 7, 13, 12,
+        11, 13, 6, 7, 14, 9, 13, 15, 14, 8, 13, 6, 5, 12, 7, 5,
+        11, 12, 14, 15, 14, 15, 9, 8, 9, 14, 5, 6, 8, 6, 5, 12,
+        9, 15, 5, 11, 6, 8, 13, 12, 5, 12, 13, 14, 11, 8, 5, 6,
+    };
+    static const uint8_t SR[80] = {
+        8, 9, 9, 11, 13, 15, 15, 5, 7, 7, 8, 11, 14, 14, 12, 6,
+        9, 13, 15, 7, 12, 8, 9, 11, 7, 7, 12, 7, 6, 15, 13, 11,
+        9, 7, 15, 11, 8, 6, 6, 14, 12, 13, 5, 14, 13, 13, 7, 5,
+        15, 5, 8, 11, 14, 14, 6, 14, 6, 9, 12, 9, 12, 5, 15, 8,
+        8, 5, 12, 9, 12, 5, 14, 6, 8, 13, 6, 5, 15, 13, 11, 11,
+    };
+    static const uint32_t KL[5] = {0x00000000, 0x5A827999, 0x6ED9EBA1, 0x8F1BBCDC, 0xA953FD4E};
+    static const uint32_t KR[5] = {0x50A28BE6, 0x5C4DD124, 0x6D703EF3, 0x7A6D76E9, 0x00000000};
+    uint32_t x[16];
+    for (int i = 0; i < 16; ++i)
+        x[i] = (uint32_t)block[4 * i] | (uint32_t)block[4 * i + 1] << 8 | (uint32_t)block[4 * i + 2] << 16
+            | (uint32_t)block[4 * i + 3] << 24;
+    uint32_t al = s[0], bl = s[1], cl = s[2], dl = s[3], el = s[4];
+    uint32_t ar = al, br = bl, cr = cl, dr = dl, er = el;
+    for (int i = 0; i < 80; ++i) {
+        int round = i / 16;
+        uint32_t t = rol(al + f(round, bl, cl, dl) + x[RL[i]] + KL[round], SL[i]) + el;
+        al = el, el = dl, dl = rol(cl, 10), cl = bl, bl = t;
+        t = rol(ar + f(4 - round, br, cr, dr) + x[RR[i]] + KR[round], SR[i]) + er;
+        ar = er, er = dr, dr = rol(cr, 10), cr = br, br = t;
+    }
+    uint32_t t = s[1] + cl + dr;
+    s[1] = s[2] + dl + er;
+    s[2] = s[3] + el + ar;
+    s[3] = s[4] + al + br;
+    s[4] = s[0] + bl + cr;
+    s[0] = t;
+}
+
+inline void hash(const uint8_t *data, size_t len, uint8_t out[20]) {
+    uint32_t s[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    size_t full = len / 64;
+    for (size_t i = 0; i < full; ++i)
+        transform(s, data + 64 * i);
+    uint8_t tail[128] = {0};
+    size_t rem = len % 64, blocks = rem < 56 ? 1 : 2;
+    std::memcpy(tail, data + 64 * full, rem);
+    tail[rem] = 0x80;
+    uint64_t bits = (uint64_t)len << 3;
+    for (int i = 0; i < 8; ++i)
+        tail[64 * blocks - 8 + i] = (uint8_t)(bits >> (8 * i));
+    for (size_t i = 0; i < blocks; ++i)
+        transform(s, tail + 64 * i);
+    for (int i = 0; i < 5; ++i)
+        for (int j = 0; j < 4; ++j)
+            out[4 * i + j] = (uint8_t)(s[i] >> (8 * j));
+}
+
+/**
+ * @brief RIPEMD-160 of SHA-256, as used for addresses.
+ */
+inline void hash160(const uint8_t *data, size_t len, uint8_t out[20]) {
+    uint8_t digest[32];
+    sha256::hash(data, len, digest);
+    hash(digest, 32, out);
+}
+
+}  // namespace ripemd160
+
+#endif  // PYCOIN_RIPEMD160_H
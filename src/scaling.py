@@ -0,0 +1,221 @@
+"""Thread scaling of the native miner, ECDSA verification and Merkle
+hashing.
+
+For each workload, and each thread count from 1 up to the number of
+CPUs, the microbench extension runs the workload on that many threads
+for a fixed time (see scale() in microbench.cpp and run_threads() in
+bench.h) and reports the throughput. From that come the speedup over
+one thread and the parallel efficiency (speedup / threads): 1.0 is
+perfect scaling, and the point where it drops off is where adding
+cores stops paying.
+
+Each point is the median of --repeat runs. Threads can be pinned, so
+that curves from different runs (and machines) are comparable:
+
+    none      the scheduler places threads (the default).
+    compact   thread i on the i-th allowed CPU, so hyperthreads of the
+              same core fill up together.
+    spread    one thread per physical core first, then the second
+              hyperthread of each.
+    0,2,4     an explicit list of CPUs, used round-robin.
+
+    python -m src.scaling
+    python -m src.scaling mine --threads 1 2 4 8 --pin spread --json mine.json
+"""
+
+from __future__ import annotations
+
+import argparse
+import json
+import os
+import platform
+import statistics
+import sys
+from pathlib import Path
+from typing import NamedTuple, Sequence
+
+try:
+    from . import microbench  # type: ignore
+except ImportError:
+    microbench = None
+
+WORKLOADS = ("mine", "ecdsa_verify", "merkle")
+MIN_TIME = 0.5  # Seconds per run.
+REPEAT = 3
+PIN_POLICIES = ("none", "compact", "spread")
+SYS_CPU = Path("/sys/devices/system/cpu")
+
+
+class Point(NamedTuple):
+    threads: int
+    rate: float  # Items per second, median of the runs.
+    speedup: float
+    efficiency: float
+    runs: list[float]
+
+
+class Curve(NamedTuple):
+    name: str
+    unit: str
+    pin: str
+    points: list[Point]
+
+    def to_json(self) -> dict:
+        return {**self._asdict(), "points": [p._asdict() for p in self.points]}
+
+
+def allowed_cpus() -> list[int]:
+    if hasattr(os, "sched_getaffinity"):
+        return sorted(os.sched_getaffinity(0))
+    return list(range(os.cpu_count() or 1))
+
+
+def _core(cpu: int) -> tuple[int, int]:
+    """(package, core) of a CPU, or (0, cpu) if the topology is unknown."""
+    try:
+        topology = SYS_CPU / f"cpu{cpu}" / "topology"
+        return int((topology / "physical_package_id").read_text()), int((topology / "core_id").read_text())
+    except (OSError, ValueError):
+        return 0, cpu
+
+
+def pin_order(policy: str, cpus: Sequence[int] | None = None) -> list[int] | None:
+    """The CPUs to pin threads to, in order, for a policy (None for no
+    pinning)."""
+    cpus = list(cpus if cpus is not None else allowed_cpus())
+    if policy == "none":
+        return None
+    if policy == "compact":
+        return sorted(cpus, key=lambda cpu: (_core(cpu), cpu))
+    if policy == "spread":
+        seen: dict[tuple[int, int], int] = {}
+        rank = {}
+        for cpu in sorted(cpus, key=lambda cpu: (_core(cpu), cpu)):
+            rank[cpu] = seen.get(_core(cpu), 0)
+            seen[_core(cpu)] = rank[cpu] + 1
+        return sorted(cpus, key=lambda cpu: (rank[cpu], _core(cpu), cpu))
+    try:
+        order = [int(cpu) for cpu in policy.split(",")]
+    except ValueError:
+        raise ValueError(f"Unknown pinning {policy!r}: use {', '.join(PIN_POLICIES)} or a list of CPUs.") from None
+    if not order or any(cpu < 0 for cpu in order):
+        raise ValueError("CPU numbers must not be negative.")
+    return order
+
+
+def default_threads() -> list[int]:
+    return list(range(1, len(allowed_cpus()) + 1))
+
+
+def sweep(
+    name: str,
+    threads: Sequence[int] | None = None,
+    min_time: float = MIN_TIME,
+    repeat: int = REPEAT,
+    pin: str = "none",
+) -> Curve:
+    """Throughput of a workload at each thread count."""
+    if microbench is None:
+        raise RuntimeError("the microbench extension is not built.")
+    if name not in WORKLOADS:
+        raise ValueError(f"Unknown workload {name!r}: use {', '.join(WORKLOADS)}.")
+    threads = list(threads or default_threads())
+    if repeat <= 0 or not threads or any(t <= 0 for t in threads):
+        raise ValueError("threads and repeat must be positive.")
+    cpus = pin_order(pin)
+    points, unit, base = [], "", None
+    for count in threads:
+        runs = []
+        for _ in range(repeat):
+            result = microbench.scale(name, threads=count, min_time=min_time, cpus=cpus)
+            unit = result["unit"]
+            runs.append(result["rate"])
+        rate = statistics.median(runs)
+        if base is None:
+            # Speedups are relative to the first thread count, normally 1.
+            base = rate / count
+        speedup = rate / base
+        points.append(Point(count, rate, speedup, speedup / count, runs))
+    return Curve(name, unit, pin, points)
+
+
+def run(
+    names: Sequence[str] | None = None,
+    threads: Sequence[int] | None = None,
+    min_time: float = MIN_TIME,
+    repeat: int = REPEAT,
+    pin: str = "none",
+) -> list[Curve]:
+    return [sweep(name, threads, min_time, repeat, pin) for name in names or WORKLOADS]
+
+
+def _format_rate(rate: float) -> str:
+    for suffix, scale in (("G", 1e9), ("M", 1e6), ("k", 1e3)):
+        if rate >= scale:
+            return f"{rate / scale:.2f}{suffix}"
+    return f"{rate:.1f}"
+
+
+def report(curves: list[Curve]) -> str:
+    lines = []
+    for curve in curves:
+        lines.append(f"{curve.name} ({curve.unit}/s, pinning: {curve.pin})")
+        lines.append(f"{'threads':>7} {'rate':>10} {'speedup':>8} {'efficiency':>10}")
+        for p in curve.points:
+            lines.append(f"{p.threads:>7} {_format_rate(p.rate):>10} {p.speedup:>7.2f}x {p.efficiency:>10.0%}")
+        lines.append("")
+    return "\n".join(lines).rstrip()
+
+
+def machine() -> dict:
+    """What the numbers depend on, recorded with them."""
+    model = platform.processor()
+    try:
+        with open("/proc/cpuinfo") as f:
+            model = next((line.split(":", 1)[1].strip() for line in f if line.startswith("model name")), model)
+    except OSError:
+        pass
+    try:
+        governor = (SYS_CPU / "cpu0" / "cpufreq" / "scaling_governor").read_text().strip()
+    except OSError:
+        governor = None
+    return {
+        "machine": platform.machine(),
+        "cpu": model,
+        "cpus": os.cpu_count(),
+        "allowed_cpus": allowed_cpus(),
+        "governor": governor,
+        "python": platform.python_version(),
+    }
+
+
+def main(argv: list[str] | None = None) -> None:
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("names", nargs="*", help=f"workloads to run (default all): {', '.join(WORKLOADS)}")
+    parser.add_argument("--threads", type=int, nargs="+", default=None, help="thread counts (default 1..cpus)")
+    parser.add_argument("--time", type=float, default=MIN_TIME, help="seconds per run")
+    parser.add_argument("--repeat", type=int, default=REPEAT, help="runs per point (the median is reported)")
+    parser.add_argument("--pin", default="none", help=f"{', '.join(PIN_POLICIES)} or a list of CPUs (0,2,4)")
+    parser.add_argument("--json", metavar="PATH", help="write the results as JSON ('-' for stdout)")
+    args = parser.parse_args(argv)
+    curves = run(args.names, args.threads, args.time, args.repeat, args.pin)
+    if args.json is None:
+        print(report(curves))
+        return
+    document = {
+        **machine(),
+        "min_time": args.time,
+        "repeat": args.repeat,
+        "pin_order": pin_order(args.pin),
+        "results": [c.to_json() for c in curves],
+    }
+    if args.json == "-":
+        json.dump(document, sys.stdout, indent=2)
+        print()
+    else:
+        with open(args.json, "w") as f:
+            json.dump(document, f, indent=2)
+
+
+if __name__ == "__main__":
+    main()
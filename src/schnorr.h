@@ -0,0 +1,120 @@
+/**
+ * @file schnorr.h
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief Header-only BIP340 Schnorr signatures and BIP341 key tweaking.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef PYCOIN_SCHNORR_H
+#define PYCOIN_SCHNORR_H
+
+#include <cstdint>
+#include <cstring>
+
+#include "secp256k1.h"
+#include "sha256.h"
+
+ /* BIP340 public keys are x coordinates only: the point is the one with
+    an even y. So a signer whose key gives an odd y signs with n - d
+    instead, and the nonce is negated the same way. A signature is
+    (x(R), k + e * d) with e the tagged hash of x(R), the key and the
+    message; verifying recomputes R = s * G - e * P and checks that it
+    has an even y and the same x.
+
+    Taproot outputs commit to an internal key P plus t * G, where t is a
+    tagged hash of P (and of the script tree, which BIP86 wallets leave
+    out), so the private key of the output is d + t.
+
+    References:
+        - https://github.com/bitcoin/bips/blob/master/bip-0340.mediawiki
+        - https://github.com/bitcoin/bips/blob/master/bip-0341.mediawiki
+        - https://github.com/bitcoin/bips/blob/master/bip-0086.mediawiki
+ */
+
+namespace schnorr {
+
+using namespace secp256k1;
+
+/**
+ * @brief Signs a 32-byte message with key, using 32 bytes of auxiliary
+ * randomness aux (all zeros is allowed, and deterministic).
+ */
+inline void sign(const Scalar &key, const uint8_t msg[32], const uint8_t aux[32], uint8_t sig[64]) {
+    static const sha256::Context AUX = sha256::tagged("BIP0340/aux");
+    static const sha256::Context NONCE = sha256::tagged("BIP0340/nonce");
+    static const sha256::Context CHALLENGE = sha256::tagged("BIP0340/challenge");
+    Ge p = to_affine(mul_g_ct(key));
+    Scalar d = fe_is_odd(p.y) ? scalar_neg(key) : key;
+    uint8_t px[32], t[32], db[32], rand[32], rx[32], e32[32];
+    fe_store(px, p.x);
+    sha256::Context(AUX).write(aux, 32).finalize(t);
+    scalar_store(db, d);
+    for (int i = 0; i < 32; ++i)
+        t[i] ^= db[i];
+    sha256::Context(NONCE).write(t, 32).write(px, 32).write(msg, 32).finalize(rand);
+    Scalar k, e;
+    scalar_load(k, rand);  // Zero only with negligible probability.
+    Ge r = to_affine(mul_g_ct(k));
+    if (fe_is_odd(r.y))
+        k = scalar_neg(k);
+    fe_store(rx, r.x);
+    sha256::Context(CHALLENGE).write(rx, 32).write(px, 32).write(msg, 32).finalize(e32);
+    scalar_load(e, e32);
+    std::memcpy(sig, rx, 32);
+    scalar_store(sig + 32, scalar_add(k, scalar_mul(e, d)));
+}
+
+/**
+ * @brief The point with x coordinate xonly and an even y.
+ */
+inline bool lift_x(Ge &r, const uint8_t xonly[32]) {
+    uint8_t sec[33] = {2};
+    std::memcpy(sec + 1, xonly, 32);
+    return ge_load(r, sec, 33);
+}
+
+/**
+ * @brief Whether sig is a valid signature of a 32-byte message by the
+ * x-only public key xonly.
+ */
+inline bool verify(const uint8_t xonly[32], const uint8_t msg[32], const uint8_t sig[64]) {
+    static const sha256::Context CHALLENGE = sha256::tagged("BIP0340/challenge");
+    Ge p;
+    Fe rx;
+    Scalar s, e;
+    if (!lift_x(p, xonly) || !fe_load(rx, sig) || !scalar_load(s, sig + 32))
+        return false;
+    uint8_t e32[32];
+    sha256::Context(CHALLENGE).write(sig, 32).write(xonly, 32).write(msg, 32).finalize(e32);
+    scalar_load(e, e32);
+    Gej r = gej_add(mul_g(s), mul(gej(p), scalar_neg(e)));
+    if (r.infinity)
+        return false;
+    Ge a = to_affine(r);
+    return !fe_is_odd(a.y) && fe_equal(a.x, rx);
+}
+
+/**
+ * @brief The BIP86 output key of an internal private key: returns the
+ * tweaked private key, and its x-only public key in xonly.
+ */
+inline Scalar taproot_tweak(const Scalar &key, uint8_t xonly[32]) {
+    static const sha256::Context TAP_TWEAK = sha256::tagged("TapTweak");
+    Ge p = to_affine(mul_g_ct(key));
+    Scalar d = fe_is_odd(p.y) ? scalar_neg(key) : key, t;
+    uint8_t px[32], digest[32];
+    fe_store(px, p.x);
+    sha256::Context(TAP_TWEAK).write(px, 32).finalize(digest);
+    scalar_load(t, digest);
+    Scalar tweaked = scalar_add(d, t);
+    fe_store(xonly, to_affine(mul_g_ct(tweaked)).x);
+    return tweaked;
+}
+
+}  // namespace schnorr
+
+#endif  // PYCOIN_SCHNORR_H
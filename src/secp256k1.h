@@ -0,0 +1,694 @@
+/**
+ * @file secp256k1.h
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief Header-only secp256k1 field, scalar and point arithmetic.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef PYCOIN_SECP256K1_H
+#define PYCOIN_SECP256K1_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+ /* The same curve as secp256k1.py, with 256-bit numbers stored as four
+    64-bit limbs (least significant first) and products computed with
+    128-bit multiplies, instead of Python integers.
+
+    Field elements are kept below 2^256 but not necessarily below p;
+    since 2^256 = 0x1000003D1 (mod p), the high half of a product or a
+    carry out of the top limb is folded back by multiplying it by that
+    small constant. normalize() makes the representation unique, and is
+    only needed to compare or serialize.
+
+    Points are in Jacobian coordinates, as in secp256k1.py (Point), so
+    an addition needs no inversion. Converting many points to affine
+    coordinates at once (batch_to_affine) uses Montgomery's trick: one
+    inversion for the whole batch, plus three multiplications per point.
+
+    Multiplying G uses a table of j * 256^i * G (32 windows of 8 bits),
+    built on first use, so k * G is at most 32 mixed additions and no
+    doublings. Multiplying any other point uses a 4-bit fixed window.
+
+    Scalars (numbers mod n) only have what signing needs; products are
+    reduced the same way as field elements, with 2^256 - n (129 bits)
+    in place of 0x1000003D1, and inverses are a^(n - 2).
+
+    Most of this is not constant time: it is meant for speed, and
+    operations on public data (verifying, parsing, multiplying public
+    points with mul and mul_g) branch on the values. What secret keys
+    and nonces go through is written without branches or memory
+    accesses that depend on them: the field and scalar arithmetic
+    (fixed numbers of carry folds, conditional subtractions done with
+    masks, exponentiations by the public p - 2 and n - 2), and mul_g_ct
+    for k * G. That is as far as it goes. The compiler is trusted not
+    to turn the masks back into branches, which has not been checked
+    with a tool, and whatever the callers do outside these functions
+    (turning keys into Python ints, the retry loop of signing on a zero
+    r or s, scalar_is_high on s) is not covered.
+
+    References:
+        - https://www.hyperelliptic.org/EFD/g1p/auto-shortw-jacobian-0.html
+        - https://github.com/bitcoin-core/secp256k1
+ */
+
+namespace secp256k1 {
+
+typedef unsigned __int128 u128;
+
+/* 2^256 - p and 2^256 - n. */
+static const uint64_t FIELD_C = 0x1000003D1ULL;
+static const uint64_t P[4] = {0xFFFFFFFEFFFFFC2FULL, ~0ULL, ~0ULL, ~0ULL};
+static const uint64_t N[4] = {0xBFD25E8CD0364141ULL, 0xBAAEDCE6AF48A03BULL, 0xFFFFFFFFFFFFFFFEULL, ~0ULL};
+static const uint64_t NC[4] = {0x402DA1732FC9BEBFULL, 0x4551231950B75FC4ULL, 1, 0};
+
+inline uint64_t load_be64(const uint8_t *p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i)
+        v = v << 8 | p[i];
+    return v;
+}
+
+inline void store_be64(uint8_t *p, uint64_t v) {
+    for (int i = 7; i >= 0; --i, v >>= 8)
+        p[i] = (uint8_t)v;
+}
+
+/**
+ * @brief Reads a 32-byte big-endian number into limbs.
+ */
+inline void load256(uint64_t r[4], const uint8_t *p) {
+    for (int i = 0; i < 4; ++i)
+        r[3 - i] = load_be64(p + 8 * i);
+}
+
+inline void store256(uint8_t *p, const uint64_t a[4]) {
+    for (int i = 0; i < 4; ++i)
+        store_be64(p + 8 * i, a[3 - i]);
+}
+
+/**
+ * @brief a >= b for 256-bit numbers.
+ */
+inline bool geq(const uint64_t a[4], const uint64_t b[4]) {
+    for (int i = 3; i >= 0; --i)
+        if (a[i] != b[i])
+            return a[i] > b[i];
+    return true;
+}
+
+/**
+ * @brief r = a + b, returning the carry.
+ */
+inline uint64_t add256(uint64_t r[4], const uint64_t a[4], const uint64_t b[4]) {
+    u128 t = 0;
+    for (int i = 0; i < 4; ++i) {
+        t += (u128)a[i] + b[i];
+        r[i] = (uint64_t)t;
+        t >>= 64;
+    }
+    return (uint64_t)t;
+}
+
+/**
+ * @brief r = a + v (v < 2^64), returning the carry.
+ */
+inline uint64_t add_small(uint64_t r[4], const uint64_t a[4], u128 v) {
+    u128 t = v;
+    for (int i = 0; i < 4; ++i) {
+        t += a[i];
+        r[i] = (uint64_t)t;
+        t >>= 64;
+    }
+    return (uint64_t)t;
+}
+
+/* Field elements. */
+
+struct Fe {
+    uint64_t n[4];
+};
+
+inline Fe fe(uint64_t v) { return Fe{{v, 0, 0, 0}}; }
+
+/**
+ * @brief r = a where mask is all ones, r unchanged where it is zero.
+ */
+inline void cmov256(uint64_t r[4], const uint64_t a[4], uint64_t mask) {
+    for (int i = 0; i < 4; ++i)
+        r[i] ^= mask & (r[i] ^ a[i]);
+}
+
+inline Fe fe_normalize(Fe a) {
+    /* a >= p exactly when a + (2^256 - p) carries, and then the sum
+       without the carry is a - p. */
+    uint64_t t[4];
+    uint64_t carry = add_small(t, a.n, FIELD_C);
+    cmov256(a.n, t, 0 - carry);
+    return a;
+}
+
+/**
+ * @brief Reads a big-endian field element, returning false if it is not below p.
+ */
+inline bool fe_load(Fe &r, const uint8_t *p) {
+    load256(r.n, p);
+    return !geq(r.n, P);
+}
+
+inline void fe_store(uint8_t *p, Fe a) {
+    a = fe_normalize(a);
+    store256(p, a.n);
+}
+
+inline bool fe_is_zero(Fe a) {
+    a = fe_normalize(a);
+    return (a.n[0] | a.n[1] | a.n[2] | a.n[3]) == 0;
+}
+
+inline bool fe_equal(Fe a, Fe b) {
+    a = fe_normalize(a), b = fe_normalize(b);
+    return std::memcmp(a.n, b.n, sizeof(a.n)) == 0;
+}
+
+inline bool fe_is_odd(Fe a) { return fe_normalize(a).n[0] & 1; }
+
+/* The carries and borrows below are folded back a fixed number of
+   times, whether they are 0 or 1, so the time taken does not depend on
+   the values. A second fold is all it can take: after a first one that
+   carried, the number is below 2 * FIELD_C. */
+
+inline Fe fe_add(Fe a, Fe b) {
+    Fe r;
+    uint64_t carry = add256(r.n, a.n, b.n);
+    carry = add_small(r.n, r.n, (u128)carry * FIELD_C);
+    add_small(r.n, r.n, (u128)carry * FIELD_C);
+    return r;
+}
+
+inline Fe fe_sub(Fe a, Fe b) {
+    /* A borrow wraps around by 2^256 = FIELD_C (mod p), which is taken
+       back off (and that can only borrow once more). */
+    Fe r;
+    u128 t = 0;
+    uint64_t borrow = 0;
+    for (int i = 0; i < 4; ++i) {
+        t = (u128)a.n[i] - b.n[i] - borrow;
+        r.n[i] = (uint64_t)t;
+        borrow = (uint64_t)(t >> 64) & 1;
+    }
+    for (int round = 0; round < 2; ++round) {
+        uint64_t sub = borrow * FIELD_C;
+        borrow = 0;
+        for (int i = 0; i < 4; ++i) {
+            t = (u128)r.n[i] - sub - borrow;
+            r.n[i] = (uint64_t)t;
+            borrow = (uint64_t)(t >> 64) & 1;
+            sub = 0;
+        }
+    }
+    return r;
+}
+
+inline Fe fe_neg(Fe a) { return fe_sub(fe(0), a); }
+
+inline void fe_cmov(Fe &r, const Fe &a, uint64_t mask) { cmov256(r.n, a.n, mask); }
+
+inline Fe fe_double(Fe a) { return fe_add(a, a); }
+
+/**
+ * @brief Folds a 512-bit product into a field element.
+ */
+inline Fe fe_reduce(const uint64_t t[8]) {
+    Fe r;
+    u128 acc = 0;
+    for (int i = 0; i < 4; ++i) {
+        acc += (u128)t[i] + (u128)t[i + 4] * FIELD_C;
+        r.n[i] = (uint64_t)acc;
+        acc >>= 64;
+    }
+    uint64_t carry = add_small(r.n, r.n, acc * FIELD_C);
+    add_small(r.n, r.n, (u128)carry * FIELD_C);
+    return r;
+}
+
+inline Fe fe_mul(Fe a, Fe b) {
+    uint64_t t[8] = {0};
+    for (int i = 0; i < 4; ++i) {
+        u128 carry = 0;
+        for (int j = 0; j < 4; ++j) {
+            carry += (u128)a.n[i] * b.n[j] + t[i + j];
+            t[i + j] = (uint64_t)carry;
+            carry >>= 64;
+        }
+        t[i + 4] = (uint64_t)carry;
+    }
+    return fe_reduce(t);
+}
+
+inline Fe fe_sqr(Fe a) { return fe_mul(a, a); }
+
+/**
+ * @brief a^e for a 256-bit exponent (square and multiply, most significant bit first).
+ */
+inline Fe fe_pow(Fe a, const uint64_t e[4]) {
+    Fe r = fe(1);
+    for (int i = 255; i >= 0; --i) {
+        r = fe_sqr(r);
+        if (e[i / 64] >> (i % 64) & 1)
+            r = fe_mul(r, a);
+    }
+    return r;
+}
+
+/**
+ * @brief a^-1 = a^(p - 2) (0 for a = 0).
+ */
+inline Fe fe_inv(Fe a) {
+    static const uint64_t e[4] = {P[0] - 2, P[1], P[2], P[3]};
+    return fe_pow(a, e);
+}
+
+/**
+ * @brief A square root of a (as a^((p + 1) / 4), since p = 3 mod 4). Returns
+ * false if a is not a square.
+ */
+inline bool fe_sqrt(Fe &r, Fe a) {
+    static const uint64_t e[4] = {
+        (P[0] + 1) >> 2 | P[1] << 62, P[1] >> 2 | P[2] << 62, P[2] >> 2 | P[3] << 62, P[3] >> 2,
+    };
+    r = fe_pow(a, e);
+    return fe_equal(fe_sqr(r), a);
+}
+
+/* Scalars (integers modulo the group order n). */
+
+struct Scalar {
+    uint64_t n[4];
+};
+
+/**
+ * @brief Reads a big-endian scalar reduced modulo n, returning false if it
+ * was not below n.
+ */
+inline bool scalar_load(Scalar &r, const uint8_t *p) {
+    load256(r.n, p);
+    if (!geq(r.n, N))
+        return true;
+    add256(r.n, r.n, NC);
+    return false;
+}
+
+inline void scalar_store(uint8_t *p, const Scalar &a) { store256(p, a.n); }
+
+inline bool scalar_is_zero(const Scalar &a) { return (a.n[0] | a.n[1] | a.n[2] | a.n[3]) == 0; }
+
+inline Scalar scalar_add(const Scalar &a, const Scalar &b) {
+    /* a + b >= n when the sum or the sum + (2^256 - n) carries, and then
+       the latter (without the carry) is a + b - n. */
+    Scalar r;
+    uint64_t t[4];
+    uint64_t carry = add256(r.n, a.n, b.n);
+    carry |= add256(t, r.n, NC);
+    cmov256(r.n, t, 0 - carry);
+    return r;
+}
+
+inline Scalar scalar_neg(const Scalar &a) {
+    if (scalar_is_zero(a))
+        return a;
+    Scalar r;
+    u128 borrow = 0;
+    for (int i = 0; i < 4; ++i) {
+        u128 t = (u128)N[i] - a.n[i] - borrow;
+        r.n[i] = (uint64_t)t;
+        borrow = t >> 127;
+    }
+    return r;
+}
+
+/**
+ * @brief Reduces a 512-bit number modulo n. Since 2^256 = 2^256 - n
+ * (mod n), a 129-bit constant, the high half is folded back as
+ * high * NC until nothing is left above 2^256 (512 -> 386 -> 260 -> 256
+ * bits, with at most one more round for a carry). All four rounds
+ * always run, carrying through every limb, so the time does not depend
+ * on the number; a round with nothing above 2^256 adds zero.
+ */
+inline Scalar scalar_reduce(const uint64_t t[8]) {
+    uint64_t a[8];
+    std::memcpy(a, t, sizeof(a));
+    for (int round = 0; round < 4; ++round) {
+        uint64_t r[8] = {a[0], a[1], a[2], a[3], 0, 0, 0, 0};
+        for (int i = 0; i < 4; ++i) {
+            u128 carry = 0;
+            for (int j = 0; j < 3; ++j) {
+                carry += (u128)a[i + 4] * NC[j] + r[i + j];
+                r[i + j] = (uint64_t)carry;
+                carry >>= 64;
+            }
+            for (int k = i + 3; k < 8; ++k) {
+                carry += r[k];
+                r[k] = (uint64_t)carry;
+                carry >>= 64;
+            }
+        }
+        std::memcpy(a, r, sizeof(a));
+    }
+    /* Below 2^256 < 2n, so one conditional subtraction of n is enough. */
+    Scalar s;
+    uint64_t u[4];
+    std::memcpy(s.n, a, sizeof(s.n));
+    cmov256(s.n, u, 0 - add256(u, s.n, NC));
+    return s;
+}
+
+inline Scalar scalar_mul(const Scalar &a, const Scalar &b) {
+    uint64_t t[8] = {0};
+    for (int i = 0; i < 4; ++i) {
+        u128 carry = 0;
+        for (int j = 0; j < 4; ++j) {
+            carry += (u128)a.n[i] * b.n[j] + t[i + j];
+            t[i + j] = (uint64_t)carry;
+            carry >>= 64;
+        }
+        t[i + 4] = (uint64_t)carry;
+    }
+    return scalar_reduce(t);
+}
+
+/**
+ * @brief a^-1 = a^(n - 2) mod n (0 for a = 0).
+ */
+inline Scalar scalar_inv(const Scalar &a) {
+    static const uint64_t e[4] = {N[0] - 2, N[1], N[2], N[3]};
+    Scalar r = {{1, 0, 0, 0}};
+    for (int i = 255; i >= 0; --i) {
+        r = scalar_mul(r, r);
+        if (e[i / 64] >> (i % 64) & 1)
+            r = scalar_mul(r, a);
+    }
+    return r;
+}
+
+/**
+ * @brief Whether a > n / 2 (the "high" half, which BIP62 rules out for s).
+ */
+inline bool scalar_is_high(const Scalar &a) {
+    static const uint64_t half[4] = {
+        N[0] >> 1 | N[1] << 63, N[1] >> 1 | N[2] << 63, N[2] >> 1 | N[3] << 63, N[3] >> 1,
+    };
+    return !geq(half, a.n);
+}
+
+/* Points. */
+
+struct Ge {
+    Fe x, y;
+    bool infinity;
+};
+
+struct Gej {
+    Fe x, y, z;
+    bool infinity;
+};
+
+static const Ge G = {
+    {{0x59F2815B16F81798ULL, 0x029BFCDB2DCE28D9ULL, 0x55A06295CE870B07ULL, 0x79BE667EF9DCBBACULL}},
+    {{0x9C47D08FFB10D4B8ULL, 0xFD17B448A6855419ULL, 0x5DA4FBFC0E1108A8ULL, 0x483ADA7726A3C465ULL}},
+    false,
+};
+
+inline Gej gej_infinity() { return Gej{fe(0), fe(1), fe(0), true}; }
+
+inline Gej gej(const Ge &a) { return a.infinity ? gej_infinity() : Gej{a.x, a.y, fe(1), false}; }
+
+inline Ge ge_neg(Ge a) {
+    a.y = fe_neg(a.y);
+    return a;
+}
+
+/**
+ * @brief 2a (dbl-2009-l) for a finite a, without looking at the coordinates.
+ */
+inline Gej gej_double_unchecked(const Gej &a) {
+    Fe A = fe_sqr(a.x), B = fe_sqr(a.y), C = fe_sqr(B);
+    Fe t = fe_add(a.x, B);
+    Fe D = fe_double(fe_sub(fe_sub(fe_sqr(t), A), C));
+    Fe E = fe_add(fe_double(A), A), F = fe_sqr(E);
+    Gej r;
+    r.x = fe_sub(F, fe_double(D));
+    r.y = fe_sub(fe_mul(E, fe_sub(D, r.x)), fe_double(fe_double(fe_double(C))));
+    r.z = fe_double(fe_mul(a.y, a.z));
+    r.infinity = false;
+    return r;
+}
+
+/**
+ * @brief 2a.
+ */
+inline Gej gej_double(const Gej &a) {
+    if (a.infinity || fe_is_zero(a.y))
+        return gej_infinity();
+    return gej_double_unchecked(a);
+}
+
+/**
+ * @brief a + b for an affine b (madd-2007-bl).
+ */
+inline Gej gej_add_ge(const Gej &a, const Ge &b) {
+    if (a.infinity)
+        return gej(b);
+    if (b.infinity)
+        return a;
+    Fe z1z1 = fe_sqr(a.z);
+    Fe u2 = fe_mul(b.x, z1z1), s2 = fe_mul(fe_mul(b.y, a.z), z1z1);
+    Fe h = fe_sub(u2, a.x), rr = fe_double(fe_sub(s2, a.y));
+    if (fe_is_zero(h))
+        return fe_is_zero(rr) ? gej_double(a) : gej_infinity();
+    Fe hh = fe_sqr(h), i = fe_double(fe_double(hh)), j = fe_mul(h, i), v = fe_mul(a.x, i);
+    Gej r;
+    r.x = fe_sub(fe_sub(fe_sqr(rr), j), fe_double(v));
+    r.y = fe_sub(fe_mul(rr, fe_sub(v, r.x)), fe_double(fe_mul(a.y, j)));
+    r.z = fe_sub(fe_sub(fe_sqr(fe_add(a.z, h)), z1z1), hh);
+    r.infinity = false;
+    return r;
+}
+
+/**
+ * @brief a + b for an affine, finite b, like gej_add_ge but without
+ * branches on the coordinates: the doubling (a = b) and infinity
+ * (a = -b, or an infinite a) results are computed too, and the one that
+ * applies picked with masks.
+ */
+inline Gej gej_add_ge_ct(const Gej &a, const Ge &b) {
+    Fe z1z1 = fe_sqr(a.z);
+    Fe u2 = fe_mul(b.x, z1z1), s2 = fe_mul(fe_mul(b.y, a.z), z1z1);
+    Fe h = fe_sub(u2, a.x), rr = fe_double(fe_sub(s2, a.y));
+    Fe hh = fe_sqr(h), i = fe_double(fe_double(hh)), j = fe_mul(h, i), v = fe_mul(a.x, i);
+    Gej r;
+    r.x = fe_sub(fe_sub(fe_sqr(rr), j), fe_double(v));
+    r.y = fe_sub(fe_mul(rr, fe_sub(v, r.x)), fe_double(fe_mul(a.y, j)));
+    r.z = fe_sub(fe_sub(fe_sqr(fe_add(a.z, h)), z1z1), hh);
+    Gej d = gej_double_unchecked(a);
+    uint64_t infinite = 0 - (uint64_t)a.infinity;
+    uint64_t same_x = ~infinite & (0 - (uint64_t)fe_is_zero(h)), same_y = 0 - (uint64_t)fe_is_zero(rr);
+    Fe one = fe(1);
+    fe_cmov(r.x, d.x, same_x & same_y);
+    fe_cmov(r.y, d.y, same_x & same_y);
+    fe_cmov(r.z, d.z, same_x & same_y);
+    fe_cmov(r.x, b.x, infinite);
+    fe_cmov(r.y, b.y, infinite);
+    fe_cmov(r.z, one, infinite);
+    r.infinity = (same_x & ~same_y & 1) != 0;
+    return r;
+}
+
+/**
+ * @brief a + b (add-2007-bl).
+ */
+inline Gej gej_add(const Gej &a, const Gej &b) {
+    if (a.infinity)
+        return b;
+    if (b.infinity)
+        return a;
+    Fe z1z1 = fe_sqr(a.z), z2z2 = fe_sqr(b.z);
+    Fe u1 = fe_mul(a.x, z2z2), u2 = fe_mul(b.x, z1z1);
+    Fe s1 = fe_mul(fe_mul(a.y, b.z), z2z2), s2 = fe_mul(fe_mul(b.y, a.z), z1z1);
+    Fe h = fe_sub(u2, u1), rr = fe_double(fe_sub(s2, s1));
+    if (fe_is_zero(h))
+        return fe_is_zero(rr) ? gej_double(a) : gej_infinity();
+    Fe i = fe_sqr(fe_double(h)), j = fe_mul(h, i), v = fe_mul(u1, i);
+    Gej r;
+    r.x = fe_sub(fe_sub(fe_sqr(rr), j), fe_double(v));
+    r.y = fe_sub(fe_mul(rr, fe_sub(v, r.x)), fe_double(fe_mul(s1, j)));
+    r.z = fe_mul(fe_sub(fe_sub(fe_sqr(fe_add(a.z, b.z)), z1z1), z2z2), h);
+    r.infinity = false;
+    return r;
+}
+
+inline Ge to_affine(const Gej &a) {
+    if (a.infinity)
+        return Ge{fe(0), fe(0), true};
+    Fe zi = fe_inv(a.z), zi2 = fe_sqr(zi);
+    return Ge{fe_mul(a.x, zi2), fe_mul(fe_mul(a.y, zi2), zi), false};
+}
+
+/**
+ * @brief Converts count points to affine coordinates with one inversion.
+ */
+inline void batch_to_affine(const Gej *in, Ge *out, size_t count) {
+    std::vector<Fe> prefix(count);
+    Fe acc = fe(1);
+    for (size_t i = 0; i < count; ++i) {
+        prefix[i] = acc;
+        if (!in[i].infinity)
+            acc = fe_mul(acc, in[i].z);
+    }
+    Fe inv = fe_inv(acc);  // (z_0 * z_1 * ... * z_{count-1})^-1
+    for (size_t i = count; i-- > 0;) {
+        if (in[i].infinity) {
+            out[i] = Ge{fe(0), fe(0), true};
+            continue;
+        }
+        Fe zi = fe_mul(inv, prefix[i]), zi2 = fe_sqr(zi);
+        inv = fe_mul(inv, in[i].z);
+        out[i] = Ge{fe_mul(in[i].x, zi2), fe_mul(fe_mul(in[i].y, zi2), zi), false};
+    }
+}
+
+inline bool on_curve(const Ge &a) {
+    return !a.infinity && fe_equal(fe_sqr(a.y), fe_add(fe_mul(fe_sqr(a.x), a.x), fe(7)));
+}
+
+/**
+ * @brief Parses a SEC encoded point (33 bytes compressed or 65 bytes uncompressed).
+ */
+inline bool ge_load(Ge &r, const uint8_t *p, size_t len) {
+    r.infinity = false;
+    if (len == 33 && (p[0] == 2 || p[0] == 3)) {
+        if (!fe_load(r.x, p + 1))
+            return false;
+        if (!fe_sqrt(r.y, fe_add(fe_mul(fe_sqr(r.x), r.x), fe(7))))
+            return false;
+        if (fe_is_odd(r.y) != (p[0] == 3))
+            r.y = fe_neg(r.y);
+        return true;
+    }
+    if (len == 65 && p[0] == 4)
+        return fe_load(r.x, p + 1) && fe_load(r.y, p + 33) && on_curve(r);
+    return false;
+}
+
+/**
+ * @brief SEC encoding of a (finite) point: 33 bytes compressed, or 65 bytes.
+ */
+inline size_t ge_store(uint8_t *p, const Ge &a, bool compressed = true) {
+    fe_store(p + 1, a.x);
+    if (compressed) {
+        p[0] = fe_is_odd(a.y) ? 3 : 2;
+        return 33;
+    }
+    p[0] = 4;
+    fe_store(p + 33, a.y);
+    return 65;
+}
+
+/**
+ * @brief The table of j * 256^i * G used by mul_g (row i, column j; column 0 unused).
+ */
+struct GTable {
+    Ge t[32][256];
+
+    GTable() {
+        std::vector<Gej> points(32 * 256);
+        Gej base = gej(G);
+        for (int i = 0; i < 32; ++i) {
+            Gej *row = &points[i * 256];
+            row[0] = gej_infinity();
+            row[1] = base;
+            for (int j = 2; j < 256; ++j)
+                row[j] = gej_add(row[j - 1], base);
+            base = gej_add(row[255], base);
+        }
+        batch_to_affine(points.data(), &t[0][0], points.size());
+    }
+};
+
+inline const GTable &g_table() {
+    static const GTable *table = new GTable();  // 576 KiB, never freed.
+    return *table;
+}
+
+/**
+ * @brief k * G, for a public k: the table lookups and skipped zero bytes
+ * depend on k. Use mul_g_ct for secret keys and nonces.
+ */
+inline Gej mul_g(const Scalar &k) {
+    const GTable &table = g_table();
+    Gej r = gej_infinity();
+    for (int i = 0; i < 32; ++i) {
+        unsigned byte = (unsigned)(k.n[i / 8] >> (8 * (i % 8))) & 0xFF;
+        if (byte)
+            r = gej_add_ge(r, table.t[i][byte]);
+    }
+    return r;
+}
+
+/**
+ * @brief k * G for a secret k. Every entry of each table row is read and
+ * the one wanted kept with a mask, a zero byte still adds a point (whose
+ * sum is then dropped), and the additions (gej_add_ge_ct) and the field
+ * arithmetic under them do not branch on values, so neither the memory
+ * touched nor the instructions run depend on k.
+ */
+inline Gej mul_g_ct(const Scalar &k) {
+    const GTable &table = g_table();
+    Gej r = gej_infinity();
+    for (int i = 0; i < 32; ++i) {
+        uint64_t byte = (k.n[i / 8] >> (8 * (i % 8))) & 0xFF;
+        Ge entry = table.t[i][1];
+        for (uint64_t j = 2; j < 256; ++j) {
+            uint64_t mask = 0 - (((j ^ byte) - 1) >> 63);
+            fe_cmov(entry.x, table.t[i][j].x, mask);
+            fe_cmov(entry.y, table.t[i][j].y, mask);
+        }
+        Gej sum = gej_add_ge_ct(r, entry);
+        uint64_t nonzero = 0 - ((0 - byte) >> 63);
+        fe_cmov(r.x, sum.x, nonzero);
+        fe_cmov(r.y, sum.y, nonzero);
+        fe_cmov(r.z, sum.z, nonzero);
+        r.infinity = ((nonzero & sum.infinity) | (~nonzero & r.infinity)) & 1;
+    }
+    return r;
+}
+
+/**
+ * @brief k * a, with a 4-bit fixed window.
+ */
+inline Gej mul(const Gej &a, const Scalar &k) {
+    Gej window[16];
+    window[0] = gej_infinity();
+    window[1] = a;
+    for (int j = 2; j < 16; ++j)
+        window[j] = gej_add(window[j - 1], a);
+    Gej r = gej_infinity();
+    for (int i = 63; i >= 0; --i) {
+        for (int d = 0; d < 4; ++d)
+            r = gej_double(r);
+        unsigned nibble = (unsigned)(k.n[i / 16] >> (4 * (i % 16))) & 15;
+        if (nibble)
+            r = gej_add(r, window[nibble]);
+    }
+    return r;
+}
+
+}  // namespace secp256k1
+
+#endif  // PYCOIN_SECP256K1_H
@@ -15,12 +15,13 @@ purposes.
 from __future__ import annotations
 import doctest
 
-import multiprocessing as mp
 import random
 import struct
 import time
-from typing import NamedTuple
+from typing import Iterator, NamedTuple
 
+from . import backends, sigbatch, workers
+from .sigbatch import SigBatch
 from .utils import bytelength, extract_bits, sha256d
 
 CURVE = (p, a, b, G, n, h) = (
@@ -220,8 +221,12 @@ class Point(NamedTuple):
 
     def affine(self) -> AffinePoint:
         (x, y, z) = self
-        xr = x * pow(z, -2, p) % p
-        yr = y * pow(z, -3, p) % p
+        if z % p == 0:
+            raise ValueError("The point at infinity has no affine coordinates.")
+        zi = inverse(z, p)
+        zi_2 = zi*zi % p
+        xr = x * zi_2 % p
+        yr = y * zi_2 * zi % p
         return AffinePoint(xr, yr)
 
     def __str__(self) -> str:
@@ -388,6 +393,26 @@ def tonelli(n: int, p: int) -> int | None:
 
 G = Point.from_int(G)
 
+
+def py_inverse(a: int, m: int) -> int:
+    return pow(a, -1, m)
+
+
+def py_public_key(key: bytes) -> bytes:
+    """The compressed SEC encoding of key * G."""
+    (x, y) = (int.from_bytes(key, "big") * G).affine()  # type: ignore
+    return bytes([2 + (y & 1)]) + x.to_bytes(32, "big")
+
+
+# The fastest implementations here (see backends.py): inverses for the
+# affine coordinates and signatures, and k * G for the nonce point of
+# a signature, of which only x is needed.
+backends.register("field", backends.REFERENCE, py_inverse, origin=__file__)
+backends.register("point", backends.REFERENCE, py_public_key, origin=__file__)
+inverse = backends.select("field")
+public_key = backends.select("point")
+
+
 def generate(privkey: int, message: bytes = b"") -> tuple[int, int]:
     """Signs a message when given a private key, returning the signature of
     the signed message in the form of a an integer pair (r, s).
@@ -395,14 +420,16 @@ def generate(privkey: int, message: bytes = b"") -> tuple[int, int]:
     References:
         - https://en.wikipedia.org/wiki/Elliptic_Curve_Digital_Signature_Algorithm
     """
-    message_hash = sha256d(message)
-    z = extract_bits(message_hash, start=0, end=256)
+    return sign_hash(privkey, extract_bits(sha256d(message), start=0, end=256))
+
+
+def sign_hash(privkey: int, z: int) -> tuple[int, int]:
+    """generate(), given the message hash as an integer."""
     (r, s) = (0, 0)  # Start with invalid values by default.
     while r == 0 or s == 0:
         k = random.randrange(1, n)
-        (x, y) = (k * G).affine()  # type: ignore
-        r = x % n
-        s = pow(k, -1, n) * (z + r*privkey) % n
+        r = int.from_bytes(public_key(k.to_bytes(32, "big"))[1:], "big") % n
+        s = inverse(k, n) * (z + r*privkey) % n
     return (r, s)
 
 
@@ -412,12 +439,15 @@ def verify(signature: tuple[int, int], pubkey: Point, message: bytes) -> bool:
     References:
         - https://en.wikipedia.org/wiki/Elliptic_Curve_Digital_Signature_Algorithm
     """
-    if not pubkey.on_curve or pubkey == (0, 1, 0):
-        return False
-    message_hash = sha256d(message)
-    z = extract_bits(message_hash, start=0, end=256)
+    return verify_hash(signature, pubkey, extract_bits(sha256d(message), start=0, end=256))
+
+
+def verify_hash(signature: tuple[int, int], pubkey: Point, z: int) -> bool:
+    """verify(), given the message hash as an integer."""
     (r, s) = signature
-    s1 = pow(s, -1, n)
+    if pubkey == (0, 1, 0) or not pubkey.on_curve or s % n == 0:
+        return False
+    s1 = inverse(s, n)
     u1, u2 = (z * s1) % n, (r * s1) % n
     (x, y, z) = point = u1 * G + u2 * pubkey
     if point == (0, 1, 0):
@@ -483,22 +513,72 @@ def decode(signature: bytes) -> tuple[int, int]:
     return (r, s)
 
 
-def generate_sigs(amount: int) -> list:
-    cores = mp.cpu_count()
+# Batches go to the workers (see workers.py) as records packed into one
+# bytes object, 32-byte big-endian integers each, rather than as lists
+# of tuples to pickle:
+#     signing:    privkey, z                  -> r, s
+#     verifying:  r, s, pubkey x, y (affine), z  -> one byte, 1 if valid
+SIGN_RECORD = 64
+VERIFY_RECORD = 160
+
+
+def _ints(data: bytes, size: int) -> Iterator[list[int]]:
+    for i in range(0, len(data), size):
+        yield [int.from_bytes(data[j:j+32], "big") for j in range(i, i + size, 32)]
+
+
+def _sign_records(data: bytes) -> bytes:
+    out = bytearray()
+    for privkey, z in _ints(data, SIGN_RECORD):
+        (r, s) = sign_hash(privkey, z)
+        out += r.to_bytes(32, "big") + s.to_bytes(32, "big")
+    return bytes(out)
+
+
+def _verify_records(data: bytes) -> bytes:
+    return bytes(
+        verify_hash((r, s), Point(x, y), z) for r, s, x, y, z in _ints(data, VERIFY_RECORD)
+    )
+
+
+def pack_verify(params: list) -> bytes:
+    """The verify records of (signature, pubkey, message) triples. The
+    point at infinity is packed as (0, 0), which is not on the curve."""
+    out = bytearray()
+    for (r, s), pubkey, message in params:
+        (x, y) = (0, 0) if pubkey == (0, 1, 0) else pubkey.affine()
+        for v in (r, s, x % p, y % p):
+            out += v.to_bytes(32, "big")
+        out += sha256d(message)  # z, as generate() and verify() read it.
+    return bytes(out)
+
+
+def _run(fn, data: bytes, size: int, pool: workers.Pool | None) -> bytes:
+    """fn over data (records of size bytes), a few slices per worker."""
+    pool = pool or workers.default()
+    count = len(data) // size
+    chunks = [data[i*size:j*size] for i, j in workers.split(count, 4 * pool.workers)]
+    return b"".join(pool.map(fn, chunks))
+
+
+def generate_sigs(amount: int, pool: workers.Pool | None = None) -> list:
     msgs = [random.randbytes(10)] * amount
     keys = [random.randrange(1, n) for _ in range(amount)]
     pubkeys = [k * G for k in keys]
-    with mp.Pool() as pool:
-        sigs = pool.starmap(generate, zip(keys, msgs), chunksize=amount // cores)
+    data = b"".join(
+        k.to_bytes(32, "big") + sha256d(m) for k, m in zip(keys, msgs)
+    )
+    sigs = [tuple(v) for v in _ints(_run(_sign_records, data, SIGN_RECORD, pool), 64)]
     return list(zip(sigs, pubkeys, msgs))
 
 
-def verify_sigs(params: list) -> list:
-    cores = mp.cpu_count()
-    amount = len(params)
-    with mp.Pool() as pool:
-        results = pool.starmap(verify, params, chunksize=amount // cores)
-    return results
+def verify_sigs(params: list | SigBatch, pool: workers.Pool | None = None) -> list:
+    """verify() of each (signature, pubkey, message), on the workers.
+    params can also be a SigBatch, which the workers map and write
+    their results into, so nothing is pickled at all."""
+    if isinstance(params, SigBatch):
+        return sigbatch.verify(params, pool)
+    return [bool(v) for v in _run(_verify_records, pack_verify(params), VERIFY_RECORD, pool)]
 
 # fmt: on
 
@@ -507,10 +587,12 @@ def verify_sigs(params: list) -> list:
 # On my 8 core machine, I was able to increase signature
 # verification rate from ~50/s to ~2,000/s using Projective
 # coordinates instead of affine coordinates, as well as
-# parallel processing.
+# parallel processing (now a pool kept between batches).
 # With GMP, you can expect a speedup by at least an order
 # of magnitude, so somewhere in the thousands of transactions
 # per second range on a single core.
+# scaling.py measures the native verification rate (and its
+# speedup) for each number of threads.
 
 if __name__ == "__main__":
     # Check that things are working as intended.
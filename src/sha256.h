@@ -0,0 +1,319 @@
+/**
+ * @file sha256.h
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief Header-only SHA-256 and double SHA-256 shared by the extensions.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef PYCOIN_SHA256_H
+#define PYCOIN_SHA256_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+ /* Besides the usual streaming interface, there is a multi-buffer
+    version of the compression function that runs SHA256_LANES
+    independent messages in lockstep. Each round is written as a loop
+    over the lanes, so the compiler turns it into SIMD code (SSE2/AVX2
+    depending on -march) without any intrinsics. This is what makes
+    checksumming lots of small P2P messages cheap, since a single
+    message never fills a vector register by itself.
+ */
+
+#define SHA256_LANES 8
+
+namespace sha256 {
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static const uint32_t IV[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+inline uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+inline uint32_t load_be32(const uint8_t *p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | (uint32_t)p[3];
+}
+
+inline void store_be32(uint8_t *p, uint32_t v) {
+    p[0] = v >> 24, p[1] = v >> 16, p[2] = v >> 8, p[3] = v;
+}
+
+inline void store_be64(uint8_t *p, uint64_t v) {
+    store_be32(p, (uint32_t)(v >> 32));
+    store_be32(p + 4, (uint32_t)v);
+}
+
+/**
+ * @brief Compresses a single 64-byte block into the state s.
+ */
+inline void transform(uint32_t s[8], const uint8_t *block) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; ++i)
+        w[i] = load_be32(block + 4 * i);
+    for (int i = 16; i < 64; ++i) {
+        uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+    for (int i = 0; i < 64; ++i) {
+        uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+        uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g, g = f, f = e, e = d + t1;
+        d = c, c = b, b = a, a = t1 + t2;
+    }
+    s[0] += a, s[1] += b, s[2] += c, s[3] += d;
+    s[4] += e, s[5] += f, s[6] += g, s[7] += h;
+}
+
+/**
+ * @brief Compresses one block per lane. The state is stored transposed
+ * (s[word][lane]) so that every operation below is a loop over lanes.
+ */
+inline void transform_lanes(uint32_t s[8][SHA256_LANES], const uint8_t *const blocks[SHA256_LANES]) {
+    uint32_t w[64][SHA256_LANES];
+    uint32_t a[SHA256_LANES], b[SHA256_LANES], c[SHA256_LANES], d[SHA256_LANES];
+    uint32_t e[SHA256_LANES], f[SHA256_LANES], g[SHA256_LANES], h[SHA256_LANES];
+    for (int i = 0; i < 16; ++i)
+        for (int l = 0; l < SHA256_LANES; ++l)
+            w[i][l] = load_be32(blocks[l] + 4 * i);
+    for (int i = 16; i < 64; ++i) {
+        for (int l = 0; l < SHA256_LANES; ++l) {
+            uint32_t s0 = rotr(w[i - 15][l], 7) ^ rotr(w[i - 15][l], 18) ^ (w[i - 15][l] >> 3);
+            uint32_t s1 = rotr(w[i - 2][l], 17) ^ rotr(w[i - 2][l], 19) ^ (w[i - 2][l] >> 10);
+            w[i][l] = w[i - 16][l] + s0 + w[i - 7][l] + s1;
+        }
+    }
+    for (int l = 0; l < SHA256_LANES; ++l) {
+        a[l] = s[0][l], b[l] = s[1][l], c[l] = s[2][l], d[l] = s[3][l];
+        e[l] = s[4][l], f[l] = s[5][l], g[l] = s[6][l], h[l] = s[7][l];
+    }
+    for (int i = 0; i < 64; ++i) {
+        for (int l = 0; l < SHA256_LANES; ++l) {
+            uint32_t t1 = h[l] + (rotr(e[l], 6) ^ rotr(e[l], 11) ^ rotr(e[l], 25))
+                + ((e[l] & f[l]) ^ (~e[l] & g[l])) + K[i] + w[i][l];
+            uint32_t t2 = (rotr(a[l], 2) ^ rotr(a[l], 13) ^ rotr(a[l], 22))
+                + ((a[l] & b[l]) ^ (a[l] & c[l]) ^ (b[l] & c[l]));
+            h[l] = g[l], g[l] = f[l], f[l] = e[l], e[l] = d[l] + t1;
+            d[l] = c[l], c[l] = b[l], b[l] = a[l], a[l] = t1 + t2;
+        }
+    }
+    for (int l = 0; l < SHA256_LANES; ++l) {
+        s[0][l] += a[l], s[1][l] += b[l], s[2][l] += c[l], s[3][l] += d[l];
+        s[4][l] += e[l], s[5][l] += f[l], s[6][l] += g[l], s[7][l] += h[l];
+    }
+}
+
+/**
+ * @brief Streaming SHA-256 context (write as many times as needed,
+ * then finalize once).
+ */
+struct Context {
+    uint32_t s[8];
+    uint8_t buf[64];
+    uint64_t bytes = 0;
+
+    Context() { std::memcpy(s, IV, sizeof(s)); }
+
+    Context &write(const uint8_t *data, size_t len) {
+        size_t fill = bytes % 64;
+        bytes += len;
+        if (fill && fill + len >= 64) {
+            std::memcpy(buf + fill, data, 64 - fill);
+            transform(s, buf);
+            data += 64 - fill, len -= 64 - fill;
+            fill = 0;
+        }
+        for (; len >= 64; data += 64, len -= 64)
+            transform(s, data);
+        std::memcpy(buf + fill, data, len);
+        return *this;
+    }
+
+    void finalize(uint8_t out[32]) {
+        static const uint8_t pad[64] = {0x80};
+        uint8_t size[8];
+        store_be64(size, bytes << 3);
+        write(pad, 1 + ((119 - (bytes % 64)) % 64));
+        write(size, 8);
+        for (int i = 0; i < 8; ++i)
+            store_be32(out + 4 * i, s[i]);
+    }
+};
+
+inline void hash(const uint8_t *data, size_t len, uint8_t out[32]) {
+    Context().write(data, len).finalize(out);
+}
+
+/**
+ * @brief Hashes a 32-byte digest a second time. This is always exactly one
+ * block, so the padding is written in place instead of going through
+ * the streaming context.
+ */
+inline void hash_digest(const uint8_t in[32], uint8_t out[32]) {
+    uint8_t block[64] = {0};
+    std::memcpy(block, in, 32);
+    block[32] = 0x80;
+    block[62] = 0x01;  // 256 bits, big-endian.
+    uint32_t s[8];
+    std::memcpy(s, IV, sizeof(s));
+    transform(s, block);
+    for (int i = 0; i < 8; ++i)
+        store_be32(out + 4 * i, s[i]);
+}
+
+/**
+ * @brief Two rounds of sha256, the same as sha256d in utils.py.
+ */
+inline void sha256d(const uint8_t *data, size_t len, uint8_t out[32]) {
+    uint8_t tmp[32];
+    hash(data, len, tmp);
+    hash_digest(tmp, out);
+}
+
+/**
+ * @brief HMAC-SHA256 with the inner and outer midstates of one key (as
+ * sha512::Hmac), for RFC6979 nonces.
+ */
+struct Hmac {
+    Context inner, outer;
+
+    Hmac(const uint8_t *key, size_t len) {
+        uint8_t k[64] = {0}, pad[64];
+        if (len > 64)
+            hash(key, len, k);
+        else
+            std::memcpy(k, key, len);
+        for (int i = 0; i < 64; ++i)
+            pad[i] = k[i] ^ 0x36;
+        inner.write(pad, 64);
+        for (int i = 0; i < 64; ++i)
+            pad[i] = k[i] ^ 0x5c;
+        outer.write(pad, 64);
+    }
+
+    void mac(const uint8_t *data, size_t len, uint8_t out[32]) const {
+        uint8_t digest[32];
+        Context(inner).write(data, len).finalize(digest);
+        Context(outer).write(digest, 32).finalize(out);
+    }
+};
+
+/**
+ * @brief A context that has absorbed sha256(tag) twice, the prefix of a
+ * BIP340 tagged hash. It is exactly one block, so copies of it are
+ * midstates.
+ */
+inline Context tagged(const char *tag) {
+    uint8_t digest[32];
+    hash(reinterpret_cast<const uint8_t *>(tag), std::strlen(tag), digest);
+    Context ctx;
+    ctx.write(digest, 32).write(digest, 32);
+    return ctx;
+}
+
+/**
+ * @brief Double hashes count messages at once, writing 32 bytes per message
+ * into out. Messages may have different lengths; a lane that finishes
+ * early is refilled with the next pending message (the same scheduling
+ * used by multi-buffer hashing libraries), so short and long messages
+ * can be mixed freely.
+ */
+inline void sha256d_batch(const uint8_t *const *data, const size_t *lens, size_t count, uint8_t *out) {
+    struct Lane {
+        const uint8_t *data;
+        size_t idx, block, nblocks, full;
+        uint8_t tail[128];
+        bool active;
+    };
+    static const uint8_t idle[64] = {0};
+    Lane lanes[SHA256_LANES];
+    uint32_t s[8][SHA256_LANES];
+    const uint8_t *blocks[SHA256_LANES];
+    size_t next = 0;
+
+    for (int l = 0; l < SHA256_LANES; ++l)
+        lanes[l].active = false;
+
+    /* First round: arbitrary length messages. */
+    for (;;) {
+        int running = 0;
+        for (int l = 0; l < SHA256_LANES; ++l) {
+            Lane &ln = lanes[l];
+            if (!ln.active && next < count) {
+                size_t len = lens[next];
+                ln.data = data[next];
+                ln.idx = next++;
+                ln.block = 0;
+                ln.nblocks = (len + 9 + 63) / 64;
+                ln.full = len / 64;
+                size_t rem = len % 64;
+                std::memset(ln.tail, 0, sizeof(ln.tail));
+                std::memcpy(ln.tail, ln.data + ln.full * 64, rem);
+                ln.tail[rem] = 0x80;
+                store_be64(ln.tail + (ln.nblocks - ln.full) * 64 - 8, (uint64_t)len << 3);
+                for (int i = 0; i < 8; ++i)
+                    s[i][l] = IV[i];
+                ln.active = true;
+            }
+            if (ln.active) {
+                ++running;
+                blocks[l] = ln.block < ln.full ? ln.data + ln.block * 64 : ln.tail + (ln.block - ln.full) * 64;
+            } else {
+                blocks[l] = idle;
+            }
+        }
+        if (!running)
+            break;
+        transform_lanes(s, blocks);
+        for (int l = 0; l < SHA256_LANES; ++l) {
+            Lane &ln = lanes[l];
+            if (ln.active && ++ln.block == ln.nblocks) {
+                for (int i = 0; i < 8; ++i)
+                    store_be32(out + 32 * ln.idx + 4 * i, s[i][l]);
+                ln.active = false;
+            }
+        }
+    }
+
+    /* Second round: every input is a 32-byte digest, so each group of
+       lanes is exactly one block and needs no scheduling. */
+    uint8_t padded[SHA256_LANES][64];
+    for (size_t base = 0; base < count; base += SHA256_LANES) {
+        size_t n = count - base < SHA256_LANES ? count - base : SHA256_LANES;
+        for (int l = 0; l < SHA256_LANES; ++l) {
+            std::memset(padded[l], 0, 64);
+            if ((size_t)l < n)
+                std::memcpy(padded[l], out + 32 * (base + l), 32);
+            padded[l][32] = 0x80;
+            padded[l][62] = 0x01;
+            blocks[l] = padded[l];
+            for (int i = 0; i < 8; ++i)
+                s[i][l] = IV[i];
+        }
+        transform_lanes(s, blocks);
+        for (size_t l = 0; l < n; ++l)
+            for (int i = 0; i < 8; ++i)
+                store_be32(out + 32 * (base + l) + 4 * i, s[i][l]);
+    }
+}
+
+}  // namespace sha256
+
+#endif  // PYCOIN_SHA256_H
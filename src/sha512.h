@@ -0,0 +1,170 @@
+/**
+ * @file sha512.h
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief Header-only SHA-512 and HMAC-SHA512 shared by the extensions.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef PYCOIN_SHA512_H
+#define PYCOIN_SHA512_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+ /* HMAC hashes the key (xored with a pad) before the message, in both
+    the inner and the outer hash. Since the padded key is exactly one
+    block, the state after compressing it (the midstate) only depends
+    on the key. Hmac keeps both midstates, so every message hashed under
+    the same key (every child of one BIP32 parent, for example) costs
+    two compressions less: for a short message, two instead of four.
+ */
+
+namespace sha512 {
+
+static const uint64_t K[80] = {
+    0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+    0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+    0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+    0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+    0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+    0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+    0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+    0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+    0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+    0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+    0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+    0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+    0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+    0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+    0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+    0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+    0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+    0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+    0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+    0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL,
+};
+
+static const uint64_t IV[8] = {
+    0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+    0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL,
+};
+
+inline uint64_t rotr(uint64_t x, int n) { return (x >> n) | (x << (64 - n)); }
+
+inline uint64_t load_be64(const uint8_t *p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i)
+        v = v << 8 | p[i];
+    return v;
+}
+
+inline void store_be64(uint8_t *p, uint64_t v) {
+    for (int i = 7; i >= 0; --i, v >>= 8)
+        p[i] = (uint8_t)v;
+}
+
+/**
+ * @brief Compresses a single 128-byte block into the state s.
+ */
+inline void transform(uint64_t s[8], const uint8_t *block) {
+    uint64_t w[80];
+    for (int i = 0; i < 16; ++i)
+        w[i] = load_be64(block + 8 * i);
+    for (int i = 16; i < 80; ++i) {
+        uint64_t s0 = rotr(w[i - 15], 1) ^ rotr(w[i - 15], 8) ^ (w[i - 15] >> 7);
+        uint64_t s1 = rotr(w[i - 2], 19) ^ rotr(w[i - 2], 61) ^ (w[i - 2] >> 6);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint64_t a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+    for (int i = 0; i < 80; ++i) {
+        uint64_t t1 = h + (rotr(e, 14) ^ rotr(e, 18) ^ rotr(e, 41)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+        uint64_t t2 = (rotr(a, 28) ^ rotr(a, 34) ^ rotr(a, 39)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g, g = f, f = e, e = d + t1;
+        d = c, c = b, b = a, a = t1 + t2;
+    }
+    s[0] += a, s[1] += b, s[2] += c, s[3] += d;
+    s[4] += e, s[5] += f, s[6] += g, s[7] += h;
+}
+
+/**
+ * @brief Streaming SHA-512 context. Copying one copies its midstate.
+ */
+struct Context {
+    uint64_t s[8];
+    uint8_t buf[128];
+    uint64_t bytes = 0;
+
+    Context() { std::memcpy(s, IV, sizeof(s)); }
+
+    Context &write(const uint8_t *data, size_t len) {
+        if (len == 0)
+            return *this;
+        size_t fill = bytes % 128;
+        bytes += len;
+        if (fill && fill + len >= 128) {
+            std::memcpy(buf + fill, data, 128 - fill);
+            transform(s, buf);
+            data += 128 - fill, len -= 128 - fill;
+            fill = 0;
+        }
+        for (; len >= 128; data += 128, len -= 128)
+            transform(s, data);
+        std::memcpy(buf + fill, data, len);
+        return *this;
+    }
+
+    void finalize(uint8_t out[64]) {
+        static const uint8_t pad[128] = {0x80};
+        uint8_t size[16] = {0};
+        store_be64(size + 8, bytes << 3);
+        write(pad, 1 + ((239 - (bytes % 128)) % 128));
+        write(size, 16);
+        for (int i = 0; i < 8; ++i)
+            store_be64(out + 8 * i, s[i]);
+    }
+};
+
+inline void hash(const uint8_t *data, size_t len, uint8_t out[64]) {
+    Context().write(data, len).finalize(out);
+}
+
+/**
+ * @brief HMAC-SHA512 with the inner and outer midstates of one key.
+ */
+struct Hmac {
+    Context inner, outer;
+
+    Hmac(const uint8_t *key, size_t len) {
+        uint8_t k[128] = {0}, pad[128];
+        if (len > 128)
+            hash(key, len, k);
+        else
+            std::memcpy(k, key, len);
+        for (int i = 0; i < 128; ++i)
+            pad[i] = k[i] ^ 0x36;
+        inner.write(pad, 128);
+        for (int i = 0; i < 128; ++i)
+            pad[i] = k[i] ^ 0x5c;
+        outer.write(pad, 128);
+    }
+
+    /**
+     * @brief HMAC of the concatenation of two parts (either may be empty).
+     */
+    void mac(const uint8_t *a, size_t alen, const uint8_t *b, size_t blen, uint8_t out[64]) const {
+        uint8_t digest[64];
+        Context(inner).write(a, alen).write(b, blen).finalize(digest);
+        Context(outer).write(digest, 64).finalize(out);
+    }
+
+    void mac(const uint8_t *data, size_t len, uint8_t out[64]) const { mac(data, len, nullptr, 0, out); }
+};
+
+}  // namespace sha512
+
+#endif  // PYCOIN_SHA512_H
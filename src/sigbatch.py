@@ -0,0 +1,167 @@
+"""Batches of ECDSA signatures to verify, in shared memory.
+
+A SigBatch is one multiprocessing.shared_memory block, laid out as
+plain bytes so that any process (or the native code) can use it
+without unpickling anything:
+
+    header   32 bytes: b"PCSB", the version and the number of records
+             (little-endian u32 and u64), then zeros.
+    records  160 bytes each: r, s, the pubkey's affine x and y, and
+             the double SHA-256 of the message, each 32 bytes big-
+             endian (secp256k1.VERIFY_RECORD).
+    results  a bit per record (least significant first), set when its
+             signature is valid.
+
+Workers attach to the block by name, verify a slice of the records
+and set its result bits in place; nothing goes back but a count.
+Slices start at multiples of 8 records, so no two workers write the
+same byte of results. With the txsign extension, records are verified
+natively (ecdsa_verify_batch() in txsign.cpp), otherwise with
+secp256k1.verify_hash().
+
+    with SigBatch.from_params(params) as batch:
+        secp256k1.verify_sigs(batch)      # One bool per signature.
+"""
+
+from __future__ import annotations
+
+import struct
+import sys
+import threading
+from multiprocessing import resource_tracker, shared_memory
+
+from . import workers
+
+try:
+    from . import txsign  # type: ignore
+except ImportError:
+    txsign = None
+
+MAGIC = b"PCSB"
+VERSION = 1
+HEADER = struct.Struct("<4sIQ16x")
+RECORD = 160
+
+_tracker_lock = threading.Lock()
+
+
+def _attach(name: str) -> shared_memory.SharedMemory:
+    """Maps an existing block without registering it with the resource
+    tracker, which would unlink it when this process exits (or warn of
+    a leak), though the creator still uses it."""
+    if sys.version_info >= (3, 13):
+        return shared_memory.SharedMemory(name, track=False)  # type: ignore
+    with _tracker_lock:
+        register = resource_tracker.register
+        resource_tracker.register = lambda name, rtype: None
+        try:
+            return shared_memory.SharedMemory(name)
+        finally:
+            resource_tracker.register = register
+
+
+class SigBatch:
+    """Records and result bits in a shared memory block. The process
+    that created it unlinks the block on close(); the others only
+    unmap it."""
+
+    def __init__(self, shm: shared_memory.SharedMemory, count: int, owner: bool) -> None:
+        self.shm = shm
+        self.count = count
+        self.owner = owner
+
+    @classmethod
+    def create(cls, count: int) -> SigBatch:
+        size = HEADER.size + count * RECORD + (count + 7) // 8
+        with _tracker_lock:
+            shm = shared_memory.SharedMemory(create=True, size=max(size, 1))
+        HEADER.pack_into(shm.buf, 0, MAGIC, VERSION, count)
+        shm.buf[HEADER.size + count * RECORD : size] = bytes(size - HEADER.size - count * RECORD)
+        return cls(shm, count, owner=True)
+
+    @classmethod
+    def from_records(cls, data: bytes) -> SigBatch:
+        batch = cls.create(len(data) // RECORD)
+        batch.shm.buf[HEADER.size : HEADER.size + len(data)] = data
+        return batch
+
+    @classmethod
+    def from_params(cls, params: list) -> SigBatch:
+        """A batch of (signature, pubkey, message) triples, as verify_sigs() takes them."""
+        from .secp256k1 import pack_verify
+
+        return cls.from_records(pack_verify(params))
+
+    @classmethod
+    def attach(cls, name: str) -> SigBatch:
+        shm = _attach(name)
+        magic, version, count = HEADER.unpack_from(shm.buf, 0)
+        if magic != MAGIC or version != VERSION:
+            shm.close()
+            raise ValueError(f"{name} is not a signature batch.")
+        return cls(shm, count, owner=False)
+
+    @property
+    def name(self) -> str:
+        return self.shm.name
+
+    def records(self) -> memoryview:
+        return self.shm.buf[HEADER.size : HEADER.size + self.count * RECORD]
+
+    def results(self) -> memoryview:
+        start = HEADER.size + self.count * RECORD
+        return self.shm.buf[start : start + (self.count + 7) // 8]
+
+    def verify(self, start: int = 0, stop: int | None = None, threads: int = 1) -> int:
+        """Verifies records[start:stop] in this process, setting their
+        bits. Returns how many are valid."""
+        stop = self.count if stop is None else min(stop, self.count)
+        with self.records() as records, self.results() as results:
+            if txsign is not None:
+                return txsign.ecdsa_verify_batch(records, results, start, stop, threads=threads)
+            from .secp256k1 import _verify_records
+
+            valid = _verify_records(bytes(records[start * RECORD : stop * RECORD]))
+            for i, ok in enumerate(valid, start):
+                if ok:
+                    results[i // 8] |= 1 << (i % 8)
+                else:
+                    results[i // 8] &= ~(1 << (i % 8)) & 0xFF
+            return sum(valid)
+
+    def valid(self) -> list[bool]:
+        with self.results() as results:
+            return [bool(results[i // 8] >> (i % 8) & 1) for i in range(self.count)]
+
+    def close(self) -> None:
+        self.shm.close()
+        if self.owner:
+            self.shm.unlink()
+
+    def __enter__(self) -> SigBatch:
+        return self
+
+    def __exit__(self, *exc) -> None:
+        self.close()
+
+    def __len__(self) -> int:
+        return self.count
+
+
+def _verify_slice(name: str, start: int, stop: int) -> int:
+    batch = SigBatch.attach(name)
+    try:
+        return batch.verify(start, stop)
+    finally:
+        batch.close()
+
+
+def verify(batch: SigBatch, pool: workers.Pool | None = None) -> list[bool]:
+    """Verifies every record of the batch on the workers, which write
+    the results into it, and returns them."""
+    pool = pool or workers.default()
+    groups = workers.split((batch.count + 7) // 8, 4 * pool.workers)
+    starts = [8 * i for i, _ in groups]
+    stops = [min(8 * j, batch.count) for _, j in groups]
+    list(pool.map(_verify_slice, [batch.name] * len(groups), starts, stops))
+    return batch.valid()
@@ -0,0 +1,254 @@
+/**
+ * @file sighash.h
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief Header-only signature hashes (legacy, BIP143 and BIP341 key path).
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef PYCOIN_SIGHASH_H
+#define PYCOIN_SIGHASH_H
+
+#include <cstdint>
+#include <cstring>
+
+#include "blockparser.h"
+#include "sha256.h"
+
+ /* The message a signature commits to, for each input of a transaction
+    in a parsed block (see blockparser.h):
+
+        - legacy: the transaction with every other input's script
+          emptied and this one's replaced by the script code, hashed
+          again for every input (so quadratic in the number of inputs).
+        - BIP143 (segwit v0): a fixed-size preimage, made from hashes of
+          all outpoints, sequences and outputs, which are computed once
+          per transaction (Precomputed), plus this input's own fields.
+        - BIP341 (taproot, key path only): the same idea with single
+          SHA-256 hashes, also over the amounts and scripts spent.
+
+    SIGHASH_NONE, SIGHASH_SINGLE and ANYONECANPAY are handled as in
+    Bitcoin Core, including the legacy SIGHASH_SINGLE bug (a hash of 1
+    when there is no output with the input's index). The legacy script
+    code is used as given: removing OP_CODESEPARATORs and the signature
+    itself (FindAndDelete) is left to the caller, and never matters for
+    standard scripts.
+
+    References:
+        - https://github.com/bitcoin/bitcoin/blob/master/src/script/interpreter.cpp
+        - https://github.com/bitcoin/bips/blob/master/bip-0143.mediawiki
+        - https://github.com/bitcoin/bips/blob/master/bip-0341.mediawiki
+ */
+
+#define SIGHASH_DEFAULT 0x00
+#define SIGHASH_ALL 0x01
+#define SIGHASH_NONE 0x02
+#define SIGHASH_SINGLE 0x03
+#define SIGHASH_ANYONECANPAY 0x80
+
+namespace sighash {
+
+using blockparser::Block;
+using blockparser::Output;
+using blockparser::Span;
+using blockparser::Tx;
+
+inline void write_le(sha256::Context &ctx, uint64_t v, int n) {
+    uint8_t b[8];
+    for (int i = 0; i < n; ++i)
+        b[i] = (uint8_t)(v >> (8 * i));
+    ctx.write(b, n);
+}
+
+inline void write_varint(sha256::Context &ctx, uint64_t n) {
+    if (n < 0xFD) {
+        write_le(ctx, n, 1);
+    } else if (n <= 0xFFFF) {
+        write_le(ctx, 0xFD, 1);
+        write_le(ctx, n, 2);
+    } else {
+        write_le(ctx, 0xFE, 1);
+        write_le(ctx, n, 4);
+    }
+}
+
+inline void write_script(sha256::Context &ctx, const uint8_t *script, size_t len) {
+    write_varint(ctx, len);
+    ctx.write(script, len);
+}
+
+inline void write_output(sha256::Context &ctx, const Output &out) {
+    write_le(ctx, (uint64_t)out.value, 8);
+    write_script(ctx, out.script.data, out.script.len);
+}
+
+/**
+ * @brief The hashes shared by every input of a transaction. The taproot
+ * ones need the amount and script of every output spent, and are only
+ * computed when they are given.
+ */
+struct Precomputed {
+    // BIP143 (double SHA-256).
+    uint8_t hash_prevouts[32], hash_sequence[32], hash_outputs[32];
+    // BIP341 (single SHA-256).
+    uint8_t sha_prevouts[32], sha_amounts[32], sha_scripts[32], sha_sequences[32], sha_outputs[32];
+    bool taproot = false;
+
+    Precomputed(const Block &block, const Tx &tx, const int64_t *amounts = nullptr, const Span *scripts = nullptr) {
+        sha256::Context prevouts, sequences, outputs;
+        for (uint32_t i = 0; i < tx.input_count; ++i) {
+            const blockparser::Input &in = block.input(tx, i);
+            prevouts.write(in.prevout, 36);
+            write_le(sequences, in.sequence, 4);
+        }
+        for (uint32_t i = 0; i < tx.output_count; ++i)
+            write_output(outputs, block.output(tx, i));
+        prevouts.finalize(sha_prevouts);
+        sequences.finalize(sha_sequences);
+        outputs.finalize(sha_outputs);
+        sha256::hash_digest(sha_prevouts, hash_prevouts);
+        sha256::hash_digest(sha_sequences, hash_sequence);
+        sha256::hash_digest(sha_outputs, hash_outputs);
+        if (amounts && scripts) {
+            sha256::Context a, s;
+            for (uint32_t i = 0; i < tx.input_count; ++i) {
+                write_le(a, (uint64_t)amounts[i], 8);
+                write_script(s, scripts[i].data, scripts[i].len);
+            }
+            a.finalize(sha_amounts);
+            s.finalize(sha_scripts);
+            taproot = true;
+        }
+    }
+};
+
+/**
+ * @brief The legacy (pre-segwit) signature hash of input i.
+ */
+inline void legacy(const Block &block, const Tx &tx, uint32_t i, const uint8_t *script_code, size_t len,
+                   uint32_t hash_type, uint8_t out[32]) {
+    bool anyone = hash_type & SIGHASH_ANYONECANPAY;
+    uint32_t base = hash_type & 0x1F;
+    bool single = base == SIGHASH_SINGLE, none = base == SIGHASH_NONE;
+    if (single && i >= tx.output_count) {
+        std::memset(out, 0, 32);
+        out[0] = 1;
+        return;
+    }
+    sha256::Context ctx;
+    ctx.write(tx.raw.data, 4);
+    write_varint(ctx, anyone ? 1 : tx.input_count);
+    for (uint32_t j = anyone ? i : 0; j < (anyone ? i + 1 : tx.input_count); ++j) {
+        const blockparser::Input &in = block.input(tx, j);
+        ctx.write(in.prevout, 36);
+        if (j == i)
+            write_script(ctx, script_code, len);
+        else
+            write_varint(ctx, 0);
+        write_le(ctx, j != i && (single || none) ? 0 : in.sequence, 4);
+    }
+    uint32_t outputs = none ? 0 : single ? i + 1 : tx.output_count;
+    write_varint(ctx, outputs);
+    for (uint32_t j = 0; j < outputs; ++j) {
+        if (single && j != i) {
+            write_le(ctx, ~0ULL, 8);
+            write_varint(ctx, 0);
+        } else {
+            write_output(ctx, block.output(tx, j));
+        }
+    }
+    ctx.write(tx.raw.data + tx.raw.len - 4, 4);
+    write_le(ctx, hash_type, 4);
+    uint8_t tmp[32];
+    ctx.finalize(tmp);
+    sha256::hash_digest(tmp, out);
+}
+
+/**
+ * @brief The BIP143 signature hash of input i, spending amount.
+ */
+inline void segwit_v0(const Block &block, const Tx &tx, const Precomputed &pre, uint32_t i, const uint8_t *script_code,
+                      size_t len, int64_t amount, uint32_t hash_type, uint8_t out[32]) {
+    static const uint8_t ZERO[32] = {0};
+    bool anyone = hash_type & SIGHASH_ANYONECANPAY;
+    uint32_t base = hash_type & 0x1F;
+    const blockparser::Input &in = block.input(tx, i);
+    uint8_t single_output[32];
+    const uint8_t *hash_outputs = pre.hash_outputs;
+    if (base == SIGHASH_SINGLE || base == SIGHASH_NONE) {
+        hash_outputs = ZERO;
+        if (base == SIGHASH_SINGLE && i < tx.output_count) {
+            uint8_t tmp[32];
+            sha256::Context ctx;
+            write_output(ctx, block.output(tx, i));
+            ctx.finalize(tmp);
+            sha256::hash_digest(tmp, single_output);
+            hash_outputs = single_output;
+        }
+    }
+    sha256::Context ctx;
+    ctx.write(tx.raw.data, 4);
+    ctx.write(anyone ? ZERO : pre.hash_prevouts, 32);
+    ctx.write(anyone || base == SIGHASH_SINGLE || base == SIGHASH_NONE ? ZERO : pre.hash_sequence, 32);
+    ctx.write(in.prevout, 36);
+    write_script(ctx, script_code, len);
+    write_le(ctx, (uint64_t)amount, 8);
+    write_le(ctx, in.sequence, 4);
+    ctx.write(hash_outputs, 32);
+    ctx.write(tx.raw.data + tx.raw.len - 4, 4);
+    write_le(ctx, hash_type, 4);
+    uint8_t tmp[32];
+    ctx.finalize(tmp);
+    sha256::hash_digest(tmp, out);
+}
+
+/**
+ * @brief The BIP341 signature hash of a key path spend (without annex) of
+ * input i. pre must have the taproot hashes. Returns false for an
+ * invalid hash type, or SIGHASH_SINGLE without a matching output.
+ */
+inline bool taproot(const Block &block, const Tx &tx, const Precomputed &pre, uint32_t i, int64_t amount,
+                    const Span &script, uint32_t hash_type, uint8_t out[32]) {
+    static const sha256::Context TAP_SIGHASH = sha256::tagged("TapSighash");
+    uint32_t base = hash_type & 3;
+    bool anyone = hash_type & SIGHASH_ANYONECANPAY;
+    if (!pre.taproot || (hash_type > 3 && (hash_type < 0x81 || hash_type > 0x83))
+        || (base == SIGHASH_SINGLE && i >= tx.output_count))
+        return false;
+    const blockparser::Input &in = block.input(tx, i);
+    sha256::Context ctx = TAP_SIGHASH;
+    uint8_t header[2] = {0, (uint8_t)hash_type}, spend_type = 0;
+    ctx.write(header, 2).write(tx.raw.data, 4).write(tx.raw.data + tx.raw.len - 4, 4);
+    if (!anyone)
+        ctx.write(pre.sha_prevouts, 32)
+            .write(pre.sha_amounts, 32)
+            .write(pre.sha_scripts, 32)
+            .write(pre.sha_sequences, 32);
+    if (base != SIGHASH_NONE && base != SIGHASH_SINGLE)
+        ctx.write(pre.sha_outputs, 32);
+    ctx.write(&spend_type, 1);
+    if (anyone) {
+        ctx.write(in.prevout, 36);
+        write_le(ctx, (uint64_t)amount, 8);
+        write_script(ctx, script.data, script.len);
+        write_le(ctx, in.sequence, 4);
+    } else {
+        write_le(ctx, i, 4);
+    }
+    if (base == SIGHASH_SINGLE) {
+        uint8_t single_output[32];
+        sha256::Context o;
+        write_output(o, block.output(tx, i));
+        o.finalize(single_output);
+        ctx.write(single_output, 32);
+    }
+    ctx.finalize(out);
+    return true;
+}
+
+}  // namespace sighash
+
+#endif  // PYCOIN_SIGHASH_H
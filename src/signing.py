@@ -0,0 +1,297 @@
+"""Signing every input of a segwit transaction at once.
+
+sign_transaction() takes an unsigned transaction whose inputs spend
+P2WPKH or P2TR outputs, the amount and script of each output spent and
+a private key per input, and returns the transaction with a witness for
+every input:
+
+    - P2WPKH: an ECDSA signature (SIGHASH_ALL, low s, RFC6979 nonce) of
+      the BIP143 sighash, and the compressed public key.
+    - P2TR: a BIP340 Schnorr signature (SIGHASH_DEFAULT) of the BIP341
+      key path sighash, with the key tweaked as in BIP86.
+
+Inputs whose key is None are left with an empty witness, for another
+signer to fill in.
+
+When the txsign extension is built, the parts of the sighashes that are
+the same for every input are hashed once and the inputs are signed on
+several threads (see txsign.cpp). Otherwise the py_* versions below are
+used; both give the same signatures for the same aux.
+
+References:
+    - https://github.com/bitcoin/bips/blob/master/bip-0143.mediawiki
+    - https://github.com/bitcoin/bips/blob/master/bip-0340.mediawiki
+    - https://github.com/bitcoin/bips/blob/master/bip-0341.mediawiki
+    - https://www.rfc-editor.org/rfc/rfc6979
+"""
+
+from __future__ import annotations
+
+import hashlib
+import hmac
+import os
+import struct
+from typing import Iterator, Sequence
+
+from .address import hash160
+from .secp256k1 import G, Point, n, p
+from .utils import int_to_vint, read_vint, sha256d
+
+try:
+    from . import txsign  # type: ignore
+except ImportError:
+    txsign = None
+
+SIGHASH_DEFAULT = 0x00
+SIGHASH_ALL = 0x01
+
+
+def tagged_hash(tag: str, data: bytes) -> bytes:
+    digest = hashlib.sha256(tag.encode()).digest()
+    return hashlib.sha256(digest + digest + data).digest()
+
+
+def _point(key: int) -> tuple[int, int]:
+    return (key * G).affine()  # type: ignore
+
+
+def _lift_x(x: int) -> Point:
+    y = pow((x * x * x + 7) % p, (p + 1) // 4, p)
+    if x >= p or y * y % p != (x * x * x + 7) % p:
+        raise ValueError("invalid public key.")
+    return Point(x, y if y & 1 == 0 else p - y)
+
+
+def _der(r: int, s: int) -> bytes:
+    def integer(v: int) -> bytes:
+        data = v.to_bytes(33, "big").lstrip(b"\x00")
+        data = b"\x00" + data if data[0] & 0x80 else data
+        return bytes([0x02, len(data)]) + data
+
+    body = integer(r) + integer(s)
+    return bytes([0x30, len(body)]) + body
+
+
+def _parse_der(sig: bytes) -> tuple[int, int]:
+    if len(sig) < 8 or sig[0] != 0x30 or sig[1] != len(sig) - 2 or sig[2] != 0x02:
+        raise ValueError("invalid DER signature.")
+    r_len = sig[3]
+    if sig[4 + r_len] != 0x02 or 6 + r_len + sig[5 + r_len] != len(sig):
+        raise ValueError("invalid DER signature.")
+    return int.from_bytes(sig[4 : 4 + r_len], "big"), int.from_bytes(sig[6 + r_len :], "big")
+
+
+def _parse_tx(tx: bytes) -> tuple[bytes, list[tuple[bytes, int]], bytes, bytes]:
+    """Splits a transaction without witnesses into its version, inputs
+    (outpoint, sequence), serialized outputs and locktime."""
+    count, pos = read_vint(tx, 4)
+    inputs = []
+    for _ in range(count):
+        length, end = read_vint(tx, pos + 36)
+        inputs.append((tx[pos : pos + 36], struct.unpack_from("<I", tx, end + length)[0]))
+        pos = end + length + 4
+    start = pos
+    count, pos = read_vint(tx, pos)
+    outputs = count
+    for _ in range(outputs):
+        length, pos = read_vint(tx, pos + 8)
+        pos += length
+    if not inputs or not outputs or pos + 4 != len(tx):
+        raise ValueError("malformed transaction.")
+    return tx[:4], inputs, tx[start:pos], tx[pos:]
+
+
+# Pure-Python versions of the functions in txsign.cpp.
+
+
+def _rfc6979(key: bytes, msg: bytes) -> Iterator[int]:
+    v, k = b"\x01" * 32, b"\x00" * 32
+    msg = (int.from_bytes(msg, "big") % n).to_bytes(32, "big")
+    for round in (b"\x00", b"\x01"):
+        k = hmac.digest(k, v + round + key + msg, "sha256")
+        v = hmac.digest(k, v, "sha256")
+    while True:
+        v = hmac.digest(k, v, "sha256")
+        yield int.from_bytes(v, "big")
+        k = hmac.digest(k, v + b"\x00", "sha256")
+        v = hmac.digest(k, v, "sha256")
+
+
+def _key(key: bytes) -> int:
+    d = int.from_bytes(key, "big")
+    if len(key) != 32 or not 0 < d < n:
+        raise ValueError("invalid private key.")
+    return d
+
+
+def py_ecdsa_sign(key: bytes, msg: bytes) -> bytes:
+    d, z = _key(key), int.from_bytes(msg, "big") % n
+    for k in _rfc6979(key, msg):
+        if not 0 < k < n:
+            continue
+        r = _point(k)[0] % n
+        s = pow(k, -1, n) * (z + r * d) % n
+        if r and s:
+            return _der(r, min(s, n - s))
+    raise AssertionError("unreachable")
+
+
+def py_schnorr_sign(key: bytes, msg: bytes, aux: bytes = bytes(32)) -> bytes:
+    d = _key(key)
+    px, py = _point(d)
+    d = d if py & 1 == 0 else n - d
+    t = (d ^ int.from_bytes(tagged_hash("BIP0340/aux", aux), "big")).to_bytes(32, "big")
+    pxb = px.to_bytes(32, "big")
+    k = int.from_bytes(tagged_hash("BIP0340/nonce", t + pxb + msg), "big") % n
+    rx, ry = _point(k)
+    k = k if ry & 1 == 0 else n - k
+    rxb = rx.to_bytes(32, "big")
+    e = int.from_bytes(tagged_hash("BIP0340/challenge", rxb + pxb + msg), "big") % n
+    return rxb + ((k + e * d) % n).to_bytes(32, "big")
+
+
+def _tweak(key: bytes) -> tuple[int, bytes]:
+    d = _key(key)
+    px, py = _point(d)
+    d = d if py & 1 == 0 else n - d
+    t = int.from_bytes(tagged_hash("TapTweak", px.to_bytes(32, "big")), "big")
+    d = (d + t) % n
+    return d, _point(d)[0].to_bytes(32, "big")
+
+
+def py_taproot_output_key(key: bytes) -> bytes:
+    return _tweak(key)[1]
+
+
+def _is_p2wpkh(script: bytes) -> bool:
+    return len(script) == 22 and script[:2] == b"\x00\x14"
+
+
+def _is_p2tr(script: bytes) -> bool:
+    return len(script) == 34 and script[:2] == b"\x51\x20"
+
+
+def py_sighashes(tx: bytes, amounts: Sequence[int], scripts: Sequence[bytes]) -> list[bytes]:
+    version, inputs, outputs, locktime = _parse_tx(bytes(tx))
+    if len(amounts) != len(inputs) or len(scripts) != len(inputs):
+        raise ValueError("need an amount and a script for every input.")
+    for i, script in enumerate(scripts):
+        if not _is_p2wpkh(script) and not _is_p2tr(script):
+            raise ValueError(f"input {i} does not spend a P2WPKH or P2TR output.")
+    sha = lambda data: hashlib.sha256(data).digest()  # noqa: E731
+    sha_prevouts = sha(b"".join(outpoint for outpoint, _ in inputs))
+    sha_sequences = sha(b"".join(struct.pack("<I", sequence) for _, sequence in inputs))
+    sha_amounts = sha(b"".join(struct.pack("<q", amount) for amount in amounts))
+    sha_scripts = sha(b"".join(int_to_vint(len(script)) + script for script in scripts))
+    sha_outputs = sha(outputs[len(int_to_vint(read_vint(outputs)[0])) :])
+    segwit = version + sha(sha_prevouts) + sha(sha_sequences)
+    taproot = bytes([0, SIGHASH_DEFAULT]) + version + locktime
+    taproot += sha_prevouts + sha_amounts + sha_scripts + sha_sequences + sha_outputs + b"\x00"
+    digests = []
+    for i, ((outpoint, sequence), amount, script) in enumerate(zip(inputs, amounts, scripts)):
+        if _is_p2tr(script):
+            digests.append(tagged_hash("TapSighash", taproot + struct.pack("<I", i)))
+            continue
+        script_code = b"\x19\x76\xa9\x14" + script[2:] + b"\x88\xac"
+        data = segwit + outpoint + script_code + struct.pack("<qI", amount, sequence)
+        data += sha(sha_outputs) + locktime + struct.pack("<I", SIGHASH_ALL)
+        digests.append(sha256d(data))
+    return digests
+
+
+def py_sign_transaction(
+    tx: bytes,
+    amounts: Sequence[int],
+    scripts: Sequence[bytes],
+    keys: Sequence[bytes | None],
+    aux: bytes | None = None,
+    threads: int = 1,
+) -> bytes:
+    tx = bytes(tx)
+    digests = py_sighashes(tx, amounts, scripts)
+    if len(keys) != len(digests):
+        raise ValueError("need a key (or None) for every input.")
+    if aux is not None and len(aux) != 32:
+        raise ValueError("aux must be 32 bytes.")
+    witnesses = []
+    for i, (digest, script, key) in enumerate(zip(digests, scripts, keys)):
+        if key is None:
+            witnesses.append(b"\x00")
+            continue
+        try:
+            d = _key(key)
+        except ValueError:
+            raise ValueError(f"invalid private key for input {i}.") from None
+        if _is_p2tr(script):
+            tweaked, xonly = _tweak(key)
+            if xonly != script[2:]:
+                raise ValueError(f"key does not match the script of input {i}.")
+            sig = py_schnorr_sign(tweaked.to_bytes(32, "big"), digest, aux or bytes(32))
+            witnesses.append(b"\x01\x40" + sig)
+            continue
+        x, y = _point(d)
+        pubkey = bytes([2 + (y & 1)]) + x.to_bytes(32, "big")
+        if hash160(pubkey) != script[2:]:
+            raise ValueError(f"key does not match the script of input {i}.")
+        sig = py_ecdsa_sign(key, digest) + bytes([SIGHASH_ALL])
+        witnesses.append(b"\x02" + bytes([len(sig)]) + sig + b"\x21" + pubkey)
+    return tx[:4] + b"\x00\x01" + tx[4:-4] + b"".join(witnesses) + tx[-4:]
+
+
+if txsign is not None:
+    sighashes = txsign.sighashes
+    ecdsa_sign = txsign.ecdsa_sign
+    schnorr_sign = txsign.schnorr_sign
+    taproot_output_key = txsign.taproot_output_key
+    _sign_transaction = txsign.sign_transaction
+else:
+    sighashes = py_sighashes
+    ecdsa_sign = py_ecdsa_sign
+    schnorr_sign = py_schnorr_sign
+    taproot_output_key = py_taproot_output_key
+    _sign_transaction = py_sign_transaction
+
+
+def ecdsa_verify(pubkey: bytes, msg: bytes, sig: bytes) -> bool:
+    """Verifies a DER signature (without the sighash byte) of a 32-byte
+    hash by a compressed public key."""
+    r, s = _parse_der(sig)
+    if not (0 < r < n and 0 < s < n) or len(pubkey) != 33 or pubkey[0] not in {2, 3}:
+        return False
+    point = _lift_x(int.from_bytes(pubkey[1:], "big"))
+    if pubkey[0] == 3:
+        point = Point(point.x, p - point.y)
+    w = pow(s, -1, n)
+    result = (int.from_bytes(msg, "big") * w % n) * G + (r * w % n) * point
+    return result.z != 0 and result.affine().x % n == r
+
+
+def schnorr_verify(xonly: bytes, msg: bytes, sig: bytes) -> bool:
+    """Verifies a BIP340 signature by an x-only public key."""
+    point = _lift_x(int.from_bytes(xonly, "big"))
+    r, s = int.from_bytes(sig[:32], "big"), int.from_bytes(sig[32:], "big")
+    if len(sig) != 64 or r >= p or s >= n:
+        return False
+    e = int.from_bytes(tagged_hash("BIP0340/challenge", sig[:32] + xonly + msg), "big") % n
+    result = s * G + (n - e) * point
+    if result.z == 0:
+        return False
+    x, y = result.affine()
+    return y & 1 == 0 and x == r
+
+
+def sign_transaction(
+    tx: bytes,
+    amounts: Sequence[int],
+    scripts: Sequence[bytes],
+    keys: Sequence[bytes | None],
+    aux: bytes | None = None,
+    threads: int = 0,
+) -> bytes:
+    """Signs the inputs of an unsigned transaction (without witnesses)
+    that spend outputs with these amounts and scripts, with a 32-byte
+    private key (or None) per input, and returns it with its witnesses.
+    aux is the BIP340 auxiliary randomness of the Schnorr signatures; it
+    is drawn from os.urandom() unless given."""
+    aux = os.urandom(32) if aux is None else aux
+    return _sign_transaction(tx, amounts, scripts, keys, aux=aux, threads=threads or os.cpu_count() or 1)
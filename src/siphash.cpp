@@ -1,7 +1,7 @@
 /**
  * @file siphash.cpp
  * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
- * @brief Siphash-2-4 implementation in C++ (WIP -- not added yet).
+ * @brief Siphash-2-4 implementation in C++.
  * @version 0.1
  * @date 2022-04-04
  *
@@ -11,9 +11,115 @@
 
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
-#include <array>
-#include <cassert>
-#include <immintrin.h>  // Vectorization (can potentially speed up, although unlikely to be used).
 
+#include "metrics.h"
+#include "pymodule.h"
+#include "siphash.h"
 
+ /* The hashing itself lives in siphash.h so other extensions can use
+    it too. The batch function below is what makes this worth doing
+    natively: short ids for a whole set of transactions are computed
+    with one call instead of one Python call (and object) per hash.
+ */
+
+static PyObject *siphash_siphash(PyObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    unsigned long long k0, k1;
+    Py_buffer data;
+    if (!check_nargs("siphash", nargs, 3) || !read_u64(args[0], &k0) || !read_u64(args[1], &k1)
+        || !read_buffer(args[2], &data))
+        return NULL;
+    METRICS_INC(HASHES);
+    uint64_t h = siphash::hash(k0, k1, static_cast<const uint8_t *>(data.buf), data.len);
+    PyBuffer_Release(&data);
+    return PyLong_FromUnsignedLongLong(h);
+}
+
+static PyObject *siphash_siphash_uint256(PyObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    unsigned long long k0, k1;
+    Py_buffer data;
+    if (!check_nargs("siphash_uint256", nargs, 3) || !read_u64(args[0], &k0) || !read_u64(args[1], &k1)
+        || !read_buffer(args[2], &data))
+        return NULL;
+    if (data.len != 32) {
+        PyBuffer_Release(&data);
+        PyErr_SetString(PyExc_ValueError, "expected a 32-byte hash.");
+        return NULL;
+    }
+    METRICS_INC(HASHES);
+    uint64_t h = siphash::hash_uint256(k0, k1, static_cast<const uint8_t *>(data.buf));
+    PyBuffer_Release(&data);
+    return PyLong_FromUnsignedLongLong(h);
+}
+
+static PyObject *siphash_short_ids(PyObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    unsigned long long k0, k1;
+    PyObject *hashes;
+    if (!parse_args(args, nargs, "KKO:short_ids", &k0, &k1, &hashes))
+        return NULL;
+    PyObject *seq = PySequence_Fast(hashes, "expected a sequence of 32-byte hashes.");
+    if (!seq)
+        return NULL;
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    PyObject *result = PyList_New(n);
+    for (Py_ssize_t i = 0; result && i < n; ++i) {
+        Py_buffer h;
+        if (PyObject_GetBuffer(PySequence_Fast_GET_ITEM(seq, i), &h, PyBUF_SIMPLE) < 0) {
+            Py_CLEAR(result);
+            break;
+        }
+        PyObject *item = NULL;
+        if (h.len == 32)
+            item = PyLong_FromUnsignedLong(siphash::short_id(k0, k1, static_cast<const uint8_t *>(h.buf)));
+        else
+            PyErr_SetString(PyExc_ValueError, "expected a sequence of 32-byte hashes.");
+        PyBuffer_Release(&h);
+        if (!item) {
+            Py_CLEAR(result);
+            break;
+        }
+        PyList_SET_ITEM(result, i, item);
+    }
+    Py_DECREF(seq);
+    if (result)
+        METRICS_ADD(HASHES, n);
+    return result;
+}
+
+static PyMethodDef siphash_methods[] = {
+    {"siphash", (PyCFunction)(void (*)(void))siphash_siphash, METH_FASTCALL,
+     "SipHash-2-4 of data under the key (k0, k1)."},
+    {"siphash_uint256", (PyCFunction)(void (*)(void))siphash_siphash_uint256, METH_FASTCALL,
+     "SipHash-2-4 of a 32-byte hash (unrolled)."},
+    {"short_ids", (PyCFunction)(void (*)(void))siphash_short_ids, METH_FASTCALL,
+     "BIP330 32-bit short ids of a sequence of wtxids."},
+    METRICS_METHODS,
+    {NULL, NULL, 0, NULL}
+};
+
+static const Backend siphash_backends[] = {
+    {"siphash", "siphash", ""},
+    {NULL, NULL, NULL}
+};
+
+static int siphash_exec(PyObject *m) {
+    return module_add_backends(m, siphash_backends);
+}
+
+static PyModuleDef_Slot siphash_slots[] = {
+    {Py_mod_exec, (void *)siphash_exec},
+    MODULE_SLOTS
+    {0, NULL}
+};
+
+static struct PyModuleDef siphash_module = {
+    PyModuleDef_HEAD_INIT,
+    "siphash",
+    NULL,
+    0,
+    siphash_methods,
+    siphash_slots
+};
 
+PyMODINIT_FUNC PyInit_siphash(void) {
+    return PyModuleDef_Init(&siphash_module);
+}
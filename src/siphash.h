@@ -0,0 +1,111 @@
+/**
+ * @file siphash.h
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief SipHash-2-4, including a fast path for 32-byte hashes.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef PYCOIN_SIPHASH_H
+#define PYCOIN_SIPHASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+ /* SipHash is a keyed hash with a 128-bit key, cheap enough to hash
+    every transaction id and address we see, while an attacker who does
+    not know the key cannot pick inputs that collide. It is used for
+    short transaction ids (BIP152, BIP330) and for bucketing addresses.
+
+    References:
+        - https://www.aumasson.jp/siphash/siphash.pdf
+        - https://github.com/bitcoin/bitcoin/blob/master/src/crypto/siphash.cpp
+ */
+
+namespace siphash {
+
+#define SIPROUND(v0, v1, v2, v3)                                                                            \
+    do {                                                                                                    \
+        v0 += v1, v1 = rotl(v1, 13), v1 ^= v0, v0 = rotl(v0, 32);                                           \
+        v2 += v3, v3 = rotl(v3, 16), v3 ^= v2;                                                              \
+        v0 += v3, v3 = rotl(v3, 21), v3 ^= v0;                                                              \
+        v2 += v1, v1 = rotl(v1, 17), v1 ^= v2, v2 = rotl(v2, 32);                                           \
+    } while (0)
+
+inline uint64_t rotl(uint64_t x, int b) { return x << b | x >> (64 - b); }
+
+inline uint64_t load_le64(const uint8_t *p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; --i)
+        v = v << 8 | p[i];
+    return v;
+}
+
+/**
+ * @brief SipHash-2-4 of a message under the key (k0, k1).
+ */
+inline uint64_t hash(uint64_t k0, uint64_t k1, const uint8_t *data, size_t len) {
+    uint64_t v0 = 0x736f6d6570736575ULL ^ k0, v1 = 0x646f72616e646f6dULL ^ k1;
+    uint64_t v2 = 0x6c7967656e657261ULL ^ k0, v3 = 0x7465646279746573ULL ^ k1;
+    size_t end = len - len % 8;
+    for (size_t i = 0; i < end; i += 8) {
+        uint64_t m = load_le64(data + i);
+        v3 ^= m;
+        SIPROUND(v0, v1, v2, v3);
+        SIPROUND(v0, v1, v2, v3);
+        v0 ^= m;
+    }
+    uint64_t last = (uint64_t)len << 56;
+    for (size_t i = 0; i < len % 8; ++i)
+        last |= (uint64_t)data[end + i] << (8 * i);
+    v3 ^= last;
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+    v0 ^= last;
+    v2 ^= 0xFF;
+    for (int i = 0; i < 4; ++i)
+        SIPROUND(v0, v1, v2, v3);
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+/**
+ * @brief SipHash-2-4 of a 32-byte hash, with the four message words and
+ * the length block unrolled (same result as hash(k0, k1, h, 32)).
+ */
+inline uint64_t hash_uint256(uint64_t k0, uint64_t k1, const uint8_t h[32]) {
+    uint64_t v0 = 0x736f6d6570736575ULL ^ k0, v1 = 0x646f72616e646f6dULL ^ k1;
+    uint64_t v2 = 0x6c7967656e657261ULL ^ k0, v3 = 0x7465646279746573ULL ^ k1;
+    for (int i = 0; i < 4; ++i) {
+        uint64_t m = load_le64(h + 8 * i);
+        v3 ^= m;
+        SIPROUND(v0, v1, v2, v3);
+        SIPROUND(v0, v1, v2, v3);
+        v0 ^= m;
+    }
+    v3 ^= (uint64_t)32 << 56;
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+    v0 ^= (uint64_t)32 << 56;
+    v2 ^= 0xFF;
+    for (int i = 0; i < 4; ++i)
+        SIPROUND(v0, v1, v2, v3);
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+/**
+ * @brief Erlay (BIP330) short id of a wtxid: never 0, so it is a valid
+ * element of a sketch.
+ */
+inline uint32_t short_id(uint64_t k0, uint64_t k1, const uint8_t wtxid[32]) {
+    return 1 + (uint32_t)(hash_uint256(k0, k1, wtxid) % 0xFFFFFFFFULL);
+}
+
+#undef SIPROUND
+
+}  // namespace siphash
+
+#endif  // PYCOIN_SIPHASH_H
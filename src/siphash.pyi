@@ -0,0 +1,10 @@
+from typing import Sequence
+
+def siphash(k0: int, k1: int, data: bytes) -> int: ...
+def siphash_uint256(k0: int, k1: int, data: bytes) -> int: ...
+def short_ids(k0: int, k1: int, wtxids: Sequence[bytes]) -> list[int]: ...
+def _metrics() -> dict: ...
+def _metrics_reset() -> None: ...
+def _metrics_enable(flag: bool) -> None: ...
+
+BACKENDS: tuple[tuple[str, str, str], ...]
@@ -0,0 +1,81 @@
+/**
+ * @file trace.h
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief Statically defined tracepoints (USDT) in the native hot paths.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef PYCOIN_TRACE_H
+#define PYCOIN_TRACE_H
+
+ /* A probe is a nop instruction plus a note in the shared object saying
+    where it is and where its arguments are; it costs nothing until a
+    tracer (bpftrace, perf, SystemTap) attaches to it and patches in a
+    breakpoint, so the probes are always compiled in, with no logging
+    to turn on. They need <sys/sdt.h> (systemtap-sdt-dev on Debian,
+    systemtap-sdt-devel on Fedora) at build time; without it, or with
+    -DPYCOIN_NO_TRACE, the TRACE macros expand to nothing and their
+    arguments are not evaluated. As in Core, the arguments are integers
+    and C strings only, and durations are in nanoseconds.
+
+    validation (validation.cpp):
+        connect_start(size, threads)
+            a block of size bytes is about to be connected.
+        stage(name, height, duration)
+            a stage (parse, hash, merkle, inputs, scripts, update) ended.
+        connect_end(height, txs, inputs, signatures, duration, valid)
+            the block was connected (or rejected, if valid is 0).
+    utxocache (validation.cpp):
+        flush(height, removed, added, size, duration, applied)
+            the spent coins were removed from the set and the new ones
+            added; if applied is 0 the change was then undone.
+    mining (hashminer.cpp):
+        job(start, stop, threads, bits)
+            a new header is being mined, over nonces [start, stop).
+        share(nonce, thread)
+            a thread found a nonce meeting the target.
+        job_end(nonce, hashes, duration)
+            the search ended; nonce is -1 if none was found.
+
+    For example, the scripts stage of every block connected:
+
+        bpftrace -e 'usdt:src/validation*.so:validation:stage
+            /str(arg0) == "scripts"/ { printf("%d %d us\n", arg1, arg2 / 1000); }'
+
+    and `readelf -n src/validation*.so` lists the probes that were built.
+
+    References:
+        - https://sourceware.org/systemtap/wiki/UserSpaceProbeImplementation
+        - https://github.com/bitcoin/bitcoin/blob/master/doc/tracing.md
+ */
+
+#if defined(__has_include) && !defined(PYCOIN_NO_TRACE)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define PYCOIN_TRACE 1
+#endif
+#endif
+
+#ifdef PYCOIN_TRACE
+#define TRACE(context, event) DTRACE_PROBE(context, event)
+#define TRACE1(context, event, a) DTRACE_PROBE1(context, event, a)
+#define TRACE2(context, event, a, b) DTRACE_PROBE2(context, event, a, b)
+#define TRACE3(context, event, a, b, c) DTRACE_PROBE3(context, event, a, b, c)
+#define TRACE4(context, event, a, b, c, d) DTRACE_PROBE4(context, event, a, b, c, d)
+#define TRACE5(context, event, a, b, c, d, e) DTRACE_PROBE5(context, event, a, b, c, d, e)
+#define TRACE6(context, event, a, b, c, d, e, f) DTRACE_PROBE6(context, event, a, b, c, d, e, f)
+#else
+#define TRACE(context, event)
+#define TRACE1(context, event, a)
+#define TRACE2(context, event, a, b)
+#define TRACE3(context, event, a, b, c)
+#define TRACE4(context, event, a, b, c, d)
+#define TRACE5(context, event, a, b, c, d, e)
+#define TRACE6(context, event, a, b, c, d, e, f)
+#endif
+
+#endif  // PYCOIN_TRACE_H
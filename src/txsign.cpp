@@ -0,0 +1,534 @@
+/**
+ * @file txsign.cpp
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief C++ Python Extension for signing every input of a transaction at once.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "blockparser.h"
+#include "ecdsa.h"
+#include "metrics.h"
+#include "pymodule.h"
+#include "ripemd160.h"
+#include "schnorr.h"
+#include "secp256k1.h"
+#include "sha256.h"
+
+ /* Signing a transaction with hundreds of inputs is mostly the same work
+    repeated, so it is shared:
+
+        - The sighash of every input starts with hashes of all the
+          outpoints, sequences and outputs (BIP143, BIP341). Those are
+          computed once, and so is the SHA-256 midstate after them;
+          each input then only hashes its own ~100 bytes.
+        - Nonces are derived from the key and the sighash (RFC6979 for
+          ECDSA, BIP340's tagged hashes for Schnorr), so signing needs
+          no randomness and is repeatable, and k * G uses the fixed-base
+          table from secp256k1.h.
+        - Inputs are signed on several threads with the GIL released,
+          and the signatures are written into the witness of the signed
+          transaction directly, in one buffer of the exact final size.
+
+    The kind of each input comes from the script of the output it spends:
+    P2WPKH inputs get an ECDSA signature (SIGHASH_ALL, low s) and the
+    public key, P2TR inputs a key path Schnorr signature (SIGHASH_DEFAULT)
+    with the key tweaked as in BIP86 (no script tree). Legacy inputs are
+    not supported, since their sighash cannot share any work.
+
+    ecdsa_verify_batch() checks the records of a sigbatch.SigBatch (see
+    sigbatch.py), which are usually in shared memory, and sets the result
+    bits in place, eight records (one byte of results) at a time per
+    thread, so no two threads or processes write the same byte.
+
+    References:
+        - https://github.com/bitcoin/bips/blob/master/bip-0143.mediawiki
+        - https://github.com/bitcoin/bips/blob/master/bip-0340.mediawiki
+        - https://github.com/bitcoin/bips/blob/master/bip-0341.mediawiki
+        - https://www.rfc-editor.org/rfc/rfc6979
+ */
+
+#define SIGHASH_ALL 1
+#define VERIFY_RECORD 160  // r, s, pubkey x, y (affine) and the message hash, 32 bytes each.
+
+using namespace secp256k1;
+
+enum Kind { P2WPKH, P2TR };
+
+struct Prevout {
+    Kind kind;
+    int64_t amount;
+    std::string script;
+};
+
+/**
+ * @brief The parts of every sighash that do not depend on the input.
+ */
+struct Midstates {
+    sha256::Context segwit;   // BIP143, up to and including hashSequence.
+    uint8_t hash_outputs[32]; // BIP143 (double SHA-256).
+    sha256::Context taproot;  // BIP341, up to and including spend_type.
+    uint32_t locktime;
+};
+
+static void write_le(sha256::Context &ctx, uint64_t v, int n) {
+    uint8_t b[8];
+    for (int i = 0; i < n; ++i)
+        b[i] = (uint8_t)(v >> (8 * i));
+    ctx.write(b, n);
+}
+
+static void write_varint(sha256::Context &ctx, uint64_t n) {
+    uint8_t b = 0xFD;
+    if (n < 0xFD)
+        write_le(ctx, n, 1);
+    else if (n <= 0xFFFF)
+        ctx.write(&b, 1), write_le(ctx, n, 2);
+    else
+        b = 0xFE, ctx.write(&b, 1), write_le(ctx, n, 4);
+}
+
+static void build_midstates(const blockparser::Block &block, const std::vector<Prevout> &prevouts, Midstates &m) {
+    const blockparser::Tx &tx = block.txs[0];
+    const uint8_t *version = tx.raw.data, *locktime = tx.raw.data + tx.raw.len - 4;
+    sha256::Context prevouts_ctx, amounts_ctx, scripts_ctx, sequences_ctx, outputs_ctx;
+    for (uint32_t i = 0; i < tx.input_count; ++i) {
+        const blockparser::Input &in = block.input(tx, i);
+        prevouts_ctx.write(in.prevout, 36);
+        write_le(sequences_ctx, in.sequence, 4);
+        write_le(amounts_ctx, (uint64_t)prevouts[i].amount, 8);
+        write_varint(scripts_ctx, prevouts[i].script.size());
+        scripts_ctx.write(reinterpret_cast<const uint8_t *>(prevouts[i].script.data()), prevouts[i].script.size());
+    }
+    const blockparser::Output &first = block.output(tx, 0), &last = block.output(tx, tx.output_count - 1);
+    const uint8_t *outputs = first.script.data - 8 - (first.script.len < 0xFD ? 1 : first.script.len <= 0xFFFF ? 3 : 5);
+    outputs_ctx.write(outputs, last.script.data + last.script.len - outputs);
+    uint8_t sha_prevouts[32], sha_amounts[32], sha_scripts[32], sha_sequences[32], sha_outputs[32], tmp[32];
+    prevouts_ctx.finalize(sha_prevouts);
+    amounts_ctx.finalize(sha_amounts);
+    scripts_ctx.finalize(sha_scripts);
+    sequences_ctx.finalize(sha_sequences);
+    outputs_ctx.finalize(sha_outputs);
+    // BIP143 uses the double SHA-256 of the same data.
+    m.segwit = sha256::Context();
+    m.segwit.write(version, 4);
+    sha256::hash_digest(sha_prevouts, tmp);
+    m.segwit.write(tmp, 32);
+    sha256::hash_digest(sha_sequences, tmp);
+    m.segwit.write(tmp, 32);
+    sha256::hash_digest(sha_outputs, m.hash_outputs);
+    static const sha256::Context TAP_SIGHASH = sha256::tagged("TapSighash");
+    static const uint8_t epoch_and_type[2] = {0, 0};  // Epoch 0, SIGHASH_DEFAULT.
+    static const uint8_t spend_type = 0;               // Key path, no annex.
+    m.taproot = TAP_SIGHASH;
+    m.taproot.write(epoch_and_type, 2).write(version, 4).write(locktime, 4);
+    m.taproot.write(sha_prevouts, 32).write(sha_amounts, 32).write(sha_scripts, 32);
+    m.taproot.write(sha_sequences, 32).write(sha_outputs, 32).write(&spend_type, 1);
+    m.locktime = (uint32_t)locktime[0] | (uint32_t)locktime[1] << 8 | (uint32_t)locktime[2] << 16
+        | (uint32_t)locktime[3] << 24;
+}
+
+static void sighash(const blockparser::Block &block, const Midstates &m, const Prevout &prevout, uint32_t i,
+                    uint8_t out[32]) {
+    const blockparser::Input &in = block.input(block.txs[0], i);
+    if (prevout.kind == P2TR) {
+        sha256::Context ctx = m.taproot;
+        write_le(ctx, i, 4);
+        ctx.finalize(out);
+        return;
+    }
+    uint8_t script_code[26] = {0x19, 0x76, 0xA9, 0x14};
+    std::memcpy(script_code + 4, prevout.script.data() + 2, 20);
+    script_code[24] = 0x88, script_code[25] = 0xAC;
+    sha256::Context ctx = m.segwit;
+    ctx.write(in.prevout, 36).write(script_code, 26);
+    write_le(ctx, (uint64_t)prevout.amount, 8);
+    write_le(ctx, in.sequence, 4);
+    ctx.write(m.hash_outputs, 32);
+    write_le(ctx, m.locktime, 4);
+    write_le(ctx, SIGHASH_ALL, 4);
+    uint8_t tmp[32];
+    ctx.finalize(tmp);
+    sha256::hash_digest(tmp, out);
+}
+
+/* Argument handling. */
+
+static bool get_prevouts(PyObject *amounts_seq, PyObject *scripts_seq, size_t count, std::vector<Prevout> &out) {
+    PyObject *amounts = PySequence_Fast(amounts_seq, "amounts must be a sequence.");
+    PyObject *scripts = amounts ? PySequence_Fast(scripts_seq, "scripts must be a sequence.") : NULL;
+    bool ok = scripts != NULL;
+    if (ok
+        && ((size_t)PySequence_Fast_GET_SIZE(amounts) != count || (size_t)PySequence_Fast_GET_SIZE(scripts) != count)) {
+        PyErr_SetString(PyExc_ValueError, "need an amount and a script for every input.");
+        ok = false;
+    }
+    for (size_t i = 0; ok && i < count; ++i) {
+        Prevout p;
+        char *script;
+        Py_ssize_t len;
+        p.amount = PyLong_AsLongLong(PySequence_Fast_GET_ITEM(amounts, i));
+        ok = !PyErr_Occurred() && PyBytes_AsStringAndSize(PySequence_Fast_GET_ITEM(scripts, i), &script, &len) == 0;
+        if (!ok)
+            break;
+        p.script.assign(script, len);
+        if (len == 22 && script[0] == 0x00 && script[1] == 0x14) {
+            p.kind = P2WPKH;
+        } else if (len == 34 && script[0] == 0x51 && script[1] == 0x20) {
+            p.kind = P2TR;
+        } else {
+            PyErr_Format(PyExc_ValueError, "input %zu does not spend a P2WPKH or P2TR output.", i);
+            ok = false;
+        }
+        out.push_back(std::move(p));
+    }
+    Py_XDECREF(amounts);
+    Py_XDECREF(scripts);
+    return ok;
+}
+
+static bool parse_tx(const Py_buffer &buf, blockparser::Block &block) {
+    blockparser::Reader r(static_cast<const uint8_t *>(buf.buf), buf.len);
+    if (!blockparser::parse_tx(r, block) || r.p != r.end || block.txs[0].input_count == 0
+        || block.txs[0].output_count == 0) {
+        PyErr_SetString(PyExc_ValueError, "malformed transaction.");
+        return false;
+    }
+    return true;
+}
+
+static PyObject *txsign_sighashes(PyObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    Py_buffer data;
+    PyObject *amounts, *scripts;
+    if (!parse_args(args, nargs, "y*OO:sighashes", &data, &amounts, &scripts))
+        return NULL;
+    blockparser::Block block;
+    std::vector<Prevout> prevouts;
+    PyObject *result = NULL;
+    if (parse_tx(data, block) && get_prevouts(amounts, scripts, block.txs[0].input_count, prevouts)) {
+        Midstates m;
+        build_midstates(block, prevouts, m);
+        result = PyList_New(prevouts.size());
+        for (size_t i = 0; result && i < prevouts.size(); ++i) {
+            uint8_t digest[32];
+            sighash(block, m, prevouts[i], (uint32_t)i, digest);
+            PyList_SET_ITEM(result, i, PyBytes_FromStringAndSize(reinterpret_cast<char *>(digest), 32));
+        }
+    }
+    PyBuffer_Release(&data);
+    return result;
+}
+
+/**
+ * @brief The witness of one input: a signature (and the public key for
+ * P2WPKH), or nothing for inputs without a key.
+ */
+struct Witness {
+    uint8_t sig[ECDSA_MAX_DER_SIZE + 1];
+    uint8_t sig_len = 0;
+    uint8_t pubkey[33];
+    bool mismatch = false;  // The key does not match the script.
+
+    size_t size() const { return sig_len == 0 ? 1 : sig_len == 64 ? 66 : 1 + 1 + sig_len + 1 + 33; }
+
+    uint8_t *write(uint8_t *p) const {
+        if (sig_len == 0) {
+            *p++ = 0;
+        } else if (sig_len == 64) {
+            *p++ = 1, *p++ = 64;
+            std::memcpy(p, sig, 64), p += 64;
+        } else {
+            *p++ = 2, *p++ = sig_len;
+            std::memcpy(p, sig, sig_len), p += sig_len;
+            *p++ = 33;
+            std::memcpy(p, pubkey, 33), p += 33;
+        }
+        return p;
+    }
+};
+
+static void sign_input(const blockparser::Block &block, const Midstates &m, const Prevout &prevout, uint32_t i,
+                       const Scalar &key, const uint8_t aux[32], Witness &w) {
+    uint8_t msg[32];
+    sighash(block, m, prevout, i, msg);
+    if (prevout.kind == P2TR) {
+        uint8_t xonly[32];
+        Scalar tweaked = schnorr::taproot_tweak(key, xonly);
+        w.mismatch = std::memcmp(xonly, prevout.script.data() + 2, 32) != 0;
+        schnorr::sign(tweaked, msg, aux, w.sig);
+        w.sig_len = 64;
+        return;
+    }
+    uint8_t hash[20];
+    ge_store(w.pubkey, to_affine(mul_g_ct(key)));
+    ripemd160::hash160(w.pubkey, 33, hash);
+    w.mismatch = std::memcmp(hash, prevout.script.data() + 2, 20) != 0;
+    w.sig_len = (uint8_t)ecdsa::sign_der(key, msg, w.sig);
+    w.sig[w.sig_len++] = SIGHASH_ALL;
+}
+
+static PyObject *txsign_sign_transaction(PyObject *self, PyObject *args, PyObject *kwds) {
+    static const char *kwlist[] = {"tx", "amounts", "scripts", "keys", "aux", "threads", NULL};
+    Py_buffer data, aux = {NULL, NULL};
+    PyObject *amounts, *scripts, *keys_seq;
+    int threads = 1;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y*OOO|z*i", const_cast<char **>(kwlist), &data, &amounts, &scripts,
+                                     &keys_seq, &aux, &threads))
+        return NULL;
+    blockparser::Block block;
+    std::vector<Prevout> prevouts;
+    std::vector<Scalar> keys;
+    std::vector<char> has_key;
+    PyObject *result = NULL, *keys_fast = NULL;
+    uint8_t aux32[32] = {0};
+    if (aux.buf && aux.len != 32) {
+        PyErr_SetString(PyExc_ValueError, "aux must be 32 bytes.");
+    } else if (parse_tx(data, block) && get_prevouts(amounts, scripts, block.txs[0].input_count, prevouts)
+               && (keys_fast = PySequence_Fast(keys_seq, "keys must be a sequence."))) {
+        if (aux.buf)
+            std::memcpy(aux32, aux.buf, 32);
+        size_t count = prevouts.size();
+        if ((size_t)PySequence_Fast_GET_SIZE(keys_fast) != count)
+            PyErr_SetString(PyExc_ValueError, "need a key (or None) for every input.");
+        for (size_t i = 0; i < count && !PyErr_Occurred(); ++i) {
+            PyObject *item = PySequence_Fast_GET_ITEM(keys_fast, i);
+            Scalar k = {{0, 0, 0, 0}};
+            char *key;
+            Py_ssize_t len;
+            if (item != Py_None && PyBytes_AsStringAndSize(item, &key, &len) == 0
+                && (len != 32 || !scalar_load(k, reinterpret_cast<uint8_t *>(key)) || scalar_is_zero(k)))
+                PyErr_Format(PyExc_ValueError, "invalid private key for input %zu.", i);
+            keys.push_back(k);
+            has_key.push_back(item != Py_None);
+        }
+        if (!PyErr_Occurred()) {
+            Midstates m;
+            std::vector<Witness> witnesses(count);
+            g_table();  // Built once, before any thread needs it.
+            size_t n = std::max<size_t>(1, std::min<size_t>(std::max(threads, 1), count / 16 + 1));
+            Py_BEGIN_ALLOW_THREADS
+            build_midstates(block, prevouts, m);
+            auto work = [&](size_t t) {
+                for (size_t i = t; i < count; i += n)
+                    if (has_key[i])
+                        sign_input(block, m, prevouts[i], (uint32_t)i, keys[i], aux32, witnesses[i]);
+            };
+            std::vector<std::thread> workers;
+            for (size_t t = 1; t < n; ++t)
+                workers.emplace_back(work, t);
+            work(0);
+            for (std::thread &w : workers)
+                w.join();
+            Py_END_ALLOW_THREADS
+            size_t bad = count;
+            for (size_t i = 0; i < count && bad == count; ++i)
+                if (witnesses[i].mismatch)
+                    bad = i;
+            if (bad < count) {
+                PyErr_Format(PyExc_ValueError, "key does not match the script of input %zu.", bad);
+            } else {
+                // version | marker, flag | inputs and outputs | witnesses | locktime
+                const blockparser::Tx &tx = block.txs[0];
+                size_t size = 4 + 2 + tx.body.len + 4;
+                for (const Witness &w : witnesses)
+                    size += w.size();
+                result = PyBytes_FromStringAndSize(NULL, (Py_ssize_t)size);
+                if (result) {
+                    uint8_t *p = reinterpret_cast<uint8_t *>(PyBytes_AS_STRING(result));
+                    std::memcpy(p, tx.raw.data, 4), p += 4;
+                    *p++ = 0, *p++ = 1;
+                    std::memcpy(p, tx.body.data, tx.body.len), p += tx.body.len;
+                    for (const Witness &w : witnesses)
+                        p = w.write(p);
+                    std::memcpy(p, tx.raw.data + tx.raw.len - 4, 4);
+                }
+            }
+        }
+    }
+    Py_XDECREF(keys_fast);
+    PyBuffer_Release(&data);
+    if (aux.buf)
+        PyBuffer_Release(&aux);
+    return result;
+}
+
+static bool get_key_msg(const Py_buffer &key, const Py_buffer &msg, Scalar &k) {
+    if (key.len != 32 || !scalar_load(k, static_cast<const uint8_t *>(key.buf)) || scalar_is_zero(k)) {
+        PyErr_SetString(PyExc_ValueError, "invalid private key.");
+        return false;
+    }
+    if (msg.len != 32) {
+        PyErr_SetString(PyExc_ValueError, "message must be a 32-byte hash.");
+        return false;
+    }
+    return true;
+}
+
+static PyObject *txsign_ecdsa_sign(PyObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    Py_buffer key, msg;
+    if (!parse_args(args, nargs, "y*y*:ecdsa_sign", &key, &msg))
+        return NULL;
+    Scalar k;
+    PyObject *result = NULL;
+    if (get_key_msg(key, msg, k)) {
+        uint8_t sig[ECDSA_MAX_DER_SIZE];
+        size_t len = ecdsa::sign_der(k, static_cast<const uint8_t *>(msg.buf), sig);
+        result = PyBytes_FromStringAndSize(reinterpret_cast<char *>(sig), (Py_ssize_t)len);
+    }
+    PyBuffer_Release(&key);
+    PyBuffer_Release(&msg);
+    return result;
+}
+
+static PyObject *txsign_schnorr_sign(PyObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    Py_buffer key, msg, aux = {NULL, NULL};
+    if (!parse_args(args, nargs, "y*y*|y*:schnorr_sign", &key, &msg, &aux))
+        return NULL;
+    Scalar k;
+    PyObject *result = NULL;
+    if (aux.buf && aux.len != 32) {
+        PyErr_SetString(PyExc_ValueError, "aux must be 32 bytes.");
+    } else if (get_key_msg(key, msg, k)) {
+        uint8_t sig[64], zero[32] = {0};
+        schnorr::sign(k, static_cast<const uint8_t *>(msg.buf), aux.buf ? static_cast<const uint8_t *>(aux.buf) : zero,
+                     sig);
+        result = PyBytes_FromStringAndSize(reinterpret_cast<char *>(sig), 64);
+    }
+    PyBuffer_Release(&key);
+    PyBuffer_Release(&msg);
+    if (aux.buf)
+        PyBuffer_Release(&aux);
+    return result;
+}
+
+static PyObject *txsign_taproot_output_key(PyObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    Py_buffer key;
+    if (!parse_args(args, nargs, "y*:taproot_output_key", &key))
+        return NULL;
+    Scalar k;
+    bool ok = key.len == 32 && scalar_load(k, static_cast<const uint8_t *>(key.buf)) && !scalar_is_zero(k);
+    PyBuffer_Release(&key);
+    if (!ok) {
+        PyErr_SetString(PyExc_ValueError, "invalid private key.");
+        return NULL;
+    }
+    uint8_t xonly[32];
+    schnorr::taproot_tweak(k, xonly);
+    return PyBytes_FromStringAndSize(reinterpret_cast<char *>(xonly), 32);
+}
+
+/**
+ * @brief Whether a verify record holds a valid signature. r, s and the
+ * coordinates must be in range, and the key on the curve.
+ */
+static bool verify_record(const uint8_t *p) {
+    Scalar r, s;
+    Ge q;
+    q.infinity = false;
+    if (!scalar_load(r, p) || !scalar_load(s, p + 32) || !fe_load(q.x, p + 64) || !fe_load(q.y, p + 96)
+        || !on_curve(q))
+        return false;
+    return ecdsa::verify(q, p + 128, r, s);
+}
+
+static PyObject *txsign_ecdsa_verify_batch(PyObject *self, PyObject *args, PyObject *kwds) {
+    static const char *kwlist[] = {"records", "results", "start", "stop", "threads", NULL};
+    Py_buffer records, results;
+    Py_ssize_t start = 0, stop = -1;
+    int threads = 1;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y*w*|nni", const_cast<char **>(kwlist), &records, &results,
+                                     &start, &stop, &threads))
+        return NULL;
+    Py_ssize_t count = records.len / VERIFY_RECORD;
+    if (stop < 0 || stop > count)
+        stop = count;
+    PyObject *result = NULL;
+    if (records.len % VERIFY_RECORD || results.len < (count + 7) / 8 || start < 0 || start % 8 || start > stop) {
+        PyErr_SetString(PyExc_ValueError, "expected 160-byte records, a result bit for each, and start a multiple "
+                                          "of 8.");
+    } else {
+        const uint8_t *data = static_cast<const uint8_t *>(records.buf);
+        uint8_t *bits = static_cast<uint8_t *>(results.buf);
+        size_t first = start / 8, groups = (stop + 7) / 8 - first;
+        size_t n = std::max<size_t>(1, std::min<size_t>(std::max(threads, 1), groups / 8 + 1));
+        std::vector<size_t> valid(n);
+        g_table();  // Built once, before any thread needs it.
+        Py_BEGIN_ALLOW_THREADS
+        auto work = [&](size_t t) {
+            for (size_t g = first + t; g < first + groups; g += n) {
+                uint8_t byte = 0, mask = 0;
+                for (size_t i = 8 * g; i < 8 * g + 8 && i < (size_t)stop; ++i) {
+                    mask |= 1 << (i % 8);
+                    if (verify_record(data + i * VERIFY_RECORD)) {
+                        byte |= 1 << (i % 8);
+                        ++valid[t];
+                    }
+                }
+                bits[g] = (bits[g] & ~mask) | byte;
+            }
+        };
+        std::vector<std::thread> workers;
+        for (size_t t = 1; t < n; ++t)
+            workers.emplace_back(work, t);
+        work(0);
+        for (std::thread &w : workers)
+            w.join();
+        Py_END_ALLOW_THREADS
+        size_t total = 0;
+        for (size_t v : valid)
+            total += v;
+        METRICS_ADD(SIG_VERIFIES, stop - start);
+        METRICS_ADD(SIG_FAILURES, stop - start - total);
+        result = PyLong_FromSize_t(total);
+    }
+    PyBuffer_Release(&records);
+    PyBuffer_Release(&results);
+    return result;
+}
+
+static PyMethodDef txsign_methods[] = {
+    {"sign_transaction", (PyCFunction)(void (*)(void))txsign_sign_transaction, METH_VARARGS | METH_KEYWORDS,
+     "Sign the P2WPKH and P2TR inputs of tx (spending outputs with these amounts and scripts) with keys, "
+     "returning the transaction with witnesses."},
+    {"sighashes", (PyCFunction)(void (*)(void))txsign_sighashes, METH_FASTCALL,
+     "The BIP143 or BIP341 sighash of every input."},
+    {"ecdsa_sign", (PyCFunction)(void (*)(void))txsign_ecdsa_sign, METH_FASTCALL,
+     "Low-s DER ECDSA signature of a 32-byte hash (RFC6979 nonce)."},
+    {"schnorr_sign", (PyCFunction)(void (*)(void))txsign_schnorr_sign, METH_FASTCALL,
+     "BIP340 signature of a 32-byte message."},
+    {"taproot_output_key", (PyCFunction)(void (*)(void))txsign_taproot_output_key, METH_FASTCALL,
+     "The x-only BIP86 output key of an internal private key."},
+    {"ecdsa_verify_batch", (PyCFunction)(void (*)(void))txsign_ecdsa_verify_batch, METH_VARARGS | METH_KEYWORDS,
+     "Verify the 160-byte records[start:stop], setting their bits in results. Returns how many are valid."},
+    METRICS_METHODS,
+    {NULL, NULL, 0, NULL}
+};
+
+static PyModuleDef_Slot txsign_slots[] = {
+    MODULE_SLOTS
+    {0, NULL}
+};
+
+static struct PyModuleDef txsign = {
+    PyModuleDef_HEAD_INIT,
+    "txsign",
+    NULL,
+    0,
+    txsign_methods,
+    txsign_slots
+};
+
+PyMODINIT_FUNC PyInit_txsign(void) {
+    return PyModuleDef_Init(&txsign);
+}
@@ -0,0 +1,24 @@
+from typing import Sequence
+
+def sign_transaction(
+    tx: bytes,
+    amounts: Sequence[int],
+    scripts: Sequence[bytes],
+    keys: Sequence[bytes | None],
+    aux: bytes | None = ...,
+    threads: int = ...,
+) -> bytes: ...
+def sighashes(tx: bytes, amounts: Sequence[int], scripts: Sequence[bytes]) -> list[bytes]: ...
+def ecdsa_sign(key: bytes, msg: bytes) -> bytes: ...
+def schnorr_sign(key: bytes, msg: bytes, aux: bytes = ...) -> bytes: ...
+def taproot_output_key(key: bytes) -> bytes: ...
+def ecdsa_verify_batch(
+    records: bytes | memoryview,
+    results: bytearray | memoryview,
+    start: int = ...,
+    stop: int = ...,
+    threads: int = ...,
+) -> int: ...
+def _metrics() -> dict: ...
+def _metrics_reset() -> None: ...
+def _metrics_enable(flag: bool) -> None: ...
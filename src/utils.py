@@ -4,24 +4,60 @@ from datetime import datetime
 from hashlib import sha256
 from typing import Literal, TypeVar
 
+from . import backends
+
 T = TypeVar("T")
 
 Bit = Literal[0, 1]
 
 
-def sha256d(b: bytes) -> bytes:
+def py_sha256d(b: bytes) -> bytes:
     """Two rounds of sha256."""
     return sha256(sha256(b).digest()).digest()
 
 
+backends.register("hash", backends.REFERENCE, py_sha256d, origin=__file__)
+sha256d = backends.select("hash")
+
+
 def swap_ordering(hexstr: str) -> str:
     """Returns a copy of a hex string with the byte order reversed."""
     rbytes = bytes.fromhex(hexstr)[::-1]
     return rbytes.hex()
 
 
-def int_to_vint(v: int) -> int:
-    ...
+def int_to_vint(v: int) -> bytes:
+    """Encodes an integer as a variable length integer (CompactSize).
+
+    Examples:
+    >>> int_to_vint(252).hex()
+    'fc'
+    >>> int_to_vint(253).hex()
+    'fdfd00'
+    """
+    if v < 0xFD:
+        return bytes([v])
+    if v <= 0xFFFF:
+        return b"\xfd" + v.to_bytes(2, byteorder="little")
+    if v <= 0xFFFFFFFF:
+        return b"\xfe" + v.to_bytes(4, byteorder="little")
+    return b"\xff" + v.to_bytes(8, byteorder="little")
+
+
+def read_vint(data: bytes, offset: int = 0) -> tuple[int, int]:
+    """Decodes a variable length integer (CompactSize) starting at offset,
+    returning the value and the offset just past it.
+
+    Examples:
+    >>> read_vint(bytes.fromhex("fdfd00"))
+    (253, 3)
+    """
+    prefix = data[offset]
+    if prefix < 0xFD:
+        return prefix, offset + 1
+    size = {0xFD: 2, 0xFE: 4, 0xFF: 8}[prefix]
+    value = int.from_bytes(data[offset + 1 : offset + 1 + size], byteorder="little")
+    return value, offset + 1 + size
 
 
 def datetime_to_hex(
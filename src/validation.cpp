@@ -0,0 +1,916 @@
+/**
+ * @file validation.cpp
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief C++ Python Extension for connecting blocks to a UTXO set, timed by stage.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "blockparser.h"
+#include "ecdsa.h"
+#include "memory.h"
+#include "merkle.h"
+#include "metrics.h"
+#include "profiler.h"
+#include "pymodule.h"
+#include "ripemd160.h"
+#include "schnorr.h"
+#include "sighash.h"
+#include "trace.h"
+
+ /* Connecting a block checks it against the UTXO set and then updates the
+    set, in the stages Bitcoin Core goes through (ConnectBlock), each
+    timed separately:
+
+        parse    the block, in place (blockparser.h).
+        hash     the txid and wtxid of every transaction.
+        merkle   the Merkle root in the header and the witness commitment
+                 in the coinbase (BIP141).
+        inputs   find the coin spent by every input (in the UTXO set, or
+                 created earlier in the block), reject double spends and
+                 transactions spending more than their inputs, and check
+                 the coinbase against the subsidy plus fees.
+        scripts  the scripts and signatures of every input.
+        update   remove the spent coins from the set and add the new ones.
+
+    hash and scripts are split between threads (scripts a transaction at
+    a time, with the work shared through an atomic counter, since a few
+    transactions have hundreds of inputs); the other stages are
+    sequential, as they are in Core. The start and end of a connect, and
+    each stage, are also tracepoints (see trace.h), and the stages, the
+    transactions, sighashes and signature checks are profiler zones
+    (profiler.h).
+
+    There is no script interpreter: inputs are checked when they spend
+    one of the standard templates (P2PKH, P2WPKH, P2TR key path, and
+    P2SH, P2WSH or P2SH-P2WSH wrapping P2WPKH or a bare multisig),
+    exactly as the interpreter would for those scripts, and counted as
+    skipped otherwise. Nor are there any consensus checks beyond the
+    above (proof of work, timestamps, weight, sigops, locktimes).
+
+    References:
+        - https://github.com/bitcoin/bitcoin/blob/master/src/validation.cpp
+        - https://github.com/bitcoin/bips/blob/master/bip-0034.mediawiki
+        - https://github.com/bitcoin/bips/blob/master/bip-0141.mediawiki
+ */
+
+#define COIN 100000000LL
+#define SUBSIDY_HALVING_INTERVAL 210000
+#define WITNESS_COMMITMENT_SIZE 38  // OP_RETURN, push 36, 0xaa21a9ed, 32-byte hash.
+
+using blockparser::Span;
+using namespace secp256k1;
+
+struct Outpoint {
+    uint8_t b[36];
+
+    bool operator==(const Outpoint &o) const { return std::memcmp(b, o.b, 36) == 0; }
+};
+
+struct OutpointHasher {
+    size_t operator()(const Outpoint &o) const {
+        uint64_t h, n;
+        std::memcpy(&h, o.b, 8);  // Txids are hashes already.
+        n = (uint64_t)o.b[32] | (uint64_t)o.b[33] << 8;
+        return (size_t)(h ^ n * 0x9E3779B97F4A7C15ULL);
+    }
+};
+
+struct Coin {
+    int64_t value;
+    memory::String<memory::COINS> script;
+};
+
+typedef std::unordered_map<Outpoint, Coin, OutpointHasher, std::equal_to<Outpoint>,
+                           memory::Allocator<std::pair<const Outpoint, Coin>, memory::COINS>>
+    CoinMap;
+
+// Outpoints seen while connecting a block, allocated from its arena.
+template <class T>
+using BlockMap = std::unordered_map<Outpoint, T, OutpointHasher, std::equal_to<Outpoint>,
+                                    memory::ArenaAllocator<std::pair<const Outpoint, T>>>;
+typedef std::unordered_set<Outpoint, OutpointHasher, std::equal_to<Outpoint>, memory::ArenaAllocator<Outpoint>>
+    BlockSet;
+
+/**
+ * @brief The coin spent by an input, pointing into the UTXO set or the
+ * block.
+ */
+struct Spent {
+    int64_t value;
+    Span script;
+};
+
+struct Timings {
+    double parse = 0, hash = 0, merkle = 0, inputs = 0, scripts = 0, update = 0;
+};
+
+struct Counts {
+    size_t inputs = 0, signatures = 0, skipped = 0;
+};
+
+static Outpoint outpoint(const uint8_t *p) {
+    Outpoint o;
+    std::memcpy(o.b, p, 36);
+    return o;
+}
+
+/* Scripts. */
+
+enum Status { VALID, SKIPPED, INVALID };
+
+/**
+ * @brief The data pushed by a push-only script, or false if it has any
+ * other opcode.
+ */
+static bool parse_pushes(Span script, std::vector<Span> &out) {
+    out.clear();
+    const uint8_t *p = script.data, *end = p + script.len;
+    while (p < end) {
+        uint8_t op = *p++;
+        size_t len;
+        if (op < 0x4C) {
+            len = op;
+        } else if (op == 0x4C && end - p >= 1) {
+            len = *p++;
+        } else if (op == 0x4D && end - p >= 2) {
+            len = (size_t)p[0] | (size_t)p[1] << 8;
+            p += 2;
+        } else {
+            return false;
+        }
+        if ((size_t)(end - p) < len)
+            return false;
+        out.push_back(Span{p, len});
+        p += len;
+    }
+    return true;
+}
+
+static bool parse_witness(Span witness, std::vector<Span> &out) {
+    out.clear();
+    if (!witness.len)
+        return true;
+    blockparser::Reader r(witness.data, witness.len);
+    uint64_t items = r.count(1);
+    for (uint64_t i = 0; i < items && r.ok; ++i)
+        out.push_back(r.bytes());
+    return r.ok;
+}
+
+/**
+ * @brief m and the public keys of OP_m <keys> OP_n OP_CHECKMULTISIG.
+ */
+static bool parse_multisig(Span script, int &m, std::vector<Span> &keys) {
+    const uint8_t *s = script.data;
+    size_t len = script.len;
+    if (len < 3 || s[len - 1] != 0xAE || s[0] < 0x51 || s[0] > 0x60 || s[len - 2] < 0x51 || s[len - 2] > 0x60)
+        return false;
+    m = s[0] - 0x50;
+    keys.clear();
+    const uint8_t *p = s + 1, *end = s + len - 2;
+    while (p < end) {
+        uint8_t key_len = *p++;
+        if ((key_len != 33 && key_len != 65) || end - p < key_len)
+            return false;
+        keys.push_back(Span{p, key_len});
+        p += key_len;
+    }
+    return (int)keys.size() == s[len - 2] - 0x50 && m <= (int)keys.size();
+}
+
+static bool is_p2pkh(Span s) {
+    return s.len == 25 && s.data[0] == 0x76 && s.data[1] == 0xA9 && s.data[2] == 0x14 && s.data[23] == 0x88
+        && s.data[24] == 0xAC;
+}
+
+static bool is_p2sh(Span s) { return s.len == 23 && s.data[0] == 0xA9 && s.data[1] == 0x14 && s.data[22] == 0x87; }
+
+static bool is_p2wpkh(Span s) { return s.len == 22 && s.data[0] == 0x00 && s.data[1] == 0x14; }
+
+static bool is_p2wsh(Span s) { return s.len == 34 && s.data[0] == 0x00 && s.data[1] == 0x20; }
+
+static bool is_p2tr(Span s) { return s.len == 34 && s.data[0] == 0x51 && s.data[1] == 0x20; }
+
+/**
+ * @brief What an input is checked against: its transaction, the hashes
+ * shared by its inputs and the coin it spends.
+ */
+struct InputCheck {
+    const blockparser::Block &block;
+    const blockparser::Tx &tx;
+    const sighash::Precomputed &pre;
+    uint32_t index;
+    const Spent &coin;
+    size_t signatures = 0;
+    // Scratch space.
+    std::vector<Span> pushes, witness;
+
+    InputCheck(const blockparser::Block &block, const blockparser::Tx &tx, const sighash::Precomputed &pre,
+               uint32_t index, const Spent &coin)
+        : block(block), tx(tx), pre(pre), index(index), coin(coin) {}
+
+    static bool counted(bool verified) {
+        METRICS_INC(SIG_VERIFIES);
+        if (!verified)
+            METRICS_INC(SIG_FAILURES);
+        return verified;
+    }
+
+    /**
+     * @brief Checks an ECDSA signature (DER and a hash type byte) by key,
+     * over the legacy or BIP143 hash with script_code.
+     */
+    bool ecdsa(Span sig, Span key, Span script_code, bool segwit) {
+        Scalar r, s;
+        Ge q;
+        if (sig.len < 9 || !ecdsa::der_decode(sig.data, sig.len - 1, r, s) || !ge_load(q, key.data, key.len))
+            return false;
+        uint32_t hash_type = sig.data[sig.len - 1];
+        uint8_t digest[32];
+        {
+            PROFILE_ZONE("sighash");
+            if (segwit)
+                sighash::segwit_v0(block, tx, pre, index, script_code.data, script_code.len, coin.value, hash_type,
+                                   digest);
+            else
+                sighash::legacy(block, tx, index, script_code.data, script_code.len, hash_type, digest);
+        }
+        ++signatures;
+        METRICS_TIMER(SIG_VERIFY);
+        PROFILE_ZONE("ecdsa_verify");
+        return counted(ecdsa::verify(q, digest, r, s));
+    }
+
+    Status pubkey_hash(Span sig, Span key, const uint8_t *hash, bool segwit) {
+        uint8_t h[20];
+        ripemd160::hash160(key.data, key.len, h);
+        if (std::memcmp(h, hash, 20) != 0)
+            return INVALID;
+        uint8_t code[25] = {0x76, 0xA9, 0x14};
+        std::memcpy(code + 3, hash, 20);
+        code[23] = 0x88, code[24] = 0xAC;
+        return ecdsa(sig, key, Span{code, 25}, segwit) ? VALID : INVALID;
+    }
+
+    /**
+     * @brief OP_CHECKMULTISIG: the signatures must match keys in order.
+     * sigs starts with the extra (dummy) item, which must be empty.
+     */
+    Status multisig(const std::vector<Span> &sigs, size_t first, size_t last, Span script, bool segwit) {
+        int m;
+        std::vector<Span> keys;
+        if (!parse_multisig(script, m, keys))
+            return SKIPPED;
+        if (last - first != (size_t)m + 1 || sigs[first].len != 0)
+            return INVALID;
+        size_t sig = first + 1, key = 0;
+        while (sig < last) {
+            if (keys.size() - key < last - sig)
+                return INVALID;
+            if (ecdsa(sigs[sig], keys[key], script, segwit))
+                ++sig;
+            ++key;
+        }
+        return VALID;
+    }
+
+    Status witness_v0(Span program) {
+        if (program.len == 20)
+            return witness.size() == 2 ? pubkey_hash(witness[0], witness[1], program.data, true) : INVALID;
+        if (witness.empty())
+            return INVALID;
+        Span script = witness.back();
+        uint8_t h[32];
+        sha256::hash(script.data, script.len, h);
+        if (std::memcmp(h, program.data, 32) != 0)
+            return INVALID;
+        return multisig(witness, 0, witness.size() - 1, script, true);
+    }
+
+    Status taproot() {
+        // Key path only: one item, without an annex.
+        if (witness.size() != 1 || (witness[0].len != 64 && witness[0].len != 65))
+            return SKIPPED;
+        uint32_t hash_type = witness[0].len == 65 ? witness[0].data[64] : SIGHASH_DEFAULT;
+        uint8_t digest[32];
+        if ((witness[0].len == 65 && hash_type == SIGHASH_DEFAULT)
+            || !sighash::taproot(block, tx, pre, index, coin.value, coin.script, hash_type, digest))
+            return INVALID;
+        ++signatures;
+        METRICS_TIMER(SIG_VERIFY);
+        PROFILE_ZONE("schnorr_verify");
+        return counted(schnorr::verify(coin.script.data + 2, digest, witness[0].data)) ? VALID : INVALID;
+    }
+
+    Status check() {
+        METRICS_INC(SCRIPT_EVALS);
+        METRICS_TIMER(SCRIPT_EVAL);
+        return evaluate();
+    }
+
+    Status evaluate() {
+        const blockparser::Input &in = block.input(tx, index);
+        Span script = coin.script;
+        if (!parse_pushes(in.script, pushes) || !parse_witness(in.witness, witness))
+            return is_p2pkh(script) || is_p2sh(script) ? INVALID : SKIPPED;
+        bool empty_sig = in.script.len == 0;
+        if (is_p2pkh(script))
+            return pushes.size() == 2 && witness.empty() ? pubkey_hash(pushes[0], pushes[1], script.data + 3, false)
+                                                         : INVALID;
+        if (is_p2wpkh(script) || is_p2wsh(script))
+            return empty_sig ? witness_v0(Span{script.data + 2, script.len - 2}) : INVALID;
+        if (is_p2tr(script))
+            return empty_sig ? taproot() : INVALID;
+        if (!is_p2sh(script))
+            return SKIPPED;
+        if (pushes.empty())
+            return INVALID;
+        Span redeem = pushes.back();
+        uint8_t h[20];
+        ripemd160::hash160(redeem.data, redeem.len, h);
+        if (std::memcmp(h, script.data + 2, 20) != 0)
+            return INVALID;
+        if (is_p2wpkh(redeem) || is_p2wsh(redeem))
+            return pushes.size() == 1 ? witness_v0(Span{redeem.data + 2, redeem.len - 2}) : INVALID;
+        if (!witness.empty())
+            return INVALID;
+        return multisig(pushes, 0, pushes.size() - 1, redeem, false);
+    }
+};
+
+/* Connecting. */
+
+/**
+ * @brief Everything found while connecting a block, kept for the next
+ * stage.
+ */
+struct Connection {
+    blockparser::Block block;
+    memory::Vector<uint8_t, memory::BLOCK> txids, wtxids;
+    memory::Vector<Spent, memory::BLOCK> spent;  // Per input (the coinbase's is unused).
+    memory::Vector<Outpoint, memory::BLOCK> spent_outpoints;
+    std::string error;
+    int64_t height = -1;  // From the coinbase (BIP34), once parsed.
+    Timings timings;
+    Counts counts;
+};
+
+static int64_t subsidy(int64_t height) {
+    int64_t halvings = height / SUBSIDY_HALVING_INTERVAL;
+    return halvings >= 64 ? 0 : (50 * COIN) >> halvings;
+}
+
+/**
+ * @brief The height in the coinbase script (BIP34), or -1.
+ */
+static int64_t coinbase_height(const blockparser::Input &in) {
+    const uint8_t *s = in.script.data;
+    if (in.script.len < 1 || s[0] < 1 || s[0] > 8 || in.script.len < (size_t)s[0] + 1)
+        return -1;
+    int64_t height = 0;
+    for (int i = s[0]; i >= 1; --i)
+        height = height << 8 | s[i];
+    return height;
+}
+
+template <class F>
+static void parallel(size_t count, int threads, F &&work) {
+    std::atomic<size_t> next{0};
+    auto run = [&]() {
+        PROFILE_ZONE("worker");
+        for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count;)
+            work(i);
+    };
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; ++t)
+        workers.emplace_back(run);
+    run();
+    for (std::thread &w : workers)
+        w.join();
+}
+
+static void hash_stage(Connection &c, int threads) {
+    PROFILE_ZONE("hash");
+    size_t count = c.block.txs.size();
+    c.txids.resize(32 * count);
+    c.wtxids.resize(32 * count);
+    parallel(count, threads, [&](size_t i) {
+        const blockparser::Tx &tx = c.block.txs[i];
+        tx.txid(&c.txids[32 * i]);
+        METRICS_ADD(HASHES, i > 0 && tx.segwit ? 2 : 1);
+        if (i == 0)
+            std::memset(&c.wtxids[0], 0, 32);  // The coinbase's wtxid is taken to be 0.
+        else if (tx.segwit)
+            sha256::sha256d(tx.raw.data, tx.raw.len, &c.wtxids[32 * i]);
+        else
+            std::memcpy(&c.wtxids[32 * i], &c.txids[32 * i], 32);
+    });
+}
+
+static bool merkle_stage(Connection &c) {
+    PROFILE_ZONE("merkle");
+    uint8_t root[32];
+    merkle::root(c.txids.data(), c.block.txs.size(), root);
+    if (std::memcmp(root, c.block.header + 36, 32) != 0) {
+        c.error = "bad merkle root.";
+        return false;
+    }
+    bool segwit = false;
+    for (const blockparser::Tx &tx : c.block.txs)
+        segwit |= tx.segwit;
+    const blockparser::Tx &coinbase = c.block.txs[0];
+    const blockparser::Output *commitment = NULL;
+    for (uint32_t i = 0; i < coinbase.output_count; ++i) {
+        const blockparser::Output &out = c.block.output(coinbase, i);
+        static const uint8_t prefix[6] = {0x6A, 0x24, 0xAA, 0x21, 0xA9, 0xED};
+        if (out.script.len >= WITNESS_COMMITMENT_SIZE && std::memcmp(out.script.data, prefix, 6) == 0)
+            commitment = &out;
+    }
+    if (!commitment) {
+        if (segwit)
+            c.error = "missing witness commitment.";
+        return !segwit;
+    }
+    std::vector<Span> items;
+    const blockparser::Input &in = c.block.input(coinbase, 0);
+    if (!parse_witness(in.witness, items) || items.size() != 1 || items[0].len != 32) {
+        c.error = "bad witness reserved value.";
+        return false;
+    }
+    uint8_t data[64], expected[32];
+    merkle::root(c.wtxids.data(), c.block.txs.size(), data);
+    std::memcpy(data + 32, items[0].data, 32);
+    sha256::sha256d(data, 64, expected);
+    if (std::memcmp(expected, commitment->script.data + 6, 32) != 0) {
+        c.error = "bad witness commitment.";
+        return false;
+    }
+    return true;
+}
+
+static bool inputs_stage(Connection &c, const CoinMap &coins) {
+    PROFILE_ZONE("inputs");
+    const blockparser::Block &block = c.block;
+    memory::Arena arena(memory::BLOCK);
+    // Outputs created earlier in the block, by outpoint.
+    BlockMap<const blockparser::Output *> created(block.outputs.size(), memory::ArenaAllocator<Outpoint>(arena));
+    BlockSet spent(block.inputs.size(), memory::ArenaAllocator<Outpoint>(arena));
+    c.spent.assign(block.inputs.size(), Spent{0, Span{nullptr, 0}});
+    c.spent_outpoints.clear();
+    int64_t fees = 0;
+    for (size_t t = 0; t < block.txs.size(); ++t) {
+        const blockparser::Tx &tx = block.txs[t];
+        int64_t in_value = 0, out_value = 0;
+        for (uint32_t i = 0; t > 0 && i < tx.input_count; ++i) {
+            Outpoint o = outpoint(block.input(tx, i).prevout);
+            Spent &s = c.spent[tx.first_input + i];
+            auto here = created.find(o);
+            METRICS_INC(UTXO_LOOKUPS);
+            if (here != created.end()) {
+                METRICS_INC(CACHE_HITS);
+                s = Spent{here->second->value, here->second->script};
+                created.erase(here);
+            } else {
+                METRICS_INC(CACHE_MISSES);
+                auto coin = coins.find(o);
+                if (coin == coins.end() || !spent.insert(o).second) {
+                    c.error = "missing or spent input (tx " + std::to_string(t) + ").";
+                    return false;
+                }
+                const auto &script = coin->second.script;
+                s = Spent{coin->second.value, Span{reinterpret_cast<const uint8_t *>(script.data()), script.size()}};
+                c.spent_outpoints.push_back(o);
+            }
+            in_value += s.value;
+            ++c.counts.inputs;
+        }
+        Outpoint o;
+        std::memcpy(o.b, &c.txids[32 * t], 32);
+        for (uint32_t i = 0; i < tx.output_count; ++i) {
+            const blockparser::Output &out = block.output(tx, i);
+            if (out.value < 0 || out.value > 21000000 * COIN) {
+                c.error = "bad output value (tx " + std::to_string(t) + ").";
+                return false;
+            }
+            out_value += out.value;
+            for (int b = 0; b < 4; ++b)
+                o.b[32 + b] = (uint8_t)(i >> (8 * b));
+            if (out.script.len && out.script.data[0] != 0x6A)  // OP_RETURN outputs are never coins.
+                created[o] = &out;
+        }
+        if (t == 0)
+            continue;
+        if (in_value < out_value) {
+            c.error = "outputs exceed inputs (tx " + std::to_string(t) + ").";
+            return false;
+        }
+        fees += in_value - out_value;
+    }
+    const blockparser::Tx &coinbase = block.txs[0];
+    int64_t height = c.height, reward = 0;
+    for (uint32_t i = 0; i < coinbase.output_count; ++i)
+        reward += block.output(coinbase, i).value;
+    if (height < 0 || reward > subsidy(height) + fees) {
+        c.error = "bad coinbase.";
+        return false;
+    }
+    return true;
+}
+
+static bool scripts_stage(Connection &c, int threads) {
+    PROFILE_ZONE("scripts");
+    const blockparser::Block &block = c.block;
+    size_t count = block.txs.size();
+    std::vector<Status> status(count, VALID);
+    std::vector<size_t> signatures(count, 0), skipped(count, 0);
+    parallel(count - 1, threads, [&](size_t k) {
+        PROFILE_ZONE("tx");
+        size_t t = k + 1;
+        const blockparser::Tx &tx = block.txs[t];
+        const Spent *spent = &c.spent[tx.first_input];
+        bool taproot = false;
+        for (uint32_t i = 0; i < tx.input_count; ++i)
+            taproot |= is_p2tr(spent[i].script);
+        std::vector<int64_t> amounts;
+        std::vector<Span> scripts;
+        if (taproot) {
+            for (uint32_t i = 0; i < tx.input_count; ++i) {
+                amounts.push_back(spent[i].value);
+                scripts.push_back(spent[i].script);
+            }
+        }
+        sighash::Precomputed pre(block, tx, taproot ? amounts.data() : nullptr, taproot ? scripts.data() : nullptr);
+        for (uint32_t i = 0; i < tx.input_count && status[t] != INVALID; ++i) {
+            InputCheck check(block, tx, pre, i, spent[i]);
+            Status s = check.check();
+            signatures[t] += check.signatures;
+            if (s == SKIPPED)
+                ++skipped[t];
+            else if (s == INVALID)
+                status[t] = INVALID;
+        }
+    });
+    for (size_t t = 1; t < count; ++t) {
+        c.counts.signatures += signatures[t];
+        c.counts.skipped += skipped[t];
+        if (status[t] == INVALID && c.error.empty())
+            c.error = "script verification failed (tx " + std::to_string(t) + ").";
+    }
+    return c.error.empty();
+}
+
+/**
+ * @brief Removes the spent coins and adds the new ones, moving the spent
+ * ones into undo (to put back if the block is not to be kept).
+ */
+static void update_stage(Connection &c, CoinMap &coins, std::vector<std::pair<Outpoint, Coin>> &undo,
+                         std::vector<Outpoint> &added) {
+    PROFILE_ZONE("update");
+    const blockparser::Block &block = c.block;
+    for (const Outpoint &o : c.spent_outpoints) {
+        auto it = coins.find(o);
+        undo.emplace_back(o, std::move(it->second));
+        coins.erase(it);
+    }
+    // Outputs spent in the same block never reach the set.
+    memory::Arena arena(memory::BLOCK);
+    BlockSet spent_here(block.inputs.size(), memory::ArenaAllocator<Outpoint>(arena));
+    for (size_t t = 1; t < block.txs.size(); ++t)
+        for (uint32_t i = 0; i < block.txs[t].input_count; ++i)
+            spent_here.insert(outpoint(block.input(block.txs[t], i).prevout));
+    Outpoint o;
+    for (size_t t = 0; t < block.txs.size(); ++t) {
+        const blockparser::Tx &tx = block.txs[t];
+        std::memcpy(o.b, &c.txids[32 * t], 32);
+        for (uint32_t i = 0; i < tx.output_count; ++i) {
+            const blockparser::Output &out = block.output(tx, i);
+            for (int b = 0; b < 4; ++b)
+                o.b[32 + b] = (uint8_t)(i >> (8 * b));
+            if (!out.script.len || out.script.data[0] == 0x6A || spent_here.count(o))
+                continue;
+            coins[o] = Coin{out.value, {reinterpret_cast<const char *>(out.script.data), out.script.len}};
+            added.push_back(o);
+        }
+    }
+}
+
+/**
+ * @brief Connects a block to coins, timing each stage. The coins are only
+ * changed if the block is valid and apply is set.
+ */
+static bool connect_stages(const uint8_t *data, size_t len, CoinMap &coins, int threads, bool apply, Connection &c) {
+    typedef std::chrono::steady_clock clock;
+    clock::time_point t0 = clock::now();
+    auto end_stage = [&](const char *name, double &timing) {
+        timing = std::chrono::duration<double>(clock::now() - t0).count();
+        TRACE3(validation, stage, name, c.height, (uint64_t)(timing * 1e9));
+        t0 = clock::now();
+    };
+    bool ok;
+    {
+        PROFILE_ZONE("parse");
+        ok = blockparser::parse_block(data, len, c.block) && !c.block.txs.empty();
+        if (ok)
+            c.height = coinbase_height(c.block.input(c.block.txs[0], 0));
+    }
+    end_stage("parse", c.timings.parse);
+    if (!ok) {
+        c.error = "malformed block.";
+        return false;
+    }
+    hash_stage(c, threads);
+    end_stage("hash", c.timings.hash);
+    ok = merkle_stage(c);
+    end_stage("merkle", c.timings.merkle);
+    if (!ok)
+        return false;
+    ok = inputs_stage(c, coins);
+    end_stage("inputs", c.timings.inputs);
+    if (!ok)
+        return false;
+    ok = scripts_stage(c, threads);
+    end_stage("scripts", c.timings.scripts);
+    if (!ok)
+        return false;
+    std::vector<std::pair<Outpoint, Coin>> undo;
+    std::vector<Outpoint> added;
+    undo.reserve(c.spent_outpoints.size());
+    update_stage(c, coins, undo, added);
+    end_stage("update", c.timings.update);
+    if (!apply) {
+        for (const Outpoint &o : added)
+            coins.erase(o);
+        for (auto &entry : undo)
+            coins.emplace(entry.first, std::move(entry.second));
+    }
+    TRACE6(utxocache, flush, c.height, undo.size(), added.size(), coins.size(), (uint64_t)(c.timings.update * 1e9),
+           apply);
+    return true;
+}
+
+static bool connect(const uint8_t *data, size_t len, CoinMap &coins, int threads, bool apply, Connection &c) {
+    g_table();
+    METRICS_TIMER(BLOCK_CONNECT);
+    PROFILE_ZONE("connect");
+    TRACE2(validation, connect_start, len, threads);
+    [[maybe_unused]] std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool ok = connect_stages(data, len, coins, threads, apply, c);
+    TRACE6(validation, connect_end, c.height, c.block.txs.size(), c.counts.inputs, c.counts.signatures,
+           (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start)
+               .count(),
+           ok);
+    return ok;
+}
+
+/* Chainstate type. */
+
+typedef struct {
+    PyObject_HEAD
+    CoinMap *coins;
+    std::mutex *mu;  // Held by every method, across connect() too.
+} ChainstateObject;
+
+static bool ready(ChainstateObject *self) {
+    if (!self->coins)
+        PyErr_SetString(PyExc_RuntimeError, "Chainstate is not initialized.");
+    return self->coins != NULL;
+}
+
+static PyObject *Chainstate_add(ChainstateObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    Py_buffer outpoints;
+    PyObject *values_seq, *scripts_seq;
+    if (!ready(self) || !parse_args(args, nargs, "y*OO:add", &outpoints, &values_seq, &scripts_seq))
+        return NULL;
+    ObjectLock lock(*self->mu);
+    PyObject *values = PySequence_Fast(values_seq, "values must be a sequence.");
+    PyObject *scripts = values ? PySequence_Fast(scripts_seq, "scripts must be a sequence.") : NULL;
+    size_t count = (size_t)outpoints.len / 36;
+    if (scripts && ((size_t)outpoints.len % 36 || (size_t)PySequence_Fast_GET_SIZE(values) != count
+                    || (size_t)PySequence_Fast_GET_SIZE(scripts) != count))
+        PyErr_SetString(PyExc_ValueError, "need 36 bytes of outpoints, a value and a script for every coin.");
+    for (size_t i = 0; scripts && i < count && !PyErr_Occurred(); ++i) {
+        char *script;
+        Py_ssize_t len;
+        long long value = PyLong_AsLongLong(PySequence_Fast_GET_ITEM(values, i));
+        if (PyErr_Occurred() || PyBytes_AsStringAndSize(PySequence_Fast_GET_ITEM(scripts, i), &script, &len) < 0)
+            break;
+        const uint8_t *o = static_cast<const uint8_t *>(outpoints.buf) + 36 * i;
+        (*self->coins)[outpoint(o)] = Coin{value, {script, (size_t)len}};
+    }
+    Py_XDECREF(values);
+    Py_XDECREF(scripts);
+    PyBuffer_Release(&outpoints);
+    if (PyErr_Occurred())
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+static int Chainstate_init(ChainstateObject *self, PyObject *args, PyObject *kwds) {
+    static const char *kwlist[] = {"outpoints", "values", "scripts", NULL};
+    PyObject *outpoints = NULL, *values = NULL, *scripts = NULL;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|OOO", const_cast<char **>(kwlist), &outpoints, &values, &scripts))
+        return -1;
+    if (!self->coins) {
+        self->coins = new CoinMap();
+        self->mu = new std::mutex();
+    }
+    {
+        ObjectLock lock(*self->mu);
+        self->coins->clear();
+    }
+    if (!outpoints)
+        return 0;
+    if (!values || !scripts) {
+        PyErr_SetString(PyExc_TypeError, "outpoints need values and scripts.");
+        return -1;
+    }
+    PyObject *add_args[] = {outpoints, values, scripts};
+    PyObject *result = Chainstate_add(self, add_args, 3);
+    Py_XDECREF(result);
+    return result ? 0 : -1;
+}
+
+static void Chainstate_dealloc(ChainstateObject *self) {
+    delete self->coins;
+    delete self->mu;
+    heap_free(reinterpret_cast<PyObject *>(self));
+}
+
+static PyObject *Chainstate_connect(ChainstateObject *self, PyObject *args, PyObject *kwds) {
+    static const char *kwlist[] = {"block", "threads", "apply", NULL};
+    Py_buffer data;
+    int threads = 1, apply = 0;
+    if (!ready(self)
+        || !PyArg_ParseTupleAndKeywords(args, kwds, "y*|ip", const_cast<char **>(kwlist), &data, &threads, &apply))
+        return NULL;
+    ObjectLock lock(*self->mu);
+    Connection c;
+    bool ok;
+    threads = std::max(threads, 1);
+    Py_BEGIN_ALLOW_THREADS
+    ok = connect(static_cast<const uint8_t *>(data.buf), (size_t)data.len, *self->coins, threads, apply, c);
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&data);
+    if (!ok) {
+        PyErr_Format(PyExc_ValueError, "invalid block: %s", c.error.c_str());
+        return NULL;
+    }
+    const Timings &t = c.timings;
+    return Py_BuildValue("{s:{s:d,s:d,s:d,s:d,s:d,s:d},s:n,s:n,s:n,s:n}", "stages", "parse", t.parse, "hash", t.hash,
+                         "merkle", t.merkle, "inputs", t.inputs, "scripts", t.scripts, "update", t.update, "txs",
+                         (Py_ssize_t)c.block.txs.size(), "inputs", (Py_ssize_t)c.counts.inputs, "signatures",
+                         (Py_ssize_t)c.counts.signatures, "skipped", (Py_ssize_t)c.counts.skipped);
+}
+
+static PyObject *Chainstate_contains(ChainstateObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    Py_buffer o;
+    if (!ready(self) || !check_nargs("has_coin", nargs, 1) || !read_buffer(args[0], &o))
+        return NULL;
+    ObjectLock lock(*self->mu);
+    bool found = o.len == 36 && self->coins->count(outpoint(static_cast<const uint8_t *>(o.buf)));
+    PyBuffer_Release(&o);
+    return PyBool_FromLong(found);
+}
+
+static Py_ssize_t Chainstate_len(ChainstateObject *self) {
+    if (!self->coins)
+        return 0;
+    ObjectLock lock(*self->mu);
+    return (Py_ssize_t)self->coins->size();
+}
+
+static PyMethodDef Chainstate_methods[] = {
+    {"add", (PyCFunction)(void (*)(void))Chainstate_add, METH_FASTCALL,
+     "Add coins: outpoints (36 bytes each), values and scripts."},
+    {"connect", (PyCFunction)(void (*)(void))Chainstate_connect, METH_VARARGS | METH_KEYWORDS,
+     "Validate a block against the coins, returning the time of each stage and counts. Raises ValueError if the "
+     "block is invalid. The coins are updated only if apply is set."},
+    {"has_coin", (PyCFunction)(void (*)(void))Chainstate_contains, METH_FASTCALL, "Whether the outpoint is unspent."},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyType_Slot Chainstate_slots[] = {
+    {Py_tp_dealloc, (void *)Chainstate_dealloc},
+    {Py_tp_doc, (void *)"A UTXO set that blocks are validated against and connected to."},
+    {Py_tp_methods, Chainstate_methods},
+    {Py_sq_length, (void *)Chainstate_len},
+    {Py_tp_init, (void *)Chainstate_init},
+    {Py_tp_new, (void *)PyType_GenericNew},
+    {0, NULL}
+};
+
+static PyType_Spec Chainstate_spec = {
+    "validation.Chainstate",
+    sizeof(ChainstateObject),
+    0,
+    Py_TPFLAGS_DEFAULT,
+    Chainstate_slots
+};
+
+/* Module. */
+
+static PyObject *validation_merkle_root(PyObject *self, PyObject *hashes) {
+    PyObject *seq = PySequence_Fast(hashes, "expected a sequence of 32-byte hashes.");
+    if (!seq)
+        return NULL;
+    Py_ssize_t count = PySequence_Fast_GET_SIZE(seq);
+    memory::Vector<uint8_t, memory::MERKLE> data(32 * count);
+    for (Py_ssize_t i = 0; i < count; ++i) {
+        char *hash;
+        Py_ssize_t len;
+        if (PyBytes_AsStringAndSize(PySequence_Fast_GET_ITEM(seq, i), &hash, &len) < 0 || len != 32) {
+            if (!PyErr_Occurred())
+                PyErr_SetString(PyExc_ValueError, "expected a sequence of 32-byte hashes.");
+            Py_DECREF(seq);
+            return NULL;
+        }
+        std::memcpy(data.data() + 32 * i, hash, 32);
+    }
+    Py_DECREF(seq);
+    uint8_t root[32];
+    Py_BEGIN_ALLOW_THREADS
+    merkle::root(data.data(), count, root);
+    Py_END_ALLOW_THREADS
+    return PyBytes_FromStringAndSize(reinterpret_cast<char *>(root), 32);
+}
+
+typedef struct {
+    PyObject *chainstate_type;
+} ValidationState;
+
+static ValidationState *get_state(PyObject *m) {
+    return static_cast<ValidationState *>(PyModule_GetState(m));
+}
+
+static const Backend validation_backends[] = {
+    {"merkle", "merkle_root", "releases_gil simd"},
+    {NULL, NULL, NULL}
+};
+
+static int validation_exec(PyObject *m) {
+    if (module_add_type(m, &Chainstate_spec, &get_state(m)->chainstate_type) < 0)
+        return -1;
+    return module_add_backends(m, validation_backends);
+}
+
+static int validation_traverse(PyObject *m, visitproc visit, void *arg) {
+    Py_VISIT(get_state(m)->chainstate_type);
+    return 0;
+}
+
+static int validation_clear(PyObject *m) {
+    Py_CLEAR(get_state(m)->chainstate_type);
+    return 0;
+}
+
+static void validation_free(void *m) {
+    validation_clear(static_cast<PyObject *>(m));
+}
+
+static PyMethodDef validation_methods[] = {
+    {"merkle_root", validation_merkle_root, METH_O,
+     "The merkle root of a sequence of 32-byte hashes (internal byte order)."},
+    METRICS_METHODS,
+    PROFILER_METHODS,
+    MEMORY_METHODS,
+    {NULL, NULL, 0, NULL}
+};
+
+static PyModuleDef_Slot validation_slots[] = {
+    {Py_mod_exec, (void *)validation_exec},
+    MODULE_SLOTS
+    {0, NULL}
+};
+
+static struct PyModuleDef validation = {
+    PyModuleDef_HEAD_INIT,
+    "validation",
+    NULL,
+    sizeof(ValidationState),
+    validation_methods,
+    validation_slots,
+    validation_traverse,
+    validation_clear,
+    validation_free
+};
+
+PyMODINIT_FUNC PyInit_validation(void) {
+    return PyModuleDef_Init(&validation);
+}
@@ -0,0 +1,21 @@
+from typing import Sequence
+
+class Chainstate:
+    def __init__(
+        self, outpoints: bytes = ..., values: Sequence[int] = ..., scripts: Sequence[bytes] = ...
+    ) -> None: ...
+    def __len__(self) -> int: ...
+    def add(self, outpoints: bytes, values: Sequence[int], scripts: Sequence[bytes]) -> None: ...
+    def connect(self, block: bytes, threads: int = ..., apply: bool = ...) -> dict: ...
+    def has_coin(self, outpoint: bytes) -> bool: ...
+def merkle_root(hashes: Sequence[bytes]) -> bytes: ...
+def _metrics() -> dict: ...
+def _metrics_reset() -> None: ...
+def _metrics_enable(flag: bool) -> None: ...
+def _profile_start() -> None: ...
+def _profile_stop() -> None: ...
+def _profile_events() -> tuple[list[tuple[str, int, int, int]], int]: ...
+def _memory() -> dict[str, dict[str, int]]: ...
+def _memory_reset_peak() -> None: ...
+
+BACKENDS: tuple[tuple[str, str, str], ...]
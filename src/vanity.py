@@ -0,0 +1,140 @@
+"""Vanity address search: find a key whose address starts with a prefix.
+
+Keys are tried in order from a random start (k, k + 1, ...), so each
+public key is the previous one plus G. When the vanitygen extension is
+built, the search runs natively on all cores, converting points to
+affine a batch at a time with one inversion and hashing the batch with
+the multi-buffer HASH160 (see vanitygen.cpp). Otherwise the same walk is
+done below with Point from secp256k1.py, one batch inversion per
+BATCH keys.
+
+Each extra prefix character multiplies the expected work by 58 (P2PKH)
+or 32 (P2WPKH); difficulty() gives the expected number of keys.
+"""
+
+from __future__ import annotations
+
+import secrets
+import time
+
+from .address import B58_ALPHABET, BECH32_CHARSET, P2PKH_TESTNET_VERSION, P2PKH_VERSION, p2pkh, p2wpkh
+from .secp256k1 import G, n, p
+
+try:
+    from . import vanitygen  # type: ignore
+except ImportError:
+    vanitygen = None
+
+BATCH = 256
+
+
+def check_prefix(prefix: str, kind: str = "p2pkh", testnet: bool = False) -> None:
+    """Raises ValueError if no address of this kind can start with prefix."""
+    if kind == "p2pkh":
+        lead = "mn" if testnet else "1"
+        if prefix and (prefix[0] not in lead or any(c not in B58_ALPHABET for c in prefix)):
+            raise ValueError(f"P2PKH addresses start with {lead!r} and use Base58 characters.")
+    elif kind == "p2wpkh":
+        lead = ("tb" if testnet else "bc") + "1q"
+        if not (prefix.startswith(lead) or lead.startswith(prefix)):
+            raise ValueError(f"P2WPKH addresses start with {lead!r}.")
+        if any(c not in BECH32_CHARSET for c in prefix[len(lead) :]):
+            raise ValueError("P2WPKH addresses use lowercase Bech32 characters.")
+    else:
+        raise ValueError(f"Unknown address kind {kind!r}.")
+
+
+def difficulty(prefix: str, kind: str = "p2pkh", testnet: bool = False) -> int:
+    """Expected number of keys to try before finding prefix (roughly)."""
+    check_prefix(prefix, kind, testnet)
+    if kind == "p2pkh":
+        # The leading "1" is the version byte; the next character is skewed
+        # (58^33 is not a power of 256), which this ignores.
+        return 58 ** max(len(prefix) - 1, 0)
+    return 32 ** max(len(prefix) - len("bc1q"), 0)
+
+
+def py_search(
+    prefix: str,
+    start: bytes,
+    kind: str = "p2pkh",
+    threads: int = 0,
+    max_keys: int = 0,
+    hrp: str = "bc",
+    version: int = P2PKH_VERSION,
+    batch: int = BATCH,
+) -> tuple[bytes, str] | None:
+    k = int.from_bytes(start, "big")
+    if len(start) != 32 or not 0 < k < n:
+        raise ValueError("start must be a valid private key.")
+    if kind not in {"p2pkh", "p2wpkh"}:
+        raise ValueError(f"unknown address kind {kind}.")
+    point, tried = k * G, 0
+    while not max_keys or tried < max_keys:
+        count = min(batch, max_keys - tried) if max_keys else batch
+        points = []
+        for _ in range(count):
+            points.append(point)
+            point = point + G
+        # Batch inversion of the z coordinates (Montgomery's trick).
+        prefixes = [1]
+        for q in points:
+            prefixes.append(prefixes[-1] * q.z % p)
+        inv = pow(prefixes[-1], -1, p)
+        pubkeys = [b""] * count
+        for i in reversed(range(count)):
+            x, y, z = points[i]
+            zi = inv * prefixes[i] % p
+            inv = inv * z % p
+            zi2 = zi * zi % p
+            x, y = x * zi2 % p, y * zi2 * zi % p
+            pubkeys[i] = bytes([2 + (y & 1)]) + x.to_bytes(32, "big")
+        for i, pubkey in enumerate(pubkeys):
+            if kind == "p2pkh":
+                address = p2pkh(pubkey, version == P2PKH_TESTNET_VERSION)
+            else:
+                address = p2wpkh(pubkey, hrp)
+            if address.startswith(prefix):
+                return ((k + tried + i) % n).to_bytes(32, "big"), address
+        tried += count
+    return None
+
+
+def search(
+    prefix: str,
+    kind: str = "p2pkh",
+    testnet: bool = False,
+    start: bytes | None = None,
+    threads: int = 0,
+    max_keys: int = 0,
+) -> tuple[bytes, str] | None:
+    """Finds (private key, address) with an address starting with prefix.
+
+    Starts from a random key unless start is given; threads = 0 uses
+    every core. Returns None if max_keys keys (0 for no limit) were
+    tried without a match.
+    """
+    check_prefix(prefix, kind, testnet)
+    if start is None:
+        start = (secrets.randbelow(n - 1) + 1).to_bytes(32, "big")
+    hrp = "tb" if testnet else "bc"
+    version = P2PKH_TESTNET_VERSION if testnet else P2PKH_VERSION
+    if vanitygen is not None:
+        return vanitygen.search(prefix, start, kind, threads, max_keys, hrp, version)
+    return py_search(prefix, start, kind, threads, max_keys, hrp, version)
+
+
+def main() -> None:
+    import sys
+
+    prefix = sys.argv[1] if len(sys.argv) > 1 else "1Bit"
+    kind = "p2wpkh" if prefix.startswith("bc1") else "p2pkh"
+    print(f"searching for {prefix} (~{difficulty(prefix, kind):,} keys)")
+    start = time.perf_counter()
+    key, address = search(prefix, kind)  # type: ignore
+    elapsed = time.perf_counter() - start
+    print(f"{address} {key.hex()} ({elapsed:.2f} s)")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,184 @@
+/**
+ * @file vanitygen.cpp
+ * @author Siddharth Pai (sidd.s.pai@gmail.com, sidd.pai@ucalgary.ca)
+ * @brief C++ Python Extension for searching keys with vanity addresses.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "address.h"
+#include "pymodule.h"
+#include "secp256k1.h"
+
+ /* Finding an address with a given prefix is brute force: about 58^k
+    keys for k Base58 characters, 32^k for Bech32. So what matters is
+    the cost per key, and most of it can be avoided:
+
+        - Keys are consecutive (k, k + 1, k + 2, ...), so each public
+          key is the previous one plus G, one mixed addition, instead of
+          a scalar multiplication.
+        - Points are converted to affine coordinates (needed for the
+          SEC encoding) a batch at a time, with one inversion per batch
+          (batch_to_affine), instead of one inversion per key.
+        - The keys of a batch are hashed 8 at a time with the
+          multi-buffer SHA-256 (hash160_many), then encoded.
+
+    Each thread walks its own range, starting 2^48 keys apart, and all
+    of them stop as soon as one finds a match (or the key budget runs
+    out), checking a shared flag once per batch.
+
+    References:
+        - https://en.bitcoin.it/wiki/Vanitygen
+ */
+
+#define DEFAULT_BATCH 1024
+#define THREAD_STRIDE_BITS 48
+
+using namespace secp256k1;
+
+enum Kind { P2PKH, P2WPKH };
+
+struct Search {
+    std::string prefix, hrp;
+    Kind kind;
+    uint8_t version;
+    size_t batch;
+    uint64_t max_keys;
+    Scalar start;
+    std::atomic<bool> found{false};
+    std::atomic<uint64_t> tried{0};
+    Scalar key;
+    std::string address;
+};
+
+static std::string encode(const Search &s, const uint8_t hash[20]) {
+    if (s.kind == P2PKH)
+        return address::b58check_encode(&s.version, 1, hash, 20);
+    return address::segwit_encode(s.hrp, 0, hash, 20);
+}
+
+static void worker(Search *s, unsigned index) {
+    Scalar base = s->start, offset = {{0, 0, 0, 0}};
+    offset.n[0] = (uint64_t)index << THREAD_STRIDE_BITS;
+    offset.n[1] = (uint64_t)index >> (64 - THREAD_STRIDE_BITS);
+    base = scalar_add(base, offset);
+    std::vector<Gej> points(s->batch);
+    std::vector<Ge> affine(s->batch);
+    std::vector<uint8_t> pubkeys(33 * s->batch), hashes(20 * s->batch);
+    Gej next = mul_g_ct(base);
+    uint64_t done = 0;  // Keys checked by this thread.
+    while (!s->found.load(std::memory_order_relaxed)) {
+        uint64_t total = s->tried.fetch_add(s->batch, std::memory_order_relaxed);
+        if (s->max_keys && total >= s->max_keys)
+            break;
+        size_t n = s->max_keys ? std::min<uint64_t>(s->batch, s->max_keys - total) : s->batch;
+        for (size_t i = 0; i < n; ++i) {
+            points[i] = next;
+            next = gej_add_ge(next, G);
+        }
+        batch_to_affine(points.data(), affine.data(), n);
+        for (size_t i = 0; i < n; ++i)
+            ge_store(&pubkeys[33 * i], affine[i]);
+        address::hash160_many(pubkeys.data(), 33, n, hashes.data());
+        for (size_t i = 0; i < n; ++i) {
+            std::string addr = encode(*s, &hashes[20 * i]);
+            if (addr.compare(0, s->prefix.size(), s->prefix) != 0)
+                continue;
+            bool expected = false;
+            if (s->found.compare_exchange_strong(expected, true)) {
+                Scalar k = {{done + i, 0, 0, 0}};
+                s->key = scalar_add(base, k);
+                s->address = addr;
+            }
+            return;
+        }
+        done += n;
+    }
+}
+
+static PyObject *vanitygen_search(PyObject *self, PyObject *args, PyObject *kwds) {
+    static const char *kwlist[] = {"prefix", "start", "kind", "threads", "max_keys", "hrp", "version", "batch", NULL};
+    const char *prefix, *kind = "p2pkh", *hrp = "bc";
+    Py_buffer start;
+    int threads = 0;
+    unsigned long long max_keys = 0;
+    unsigned char version = 0;
+    Py_ssize_t batch = DEFAULT_BATCH;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "sy*|siKsbn", const_cast<char **>(kwlist), &prefix, &start, &kind,
+                                     &threads, &max_keys, &hrp, &version, &batch))
+        return NULL;
+    Search s;
+    bool ok = start.len == 32 && scalar_load(s.start, static_cast<const uint8_t *>(start.buf))
+        && !scalar_is_zero(s.start);
+    PyBuffer_Release(&start);
+    if (!ok) {
+        PyErr_SetString(PyExc_ValueError, "start must be a valid private key.");
+        return NULL;
+    }
+    if (std::strcmp(kind, "p2pkh") == 0) {
+        s.kind = P2PKH;
+    } else if (std::strcmp(kind, "p2wpkh") == 0) {
+        s.kind = P2WPKH;
+    } else {
+        PyErr_Format(PyExc_ValueError, "unknown address kind %s.", kind);
+        return NULL;
+    }
+    if (batch <= 0) {
+        PyErr_SetString(PyExc_ValueError, "batch must be positive.");
+        return NULL;
+    }
+    s.prefix = prefix, s.hrp = hrp, s.version = version;
+    s.batch = batch, s.max_keys = max_keys;
+    if (threads <= 0)
+        threads = std::max(1, (int)std::thread::hardware_concurrency());
+    g_table();
+    Py_BEGIN_ALLOW_THREADS
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; ++t)
+        workers.emplace_back(worker, &s, (unsigned)t);
+    worker(&s, 0);
+    for (std::thread &w : workers)
+        w.join();
+    Py_END_ALLOW_THREADS
+    if (!s.found)
+        Py_RETURN_NONE;
+    uint8_t key[32];
+    scalar_store(key, s.key);
+    return Py_BuildValue("(y#s#)", key, (Py_ssize_t)32, s.address.data(), (Py_ssize_t)s.address.size());
+}
+
+static PyMethodDef vanitygen_methods[] = {
+    {"search", (PyCFunction)(void (*)(void))vanitygen_search, METH_VARARGS | METH_KEYWORDS,
+     "Search keys from start on for an address starting with prefix. Returns (key, address) or None."},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyModuleDef_Slot vanitygen_slots[] = {
+    MODULE_SLOTS
+    {0, NULL}
+};
+
+static struct PyModuleDef vanitygen = {
+    PyModuleDef_HEAD_INIT,
+    "vanitygen",
+    NULL,
+    0,
+    vanitygen_methods,
+    vanitygen_slots
+};
+
+PyMODINIT_FUNC PyInit_vanitygen(void) {
+    return PyModuleDef_Init(&vanitygen);
+}
@@ -0,0 +1,10 @@
+def search(
+    prefix: str,
+    start: bytes,
+    kind: str = ...,
+    threads: int = ...,
+    max_keys: int = ...,
+    hrp: str = ...,
+    version: int = ...,
+    batch: int = ...,
+) -> tuple[bytes, str] | None: ...
@@ -1,2 +1,501 @@
-import string
+"""Hierarchical deterministic (BIP32) keys.
 
+Every key in a wallet is derived from one seed: the master key comes
+from HMAC-SHA512 of the seed, and each key has children 0 to 2^32 - 1
+derived from HMAC-SHA512 of its chain code. Children from 2^31 on are
+hardened (they need the parent private key); the others can also be
+derived from the parent public key alone, which is how a server hands
+out receive addresses from an xpub without holding any private key.
+
+When the bip32 extension is built, derivation runs natively (see
+bip32.cpp), including derive_public_range(), which derives a whole
+range of children in one call. Otherwise the same functions are
+implemented below with hmac and secp256k1.py.
+
+select_coins() picks the UTXOs that fund a transaction, with Branch and
+Bound, Single Random Draw and knapsack like Bitcoin Core, natively when
+the coinselect extension is built (see coinselect.cpp for how they
+work) and with the py_* versions below otherwise.
+
+References:
+    - https://github.com/bitcoin/bips/blob/master/bip-0032.mediawiki
+    - https://github.com/bitcoin/bitcoin/blob/master/src/wallet/coinselection.cpp
+"""
+
+from __future__ import annotations
+
+import hmac
+import math
+import random
+import struct
+from array import array
+from typing import NamedTuple, Sequence
+
+from .address import b58check_decode, b58check_encode, hash160, p2pkh_many, p2wpkh_many
+from .secp256k1 import G, Point, n, p
+
+try:
+    from . import bip32  # type: ignore
+except ImportError:
+    bip32 = None
+
+try:
+    from . import coinselect  # type: ignore
+except ImportError:
+    coinselect = None
+
+HARDENED = 0x80000000
+
+VERSIONS = {
+    (False, True): bytes.fromhex("0488ADE4"),  # xprv
+    (False, False): bytes.fromhex("0488B21E"),  # xpub
+    (True, True): bytes.fromhex("04358394"),  # tprv
+    (True, False): bytes.fromhex("043587CF"),  # tpub
+}
+
+# Pure-Python versions of the functions in bip32.cpp.
+
+
+def _compress(point: Point) -> bytes:
+    x, y = point.affine()
+    return bytes([2 + (y & 1)]) + x.to_bytes(32, "big")
+
+
+def _decompress(key: bytes) -> Point:
+    x = int.from_bytes(key[1:], "big")
+    y = pow((x * x * x + 7) % p, (p + 1) // 4, p)
+    if len(key) != 33 or key[0] not in {2, 3} or x >= p or y * y % p != (x * x * x + 7) % p:
+        raise ValueError("invalid public key.")
+    if y & 1 != key[0] & 1:
+        y = p - y
+    return Point(x, y)
+
+
+def py_master_key(seed: bytes) -> tuple[bytes, bytes]:
+    if not 16 <= len(seed) <= 64:
+        raise ValueError("seed must be between 16 and 64 bytes.")
+    digest = hmac.digest(b"Bitcoin seed", seed, "sha512")
+    if not 0 < int.from_bytes(digest[:32], "big") < n:
+        raise ValueError("invalid master key, use another seed.")
+    return digest[:32], digest[32:]
+
+
+def py_public_key(key: bytes, compressed: bool = True) -> bytes:
+    k = int.from_bytes(key, "big")
+    if len(key) != 32 or not 0 < k < n:
+        raise ValueError("invalid private key.")
+    point = k * G
+    if compressed:
+        return _compress(point)
+    return bytes(point.affine())
+
+
+def py_derive_private(key: bytes, chain_code: bytes, index: int) -> tuple[bytes, bytes]:
+    if index >= HARDENED:
+        data = b"\x00" + key
+    else:
+        data = py_public_key(key)
+    digest = hmac.digest(chain_code, data + struct.pack(">I", index), "sha512")
+    il = int.from_bytes(digest[:32], "big")
+    child = (il + int.from_bytes(key, "big")) % n
+    if il >= n or child == 0:
+        raise ValueError(f"child {index} is invalid, use the next index.")
+    return child.to_bytes(32, "big"), digest[32:]
+
+
+def py_derive_public(key: bytes, chain_code: bytes, index: int) -> tuple[bytes, bytes]:
+    if index >= HARDENED:
+        raise ValueError("hardened children need the private key.")
+    parent = _decompress(key)
+    digest = hmac.digest(chain_code, key + struct.pack(">I", index), "sha512")
+    il = int.from_bytes(digest[:32], "big")
+    if il >= n:
+        raise ValueError(f"child {index} is invalid, use the next index.")
+    child = il * G + parent
+    if child == Point.infinity():
+        raise ValueError(f"child {index} is invalid, use the next index.")
+    return _compress(child), digest[32:]
+
+
+def py_derive_private_range(
+    key: bytes, chain_code: bytes, start: int, stop: int, threads: int = 1
+) -> bytes:
+    return b"".join(py_derive_private(key, chain_code, i)[0] for i in range(start, stop))
+
+
+def py_derive_public_range(
+    key: bytes, chain_code: bytes, start: int, stop: int, threads: int = 1
+) -> bytes:
+    return b"".join(py_derive_public(key, chain_code, i)[0] for i in range(start, stop))
+
+
+if bip32 is not None:
+    master_key = bip32.master_key
+    public_key = bip32.public_key
+    derive_private = bip32.derive_private
+    derive_public = bip32.derive_public
+    derive_private_range = bip32.derive_private_range
+    derive_public_range = bip32.derive_public_range
+else:
+    master_key = py_master_key
+    public_key = py_public_key
+    derive_private = py_derive_private
+    derive_public = py_derive_public
+    derive_private_range = py_derive_private_range
+    derive_public_range = py_derive_public_range
+
+
+def parse_path(path: str) -> list[int]:
+    """Child indexes of a path like "m/84'/0'/0'/0" (h also marks hardened)."""
+    parts = path.split("/")
+    if parts and parts[0] == "m":
+        parts = parts[1:]
+    indexes = []
+    for part in filter(None, parts):
+        hardened = part[-1] in "'hH"
+        index = int(part[:-1] if hardened else part)
+        if not 0 <= index < HARDENED:
+            raise ValueError(f"Invalid path component {part!r}.")
+        indexes.append(index + HARDENED if hardened else index)
+    return indexes
+
+
+class ExtendedKey(NamedTuple):
+    key: bytes  # 32-byte private key or 33-byte compressed public key.
+    chain_code: bytes
+    depth: int = 0
+    parent_fingerprint: bytes = bytes(4)
+    child_number: int = 0
+    testnet: bool = False
+
+    @classmethod
+    def from_seed(cls, seed: bytes, testnet: bool = False) -> ExtendedKey:
+        key, chain_code = master_key(seed)
+        return cls(key, chain_code, testnet=testnet)
+
+    @classmethod
+    def parse(cls, text: str) -> ExtendedKey:
+        data = b58check_decode(text)
+        if len(data) != 78:
+            raise ValueError("Invalid extended key length.")
+        version, depth, fingerprint, child, chain_code, key = struct.unpack(
+            ">4sB4sI32s33s", data
+        )
+        for (testnet, private), expected in VERSIONS.items():
+            if version == expected:
+                break
+        else:
+            raise ValueError("Unknown extended key version.")
+        if private:
+            if key[0] != 0:
+                raise ValueError("Invalid private key.")
+            key = key[1:]
+        return cls(key, chain_code, depth, fingerprint, child, testnet)
+
+    @property
+    def is_private(self) -> bool:
+        return len(self.key) == 32
+
+    @property
+    def public_key(self) -> bytes:
+        return public_key(self.key) if self.is_private else self.key
+
+    @property
+    def fingerprint(self) -> bytes:
+        return hash160(self.public_key)[:4]
+
+    def public(self) -> ExtendedKey:
+        return self._replace(key=self.public_key)
+
+    def child(self, index: int) -> ExtendedKey:
+        if self.is_private:
+            key, chain_code = derive_private(self.key, self.chain_code, index)
+        else:
+            key, chain_code = derive_public(self.key, self.chain_code, index)
+        return self._replace(
+            key=key,
+            chain_code=chain_code,
+            depth=self.depth + 1,
+            parent_fingerprint=self.fingerprint,
+            child_number=index,
+        )
+
+    def derive(self, path: str) -> ExtendedKey:
+        key = self
+        for index in parse_path(path):
+            key = key.child(index)
+        return key
+
+    def public_keys(self, start: int, stop: int, threads: int = 1) -> list[bytes]:
+        """Compressed public keys of the children [start, stop)."""
+        keys = derive_public_range(self.public_key, self.chain_code, start, stop, threads=threads)
+        return [keys[i : i + 33] for i in range(0, len(keys), 33)]
+
+    def addresses(self, start: int, stop: int, kind: str = "p2wpkh", threads: int = 1) -> list[str]:
+        """Addresses of the children [start, stop), derived and encoded in bulk."""
+        keys = derive_public_range(self.public_key, self.chain_code, start, stop, threads=threads)
+        if kind == "p2wpkh":
+            return p2wpkh_many(keys, "tb" if self.testnet else "bc")
+        if kind == "p2pkh":
+            return p2pkh_many(keys, 33, 0x6F if self.testnet else 0x00)
+        raise ValueError(f"Unknown address kind {kind!r}.")
+
+    def private_keys(self, start: int, stop: int, threads: int = 1) -> list[bytes]:
+        """Private keys of the children [start, stop) (hardened from 2^31)."""
+        if not self.is_private:
+            raise ValueError("Not a private key.")
+        keys = derive_private_range(self.key, self.chain_code, start, stop, threads=threads)
+        return [keys[i : i + 32] for i in range(0, len(keys), 32)]
+
+    def __str__(self) -> str:
+        key = b"\x00" + self.key if self.is_private else self.key
+        version = VERSIONS[self.testnet, self.is_private]
+        return b58check_encode(
+            struct.pack(
+                ">4sB4sI32s33s",
+                version,
+                self.depth,
+                self.parent_fingerprint,
+                self.child_number,
+                self.chain_code,
+                key,
+            )
+        )
+
+
+# Coin selection. Weights are input weights in weight units (4 per byte
+# outside the witness, 1 inside), fee rates in satoshis per vbyte.
+
+BNB_MAX_TRIES = 100_000
+KNAPSACK_ITERATIONS = 1000
+MAX_TX_WEIGHT = 400_000
+MIN_CHANGE = 50_000
+P2WPKH_INPUT_WEIGHT = 272  # Outpoint, sequence, empty script, witness.
+P2WPKH_OUTPUT_WEIGHT = 124
+
+
+class Selection(NamedTuple):
+    algorithm: str
+    indexes: list[int]  # Into the values given to select_coins().
+    waste: int
+
+
+class _Pool(NamedTuple):
+    fee: list[int]
+    long_term_fee: list[int]
+    effective: list[int]
+    weights: Sequence[int]
+    usable: list[int]
+
+
+def _pool(values: Sequence[int], weights: Sequence[int], fee_rate: float, long_term_fee_rate: float) -> _Pool:
+    fee = [math.ceil(w * fee_rate / 4) for w in weights]
+    long_term_fee = [math.ceil(w * long_term_fee_rate / 4) for w in weights]
+    effective = [v - f for v, f in zip(values, fee)]
+    return _Pool(fee, long_term_fee, effective, weights, [i for i, e in enumerate(effective) if e > 0])
+
+
+def _finish(pool: _Pool, indexes: list[int], change: bool, target: int, cost_of_change: int, max_weight: int):
+    if sum(pool.weights[i] for i in indexes) > max_weight:
+        return None
+    waste = sum(pool.fee[i] - pool.long_term_fee[i] for i in indexes)
+    waste += cost_of_change if change else sum(pool.effective[i] for i in indexes) - target
+    return sorted(indexes), waste
+
+
+def _bnb(pool: _Pool, target: int, fee_rate: float, long_term_fee_rate: float, cost_of_change: int, max_weight: int):
+    order = sorted(pool.usable, key=lambda i: -pool.effective[i])
+    eff = [pool.effective[i] for i in order]
+    available = sum(eff)
+    if not order or available < target:
+        return None
+    high = fee_rate > long_term_fee_rate
+    value = waste = weight = pos = 0
+    best_waste, selection, best = None, [], []
+    for _ in range(BNB_MAX_TRIES):
+        if (
+            value + available < target
+            or value > target + cost_of_change
+            or (high and best_waste is not None and waste > best_waste)
+            or weight > max_weight
+        ):
+            backtrack = True
+        elif value >= target:
+            if best_waste is None or waste + value - target <= best_waste:
+                best, best_waste = list(selection), waste + value - target
+            backtrack = True
+        else:
+            backtrack = False
+        if backtrack:
+            if not selection:
+                break
+            pos -= 1
+            while pos > selection[-1]:
+                available += eff[pos]
+                pos -= 1
+            i = order[pos]
+            value -= eff[pos]
+            waste -= pool.fee[i] - pool.long_term_fee[i]
+            weight -= pool.weights[i]
+            selection.pop()
+        else:
+            i = order[pos]
+            available -= eff[pos]
+            previous = order[pos - 1]
+            if (
+                not selection
+                or pos - 1 == selection[-1]
+                or eff[pos] != eff[pos - 1]
+                or pool.fee[i] != pool.fee[previous]
+            ):
+                selection.append(pos)
+                value += eff[pos]
+                waste += pool.fee[i] - pool.long_term_fee[i]
+                weight += pool.weights[i]
+        pos += 1
+    if not best:
+        return None
+    return _finish(pool, [order[k] for k in best], False, target, cost_of_change, max_weight)
+
+
+def _srd(pool: _Pool, target: int, change_fee: int, min_change: int, max_weight: int, rng: random.Random):
+    order = list(pool.usable)
+    rng.shuffle(order)
+    selected: list[int] = []
+    value = weight = 0
+    for i in order:
+        selected.append(i)
+        value += pool.effective[i]
+        weight += pool.weights[i]
+        while weight > max_weight and selected:
+            smallest = min(selected, key=lambda j: pool.effective[j])
+            selected.remove(smallest)
+            value -= pool.effective[smallest]
+            weight -= pool.weights[smallest]
+        if value >= target + change_fee + min_change:
+            return selected
+    return None
+
+
+def _best_subset(pool: _Pool, items: list[int], total_lower: int, target: int, rng: random.Random):
+    best, best_value = [True] * len(items), total_lower
+    for _ in range(KNAPSACK_ITERATIONS):
+        if best_value == target:
+            break
+        included, total, reached = [False] * len(items), 0, False
+        for pass_ in range(2):
+            if reached:
+                break
+            for k, i in enumerate(items):
+                if rng.random() < 0.5 if pass_ == 0 else not included[k]:
+                    total += pool.effective[i]
+                    included[k] = True
+                    if total >= target:
+                        reached = True
+                        if total < best_value:
+                            best, best_value = list(included), total
+                        total -= pool.effective[i]
+                        included[k] = False
+    return best, best_value
+
+
+def _knapsack(pool: _Pool, target: int, change_fee: int, min_change: int, rng: random.Random):
+    order = list(pool.usable)
+    rng.shuffle(order)
+    target += change_fee
+    lower, total_lower, lowest_larger = [], 0, None
+    for i in order:
+        v = pool.effective[i]
+        if v == target:
+            return [i]
+        if v < target + min_change:
+            lower.append(i)
+            total_lower += v
+        elif lowest_larger is None or v < pool.effective[lowest_larger]:
+            lowest_larger = i
+    if total_lower == target:
+        return lower
+    if total_lower < target:
+        return None if lowest_larger is None else [lowest_larger]
+    lower.sort(key=lambda i: -pool.effective[i])
+    best, best_value = _best_subset(pool, lower, total_lower, target, rng)
+    if best_value != target and total_lower >= target + min_change:
+        best, best_value = _best_subset(pool, lower, total_lower, target + min_change, rng)
+    if lowest_larger is not None and (
+        best_value != target and best_value < target + min_change or pool.effective[lowest_larger] <= best_value
+    ):
+        return [lowest_larger]
+    return [i for i, b in zip(lower, best) if b]
+
+
+def py_select(
+    values: Sequence[int],
+    weights: Sequence[int],
+    target: int,
+    fee_rate: float,
+    long_term_fee_rate: float = -1,
+    change_fee: int = 0,
+    cost_of_change: int = 0,
+    min_change: int = MIN_CHANGE,
+    max_weight: int = MAX_TX_WEIGHT,
+    seed: int = 0,
+    algorithms: Sequence[str] = ("bnb", "srd", "knapsack"),
+) -> tuple[str, list[int], int] | None:
+    if len(values) != len(weights):
+        raise ValueError("values (int64) and weights (uint32) must have the same length.")
+    if target <= 0 or fee_rate < 0:
+        raise ValueError("target must be positive and fee_rate not negative.")
+    if long_term_fee_rate < 0:
+        long_term_fee_rate = fee_rate
+    cost_of_change = max(cost_of_change, change_fee)
+    pool, rng = _pool(values, weights, fee_rate, long_term_fee_rate), random.Random(seed)
+    best = None
+    for name in algorithms:
+        if name == "bnb":
+            found = _bnb(pool, target, fee_rate, long_term_fee_rate, cost_of_change, max_weight)
+        else:
+            if name == "srd":
+                indexes = _srd(pool, target, change_fee, min_change, max_weight, rng)
+            else:
+                indexes = _knapsack(pool, target, change_fee, min_change, rng)
+            found = _finish(pool, indexes, True, target, cost_of_change, max_weight) if indexes else None
+        if found and (best is None or (found[1], -len(found[0])) < (best[2], -len(best[1]))):
+            best = (name, *found)
+    return best
+
+
+def _array(typecode: str, items: Sequence[int]) -> array:
+    if isinstance(items, array) and items.typecode == typecode:
+        return items  # Already contiguous, no copy.
+    return array(typecode, items)
+
+
+def select_coins(
+    values: Sequence[int],
+    weights: Sequence[int],
+    target: int,
+    fee_rate: float,
+    long_term_fee_rate: float = 10.0,
+    change_weight: int = P2WPKH_OUTPUT_WEIGHT,
+    change_spend_weight: int = P2WPKH_INPUT_WEIGHT,
+    min_change: int = MIN_CHANGE,
+    max_weight: int = MAX_TX_WEIGHT,
+    seed: int | None = None,
+    algorithm: str | None = None,
+) -> Selection | None:
+    """Picks UTXOs (by value and input weight) paying for target, which
+    includes the fee for everything but the inputs. Returns the least
+    wasteful selection found, or None if the UTXOs cannot cover it."""
+    change_fee = math.ceil(change_weight * fee_rate / 4)
+    cost_of_change = change_fee + math.ceil(change_spend_weight * long_term_fee_rate / 4)
+    if seed is None:
+        seed = random.getrandbits(64)
+    args = (target, fee_rate, long_term_fee_rate, change_fee, cost_of_change, min_change, max_weight, seed)
+    if algorithm not in {None, "bnb", "srd", "knapsack"}:
+        raise ValueError(f"Unknown coin selection algorithm {algorithm!r}.")
+    if coinselect is not None:
+        native = getattr(coinselect, algorithm or "select")
+        found = native(_array("q", values), _array("I", weights), *args)
+    else:
+        found = py_select(values, weights, *args, algorithms=(algorithm,) if algorithm else ("bnb", "srd", "knapsack"))
+    return None if found is None else Selection(*found)
@@ -0,0 +1,141 @@
+"""A persistent pool of workers for batch crypto and mining in Python.
+
+Pure-Python work (signing, verifying, hashing nonces) only runs in
+parallel on more than one interpreter, or without a GIL. Pool picks
+the cheapest way to get that on the running Python, and keeps its
+workers between calls, so neither startup nor an import of the
+modules is paid per batch:
+
+    interpreters  subinterpreters, each with its own GIL (PEP 684),
+                  through concurrent.futures.InterpreterPoolExecutor
+                  (3.14+). The extensions declare per-interpreter GIL
+                  support (pymodule.h), so workers can import them.
+    threads       plain threads, when the GIL is disabled (free-
+                  threaded builds, PEP 703).
+    processes     otherwise, a process pool started once.
+
+Callers hand work over as bytes of packed records, not lists of
+objects: a bytes object crosses into another interpreter or process
+in one piece (for processes, one pickle of one buffer), and each
+worker gets a slice of it (see split()). The results come back the
+same way. verify_sigs() and generate_sigs() in secp256k1.py, and
+mine() in miner.py without the native miner, use default().
+
+    python -m src.workers                 # Which kind default() uses.
+"""
+
+from __future__ import annotations
+
+import atexit
+import concurrent.futures as cf
+import os
+import sys
+import threading
+from typing import Callable, Iterable, Iterator
+
+KINDS = ("interpreters", "threads", "processes")
+
+_default: Pool | None = None
+_default_lock = threading.Lock()
+
+
+def gil_enabled() -> bool:
+    return getattr(sys, "_is_gil_enabled", lambda: True)()
+
+
+def available(kind: str) -> bool:
+    if kind == "interpreters":
+        return hasattr(cf, "InterpreterPoolExecutor")
+    if kind == "threads":
+        return not gil_enabled()
+    return kind == "processes"
+
+
+def best_kind() -> str:
+    """The first kind in KINDS that runs Python code in parallel here."""
+    return next(kind for kind in KINDS if available(kind))
+
+
+def cpu_count() -> int:
+    if hasattr(os, "sched_getaffinity"):
+        return len(os.sched_getaffinity(0))
+    return os.cpu_count() or 1
+
+
+def split(count: int, parts: int) -> list[tuple[int, int]]:
+    """[start, stop) ranges covering range(count) in at most parts
+    pieces of nearly equal size, none empty.
+
+    Examples:
+    >>> split(10, 3)
+    [(0, 4), (4, 7), (7, 10)]
+    >>> split(2, 4)
+    [(0, 1), (1, 2)]
+    """
+    parts = max(1, min(parts, count))
+    size, extra = divmod(count, parts)
+    ranges, start = [], 0
+    for i in range(parts if count else 0):
+        stop = start + size + (i < extra)
+        ranges.append((start, stop))
+        start = stop
+    return ranges
+
+
+def _set_path(path: list[str]) -> None:
+    """Runs first in each subinterpreter, so it imports this package
+    from the same place as the main one."""
+    sys.path[:] = path
+
+
+class Pool:
+    """Workers of one kind, started on first use and kept until
+    shutdown(). map() is Executor.map(): lazy, in order, and the
+    functions and arguments must be picklable (module level)."""
+
+    def __init__(self, kind: str | None = None, workers: int | None = None) -> None:
+        self.kind = kind or best_kind()
+        if self.kind not in KINDS:
+            raise ValueError(f"unknown kind of worker {self.kind!r}.")
+        self.workers = workers or cpu_count()
+        self._executor: cf.Executor | None = None
+        self._lock = threading.Lock()
+
+    def executor(self) -> cf.Executor:
+        with self._lock:
+            if self._executor is None:
+                if self.kind == "interpreters":
+                    self._executor = cf.InterpreterPoolExecutor(  # type: ignore
+                        self.workers, initializer=_set_path, initargs=(list(sys.path),)
+                    )
+                elif self.kind == "threads":
+                    self._executor = cf.ThreadPoolExecutor(self.workers)
+                else:
+                    self._executor = cf.ProcessPoolExecutor(self.workers)
+            return self._executor
+
+    def map(self, fn: Callable, *iterables: Iterable) -> Iterator:
+        return self.executor().map(fn, *iterables)
+
+    def shutdown(self) -> None:
+        with self._lock:
+            if self._executor is not None:
+                self._executor.shutdown(cancel_futures=True)
+                self._executor = None
+
+    def __repr__(self) -> str:
+        return f"Pool(kind={self.kind!r}, workers={self.workers})"
+
+
+def default() -> Pool:
+    """The pool shared by the batch functions, created on first use."""
+    global _default
+    with _default_lock:
+        if _default is None:
+            _default = Pool()
+            atexit.register(_default.shutdown)
+        return _default
+
+
+if __name__ == "__main__":
+    print(default())
@@ -0,0 +1,24 @@
+import os
+import shutil
+import tempfile
+
+_saved: dict[str, str | None] = {}
+
+
+def pytest_configure(config) -> None:
+    """Points the cache directory at a temporary one before src is
+    imported, so that backends.py keeps its calibration there instead of
+    in the user's ~/.cache."""
+    _saved["XDG_CACHE_HOME"] = os.environ.get("XDG_CACHE_HOME")
+    _saved["dir"] = os.environ["XDG_CACHE_HOME"] = tempfile.mkdtemp(prefix="pycoin-tests-")
+
+
+def pytest_unconfigure(config) -> None:
+    if "dir" not in _saved:
+        return
+    shutil.rmtree(_saved.pop("dir"), ignore_errors=True)
+    previous = _saved.pop("XDG_CACHE_HOME")
+    if previous is None:
+        os.environ.pop("XDG_CACHE_HOME", None)
+    else:
+        os.environ["XDG_CACHE_HOME"] = previous
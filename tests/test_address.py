@@ -0,0 +1,68 @@
+import os
+
+import pytest
+
+from src import address
+from src.address import (
+    p2pkh,
+    p2wpkh,
+    py_b58check_decode,
+    py_b58check_encode,
+    py_hash160_many,
+    py_p2pkh_many,
+    py_p2wpkh_many,
+    py_segwit_decode,
+    py_segwit_encode,
+)
+from src.wallet import ExtendedKey
+
+# Compressed public key of private key 1 (G).
+PUBKEY = bytes.fromhex("0279BE667EF9DCBBAC55A06295CE870B07029BFCDB2DCE28D959F2815B16F81798")
+PROGRAM = bytes.fromhex("751e76e8199196d454941c45d1b3a323f1433bd6")
+
+
+def test_addresses() -> None:
+    assert address.hash160(PUBKEY) == PROGRAM
+    assert p2pkh(PUBKEY) == "1BgGZ9tcN4rm9KBzDn7KprQz87SZ26SAMH"
+    assert p2wpkh(PUBKEY) == "bc1qw508d6qejxtdg4y5r3zarvary0c5xw7kv8f3t4"
+    # Test vectors from BIP173 and BIP350.
+    for encode, decode in [
+        (address.segwit_encode, address.segwit_decode),
+        (py_segwit_encode, py_segwit_decode),
+    ]:
+        assert decode("bc", "BC1QW508D6QEJXTDG4Y5R3ZARVARY0C5XW7KV8F3T4") == (0, PROGRAM)
+        taproot = "bc1pw508d6qejxtdg4y5r3zarvary0c5xw7kw508d6qejxtdg4y5r3zarvary0c5xw7kt5nd6y"
+        assert encode("bc", 1, PROGRAM * 2) == taproot
+        assert decode("bc", taproot) == (1, PROGRAM * 2)
+        for bad in [
+            "bc1qw508d6qejxtdg4y5r3zarvary0c5xw7kv8f3t5",  # Bad checksum.
+            "bc1pw508d6qejxtdg4y5r3zarvary0c5xw7kv8f3t4",  # Bech32 for version 1.
+            "BC1QW508D6QEJXTDG4Y5R3ZARVARY0C5XW7Kv8f3t4",  # Mixed case.
+            "tb1qw508d6qejxtdg4y5r3zarvary0c5xw7kxpjzsx",  # Other network.
+        ]:
+            with pytest.raises(ValueError):
+                decode("bc", bad)
+
+
+def test_base58() -> None:
+    for data in [b"", bytes(3), bytes(2) + os.urandom(30), os.urandom(78)]:
+        encoded = address.b58check_encode(data)
+        assert encoded == py_b58check_encode(data)
+        assert address.b58check_decode(encoded) == py_b58check_decode(encoded) == data
+    with pytest.raises(ValueError):
+        address.b58check_decode("1BgGZ9tcN4rm9KBzDn7KprQz87SZ26SAMJ")
+    with pytest.raises(ValueError):
+        address.b58check_decode("1BgGZ9tcN4rm9KBzDn7KprQz87SZ26SAM0")
+
+
+def test_batches() -> None:
+    keys = ExtendedKey.from_seed(bytes(16)).derive("m/0").public_keys(0, 20)
+    batch = b"".join(keys)
+    assert address.hash160_many(batch, 33) == py_hash160_many(batch, 33)
+    assert address.p2wpkh_many(batch, "tb") == py_p2wpkh_many(batch, "tb")
+    assert address.p2pkh_many(batch) == py_p2pkh_many(batch) == [p2pkh(k) for k in keys]
+    assert address.segwit_encode_many("bc", 1, batch[:640], 32) == [
+        py_segwit_encode("bc", 1, batch[i : i + 32]) for i in range(0, 640, 32)
+    ]
+    with pytest.raises(ValueError):
+        address.p2wpkh_many(batch[:-1])
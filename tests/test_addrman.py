@@ -0,0 +1,117 @@
+import importlib.util
+import random
+
+import pytest
+
+addrman = pytest.importorskip("src.addrman")
+
+NOW = 1_700_000_000
+KEY = bytes(range(16))
+
+
+def fill(man, count: int, seed: int = 1) -> list[tuple[str, int]]:
+    rng = random.Random(seed)
+    addresses = []
+    for _ in range(count):
+        host = ".".join(str(rng.randrange(1, 255)) for _ in range(4))
+        addresses.append((host, 8333, 1, NOW - rng.randrange(86400)))
+    source = f"10.{seed}.0.1"
+    man.add_many(addresses, source, NOW)
+    return [(host, port) for host, port, *_ in addresses]
+
+
+def test_add_good_select() -> None:
+    man = addrman.AddrMan(KEY)
+    assert man.select(now=NOW) is None
+    assert man.add("1.2.3.4", 8333, 9, NOW - 60, "5.6.7.8", NOW)
+    assert not man.add("1.2.3.4", 8333, 0, NOW, "5.6.7.8", NOW)
+    assert man.add("2001:db8::1", 18333, 1, NOW, "5.6.7.8", NOW)
+    assert (len(man), man.new_count, man.tried_count) == (2, 2, 0)
+    assert man.info("1.2.3.4", 8333)["time"] == NOW
+    assert man.good("1.2.3.4", 8333, NOW)
+    assert not man.good("9.9.9.9", 8333, NOW)
+    assert (man.new_count, man.tried_count) == (1, 1)
+    assert man.info("1.2.3.4", 8333)["tried"]
+    selected = {man.select(now=NOW)[:2] for _ in range(200)}
+    assert selected == {("1.2.3.4", 8333), ("2001:db8::1", 18333)}
+    assert man.select(new_only=True, now=NOW)[:2] == ("2001:db8::1", 18333)
+    with pytest.raises(ValueError):
+        man.add("not an address", 8333)
+
+
+def test_selection_prefers_fresh() -> None:
+    man = addrman.AddrMan(KEY)
+    man.add("1.1.1.1", 8333, time=NOW, source="5.6.7.8", now=NOW)
+    man.add("2.2.2.2", 8333, time=NOW, source="5.6.7.8", now=NOW)
+    for _ in range(5):
+        man.attempt("2.2.2.2", 8333, NOW - 3600)
+    picks = [man.select(now=NOW)[0] for _ in range(1000)]
+    assert picks.count("1.1.1.1") > 5 * picks.count("2.2.2.2")
+
+
+def test_future_timestamp() -> None:
+    man = addrman.AddrMan(KEY)
+    assert man.add("1.2.3.4", 8333, 1, NOW + 300, "5.6.7.8", NOW)
+    assert man.info("1.2.3.4", 8333)["time"] == NOW + 300
+    assert [a[:2] for a in man.addresses(max_pct=100, now=NOW)] == [("1.2.3.4", 8333)]
+    assert man.select(now=NOW)[:2] == ("1.2.3.4", 8333)
+
+
+def test_buckets_limit_one_source() -> None:
+    # Everything one source group tells us lands in a handful of new
+    # buckets, so it can only take a small part of the table.
+    man = addrman.AddrMan(KEY)
+    fill(man, 20_000)
+    assert man.new_count <= 64 * 64
+    other = fill(man, 20_000, seed=2)
+    assert man.new_count > 64 * 64
+    assert sum(man.info(*a) is not None for a in other) > 1000
+
+
+def test_save_load(tmp_path) -> None:
+    man = addrman.AddrMan(KEY, new_buckets=4096)
+    added = [a for seed in range(1, 6) for a in fill(man, 5000, seed)]
+    for host, port in added[::50]:
+        man.good(host, port, NOW)
+    path = tmp_path / "peers.dat"
+    assert man.save(path) == len(man)
+    loaded = addrman.AddrMan()
+    assert loaded.load(path) == len(man)
+    assert (loaded.new_count, loaded.tried_count) == (man.new_count, man.tried_count)
+    for host, port in added[::7]:
+        assert loaded.info(host, port) == man.info(host, port)
+    data = bytearray(path.read_bytes())
+    data[100] ^= 1
+    path.write_bytes(bytes(data))
+    with pytest.raises(ValueError):
+        loaded.load(path)
+    assert len(loaded) == len(man)
+    sample = man.addresses(max_count=100, now=NOW)
+    assert len(sample) == 100 and len(set(sample)) == 100
+
+
+def test_load_count_overflow(tmp_path) -> None:
+    from src.utils import sha256d
+
+    man = addrman.AddrMan(KEY)
+    fill(man, 1)
+    path = tmp_path / "peers.dat"
+    man.save(path)
+    body = path.read_bytes()[:-4] + bytes(3)
+    # A record count that makes 48 + count * RECORD_SIZE wrap around to the file size.
+    count = (len(body) + 4 - 48) * pow(57, -1, 1 << 64) % (1 << 64)
+    body = body[:36] + count.to_bytes(8, "little") + body[44:]
+    path.write_bytes(body + sha256d(body)[:4])
+    with pytest.raises(ValueError):
+        addrman.AddrMan().load(path)
+
+
+def test_module_instances() -> None:
+    # Multi-phase init: each instance of the extension has its own type.
+    spec = importlib.util.find_spec("src.addrman")
+    other = importlib.util.module_from_spec(spec)
+    spec.loader.exec_module(other)
+    assert other.AddrMan is not addrman.AddrMan
+    man = other.AddrMan(KEY)
+    fill(man, 10)
+    assert len(man) == 10 and not isinstance(man, addrman.AddrMan)
@@ -0,0 +1,64 @@
+import json
+
+import pytest
+
+from src import backends, merkle, reconcile, secp256k1, utils  # noqa: F401
+from src.backends import Capability
+
+
+@pytest.fixture
+def registry(tmp_path, monkeypatch):
+    """A copy of the registry, with nothing selected yet and its own cache."""
+    monkeypatch.setattr(backends, "_registry", {k: dict(v) for k, v in backends._registry.items()})
+    monkeypatch.setattr(backends, "_selected", {})
+    monkeypatch.setattr(backends, "CACHE", tmp_path / "backends.json")
+    return backends
+
+
+@pytest.mark.parametrize("primitive", backends.PRIMITIVES)
+def test_calibrate(registry, primitive) -> None:
+    found = registry.backends(primitive)
+    assert found[0].name == backends.REFERENCE
+    assert all(Capability.NATIVE in b.capabilities for b in found[1:])
+    timings = registry.calibrate(primitive, min_time=0.003)
+    assert timings.keys() == {b.name for b in found} and min(timings.values()) > 0
+    assert registry.selected(primitive).name in timings
+
+
+def test_cache(registry, monkeypatch) -> None:
+    chosen = registry.selected("hash")
+    cache = json.loads(registry.CACHE.read_text())
+    assert cache["choices"][registry.fingerprint("hash")]["backend"] == chosen.name
+
+    # The next process reads the choice instead of calibrating.
+    monkeypatch.setattr(registry, "_selected", {})
+    monkeypatch.setattr(registry, "calibrate", lambda primitive: pytest.fail("calibrated again"))
+    assert registry.select("hash") is chosen.func
+
+    # Another implementation changes the fingerprint, so the choice is made again.
+    registry.register("hash", "fast", lambda data: utils.py_sha256d(data))
+    monkeypatch.setattr(registry, "calibrate", lambda primitive: {"fast": 1.0, chosen.name: 2.0})
+    assert registry.selected("hash").name == "fast"
+    assert len(json.loads(registry.CACHE.read_text())["choices"]) == 2
+
+
+def test_wrong_results(registry) -> None:
+    registry.register("hash", "broken", lambda data: bytes(32))
+    registry.register("hash", "failing", lambda data: 1 / 0)
+    with pytest.warns(RuntimeWarning):
+        timings = registry.calibrate("hash", min_time=0.003)
+        assert registry.selected("hash").name not in ("broken", "failing")
+    assert "broken" not in timings and "failing" not in timings
+    with pytest.raises(ValueError):
+        registry.register("sha512", "python", lambda data: data)
+
+
+def test_unwritable_cache(registry, monkeypatch, tmp_path) -> None:
+    (tmp_path / "file").write_text("")
+    monkeypatch.setattr(registry, "CACHE", tmp_path / "file" / "backends.json")
+    assert registry.select("merkle")([bytes(32)]) == bytes(32)
+
+
+def test_capabilities() -> None:
+    assert Capability.parse("") == Capability.NATIVE
+    assert Capability.parse("releases_gil simd future") == Capability.NATIVE | Capability.RELEASES_GIL | Capability.SIMD
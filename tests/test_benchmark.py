@@ -1 +1,66 @@
-...
\ No newline at end of file
+import json
+
+import pytest
+
+from src import benchmark, secp256k1, utils
+from src.benchmark import BENCHMARKS, CALLS, pure_python, py_measure, run
+
+native = pytest.mark.skipif(benchmark.microbench is None, reason="microbench extension not built")
+
+KEYS = {"iterations", "samples", "median_ns", "p99_ns", "min_ns", "mean_ns", "median_cycles", "p99_cycles", "counter"}
+
+
+def _check(stats: dict, samples: int) -> None:
+    assert stats.keys() == KEYS
+    assert stats["samples"] == samples and stats["iterations"] >= 1
+    assert 0 < stats["min_ns"] <= stats["median_ns"] <= stats["p99_ns"]
+    if stats["median_cycles"] is not None:
+        assert 0 < stats["median_cycles"] <= stats["p99_cycles"]
+
+
+@pytest.mark.parametrize("name", [*BENCHMARKS, *CALLS])
+def test_benchmarks(name: str) -> None:
+    (result,) = run([name], min_time=0.01, samples=3)
+    assert result.name == name
+    _check(result.python, 3)
+    if result.native is not None:
+        _check(result.native, 3)
+        assert result.speedup > 0
+
+
+def test_py_measure() -> None:
+    calls = []
+    stats = py_measure(lambda: calls.append(None), min_time=0.01, samples=5)
+    _check(stats, 5)
+    assert len(calls) >= 5 * stats["iterations"]
+    with pytest.raises(ValueError):
+        py_measure(lambda: None, samples=0)
+    with pytest.raises(ValueError):
+        run(["no_such_benchmark"])
+
+
+def test_pure_python() -> None:
+    native = secp256k1.inverse, secp256k1.public_key, secp256k1.sha256d
+    with pure_python():
+        assert secp256k1.inverse is secp256k1.py_inverse and secp256k1.public_key is secp256k1.py_public_key
+        assert secp256k1.sha256d is utils.py_sha256d
+    assert (secp256k1.inverse, secp256k1.public_key, secp256k1.sha256d) == native
+
+
+@native
+def test_native_harness() -> None:
+    assert set(benchmark.microbench.names()) == set(BENCHMARKS)
+    _check(benchmark.microbench.measure(lambda: None, min_time=0.01, samples=4), 4)
+    with pytest.raises(ZeroDivisionError):
+        benchmark.microbench.measure(lambda: 1 / 0, min_time=0.01)
+    with pytest.raises(ValueError):
+        benchmark.microbench.run("no_such_benchmark")
+
+
+def test_json(tmp_path, capsys) -> None:
+    path = tmp_path / "bench.json"
+    benchmark.main(["siphash_2_4", "invert", "--time", "0.01", "--samples", "3", "--json", str(path)])
+    document = json.loads(path.read_text())
+    assert [r["name"] for r in document["results"]] == ["siphash_2_4", "invert"]
+    benchmark.main(["invert", "--time", "0.01", "--samples", "3"])
+    assert "invert" in capsys.readouterr().out
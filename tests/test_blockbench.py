@@ -0,0 +1,67 @@
+import functools
+import json
+
+import pytest
+
+from src import blockbench
+from src.blockbench import Prepared, main, prepare, run
+
+pytestmark = pytest.mark.skipif(blockbench.validation is None, reason="validation extension not built")
+
+
+@functools.lru_cache(maxsize=None)
+def prepared() -> Prepared:
+    return prepare()
+
+
+def test_connect() -> None:
+    p = prepared()
+    assert p.resigned + p.kept == 6261 and p.kept < 20
+    chainstate = p.chainstate()
+    assert len(chainstate) == len(p.values)
+    result = chainstate.connect(p.block, threads=2)
+    assert set(result["stages"]) == set(blockbench.STAGES)
+    assert result["txs"] == 2711 and result["inputs"] == 6261
+    assert result["skipped"] == p.kept
+    assert result["signatures"] > result["inputs"]  # Multisig inputs have several.
+    assert len(chainstate) == len(p.values)  # Not applied.
+
+
+def test_apply() -> None:
+    p = prepared()
+    chainstate = p.chainstate()
+    chainstate.connect(p.block, apply=True)
+    assert not chainstate.has_coin(p.outpoints[:36])
+    assert len(chainstate) != len(p.values)
+    with pytest.raises(ValueError, match="missing or spent input"):
+        chainstate.connect(p.block)
+
+
+def test_invalid() -> None:
+    p = prepared()
+    with pytest.raises(ValueError, match="merkle root"):
+        p.chainstate().connect(p.block[:36] + bytes(32) + p.block[68:])
+    with pytest.raises(ValueError, match="malformed block"):
+        p.chainstate().connect(p.block[:-1])
+    with pytest.raises(ValueError, match="missing or spent input"):
+        blockbench.validation.Chainstate(p.outpoints[36:], p.values[1:], p.scripts[1:]).connect(p.block)
+    # BIP143 signatures commit to the amount spent.
+    k = next(k for k, script in enumerate(p.scripts) if script[:2] == b"\x00\x14")
+    values = p.values[:k] + [p.values[k] + 1] + p.values[k + 1 :]
+    with pytest.raises(ValueError, match="script verification failed"):
+        blockbench.validation.Chainstate(p.outpoints, values, p.scripts).connect(p.block)
+
+
+def test_run() -> None:
+    (result,) = run(prepared(), threads=(2,), repeat=1)
+    assert result.threads == 2 and result.txs == 2711
+    assert result.total > 0 and result.ns_per_tx == result.total / result.txs * 1e9
+    with pytest.raises(ValueError):
+        run(prepared(), threads=(0,))
+
+
+def test_main(tmp_path) -> None:
+    main(["--threads", "1", "--repeat", "1", "--json", str(tmp_path / "out.json")])
+    document = json.loads((tmp_path / "out.json").read_text())
+    assert document["block"] == "727056.json"
+    assert [r["threads"] for r in document["results"]] == [1]
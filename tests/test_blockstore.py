@@ -0,0 +1,49 @@
+import os
+import struct
+
+from src.blockstore import BlockStore
+from src.network import Message
+from src.utils import sha256d
+
+
+def make_block(n: int, size: int) -> bytes:
+    header = struct.pack("<I32s32s3I", 1, bytes(32), bytes(32), n, 0, n)
+    return header + os.urandom(size)
+
+
+def test_put_get(tmp_path) -> None:
+    blocks = [make_block(i, 1000 * i) for i in range(1, 6)]
+    with BlockStore(tmp_path, max_file_size=5000) as store:
+        hashes = [store.put(block) for block in blocks]
+        assert hashes == [sha256d(block[:80]) for block in blocks]
+        assert [bytes(store.get(h)) for h in hashes] == blocks
+        assert len({store.locate(h).file for h in hashes}) > 1
+        header = store.message_header(hashes[2])
+        assert header + blocks[2] == bytes(Message("block", blocks[2]))
+        # Not parsable, so kept whole without witnesses as well.
+        assert store.message_header(hashes[2], witness=False) == header
+    # The index is reloaded (or rebuilt if missing) when reopening.
+    os.remove(tmp_path / "blk00000.idx")
+    with BlockStore(tmp_path) as store:
+        assert list(store.hashes()) == hashes
+        assert bytes(store.get(hashes[0])) == blocks[0]
+
+
+def test_stripped(tmp_path) -> None:
+    tx = bytes([1]) + bytes(36) + bytes([0]) + bytes(4) + bytes([1]) + bytes(8) + b"\x01\x51"
+    legacy = struct.pack("<I", 2) + tx + bytes(4)
+    segwit = struct.pack("<I", 2) + b"\x00\x01" + tx + b"\x01\x02\xab\xcd" + bytes(4)
+    header = struct.pack("<I32s32s3I", 1, bytes(32), bytes(32), 0, 0, 0)
+    block = header + bytes([3]) + legacy + segwit + segwit
+    stripped = header + bytes([3]) + legacy * 3
+    with BlockStore(tmp_path) as store:
+        legacy_hash = store.put(make_block(1, 0)[:80] + bytes([1]) + legacy)
+        block_hash = store.put(block)
+        assert store.locate(legacy_hash).range_count == 0
+        assert store.get(block_hash, witness=False) == stripped
+        assert store.message_header(block_hash, witness=False) == bytes(Message("block", stripped))[:24]
+    # The runs are listed again when the index is rebuilt.
+    os.remove(tmp_path / "blk00000.rng")
+    with BlockStore(tmp_path) as store:
+        assert store.get(block_hash, witness=False) == stripped
+        assert bytes(store.get(block_hash)) == block
@@ -0,0 +1,87 @@
+import struct
+
+from src.download import RETARGET_INTERVAL, BlockDownloader, HeaderChain, SimulatedPeer, simulate
+from src.header import verify
+from src.utils import sha256d
+
+REGTEST_BITS = 0x207FFFFF
+
+
+def mine(previous: bytes, time: int, bits: int = REGTEST_BITS) -> bytes:
+    for nonce in range(1 << 16):
+        header = struct.pack("<I32s32sIII", 1, previous, bytes(32), time, bits, nonce)
+        if verify(header):
+            return header
+    raise AssertionError
+
+
+def test_header_chain() -> None:
+    genesis = mine(bytes(32), 0)
+    chain = HeaderChain(genesis)
+    headers = [genesis]
+    for i in range(1, 6):
+        headers.append(mine(sha256d(headers[-1]), i))
+        assert chain.add(headers[-1])
+    assert len(chain) == 6 and chain.tip == sha256d(headers[-1])
+    assert not chain.add(mine(bytes.fromhex("11" * 32), 99))  # Does not connect.
+    # A longer fork from height 3 takes over.
+    fork = [headers[3]]
+    for i in range(3):
+        fork.append(mine(sha256d(fork[-1]), 100 + i))
+        assert chain.add(fork[-1])
+    assert chain.tip == sha256d(fork[-1]) and len(chain) == 7
+    assert chain.chain[3] == sha256d(headers[3])
+    # A fork only as long as the best chain does not.
+    assert chain.add(mine(sha256d(headers[-1]), 200)) and chain.tip == sha256d(fork[-1])
+
+
+def test_header_chain_difficulty() -> None:
+    genesis = mine(bytes(32), 0)
+    chain = HeaderChain(genesis)
+    headers = [genesis]
+    # Difficulty only changes at a retarget, and never below the limit.
+    assert not chain.add(mine(sha256d(genesis), 1, 0x203FFFFF))
+    assert not chain.add(mine(sha256d(genesis), 1, 0x2100FFFF))
+    for i in range(1, RETARGET_INTERVAL):
+        headers.append(mine(sha256d(headers[-1]), i))
+        assert chain.add(headers[-1])
+    assert not chain.add(mine(sha256d(headers[-1]), 0, 0x200FFFFF))  # More than 4 times harder.
+    for i in range(3):
+        assert chain.add(mine(chain.tip, RETARGET_INTERVAL + i))
+    # Two headers at 4 times the difficulty are more work than three.
+    fork = mine(sha256d(headers[-1]), 1, 0x20200000)
+    assert chain.add(fork) and chain.add(mine(sha256d(fork), 2, 0x20200000))
+    assert len(chain) == RETARGET_INTERVAL + 2 and chain.chain[-2] == sha256d(fork)
+
+
+def test_in_order_delivery_and_stalls() -> None:
+    hashes = [bytes([i]) * 32 for i in range(20)]
+    validated = []
+    downloader = BlockDownloader(hashes, lambda h, b: validated.append(h), window=8)
+    downloader.add_peer("a")
+    downloader.add_peer("b")
+    requests = downloader.assign(0.0)
+    assert sorted(sum(requests.values(), [])) == hashes[:4]
+    # Blocks arriving ahead of the window head are held back.
+    late = downloader.owner[hashes[0]]
+    other = "b" if late == "a" else "a"
+    for h in requests[other]:
+        downloader.block_received(other, h, b"", 0.5)
+    assert validated == []
+    # The peer holding the head stalls, so its requests go to the other one.
+    downloader.assign(1.0)
+    assert downloader.check_stalls(1.0) == []
+    assert downloader.check_stalls(3.0) == [late]
+    assert hashes[0] in downloader.assign(3.0).get(other, [])
+    downloader.block_received(other, hashes[0], b"", 3.1)
+    assert validated[0] == hashes[0]
+
+
+def test_simulate() -> None:
+    peers = [
+        SimulatedPeer("fast", latency=0.05, bandwidth=10e6),
+        SimulatedPeer("slow", latency=0.2, bandwidth=1e6),
+        SimulatedPeer("lossy", latency=0.1, bandwidth=5e6, drop_rate=0.1),
+    ]
+    result = simulate(peers, blocks=2000, block_size=100_000)
+    assert result["share_fast"] > result["share_slow"]
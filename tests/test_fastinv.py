@@ -0,0 +1,33 @@
+import pytest
+
+from src.secp256k1 import n, p
+
+fastinv = pytest.importorskip("src.fastinv", reason="fastinv extension not built")
+
+
+@pytest.mark.parametrize("modulus", [7, 1_000_003, (1 << 61) - 1, p, n])
+def test_inverse(modulus: int) -> None:
+    for a in (1, 2, 3, modulus - 1, -5, modulus + 4, 1 << 70):
+        assert fastinv.modinv(a, modulus) == pow(a, -1, modulus)
+        assert fastinv.primeinv(a, modulus) == pow(a, -1, modulus)
+    assert fastinv.modinv(4, 8) == fastinv.modinv(6, 1 << 200) == 0  # No inverse.
+    assert fastinv.primeinv(modulus, modulus) == 0
+
+
+def test_modexp() -> None:
+    for g, k, q in [(3, 10**18, (1 << 61) - 1), (-2, 5, 7), (5, 0, 1), (2, 1 << 64, 11), (7, p - 2, p), (3, -1, 7)]:
+        assert fastinv.modexp(g, k, q) == pow(g, k, q)
+
+
+def test_errors() -> None:
+    with pytest.raises(TypeError):
+        fastinv.modinv(3)
+    with pytest.raises(TypeError):
+        fastinv.modexp(3, 2, 7, 1)
+    with pytest.raises(TypeError):
+        fastinv.modinv("3", 7)
+    for modulus in (0, -7, -(1 << 70)):
+        with pytest.raises(ValueError):
+            fastinv.modinv(3, modulus)
+        with pytest.raises(ValueError):
+            fastinv.modexp(3, 2, modulus)
@@ -0,0 +1,47 @@
+import pytest
+
+from src import memory
+
+native = pytest.mark.skipif(
+    memory.validation is None or memory.addrman is None, reason="validation and addrman extensions not built"
+)
+
+
+def test_budget(tmp_path) -> None:
+    assert memory.budget(tmp_path) == (None, None)
+    (tmp_path / "memory.max").write_text("max\n")
+    (tmp_path / "memory.current").write_text("1048576\n")
+    assert memory.budget(tmp_path) == (None, 1 << 20)
+    (tmp_path / "memory.max").write_text("536870912\n")
+    assert memory.budget(tmp_path) == (1 << 29, 1 << 20)
+    v1 = tmp_path / "v1"
+    (v1 / "memory").mkdir(parents=True)
+    (v1 / "memory" / "memory.limit_in_bytes").write_text("9223372036854771712\n")
+    assert memory.budget(v1) == (None, None)
+
+
+@native
+def test_coins() -> None:
+    before = memory.memory_report()["coins"].current
+    memory.reset_peak()
+    outpoints = b"".join(i.to_bytes(36, "little") for i in range(1000))
+    chainstate = memory.validation.Chainstate(outpoints, [1] * 1000, [bytes(100)] * 1000)
+    held = memory.memory_report()["coins"]
+    # Each coin is at least its 36-byte outpoint, its value and a 100-byte script.
+    assert held.current - before > 1000 * 144
+    assert held.peak >= held.current
+    del chainstate
+    after = memory.memory_report()
+    assert after["coins"].current == before
+    assert after["coins"].peak == held.peak
+    assert after["total"].current == sum(u.current for tag, u in after.items() if tag != "total")
+
+
+@native
+def test_addrman() -> None:
+    before = memory.memory_report()["addrman"].current
+    man = memory.addrman.AddrMan(bytes(16))
+    assert memory.memory_report()["addrman"].current > before  # The tables are allocated up front.
+    del man
+    assert memory.memory_report()["addrman"].current == before
+    assert "addrman" in memory.report(memory.memory_report(), limit=1 << 30)
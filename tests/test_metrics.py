@@ -0,0 +1,71 @@
+import pytest
+
+from src import metrics
+from src.metrics import Histogram, Snapshot
+
+native = pytest.mark.skipif(
+    metrics.siphash is None or metrics.fastinv is None or metrics.hashminer is None,
+    reason="extensions not built",
+)
+
+HEADER = bytes(80)
+
+
+def test_percentile() -> None:
+    h = Histogram(100, 100 * 500, 2000, [(100, 50), (1000, 49), (2047, 1)])
+    assert h.mean_ns == 500
+    assert h.percentile(0) == 100
+    assert h.percentile(50) == 100
+    assert h.percentile(90) == 1000
+    assert h.percentile(100) == 2000  # Capped at the largest value seen.
+    assert Histogram(0, 0, 0, []).percentile(99) == 0
+    with pytest.raises(ValueError):
+        h.percentile(101)
+
+
+def test_prometheus(tmp_path) -> None:
+    snap = Snapshot({"sig_verifies": 7}, {"sig_verify": Histogram(3, 3_000_000, 2_000_000, [(900, 2), (2_097_151, 1)])})
+    text = metrics.prometheus(snap)
+    assert "# TYPE pycoin_sig_verifies_total counter\npycoin_sig_verifies_total 7\n" in text
+    assert "# TYPE pycoin_sig_verify_seconds histogram" in text
+    assert 'pycoin_sig_verify_seconds_bucket{le="1e-06"} 2' in text
+    assert 'pycoin_sig_verify_seconds_bucket{le="0.002048"} 2' in text
+    assert 'pycoin_sig_verify_seconds_bucket{le="0.004096"} 3' in text
+    assert 'pycoin_sig_verify_seconds_bucket{le="+Inf"} 3' in text
+    assert "pycoin_sig_verify_seconds_sum 0.003\npycoin_sig_verify_seconds_count 3\n" in text
+    path = tmp_path / "pycoin.prom"
+    metrics.dump(path, snap)
+    assert path.read_text() == text
+    assert [p.name for p in tmp_path.iterdir()] == ["pycoin.prom"]
+
+
+@native
+def test_counters() -> None:
+    metrics.reset()
+    metrics.siphash.short_ids(1, 2, [bytes(32)] * 10)
+    metrics.fastinv.modinv(3, 7)
+    metrics.hashminer.mine(HEADER, 0, 300_000, threads=3)
+    counters = metrics.snapshot().counters
+    assert counters["hashes"] == 300_010
+    assert counters["modular_inverses"] == 1
+    metrics.enable(False)
+    try:
+        metrics.fastinv.modinv(3, 7)
+    finally:
+        metrics.enable(True)
+    assert metrics.snapshot().counters["modular_inverses"] == 1
+    metrics.reset()
+    assert not any(metrics.snapshot().counters.values())
+
+
+@pytest.mark.skipif(
+    metrics.txsign is None or metrics.netcodec is None or metrics.addrcodec is None, reason="extensions not built"
+)
+def test_shared_counters() -> None:
+    metrics.reset()
+    metrics.netcodec.checksum_batch([b"a", b"b", b"c"])
+    metrics.addrcodec.hash160_many(bytes(66), 33)
+    assert metrics.txsign.ecdsa_verify_batch(bytes(4 * 160), bytearray(1)) == 0  # Four invalid records.
+    counters = metrics.snapshot().counters
+    assert counters["hashes"] == 5
+    assert counters["sig_verifies"] == 4 and counters["sig_failures"] == 4
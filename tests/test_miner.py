@@ -1,6 +1,29 @@
+import json
+
+from src import miner
+from src.netsim import EXAMPLE_BLOCKS, header_from_json
+
+GENESIS_NONCE = 2083236893
+
+
 def test_get_target() -> None:
     assert False
 
 
 def test_check_nonce() -> None:
     assert False
+
+
+def _genesis() -> bytes:
+    with open(EXAMPLE_BLOCKS / "genesis.json") as f:
+        return header_from_json(json.load(f))
+
+
+def test_mine() -> None:
+    header = _genesis()
+    assert miner.py_mine(header, GENESIS_NONCE - 5, GENESIS_NONCE + 5) == (GENESIS_NONCE, 6)
+    assert miner.py_mine(header, GENESIS_NONCE + 1, GENESIS_NONCE + 5) == (None, 4)
+    for threads in (1, 3):
+        nonce, hashes = miner.mine(header, GENESIS_NONCE - 200_000, GENESIS_NONCE + 10, threads=threads)
+        assert nonce == GENESIS_NONCE and hashes >= 200_001
+    assert miner.mine(header, 0, 1000, threads=2)[0] is None
@@ -0,0 +1,37 @@
+import json
+
+import pytest
+
+from src.download import HeaderChain
+from src.netsim import EXAMPLE_BLOCKS, block_from_json, ibd_benchmark, relay_benchmark, synthetic_chain
+from src.utils import sha256d
+
+
+def test_block_from_json() -> None:
+    with open(EXAMPLE_BLOCKS / "genesis.json") as f:
+        genesis = json.load(f)
+    block = block_from_json(genesis)
+    assert len(block) == genesis["size"]
+    assert sha256d(block[:80])[::-1].hex() == genesis["hash"]
+
+
+def test_synthetic_chain() -> None:
+    blocks = synthetic_chain(20, [bytes(60)], per_block=3)
+    chain = HeaderChain(blocks[0][:80])
+    assert all(chain.add(block[:80]) for block in blocks[1:])
+    assert len(chain) == 20
+
+
+def test_ibd() -> None:
+    pytest.importorskip("src.peersim")
+    blocks = synthetic_chain(50, [bytes(5000)], per_block=20)
+    stats = ibd_benchmark(blocks, peers=3, latency=0.005, timeout=30)
+    assert stats["validated"] == 49
+    assert stats["blocks_served"] >= 49
+
+
+def test_relay() -> None:
+    pytest.importorskip("src.peersim")
+    stats = relay_benchmark(peers=4, seconds=0.5, inv_rate=20, tx_per_inv=5)
+    assert stats["txs_announced"] > 0
+    assert stats["relayed"] > 0 and stats["latency_p50"] > 0
@@ -0,0 +1,112 @@
+import pytest
+
+from src.network import (
+    HEADER_SIZE,
+    MAGIC,
+    FrameReader,
+    Header,
+    Message,
+    PyFrameReader,
+    checksum,
+    checksums,
+    frame_batch,
+)
+from src.utils import sha256d
+
+
+def test_checksum() -> None:
+    assert checksum(b"") == bytes.fromhex("5df6e0e2")
+    payloads = [bytes(range(n)) for n in range(0, 200, 7)]
+    assert checksums(payloads) == [sha256d(p)[:4] for p in payloads]
+
+
+def test_message_roundtrip() -> None:
+    message = Message("inv", b"\x01" + bytes(36))
+    data = bytes(message)
+    assert len(data) == HEADER_SIZE + 37
+    header = Header.from_bytes(data)
+    assert header == (MAGIC, "inv", 37, sha256d(message.payload)[:4])
+    assert Message.from_bytes(data) == message
+
+
+def test_frame_batch() -> None:
+    messages = [Message("ping", bytes(8)), Message("verack"), Message("tx", bytes(300))]
+    assert frame_batch(messages) == b"".join(map(bytes, messages))
+
+
+def test_frame_reader_dispatch() -> None:
+    for reader_type in {FrameReader, PyFrameReader}:
+        reader = reader_type(MAGIC)
+        received: list[tuple[str, bytes]] = []
+        handlers = {"ping": lambda p: received.append(("ping", bytes(p)))}
+        data = frame_batch([("ping", bytes([i]) * 8) for i in range(5)] + [("pong", bytes(8))])
+        reader.feed(data[:30])  # A partial message is left buffered.
+        assert reader.dispatch(handlers) == 0
+        reader.feed(data[30:])
+        unknown: list[str] = []
+        assert reader.dispatch(handlers, lambda c, p: unknown.append(c)) == 6
+        assert received == [("ping", bytes([i]) * 8) for i in range(5)]
+        assert unknown == ["pong"] and reader.pending == 0
+
+
+@pytest.mark.skipif(FrameReader is PyFrameReader, reason="netcodec is not built")
+def test_frame_reader_payload() -> None:
+    reader = FrameReader(MAGIC)
+    payloads: list = []
+    commands: list[str] = []
+
+    def keep(command, payload) -> None:
+        payloads.append(payload)
+        commands.append(command)
+        assert len(payload) == 8 and payload[0] == 7 and bytes(payload[1:3]) == bytes([7, 7])
+
+    reader.feed(frame_batch([("ping", bytes([7]) * 8), ("junk", bytes([7]) * 8), ("ping", bytes([7]) * 8)]))
+    assert reader.dispatch({}, keep) == 3
+    # One payload object serves every message, and the known command is one string.
+    assert payloads[0] is payloads[1] is payloads[2] and commands[0] is commands[2]
+    assert commands[1] == "junk"
+    with pytest.raises(ValueError):
+        bytes(payloads[0])
+
+    views: list[memoryview] = []
+    reader.feed(bytes(Message("ping", bytes(8))))
+    with pytest.raises(BufferError):
+        reader.dispatch({"ping": lambda p: views.append(memoryview(p))})
+    views[0].release()
+
+
+def test_frame_reader_kept_view() -> None:
+    reader = FrameReader(MAGIC, capacity=64)
+    views: list[memoryview] = []
+
+    def keep(payload) -> None:
+        views.append(memoryview(payload))
+        raise KeyError("handler failed")
+
+    reader.feed(bytes(Message("ping", bytes([5]) * 8)))
+    with pytest.raises(KeyError):
+        reader.dispatch({"ping": keep})
+    # The ring cannot be written, grown or freed while the view is alive.
+    with pytest.raises(BufferError):
+        reader.feed(bytes(1000))
+    with pytest.raises(BufferError):
+        reader.__init__(MAGIC)
+    assert bytes(views[0]) == bytes([5]) * 8
+    views[0].release()
+    reader.feed(bytes(Message("ping", bytes(8))))
+    with pytest.raises(BufferError):
+        reader.dispatch({"ping": lambda p: views.append(memoryview(p))})
+    # Freeing the reader leaves the ring to the view.
+    del reader
+    assert bytes(views[1]) == bytes(8)
+    views[1].release()
+
+
+def test_frame_reader_bad_checksum() -> None:
+    for reader_type in {FrameReader, PyFrameReader}:
+        reader = reader_type(MAGIC)
+        data = bytearray(bytes(Message("ping", bytes(8))))
+        data[-1] ^= 1
+        reader.feed(bytes(data))
+        assert reader.dispatch({"ping": print}) == 0
+        assert reader.bad_checksums == 1
@@ -0,0 +1,188 @@
+import socket
+import threading
+import time
+
+import pytest
+
+from src.node import (
+    MISBEHAVIOR_LIMIT,
+    MISBEHAVIOR_PENALTY,
+    MSG_BLOCK,
+    MSG_WITNESS_BLOCK,
+    Node,
+    strip_witnesses,
+)
+
+
+def test_ping_pong() -> None:
+    pongs: list[bytes] = []
+    done = threading.Event()
+
+    def on_pong(conn: int, payload: bytes) -> None:
+        pongs.append(payload)
+        if len(pongs) == 10:
+            done.set()
+
+    with Node(io_threads=2) as server, Node(io_threads=1) as client:
+        server.on("ping", lambda conn, payload: server.send(conn, "pong", payload))
+        client.on("pong", on_pong)
+        port = server.listen("127.0.0.1", 0)
+        conn = client.connect("127.0.0.1", port)
+        for i in range(10):
+            client.send(conn, "ping", i.to_bytes(8, "little"))
+        assert done.wait(5)
+    assert sorted(pongs) == [i.to_bytes(8, "little") for i in range(10)]
+
+
+def test_serve_blocks(tmp_path) -> None:
+    import os
+    import struct
+
+    from src.blockstore import BlockStore
+
+    blocks: list[bytes] = []
+    done = threading.Event()
+
+    def on_block(conn: int, payload: bytes) -> None:
+        blocks.append(payload)
+        if len(blocks) == 3:
+            done.set()
+
+    with BlockStore(tmp_path) as store, Node() as server, Node() as client:
+        stored = [
+            struct.pack("<I32s32s3I", 1, bytes(32), bytes(32), i, 0, 0) + os.urandom(200_000)
+            for i in range(3)
+        ]
+        hashes = [store.put(block) for block in stored]
+        server.serve_blocks(store)
+        client.on("block", on_block)
+        conn = client.connect("127.0.0.1", server.listen("127.0.0.1", 0))
+        inv = b"".join(struct.pack("<I32s", MSG_WITNESS_BLOCK, h) for h in hashes)
+        client.send(conn, "getdata", bytes([3]) + inv)
+        assert done.wait(5)
+    assert blocks == stored
+
+
+def test_serve_blocks_without_witnesses(tmp_path) -> None:
+    import struct
+
+    from src.blockstore import BlockStore
+
+    body = bytes([1]) + bytes(36) + bytes([0]) + bytes(4) + bytes([1]) + bytes(8) + b"\x01\x51"
+    legacy = struct.pack("<I", 2) + body + bytes(4)
+    segwit = struct.pack("<I", 2) + b"\x00\x01" + body + b"\x01\x02\xab\xcd" + bytes(4)
+    header = struct.pack("<I32s32s3I", 1, bytes(32), bytes(32), 0, 0, 0)
+    block = header + bytes([2]) + segwit + legacy
+    stripped = header + bytes([2]) + legacy + legacy
+    assert strip_witnesses(block) == stripped and strip_witnesses(stripped) == stripped
+
+    blocks: list[bytes] = []
+    done = threading.Event()
+
+    def on_block(conn: int, payload: bytes) -> None:
+        blocks.append(payload)
+        if len(blocks) == 2:
+            done.set()
+
+    with BlockStore(tmp_path) as store, Node() as server, Node() as client:
+        block_hash = store.put(block)
+        assert store.locate(block_hash).stripped_size == len(stripped)
+        assert store.get(block_hash, witness=False) == stripped
+        server.serve_blocks(store)
+        client.on("block", on_block)
+        conn = client.connect("127.0.0.1", server.listen("127.0.0.1", 0))
+        client.send(conn, "getdata", bytes([1]) + struct.pack("<I32s", MSG_BLOCK, block_hash))
+        client.send(conn, "getdata", bytes([1]) + struct.pack("<I32s", MSG_WITNESS_BLOCK, block_hash))
+        assert done.wait(5)
+        with pytest.raises(ValueError):
+            client.loop.send_file(conn, store.fileno(0), 0, 0)  # Nothing to send.
+    assert blocks == [stripped, block]
+
+
+def test_malformed_message(tmp_path) -> None:
+    from src.blockstore import BlockStore
+
+    pongs: list[bytes] = []
+    pong, closed = threading.Event(), threading.Event()
+
+    def on_pong(conn: int, payload: bytes) -> None:
+        pongs.append(payload)
+        pong.set()
+
+    with BlockStore(tmp_path) as store, Node() as server, Node() as client:
+        server.serve_blocks(store)
+        server.on("ping", lambda conn, payload: server.send(conn, "pong", payload))
+        client.on("pong", on_pong)
+        client.on_disconnect = lambda conn, name: closed.set()
+        conn = client.connect("127.0.0.1", server.listen("127.0.0.1", 0))
+        client.send(conn, "getdata", b"\x05" + bytes(10))  # Truncated.
+        client.send(conn, "ping", bytes(8))
+        assert pong.wait(5) and pongs == [bytes(8)]
+        assert list(server.misbehavior.values()) == [MISBEHAVIOR_PENALTY]
+
+        # Enough of them and the peer is dropped.
+        for _ in range(MISBEHAVIOR_LIMIT // MISBEHAVIOR_PENALTY):
+            client.send(conn, "getdata", b"\x05" + bytes(10))
+        assert closed.wait(5)
+
+
+def test_getaddr_answered_once() -> None:
+    addrman = pytest.importorskip("src.addrman")
+
+    replies: list[bytes] = []
+    pong = threading.Event()
+    man = addrman.AddrMan()
+    now = int(time.time())
+    for i in range(1, 11):
+        man.add(f"1.2.3.{i}", 8333, 1, now - 60, "5.6.7.8", now)
+
+    with Node() as server, Node() as client:
+        server.track_addresses(man)
+        server.on("ping", lambda conn, payload: server.send(conn, "pong", payload))
+        client.on("addr", lambda conn, payload: replies.append(payload))
+        client.on("pong", lambda conn, payload: pong.set())
+        conn = client.connect("127.0.0.1", server.listen("127.0.0.1", 0))
+        client.send(conn, "getaddr")
+        client.send(conn, "getaddr")
+        client.send(conn, "ping", bytes(8))
+        assert pong.wait(5)
+    assert len(replies) == 1 and replies[0][0] > 0
+
+
+def test_full_queues() -> None:
+    eventloop = pytest.importorskip("src.eventloop")
+    from src.network import MAGIC, Message
+
+    loop = eventloop.EventLoop(MAGIC, threads=1, inbox=4)
+    ours, theirs = socket.socketpair()
+    conn = loop.add(ours.detach())
+    theirs.sendall(b"".join(bytes(Message("ping", i.to_bytes(8, "little"))) for i in range(100)))
+    time.sleep(0.2)  # The inbox fills up and the I/O thread stops reading.
+    # More sends than the command queue holds: they must not wait on the inbox.
+    for _ in range(20_000):
+        loop.send(conn, b"x")
+    events: list = []
+    deadline = time.monotonic() + 5
+    while len(events) < 101 and time.monotonic() < deadline:
+        events += loop.poll(64, 0.1)
+    assert [payload for _, _, _, payload in events[1:]] == [i.to_bytes(8, "little") for i in range(100)]
+    received = 0
+    while received < 20_000:
+        received += len(theirs.recv(65536))
+    loop.stop()
+    theirs.close()
+
+
+def test_failing_peer_handlers() -> None:
+    pong = threading.Event()
+    with Node() as server, Node() as client:
+        server.on_connect = lambda conn, name: 1 / 0
+        server.on_disconnect = lambda conn, name: 1 / 0
+        server.on("ping", lambda conn, payload: server.send(conn, "pong", payload))
+        client.on("pong", lambda conn, payload: pong.set())
+        port = server.listen("127.0.0.1", 0)
+        first = client.connect("127.0.0.1", port)
+        client.disconnect(first)
+        conn = client.connect("127.0.0.1", port)
+        client.send(conn, "ping", bytes(8))
+        assert pong.wait(5)
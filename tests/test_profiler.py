@@ -0,0 +1,83 @@
+import json
+import threading
+
+import pytest
+
+from src import profiler
+from src.profiler import Event, chrome_trace, collapsed, stacks, zone
+
+native = pytest.mark.skipif(profiler.validation is None, reason="validation extension not built")
+
+# Two threads: block > connect > (parse, scripts > tx > verify) on one, a tx on the other.
+EVENTS = [
+    Event("block", 1, 0, 100_000),
+    Event("connect", 1, 1_000, 98_000),
+    Event("parse", 1, 2_000, 10_000),
+    Event("scripts", 1, 20_000, 70_000),
+    Event("tx", 1, 21_000, 60_000),
+    Event("verify", 1, 22_000, 50_000),
+    Event("tx", 2, 21_000, 40_000),
+]
+
+
+def test_stacks() -> None:
+    assert stacks(EVENTS) == {
+        ("block",): 2_000,
+        ("block", "connect"): 18_000,
+        ("block", "connect", "parse"): 10_000,
+        ("block", "connect", "scripts"): 10_000,
+        ("block", "connect", "scripts", "tx"): 10_000,
+        ("block", "connect", "scripts", "tx", "verify"): 50_000,
+        ("tx",): 40_000,
+    }
+    assert collapsed(EVENTS).splitlines() == [
+        "block 2",
+        "block;connect 18",
+        "block;connect;parse 10",
+        "block;connect;scripts 10",
+        "block;connect;scripts;tx 10",
+        "block;connect;scripts;tx;verify 50",
+        "tx 40",
+    ]
+
+
+def test_chrome_trace() -> None:
+    trace = json.loads(json.dumps(chrome_trace(EVENTS)))["traceEvents"]
+    complete = [e for e in trace if e["ph"] == "X"]
+    assert len(complete) == len(EVENTS)
+    assert complete[1] == {"name": "connect", "ph": "X", "pid": complete[1]["pid"], "tid": 1, "ts": 1.0, "dur": 98.0}
+    assert {e["tid"] for e in trace if e["ph"] == "M"} == {1, 2}
+
+
+def _other() -> None:
+    with zone("other"):
+        pass
+
+
+def test_zone() -> None:
+    with zone("ignored"):
+        pass
+    profiler.start()
+    with zone("outer"):
+        with zone("inner"):
+            pass
+        worker = threading.Thread(target=_other)
+        worker.start()
+        worker.join()
+    profiler.stop()
+    recorded, dropped = profiler.events()
+    assert [e.name for e in recorded if e.thread == threading.get_native_id()] == ["outer", "inner"]
+    assert [e.name for e in recorded if e.thread == worker.native_id] == ["other"]
+    assert dropped == 0
+
+
+@native
+def test_profile_block() -> None:
+    recorded, dropped = profiler.profile_block(threads=2)
+    assert dropped == 0
+    names = {e.name for e in recorded}
+    assert {"block", "connect", "parse", "hash", "scripts", "tx", "sighash", "ecdsa_verify"} <= names
+    # The calling thread and a new one, for each of hashing and the scripts.
+    assert len({e.thread for e in recorded if e.name == "worker"}) == 3
+    totals = {stack[-1]: ns for stack, ns in stacks(recorded).items() if stack[0] == "block"}
+    assert totals["ecdsa_verify"] > totals["sighash"]
@@ -0,0 +1,84 @@
+import os
+import random
+
+import pytest
+
+from src import reconcile
+from src.reconcile import PySketch, ReconciliationState, Sketch, py_siphash, salt_keys, short_ids
+
+K0, K1 = 0x0706050403020100, 0x0F0E0D0C0B0A0908
+
+
+def test_siphash() -> None:
+    # Test vector from the SipHash paper (appendix A).
+    assert py_siphash(K0, K1, bytes(range(15))) == 0xA129CA6149BE45E5
+    wtxids = [os.urandom(32) for _ in range(10)]
+    assert short_ids(K0, K1, wtxids) == [1 + py_siphash(K0, K1, w) % 0xFFFFFFFF for w in wtxids]
+
+
+@pytest.mark.parametrize("cls", [Sketch, PySketch])
+def test_sketch_decode(cls) -> None:
+    rng = random.Random(7)
+    common = [rng.randrange(1, 1 << 32) for _ in range(200)]
+    extra_a = [rng.randrange(1, 1 << 32) for _ in range(6)]
+    extra_b = [rng.randrange(1, 1 << 32) for _ in range(4)]
+    a, b = cls(12), cls(12)
+    a.add_many(common + extra_a)
+    b.add_many(common + extra_b)
+    a.merge(cls(12, b.serialize()))
+    assert sorted(a.decode()) == sorted(extra_a + extra_b)
+    assert a.decode(5) is None
+    full = cls(3)
+    full.add_many(extra_a)
+    assert full.decode() is None
+
+
+def test_native_matches_python() -> None:
+    if reconcile.minisketch is None:
+        pytest.skip("minisketch extension not built")
+    rng = random.Random(3)
+    xs = [rng.randrange(1, 1 << 32) for _ in range(50)]
+    native, python = Sketch(20), PySketch(20)
+    native.add_many(xs)
+    python.add_many(xs)
+    assert native.serialize() == python.serialize()
+
+
+def test_reconciliation() -> None:
+    k0, k1 = salt_keys(1, 2)
+    alice = ReconciliationState(k0, k1, initiator=True)
+    bob = ReconciliationState(k0, k1, initiator=False)
+    common = [os.urandom(32) for _ in range(500)]
+    only_alice = [os.urandom(32) for _ in range(5)]
+    only_bob = [os.urandom(32) for _ in range(3)]
+    alice.add(common + only_alice)
+    bob.add(common + only_bob)
+    diff, to_bob = alice.finish(bob.respond(alice.request()))
+    to_alice = bob.diff(diff)
+    assert sorted(to_bob) == sorted(only_alice)
+    assert sorted(to_alice) == sorted(only_bob)
+    # The sketch is sized for the difference, not the 500 shared transactions.
+    assert alice.sketch_bytes < 4 * 200
+
+
+def test_field() -> None:
+    # x^31 * x = x^32 = x^7 + x^3 + x^2 + 1, as in minisketch.
+    assert reconcile.gf_mul(1 << 31, 2) == 0x8D
+    assert reconcile.gf_mul(0x12345678, reconcile.gf_inv(0x12345678)) == 1
+
+
+def test_reconciliation_limits() -> None:
+    k0, k1 = salt_keys(1, 2)
+    alice = ReconciliationState(k0, k1, initiator=True)
+    bob = ReconciliationState(k0, k1, initiator=False)
+    alice.add([os.urandom(32) for _ in range(3)])
+    bob.add([os.urandom(32) for _ in range(5)])
+    # A difference too big for a sketch (here a claimed 0xFFFF) is flooded.
+    assert bob.respond(b"\xff\xff\xff\xff") == b"\x00"
+    assert bob.diff(b"\x00\x00") and bob.snapshot is None
+    # So is a sketch that is not a whole number of elements, or too big.
+    for sketch in (b"\x05" + bytes(5), b"\x08" + bytes(4), reconcile.int_to_vint(4000) + bytes(4000)):
+        alice.request()
+        diff, announce = alice.finish(sketch)
+        assert diff == b"\x00\x00" and len(announce) == 3
+        alice.add(announce)
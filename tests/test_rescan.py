@@ -0,0 +1,97 @@
+import json
+import struct
+
+import pytest
+
+from src import rescan as rescan_module
+from src.blockstore import BlockStore
+from src.netsim import EXAMPLE_BLOCKS, block_from_json, coinbase, example_transactions, load_example_blocks
+from src.rescan import (
+    PyScanner,
+    build,
+    build_filters,
+    match_any,
+    py_build,
+    py_match_any,
+    py_transactions,
+    rescan,
+    transactions,
+)
+from src.utils import int_to_vint, sha256d
+
+WALLET = b"\x00\x14" + bytes(range(20))
+
+
+def make_tx(outpoint: bytes, outputs: list[tuple[int, bytes]], witness: bool = False) -> bytes:
+    body = int_to_vint(1) + outpoint + int_to_vint(0) + struct.pack("<I", 0xFFFFFFFF)
+    body += int_to_vint(len(outputs))
+    for value, script in outputs:
+        body += struct.pack("<q", value) + int_to_vint(len(script)) + script
+    if witness:
+        return struct.pack("<I", 2) + b"\x00\x01" + body + b"\x01\x02ab" + bytes(4)
+    return struct.pack("<I", 2) + body + bytes(4)
+
+
+def make_block(previous: bytes, txs: list[bytes]) -> bytes:
+    header = struct.pack("<I32s32sIII", 1, previous, bytes(32), 0, 0x207FFFFF, 0)
+    return header + int_to_vint(len(txs)) + b"".join(txs)
+
+
+def test_filters() -> None:
+    # Test vector from BIP158: the testnet genesis block.
+    with open(EXAMPLE_BLOCKS / "genesis.json") as f:
+        block = block_from_json(json.load(f))
+    block = block[:68] + struct.pack("<III", 1296688602, 0x1D00FFFF, 414098458) + block[80:]
+    assert sha256d(block[:80])[::-1].hex() == "000000000933ea01ad0ee984209779baaec3ced90fa3f408719526f8d77f4943"
+    assert build(block).hex() == py_build(block).hex() == "019dfca8"
+    for block in load_example_blocks():
+        txs = transactions(block)
+        assert txs == py_transactions(block)
+        filter, block_hash = build(block), sha256d(block[:80])
+        assert filter == py_build(block)
+        scripts = [script for _, _, outputs in txs for _, script in outputs if script and script[0] != 0x6A]
+        for match in (match_any, py_match_any):
+            assert match(filter, block_hash, scripts[-1:])
+            assert not match(filter, block_hash, [WALLET])
+    with pytest.raises(ValueError):
+        transactions(load_example_blocks()[0][:-1])
+
+
+def test_rescan(tmp_path) -> None:
+    others = example_transactions()
+    funding = make_tx(bytes(36), [(5000, b"\x51"), (1000, WALLET)], witness=True)
+    txid = sha256d(funding[:4] + funding[6:-8] + funding[-4:])
+    spending = make_tx(txid + struct.pack("<I", 1), [(900, b"\x51")])
+    blocks, previous = [], bytes(32)
+    for height in range(10):
+        txs = [coinbase(height)] + others[3 * height : 3 * height + 3]
+        if height == 2:
+            txs.append(funding)
+        if height == 6:
+            txs.append(spending)
+        blocks.append(make_block(previous, txs))
+        previous = sha256d(blocks[-1][:80])
+    with BlockStore(tmp_path) as store:
+        hashes = [store.put(block) for block in blocks]
+        filters = build_filters(store, hashes)
+        result = rescan(store, hashes, filters, [WALLET], threads=2)
+        assert result.blocks == [hashes[2], hashes[6]]
+        assert result.outputs == [rescan_module.Output(hashes[2], txid, 1, 1000, WALLET)]
+        assert [spend[:3] for spend in result.spends] == [(hashes[6], sha256d(spending), 0)]
+        assert result.unspent() == [] and result.balance() == 0
+        # A spend of an outpoint from before the range is found through the
+        # filters, when they are given its script.
+        outpoint = txid + struct.pack("<I", 1)
+        later = build_filters(store, hashes[3:], {outpoint: WALLET})
+        result = rescan(store, hashes[3:], later, [WALLET], [outpoint])
+        assert result.blocks == [hashes[6]] and result.outputs == []
+        assert result.spends == [rescan_module.Spend(hashes[6], sha256d(spending), 0, outpoint)]
+        # Also when it pays to a script that is not being looked for.
+        result = rescan(store, hashes[3:], later, [b"\x51\x52"], {outpoint: WALLET})
+        assert result.blocks == [hashes[6]] and [spend.outpoint for spend in result.spends] == [outpoint]
+        # The fallback scanner finds the same.
+        scanner = PyScanner([WALLET])
+        assert scanner.match(filters, hashes) == [2, 6]
+        assert scanner.scan(store.get(hashes[2]))[0] == [(txid, 1, 1000, WALLET)]
+        assert scanner.scan(store.get(hashes[6]))[1][0][2] == txid + struct.pack("<I", 1)
+        assert scanner.outpoints() == []
@@ -0,0 +1,62 @@
+import json
+
+import pytest
+
+from src import scaling
+from src.scaling import pin_order, sweep
+
+native = pytest.mark.skipif(scaling.microbench is None, reason="microbench extension not built")
+
+
+def _topology(tmp_path, cores: dict[int, int]) -> None:
+    for cpu, core in cores.items():
+        topology = tmp_path / f"cpu{cpu}" / "topology"
+        topology.mkdir(parents=True)
+        (topology / "physical_package_id").write_text("0\n")
+        (topology / "core_id").write_text(f"{core}\n")
+
+
+def test_pin_order(tmp_path, monkeypatch) -> None:
+    # Two cores with two hyperthreads each, numbered like most Intel machines.
+    _topology(tmp_path, {0: 0, 1: 1, 2: 0, 3: 1})
+    monkeypatch.setattr(scaling, "SYS_CPU", tmp_path)
+    assert pin_order("none", [0, 1, 2, 3]) is None
+    assert pin_order("compact", [0, 1, 2, 3]) == [0, 2, 1, 3]
+    assert pin_order("spread", [0, 1, 2, 3]) == [0, 1, 2, 3]
+    assert pin_order("3,1") == [3, 1]
+    with pytest.raises(ValueError):
+        pin_order("everywhere")
+    with pytest.raises(ValueError):
+        pin_order("-1")
+
+
+@native
+@pytest.mark.parametrize("name", scaling.WORKLOADS)
+def test_sweep(name: str) -> None:
+    curve = sweep(name, threads=[1, 2], min_time=0.05, repeat=1, pin="compact")
+    assert curve.name == name and curve.unit
+    assert [p.threads for p in curve.points] == [1, 2]
+    first = curve.points[0]
+    assert first.rate > 0 and first.speedup == 1 and first.efficiency == 1
+    for p in curve.points:
+        assert p.efficiency == pytest.approx(p.speedup / p.threads)
+
+
+@native
+def test_errors() -> None:
+    with pytest.raises(ValueError):
+        sweep("sort")
+    with pytest.raises(ValueError):
+        sweep("mine", threads=[0])
+    with pytest.raises(ValueError):
+        scaling.microbench.scale("mine", threads=1, min_time=0)
+
+
+@native
+def test_main(tmp_path) -> None:
+    path = tmp_path / "out.json"
+    scaling.main(["merkle", "--threads", "1", "--time", "0.05", "--repeat", "1", "--json", str(path)])
+    document = json.loads(path.read_text())
+    assert document["allowed_cpus"] and document["pin_order"] is None
+    (curve,) = document["results"]
+    assert curve["name"] == "merkle" and curve["points"][0]["threads"] == 1
@@ -0,0 +1,53 @@
+import pytest
+
+from src import secp256k1, sigbatch, workers
+from src.sigbatch import SigBatch
+
+
+@pytest.fixture(scope="module")
+def sigs() -> list:
+    # 19 signatures, so the last byte of results is partly used: one bad s, one key at infinity.
+    sigs = secp256k1.generate_sigs(17, workers.Pool("threads", 1))
+    (r, s), pubkey, message = sigs[3]
+    sigs[3] = ((r, s + 1), pubkey, message)
+    return sigs + [((r, s), secp256k1.Point.infinity(), message), sigs[0]]
+
+
+@pytest.fixture(params=["native", "python"])
+def backend(request, monkeypatch):
+    if request.param == "native" and sigbatch.txsign is None:
+        pytest.skip("txsign extension not built")
+    if request.param == "python":
+        monkeypatch.setattr(sigbatch, "txsign", None)
+
+
+EXPECTED = [i not in (3, 17) for i in range(19)]
+
+
+def test_layout(sigs) -> None:
+    with SigBatch.from_params(sigs) as batch:
+        assert len(batch) == 19 and len(batch.records()) == 19 * 160 and len(batch.results()) == 3
+        other = SigBatch.attach(batch.name)
+        assert other.count == 19 and bytes(other.records()) == secp256k1.pack_verify(sigs)
+        other.close()
+    with pytest.raises(FileNotFoundError):
+        SigBatch.attach(batch.name)  # The creator unlinked it.
+
+
+@pytest.mark.parametrize("kind", ["threads", "processes"])
+def test_verify_sigs(sigs, backend, kind) -> None:
+    pool = workers.Pool(kind, 2)
+    with SigBatch.from_params(sigs) as batch:
+        assert secp256k1.verify_sigs(batch, pool) == EXPECTED
+        # Verifying again clears the bits of records that are no longer valid.
+        batch.records()[0] ^= 1
+        assert batch.verify(0, 8) == 6 and batch.valid()[:8] == [False] + EXPECTED[1:8]
+    pool.shutdown()
+
+
+def test_bad_slice(sigs) -> None:
+    if sigbatch.txsign is None:
+        pytest.skip("txsign extension not built")
+    with SigBatch.from_params(sigs) as batch:
+        with pytest.raises(ValueError):
+            batch.verify(3)
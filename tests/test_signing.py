@@ -0,0 +1,157 @@
+import hashlib
+import random
+import struct
+
+import pytest
+
+from src import signing
+from src.address import hash160
+from src.signing import (
+    ecdsa_verify,
+    py_sighashes,
+    py_sign_transaction,
+    schnorr_verify,
+    sighashes,
+    sign_transaction,
+    taproot_output_key,
+)
+from src.utils import int_to_vint, read_vint
+from src.wallet import ExtendedKey, public_key
+
+native = pytest.mark.skipif(signing.txsign is None, reason="txsign extension not built")
+
+# The native P2WPKH example from BIP143 (its first input spends a P2PK
+# output, which only changes its own sighash).
+BIP143_TX = bytes.fromhex(
+    "0100000002fff7f7881a8099afa6940d42d1e7f6362bec38171ea3edf433541db4e4ad969f00000000"
+    "00eeffffffef51e1b804cc89d182d279655c3aa89e815b1b309fe287d9b2b55d57b90ec68a01000000"
+    "00ffffffff02202cb206000000001976a9148280b37df378db99f66f85c95a783a76ac7a6d5988ac90"
+    "93510d000000001976a9143bde42dbee7e4dbe6a21b2d50ce2f0167faa815988ac11000000"
+)
+BIP143_KEY = bytes.fromhex("619c335025c7f4012e556c2a58b2506e30b8511b53ade95ea316fd8c3286feb9")
+BIP143_SCRIPT = bytes.fromhex("00141d0f172a0ecb48aee1be1f2687d2963ae33f71a1")
+
+
+def test_vectors() -> None:
+    # RFC6979 with secp256k1, and the first BIP340 vector.
+    msg = hashlib.sha256(b"Satoshi Nakamoto").digest()
+    sig = signing.ecdsa_sign((1).to_bytes(32, "big"), msg)
+    assert sig == signing.py_ecdsa_sign((1).to_bytes(32, "big"), msg)
+    assert sig.hex() == (
+        "3045022100934b1ea10a4b3c1757e2b0c017d0b6143ce3c9a7e6a4a49860d7a6ab210ee3d8"
+        "02202442ce9d2b916064108014783e923ec36b49743e2ffa1c4496f01a512aafd9e5"
+    )
+    sig = signing.schnorr_sign((3).to_bytes(32, "big"), bytes(32), bytes(32))
+    assert sig == signing.py_schnorr_sign((3).to_bytes(32, "big"), bytes(32), bytes(32))
+    assert sig.hex() == (
+        "e907831f80848d1069a5371b402410364bdf1c5f8307b0084c55f1ce2dca8215"
+        "25f66a4a85ea8b71e482a74f382d2ce5ebeee8fdb2172f477df4900d310536c0"
+    )
+    xonly = bytes.fromhex("f9308a019258c31049344f85f89d5229b531c845836f99b08601f113bce036f9")
+    assert schnorr_verify(xonly, bytes(32), sig)
+    # BIP86: m/86'/0'/0'/0/0 of the "abandon ... about" mnemonic.
+    seed = hashlib.pbkdf2_hmac("sha512", b"abandon " * 11 + b"about", b"mnemonic", 2048)
+    key = ExtendedKey.from_seed(seed).derive("m/86'/0'/0'/0/0").key
+    assert taproot_output_key(key) == signing.py_taproot_output_key(key)
+    assert taproot_output_key(key).hex() == "a60869f0dbcf1dc659c9cecbaf8050135ea9e8cdc487053f1dc6880949dc684c"
+
+
+def test_bip143() -> None:
+    scripts = [BIP143_SCRIPT, BIP143_SCRIPT]
+    amounts = [625000000, 600000000]
+    digests = sighashes(BIP143_TX, amounts, scripts)
+    assert digests == py_sighashes(BIP143_TX, amounts, scripts)
+    assert digests[1].hex() == "c37af31116d1b27caf68aae9e3ac82f1477929014d5b917657d0eb49478cb670"
+    signed = sign_transaction(BIP143_TX, amounts, scripts, [None, BIP143_KEY])
+    assert signed == py_sign_transaction(BIP143_TX, amounts, scripts, [None, BIP143_KEY])
+    # The witness of the second input is the one in BIP143.
+    assert signed.hex().endswith(
+        "000247304402203609e17b84f6a7d30c80bfa610b5b4542f32a8a0d5447a12fb1366d7f01cc44a"
+        "0220573a954c4518331561406f90300e8f3358f51928d43c212a8caed02de67eebee0121025476c2"
+        "e83188368da1ff3e292e7acafcdb3566bb0ad253f62fc70f07aeee635711000000"
+    )
+
+
+def _unsigned(inputs: int, outputs: int, rng: random.Random) -> bytes:
+    tx = struct.pack("<i", 2) + int_to_vint(inputs)
+    for _ in range(inputs):
+        tx += rng.randbytes(32) + struct.pack("<I", rng.randrange(4)) + b"\x00" + struct.pack("<I", 0xFFFFFFFD)
+    tx += int_to_vint(outputs)
+    for _ in range(outputs):
+        tx += struct.pack("<q", rng.randrange(10**8)) + b"\x16\x00\x14" + rng.randbytes(20)
+    return tx + struct.pack("<I", 800000)
+
+
+def _witnesses(signed: bytes, inputs: int) -> list[list[bytes]]:
+    stacks = []
+    # Skip version, marker and flag, the inputs and the outputs.
+    count, pos = read_vint(signed, 6)
+    for _ in range(count):
+        length, pos = read_vint(signed, pos + 36)
+        pos += length + 4
+    count, pos = read_vint(signed, pos)
+    for _ in range(count):
+        length, pos = read_vint(signed, pos + 8)
+        pos += length
+    for _ in range(inputs):
+        items, pos = read_vint(signed, pos)
+        stack = []
+        for _ in range(items):
+            length, pos = read_vint(signed, pos)
+            stack.append(signed[pos : pos + length])
+            pos += length
+        stacks.append(stack)
+    assert pos == len(signed) - 4
+    return stacks
+
+
+def test_sign_transaction() -> None:
+    rng = random.Random(88)
+    count = 12
+    keys = [rng.randbytes(32) for _ in range(count)]
+    taproot = [i % 3 == 0 for i in range(count)]
+    scripts = [
+        b"\x51\x20" + taproot_output_key(key) if tr else b"\x00\x14" + hash160(public_key(key))
+        for key, tr in zip(keys, taproot)
+    ]
+    amounts = [rng.randrange(1, 10**8) for _ in range(count)]
+    tx = _unsigned(count, 3, rng)
+    aux = bytes(range(32))
+    signed = sign_transaction(tx, amounts, scripts, keys, aux=aux, threads=4)
+    assert signed == py_sign_transaction(tx, amounts, scripts, keys, aux=aux)
+    digests = py_sighashes(tx, amounts, scripts)
+    for digest, script, key, stack in zip(digests, scripts, keys, _witnesses(signed, count)):
+        if script[0] == 0x51:
+            assert len(stack) == 1 and schnorr_verify(script[2:], digest, stack[0])
+        else:
+            assert stack[1] == public_key(key) and stack[0][-1] == signing.SIGHASH_ALL
+            assert ecdsa_verify(stack[1], digest, stack[0][:-1])
+    # Without aux, Schnorr signatures differ but stay valid.
+    assert sign_transaction(tx, amounts, scripts, keys) != signed
+
+
+def test_errors() -> None:
+    amounts, scripts = [1, 2], [BIP143_SCRIPT, BIP143_SCRIPT]
+    for sign in (sign_transaction, py_sign_transaction):
+        with pytest.raises(ValueError, match="match the script of input 0"):
+            sign(BIP143_TX, amounts, [b"\x00\x14" + bytes(20), BIP143_SCRIPT], [BIP143_KEY, None])
+        with pytest.raises(ValueError, match="every input"):
+            sign(BIP143_TX, amounts, scripts, [BIP143_KEY])
+        with pytest.raises(ValueError, match="P2WPKH or P2TR"):
+            sign(BIP143_TX, amounts, [BIP143_SCRIPT, b"\x76\xa9"], [None, None])
+        with pytest.raises(ValueError, match="malformed"):
+            sign(BIP143_TX[:-1], amounts, scripts, [None, None])
+        with pytest.raises(ValueError, match="private key"):
+            sign(BIP143_TX, amounts, scripts, [None, bytes(32)])
+
+
+@native
+def test_threads() -> None:
+    rng = random.Random(5)
+    count = 200
+    keys = [rng.randbytes(32) for _ in range(count)]
+    scripts = [b"\x00\x14" + hash160(public_key(key)) for key in keys]
+    amounts = [10**5] * count
+    tx = _unsigned(count, 2, rng)
+    signed = signing.txsign.sign_transaction(tx, amounts, scripts, keys, threads=1)
+    assert signing.txsign.sign_transaction(tx, amounts, scripts, keys, threads=8) == signed
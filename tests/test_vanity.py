@@ -0,0 +1,45 @@
+import pytest
+
+from src import vanity
+from src.address import p2pkh, p2wpkh
+from src.vanity import check_prefix, difficulty, py_search, search
+from src.wallet import public_key
+
+START = (1).to_bytes(32, "big")
+
+
+def test_check_prefix() -> None:
+    check_prefix("1Bit")
+    check_prefix("mz", testnet=True)
+    check_prefix("bc1qxyz", "p2wpkh")
+    check_prefix("bc", "p2wpkh")
+    for prefix, kind in [("1Bil", "p2pkh"), ("3A", "p2pkh"), ("bc1pq", "p2wpkh"), ("bc1qb", "p2wpkh")]:
+        with pytest.raises(ValueError):
+            check_prefix(prefix, kind)
+    assert difficulty("1Bit") == 58**3
+    assert difficulty("bc1qq", "p2wpkh") == 32
+
+
+@pytest.mark.parametrize("kind, prefix", [("p2pkh", "1A"), ("p2wpkh", "bc1qa")])
+def test_py_search(kind: str, prefix: str) -> None:
+    key, address = py_search(prefix, START, kind, batch=16)  # type: ignore
+    encode = p2pkh if kind == "p2pkh" else p2wpkh
+    assert address.startswith(prefix)
+    assert encode(public_key(key)) == address
+    # It is the first match from the start key.
+    for k in range(1, int.from_bytes(key, "big")):
+        assert not encode(public_key(k.to_bytes(32, "big"))).startswith(prefix)
+    assert py_search("1zzz", START, kind, max_keys=20) is None
+
+
+@pytest.mark.skipif(vanity.vanitygen is None, reason="vanitygen extension not built")
+@pytest.mark.parametrize("kind, prefix", [("p2pkh", "1A"), ("p2wpkh", "bc1qa"), ("p2pkh", "1Ab")])
+def test_search(kind: str, prefix: str) -> None:
+    # With one thread the native search finds the same first match.
+    assert vanity.vanitygen.search(prefix, START, kind, 1, batch=7) == py_search(prefix, START, kind)
+    key, address = search(prefix, kind, threads=4)  # type: ignore
+    encode = p2pkh if kind == "p2pkh" else p2wpkh
+    assert address.startswith(prefix) and encode(public_key(key)) == address
+    assert search("1zzzz", max_keys=5000) is None
+    with pytest.raises(ValueError):
+        vanity.vanitygen.search("1A", bytes(32))
@@ -0,0 +1,110 @@
+import random
+from array import array
+
+import pytest
+
+from src import wallet
+from src.address import p2pkh, p2wpkh
+from src.wallet import (
+    ExtendedKey,
+    parse_path,
+    py_derive_private_range,
+    py_derive_public_range,
+    py_select,
+    select_coins,
+)
+
+SEED = bytes.fromhex("000102030405060708090a0b0c0d0e0f")
+
+
+def test_bip32_vector() -> None:
+    # Test vector 1 from BIP32.
+    master = ExtendedKey.from_seed(SEED)
+    assert str(master.public()) == (
+        "xpub661MyMwAqRbcFtXgS5sYJABqqG9YLmC4Q1Rdap9gSE8NqtwybGhePY2gZ29ESFjqJoC"
+        "u1Rupje8YtGqsefD265TMg7usUDFdp6W1EGMcet8"
+    )
+    key = master.derive("m/0'/1/2'/2/1000000000")
+    assert str(key.public()) == (
+        "xpub6H1LXWLaKsWFhvm6RVpEL9P4KfRZSW7abD2ttkWP3SSQvnyA8FSVqNTEcYFgJS2UaFc"
+        "xupHiYkro49S8yGasTvXEYBVPamhGW6cFJodrTHy"
+    )
+    assert ExtendedKey.parse(str(key)) == key
+    # Public derivation agrees with private derivation for normal children.
+    account = master.derive("m/0'/1")
+    assert account.public().derive("2/5") == account.derive("2/5").public()
+    with pytest.raises(ValueError):
+        account.public().child(parse_path("0'")[0])
+
+
+def test_ranges() -> None:
+    account = ExtendedKey.from_seed(SEED).derive("m/84'/0'/0'/0")
+    keys = account.public_keys(0, 40)
+    assert keys == [account.child(i).public_key for i in range(40)]
+    assert account.private_keys(5, 10) == [account.child(i).key for i in range(5, 10)]
+    assert account.public_keys(7, 7) == []
+    assert account.addresses(0, 3) == [p2wpkh(k) for k in keys[:3]]
+    assert account.addresses(3, 5, "p2pkh") == [p2pkh(k) for k in keys[3:5]]
+    pub = account.public_key
+    assert py_derive_public_range(pub, account.chain_code, 0, 5) == b"".join(keys[:5])
+    assert py_derive_private_range(account.key, account.chain_code, 5, 7) == b"".join(
+        account.private_keys(5, 7)
+    )
+
+
+@pytest.mark.skipif(wallet.bip32 is None, reason="bip32 extension not built")
+def test_native_threads() -> None:
+    account = ExtendedKey.from_seed(SEED).derive("m/84'/0'/0'/0")
+    pub, chain_code = account.public_key, account.chain_code
+    single = wallet.bip32.derive_public_range(pub, chain_code, 1000, 4000)
+    assert wallet.bip32.derive_public_range(pub, chain_code, 1000, 4000, threads=3) == single
+    assert single[:33] == account.child(1000).public_key
+    with pytest.raises(ValueError):
+        wallet.bip32.derive_public_range(pub, chain_code, 0x7FFFFFFF, 0x80000001)
+
+
+def check_selection(values, weights, target, fee_rate, selection) -> None:
+    assert len(set(selection.indexes)) == len(selection.indexes)
+    effective = sum(values[i] - -(-weights[i] * fee_rate // 4) for i in selection.indexes)
+    assert effective >= target
+    if selection.algorithm == "bnb":  # No change: at most the cost of change is overpaid.
+        assert effective <= target + 31 + 68
+
+
+@pytest.mark.parametrize("algorithm", ["bnb", "srd", "knapsack", None])
+def test_select_coins(algorithm) -> None:
+    rng = random.Random(1)
+    values = [rng.randint(1000, 10**7) for _ in range(100)]
+    weights = [272] * 100
+    # Targets some subset hits within the cost of change, so BnB has a solution.
+    for subset in [[3], [5, 17], [1, 8, 40, 41, 90]]:
+        target = sum(values[i] - 68 for i in subset) - 50
+        selection = select_coins(values, weights, target, 1.0, 1.0, seed=7, algorithm=algorithm)
+        assert selection is not None and selection.algorithm == (algorithm or selection.algorithm)
+        check_selection(values, weights, target, 1.0, selection)
+        if algorithm == "bnb":  # Deterministic, so the fallback finds the same.
+            fallback = py_select(values, weights, target, 1.0, 1.0, 31, 31 + 68, algorithms=["bnb"])
+            assert fallback == ("bnb", selection.indexes, selection.waste)
+    assert select_coins(values, weights, sum(values), 1.0) is None
+    if algorithm == "bnb":
+        # An exact match (after the input's fee) needs no change and wastes nothing.
+        assert select_coins([5000, 10_068, 7000], [272] * 3, 10_000, 1.0, 1.0, algorithm="bnb") == ("bnb", [1], 0)
+
+
+@pytest.mark.skipif(wallet.coinselect is None, reason="coinselect extension not built")
+def test_select_coins_large() -> None:
+    rng = random.Random(2)
+    values = array("q", (rng.randint(1000, 10**8) for _ in range(100_000)))
+    weights = array("I", (rng.choice([272, 592]) for _ in range(100_000)))
+    selection = select_coins(values, weights, 10**9, 20.0, seed=1)
+    assert selection is not None
+    check_selection(values, weights, 10**9, 20.0, selection)
+
+
+def test_public_key_sparse_keys() -> None:
+    # Keys with zero bytes, which the constant-time table scan must not skip.
+    from src.secp256k1 import n, py_public_key
+
+    for k in (1, 2, 255, 256, 1 << 248, (1 << 248) + 1, 0xFF << 120, n - 1, n - (1 << 64)):
+        key = k.to_bytes(32, "big")
+        assert wallet.public_key(key) == py_public_key(key)
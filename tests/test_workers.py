@@ -0,0 +1,42 @@
+import json
+
+import pytest
+
+from src import miner, secp256k1, workers
+from src.netsim import EXAMPLE_BLOCKS, header_from_json
+
+GENESIS_NONCE = 2083236893
+
+
+@pytest.fixture(scope="module", params=["threads", "processes"])
+def pool(request):
+    # Threads work everywhere, just without a speedup under the GIL.
+    pool = workers.Pool(request.param, 2)
+    yield pool
+    pool.shutdown()
+
+
+def test_split() -> None:
+    assert workers.split(10, 3) == [(0, 4), (4, 7), (7, 10)]
+    assert workers.split(2, 4) == [(0, 1), (1, 2)]
+    assert workers.split(0, 4) == []
+    assert workers.best_kind() in workers.KINDS
+    with pytest.raises(ValueError):
+        workers.Pool("fibers")
+
+
+def test_sigs(pool) -> None:
+    sigs = secp256k1.generate_sigs(6, pool)
+    assert all(secp256k1.verify(*params) for params in sigs)
+    (r, s), pubkey, message = sigs[0]
+    sigs += [((r, s + 1), pubkey, message), ((r, s), secp256k1.Point.infinity(), message)]
+    assert secp256k1.verify_sigs(sigs, pool) == [True] * 6 + [False, False]
+    assert secp256k1.verify_sigs([], pool) == []
+
+
+def test_pool_mine(pool) -> None:
+    with open(EXAMPLE_BLOCKS / "genesis.json") as f:
+        header = header_from_json(json.load(f))
+    nonce, hashes = miner.pool_mine(header, GENESIS_NONCE - 100_000, GENESIS_NONCE + 10, pool)
+    assert nonce == GENESIS_NONCE and hashes >= 100_001
+    assert miner.pool_mine(header, 0, 1000, pool) == (None, 1000)